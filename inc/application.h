@@ -35,6 +35,7 @@
 #include "singleappdialog.h"
 #include "usermessages.h"
 #include "systemtray.h"
+#include "prefetcher.h"
 
 namespace UpdateNode
 {
@@ -66,6 +67,7 @@ namespace UpdateNode
             void setVisible(bool aShown = true);
             void killMeOrNot();
             void afterCheck();
+            void prefetch();
 
         private:
             QString errorCodeToString(int aCode) const;
@@ -74,6 +76,7 @@ namespace UpdateNode
             UserMessages m_oMessageDialog;
             SingleAppDialog m_oSingleDialog;
             MultiAppDialog m_oManageDialog;
+            UpdateNode::Prefetcher m_oPrefetcher;
 
             UpdateNode::SystemTray* m_pSystemTray;
             QSplashScreen m_oSplashScreen;
@@ -0,0 +1,138 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef ARCHIVEEXTRACTOR_H
+#define ARCHIVEEXTRACTOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QMap>
+#include <QFile>
+#include <QTemporaryFile>
+
+#ifdef UPDATENODE_ZLIB
+#include <zlib.h>
+#endif
+
+// a staged extraction of an archive is kept next to it as "<archive>.extracted"
+#define UPDATENODE_EXTRACT_SUFFIX   ".extracted"
+// special command of an update which is extracted by UpdateNode::Commander::extract
+#define UPDATENODE_EXTRACT_COMMAND  "[UN_EXTRACT_COMMAND]"
+// size of a chunk read from an archive, or inflated at once
+#define UPDATENODE_EXTRACT_BUFFER   (256 * 1024)
+// mode of extracted files without permissions in the archive, before the umask is applied
+#define UPDATENODE_EXTRACT_MODE     0644
+
+namespace UpdateNode
+{
+    class ArchiveExtractor
+    {
+        public:
+            enum Format { FORMAT_UNKNOWN = 0, FORMAT_TAR, FORMAT_TAR_GZ, FORMAT_ZIP };
+
+        public:
+            ArchiveExtractor(const QString& aTarget);
+            ~ArchiveExtractor();
+
+        public:
+            bool write(const QByteArray& aData);
+            bool finish();
+            void abort();
+            bool extractFile(const QString& aArchive);
+
+            QString target() const;
+            Format format() const;
+            int entries() const;
+            QString errorString() const;
+
+        public:
+            static bool isSupported(Format aFormat);
+            static bool isSafePath(const QString& aPath);
+            static QString stagingDir(const QString& aArchive);
+            static bool commitStaged(const QString& aStaging, const QString& aTarget, bool aMove);
+            static bool removeTree(const QString& aPath);
+
+        private:
+            enum State { STATE_HEADER = 0, STATE_DATA, STATE_SKIP, STATE_DESCRIPTOR, STATE_END };
+
+        private:
+            bool detect();
+            bool feed(const QByteArray& aData);
+            bool inflateInput(const QByteArray& aData);
+            bool processTar();
+            bool processZip();
+            bool readTarHeader(const QByteArray& aHeader);
+            void readTarMeta();
+            bool readZipHeader();
+            bool readZipData();
+            bool readZipDescriptor();
+            bool readZipSkip();
+            void readCentralDirectory();
+            void append(const char* aData, qint64 aSize);
+            int available() const;
+            const char* current() const;
+            QByteArray& output();
+            void discardEntry();
+            bool openEntry(const QString& aName);
+            bool writeEntry(const char* aData, qint64 aSize);
+            bool closeEntry();
+            bool fail(const QString& aError);
+            static qint64 tarNumber(const QByteArray& aField);
+            static QString tarString(const QByteArray& aField);
+            static quint32 littleEndian(const QByteArray& aData, int aOffset, int aSize);
+            static void applyMode(const QString& aFile, quint32 aMode);
+            static quint32 defaultMode();
+
+        private:
+            QString m_strTarget;
+            QString m_strError;
+            QString m_strLongName;
+            QString m_strEntry;
+            Format m_eFormat;
+            State m_eState;
+            QByteArray m_oInput;
+            QByteArray m_oBuffer;
+            QByteArray m_oMeta;
+            QByteArray m_oOutput;
+            QTemporaryFile* m_pFile;
+            QMap<QString, QString> m_mapFiles;
+            int m_iPosition;
+            qint64 m_iRemaining;
+            qint64 m_iPadding;
+            quint32 m_iMode;
+            quint32 m_iCrc;
+            quint32 m_iExpectedCrc;
+            int m_iEntries;
+            int m_iMethod;
+            int m_iMeta;
+            bool m_bDescriptor;
+            bool m_bFailed;
+#ifdef UPDATENODE_ZLIB
+            z_stream m_oGzip;
+            z_stream m_oInflate;
+            bool m_bGzip;
+            bool m_bInflate;
+#endif
+    };
+}
+#endif // ARCHIVEEXTRACTOR_H
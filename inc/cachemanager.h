@@ -0,0 +1,60 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef CACHEMANAGER_H
+#define CACHEMANAGER_H
+
+#include <QString>
+#include <QSettings>
+#include <QUrl>
+
+#define UPDATENODE_CACHE_INDEX "index.ini"
+
+namespace UpdateNode
+{
+    class CacheManager
+    {
+        public:
+            CacheManager();
+
+        public:
+            QString store(const QString& aFileName, const QString& aHash, const QUrl& aUrl, const QString& aCode);
+            QString find(const QString& aHash);
+            QString findByUrl(const QUrl& aUrl);
+
+            void use(const QString& aHash, const QString& aCode);
+            void unpin(const QString& aCode);
+            bool isPinned(const QString& aHash);
+
+            qint64 size();
+            void evict(qint64 aQuota);
+
+        private:
+            QString blobFile(const QString& aHash);
+            QString pinId(const QString& aCode) const;
+            void remove(const QString& aHash);
+
+        private:
+            QSettings m_oIndex;
+    };
+}
+#endif // CACHEMANAGER_H
@@ -44,12 +44,15 @@ namespace UpdateNode
             void setUpdate(const UpdateNode::Update& aUpdate);
             QString resolve(const QString& aString);
 
+            void setElevatedHelper(bool aHelper);
+
             bool waitForFinished();
             int getReturnCode();
 
         public:
             static QString resolveGeneral(const QString& aString);
             static bool copy(const QString& aFrom, const QString& aTo);
+            static bool extract(const QString& aArchive, const QString& aTarget);
             static QStringList splitCommandLine(const QString& aString);
 
         signals:
@@ -58,8 +61,13 @@ namespace UpdateNode
             void updateExit(int aExitCode, QProcess::ExitStatus aExitStatus);
             void progressText(const QString& aStatusText);
 
+        private slots:
+            void helperOutput(int aRequest, const QByteArray& aData, bool aError);
+            void helperFinished(int aRequest, int aExitCode, QProcess::ExitStatus aExitStatus);
+
         private:
             QString setCommandBasedOnOS() const;
+            void connectHelper();
             static bool isProcessElevated();
 
 
@@ -67,6 +75,11 @@ namespace UpdateNode
             QProcess* m_pProcess;
             UpdateNode::Update m_oUpdate;
             bool m_bCopy;
+            bool m_bExtract;
+            bool m_bHelper;
+            int m_iHelperRequest;
+            mutable QByteArray m_oHelperStdOut;
+            mutable QByteArray m_oHelperStdErr;
     };
 }
 
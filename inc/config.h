@@ -24,6 +24,7 @@
 #define CONFIG_H
 
 #include <QString>
+#include <QStringList>
 #include <QList>
 
 #include "product.h"
@@ -110,6 +111,37 @@ namespace UpdateNode
             void setTimeOut(int aTimeOutInSeconds);
             int getTimeOut();
 
+            void setSegments(int aSegments);
+            int getSegments();
+
+            void setCacheQuota(qint64 aBytes);
+            qint64 getCacheQuota();
+
+            void setConcurrentDownloads(int aDownloads);
+            int getConcurrentDownloads();
+
+            void setConcurrentInstalls(int aInstalls);
+            int getConcurrentInstalls();
+
+            void setResponseTtl(int aSeconds);
+            int getResponseTtl();
+
+            void setAlternateHost(const QString& aHost);
+            QString getAlternateHost();
+
+            void setDeltaSync(bool aEnable);
+            bool isDeltaSync();
+
+            void setRateLimit(int aBytesPerSecond);
+            int getRateLimit();
+
+            void setBackground(bool aBackground);
+            bool isBackground();
+
+            void setMirrorRewrites(const QStringList& aRules);
+            void addMirrorRewrite(const QString& aRule);
+            QStringList getMirrorRewrites();
+
             void setIdentifier(const QString& aIdent);
             QString getIdentifier();
 
@@ -130,9 +162,12 @@ namespace UpdateNode
             bool m_bSingleMode;
             bool m_bRelaunch;
             bool m_bEnforeMessages;
+            bool m_bDeltaSync;
+            bool m_bBackground;
 
             QString m_strIdentifier;
             QString m_strHost;
+            QString m_strAlternateHost;
             QString m_strMainIcon;
             QString m_strKey;
             QString m_strTestKey;
@@ -145,7 +180,14 @@ namespace UpdateNode
             QString m_strSplashImage;
             QString m_strStyleSheet;
             QString m_strCustomRequestValue;
+            QStringList m_listMirrorRewrites;
             int     m_iTimeOut;
+            int     m_iSegments;
+            qint64  m_iCacheQuota;
+            int     m_iConcurrentDownloads;
+            int     m_iConcurrentInstalls;
+            int     m_iResponseTtl;
+            int     m_iRateLimit;
 
             UpdateNode::Product m_oProduct;
             UpdateNode::ProductVersion m_oCurrentVersion;
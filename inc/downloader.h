@@ -27,7 +27,6 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QList>
-#include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QSslError>
@@ -35,10 +34,20 @@
 #include <QTimer>
 #include <QUrl>
 #include <QMap>
+#include <QElapsedTimer>
 
 #include <stdio.h>
 
 #include "update.h"
+#include "partfile.h"
+#include "networksession.h"
+#include "segmenteddownload.h"
+#include "mirrorprobe.h"
+#include "archiveextractor.h"
+
+#define UPDATENODE_DOWNLOAD_BUFFER_SIZE (256 * 1024)
+#define UPDATENODE_PROGRESS_RANGE       10000
+#define UPDATENODE_RESUME_CHECKPOINT    (4 * 1024 * 1024)
 
 namespace UpdateNode
 {
@@ -49,6 +58,7 @@ namespace UpdateNode
 
          public:
              Downloader();
+             ~Downloader();
 
         public:
              void doDownload(const QUrl& url, const QString& aFileName);
@@ -61,7 +71,16 @@ namespace UpdateNode
          public slots:
              void downloadFinished(QNetworkReply *reply);
              void downloadFileFinished(QNetworkReply *reply);
-             void onSslError(QNetworkReply *reply, const QList<QSslError>& errors);
+             void downloadReadyRead();
+             void saveProgress();
+             void segmentedFinished(QNetworkReply::NetworkError aError, const QString& aErrorString);
+             void segmentedUnsupported();
+             void mirrorsProbed(const QList<QUrl>& aRanked);
+
+         private slots:
+             void replyFinished();
+             void fileReplyFinished();
+             void stalled();
 
         signals:
              void done(QByteArray array, const QString& fileName);
@@ -69,9 +88,32 @@ namespace UpdateNode
              void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
 
         private:
-             QNetworkAccessManager m_oManager;
+             QNetworkReply* doFullDownload(const QUrl& url, const UpdateNode::Update& aUpdate);
+             QNetworkReply* doStreamDownload(const QUrl& url, const UpdateNode::Update& aUpdate, const QString& aPatchBase = QString());
+             void doSegmentedDownload(const QUrl& url, const UpdateNode::Update& aUpdate);
+             QNetworkReply* startFullDownload(QList<QUrl> aMirrors, const UpdateNode::Update& aUpdate);
+             void watch(QNetworkReply* reply, const QList<QUrl>& aMirrors);
+             void storeFile(const QString& aCode, const QUrl& url, const QString& aFileName, const QString& aHash);
+             bool applyPatch(const UpdateNode::Update& aUpdate, const QString& aBase, const QString& aPatchFile);
+             bool startWriting(QNetworkReply* reply, UpdateNode::PartFile* part);
+             void checkpoint(QNetworkReply* reply, UpdateNode::PartFile* part);
+             void extract(QNetworkReply* reply, const QByteArray& aData);
+             void finishExtraction(QNetworkReply* reply, const QByteArray& aData, const QString& aArchive);
+             void discardExtraction(QNetworkReply* reply);
+             static bool isResumable(QNetworkReply* reply);
+
+        private:
              QMap<QNetworkReply*, UpdateNode::Update> m_oCurrentDownloads;
              QMap<QNetworkReply*, QString> m_oCurrentFileDownloads;
+             QMap<QNetworkReply*, UpdateNode::PartFile*> m_oPartFiles;
+             QMap<QNetworkReply*, qint64> m_oRequestedOffsets;
+             QMap<QNetworkReply*, QString> m_oPatchBases;
+             QMap<QNetworkReply*, UpdateNode::ArchiveExtractor*> m_oExtractors;
+             QMap<UpdateNode::SegmentedDownload*, UpdateNode::Update> m_oSegmentedDownloads;
+             QMap<UpdateNode::MirrorProbe*, UpdateNode::Update> m_oProbes;
+             QMap<QNetworkReply*, QList<QUrl> > m_oMirrors;
+             QMap<QNetworkReply*, QTimer*> m_oStallTimers;
+             QMap<QNetworkReply*, QElapsedTimer> m_oStarted;
      };
 
 
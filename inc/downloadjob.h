@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef DOWNLOADJOB_H
+#define DOWNLOADJOB_H
+
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QNetworkReply>
+
+#include "update.h"
+
+namespace UpdateNode
+{
+    class DownloadJob : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            DownloadJob(const UpdateNode::Update& aUpdate, int aPriority, QObject* parent = 0);
+
+            enum State { QUEUED = 0, RUNNING, PAUSED, FINISHED, FAILED, CANCELED };
+
+        public:
+            UpdateNode::Update update() const;
+            QUrl url() const;
+            int priority() const;
+
+            State state() const;
+            bool isActive() const;
+            void setState(State aState);
+
+            int retries() const;
+            void retry();
+
+            QNetworkReply::NetworkError error() const;
+            QString errorString() const;
+            void setError(QNetworkReply::NetworkError aError, const QString& aErrorString);
+
+            qint64 bytesReceived() const;
+            qint64 bytesTotal() const;
+
+            static bool isTransient(QNetworkReply::NetworkError aError);
+
+        public slots:
+            void setProgress(qint64 aBytesReceived, qint64 aBytesTotal);
+
+        signals:
+            void stateChanged(UpdateNode::DownloadJob* aJob);
+            void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+            void finished(UpdateNode::DownloadJob* aJob);
+
+        private:
+            UpdateNode::Update m_oUpdate;
+            State m_eState;
+            QNetworkReply::NetworkError m_eError;
+            QString m_strError;
+            qint64 m_iReceived;
+            qint64 m_iTotal;
+            int m_iPriority;
+            int m_iRetries;
+    };
+}
+#endif // DOWNLOADJOB_H
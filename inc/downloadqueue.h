@@ -0,0 +1,87 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef DOWNLOADQUEUE_H
+#define DOWNLOADQUEUE_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QNetworkReply>
+
+#include "update.h"
+#include "downloader.h"
+#include "downloadjob.h"
+
+#define UPDATENODE_DOWNLOAD_RETRIES     2
+
+namespace UpdateNode
+{
+    class DownloadQueue : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit DownloadQueue(QObject* parent = 0);
+            ~DownloadQueue();
+
+        public:
+            UpdateNode::DownloadJob* enqueue(const UpdateNode::Update& aUpdate, int aPriority = 0);
+
+            void setConcurrency(int aJobs);
+            int concurrency() const;
+            void setMaxRetries(int aRetries);
+
+            void pause(UpdateNode::DownloadJob* aJob);
+            void resume(UpdateNode::DownloadJob* aJob);
+            void cancel(UpdateNode::DownloadJob* aJob);
+            void cancelAll();
+
+            bool isBusy() const;
+            int running() const;
+            QList<UpdateNode::DownloadJob*> jobs() const;
+
+        private slots:
+            void schedule();
+            void downloaderDone(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString);
+
+        signals:
+            void jobStarted(UpdateNode::DownloadJob* aJob);
+            void jobFinished(UpdateNode::DownloadJob* aJob);
+            void done(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString);
+            void allDone();
+
+        private:
+            void start(UpdateNode::DownloadJob* aJob);
+            void stop(UpdateNode::DownloadJob* aJob, UpdateNode::DownloadJob::State aState);
+            void finish(UpdateNode::DownloadJob* aJob);
+            UpdateNode::DownloadJob* next() const;
+
+        private:
+            QList<UpdateNode::DownloadJob*> m_listJobs;
+            QMap<UpdateNode::DownloadJob*, UpdateNode::Downloader*> m_mapDownloaders;
+            int m_iConcurrency;
+            int m_iMaxRetries;
+            bool m_bScheduled;
+    };
+}
+#endif // DOWNLOADQUEUE_H
@@ -0,0 +1,106 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef ELEVATEDHELPER_H
+#define ELEVATEDHELPER_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QByteArray>
+#include <QStringList>
+#include <QProcess>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+// command line argument, which starts unclient as elevated helper
+#define UPDATENODE_HELPER_ARGUMENT      "-helper"
+// maximum size of a message between the client and the helper
+#define UPDATENODE_HELPER_MAX_MESSAGE   (16 * 1024 * 1024)
+
+// the helper is elevated with gksudo, kdesudo or pkexec, see Commander::setCommandBasedOnOS
+#ifdef Q_OS_LINUX
+#define UPDATENODE_HELPER_SUPPORTED
+#endif
+
+namespace UpdateNode
+{
+    class ElevatedHelper : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            enum Message { MSG_HELLO = 1, MSG_RUN = 2, MSG_STDOUT = 3, MSG_STDERR = 4, MSG_FINISHED = 5, MSG_COPY = 6, MSG_CHMOD = 7, MSG_EXTRACT = 8 };
+
+        public:
+            explicit ElevatedHelper();
+            ~ElevatedHelper();
+
+        public:
+            static ElevatedHelper* m_pInstance;
+            static ElevatedHelper* Instance();
+
+        public:
+            bool start(const QString& aElevator);
+            bool isRunning() const;
+            int run(const QString& aCommand, const QStringList& aArguments, const QString& aWorkingDir);
+            int copy(const QString& aFrom, const QString& aTo);
+            int chmod(const QString& aFile, QFile::Permissions aPermissions);
+            int extract(const QString& aArchive, const QString& aTarget);
+
+        public:
+            static void send(QLocalSocket* aSocket, const QByteArray& aMessage);
+            static bool receive(QLocalSocket* aSocket, QByteArray& aMessage);
+
+        signals:
+            void output(int aRequest, const QByteArray& aData, bool aError);
+            void finished(int aRequest, int aExitCode, QProcess::ExitStatus aExitStatus);
+
+        private slots:
+            void newConnection();
+            void readMessages();
+            void helperExit();
+            void helperDisconnected();
+
+        private:
+            QStringList elevatorArguments(const QString& aElevator) const;
+            int request(Message aType, const QByteArray& aPayload);
+            void failAll();
+            void stopListening();
+            static bool isElevated(QLocalSocket* aSocket);
+
+        private:
+            QLocalServer* m_pServer;
+            QLocalSocket* m_pSocket;
+            QProcess* m_pElevator;
+            QString m_strToken;
+            QTemporaryFile* m_pTokenFile;
+            QString m_strSocketDir;
+            QList<QByteArray> m_listPending;
+            QList<int> m_listRequests;
+            int m_iNextRequest;
+            bool m_bFailed;
+    };
+}
+#endif // ELEVATEDHELPER_H
@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef FILECOPIER_H
+#define FILECOPIER_H
+
+#include <QString>
+#include <QFile>
+
+// size of a chunk copied at once by the buffered strategy
+#define UPDATENODE_COPY_BUFFER  (1024 * 1024)
+
+namespace UpdateNode
+{
+    class FileCopier
+    {
+        public:
+            enum Strategy { STRATEGY_AUTO = 0, STRATEGY_CLONE, STRATEGY_COPY_RANGE, STRATEGY_SENDFILE, STRATEGY_BUFFERED };
+
+        public:
+            FileCopier(const QString& aFrom, const QString& aTo);
+
+        public:
+            bool copy(Strategy aStrategy = STRATEGY_AUTO);
+
+            Strategy strategy() const;
+            QString errorString() const;
+
+        public:
+            static bool isSupported(Strategy aStrategy);
+            static QString strategyName(Strategy aStrategy);
+
+        private:
+            bool copyWith(Strategy aStrategy, QFile& aSource, QFile& aTarget, qint64 aSize);
+            bool clone(QFile& aSource, QFile& aTarget);
+            bool copyRange(QFile& aSource, QFile& aTarget, qint64 aSize);
+            bool sendFile(QFile& aSource, QFile& aTarget, qint64 aSize);
+            bool buffered(QFile& aSource, QFile& aTarget, qint64 aSize);
+            bool rewind(QFile& aTarget);
+            void setSystemError(const QString& aAction);
+
+        private:
+            QString m_strFrom;
+            QString m_strTo;
+            QString m_strError;
+            Strategy m_eStrategy;
+    };
+}
+#endif // FILECOPIER_H
@@ -0,0 +1,74 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef HELPERSESSION_H
+#define HELPERSESSION_H
+
+#include <QObject>
+#include <QMap>
+#include <QProcess>
+#include <QLocalSocket>
+#include <QTimer>
+
+#define UPDATENODE_HELPER_CONNECT_TIMEOUT   10000
+// the helper quits after this many milliseconds without any operation
+#define UPDATENODE_HELPER_IDLE_TIMEOUT      (1000 * 60 * 10)
+
+namespace UpdateNode
+{
+    class HelperSession : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit HelperSession(QObject* parent = 0);
+            ~HelperSession();
+
+        public:
+            bool connectToClient(const QString& aServer, const QString& aToken);
+            void setIdleTimeout(int aMsec);
+
+        signals:
+            void finished();
+
+        private slots:
+            void readMessages();
+            void disconnected();
+            void idle();
+            void processOutput();
+            void processError();
+            void processExit(int aExitCode, QProcess::ExitStatus aExitStatus);
+
+        private:
+            void run(int aRequest, const QString& aCommand, const QStringList& aArguments, const QString& aWorkingDir);
+            void send(int aType, int aRequest, const QByteArray& aData);
+            void sendExit(int aRequest, int aExitCode, QProcess::ExitStatus aExitStatus);
+            void quitWhenIdle();
+
+        private:
+            QLocalSocket m_oSocket;
+            QMap<QProcess*, int> m_mapProcesses;
+            QTimer m_oIdleTimer;
+            bool m_bQuitting;
+    };
+}
+#endif // HELPERSESSION_H
@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef INSTALLSCHEDULER_H
+#define INSTALLSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QProcess>
+
+#include "update.h"
+#include "commander.h"
+
+namespace UpdateNode
+{
+    class InstallScheduler : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit InstallScheduler(QObject* parent = 0);
+            ~InstallScheduler();
+
+        public:
+            int add(const UpdateNode::Update& aUpdate, const QString& aGroup);
+            void setReady(int aInstall);
+            void stop();
+
+            void setConcurrency(int aInstalls);
+            int concurrency() const;
+            void setElevatedHelper(bool aHelper);
+
+            bool isBusy() const;
+            int running() const;
+            UpdateNode::Update update(int aInstall) const;
+
+        private slots:
+            void schedule();
+            void commanderExit(int aExitCode, QProcess::ExitStatus aExitStatus);
+            void commanderOutput();
+            void commanderError();
+
+        signals:
+            void started(int aInstall);
+            void output(int aInstall, const QString& aText, bool aError);
+            void finished(int aInstall, int aExitCode, QProcess::ExitStatus aExitStatus);
+            void failedToStart(int aInstall);
+
+        private:
+            struct Install
+            {
+                int m_iId;
+                UpdateNode::Update m_oUpdate;
+                QString m_strGroup;
+                bool m_bReady;
+                UpdateNode::Commander* m_pCommander;
+            };
+
+            int indexOf(int aInstall) const;
+            int indexOf(UpdateNode::Commander* aCommander) const;
+            bool isStartable(int aIndex) const;
+            void start(int aIndex);
+            void scheduleLater();
+
+        private:
+            QList<Install> m_listInstalls;
+            int m_iConcurrency;
+            int m_iNextId;
+            bool m_bHelper;
+            bool m_bScheduled;
+    };
+}
+#endif // INSTALLSCHEDULER_H
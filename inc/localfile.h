@@ -24,6 +24,7 @@
 #define LOCALFILE_H
 
 #include <QString>
+#include "update.h"
 
 namespace UpdateNode
 {
@@ -33,6 +34,9 @@ namespace UpdateNode
             static QString getDownloadLocation(const QString& aFileName);
             static QString getDownloadPath();
             static QString getCachePath();
+            static QString getBlobPath();
+            static QString getResponsePath();
+            static QString getUpdateLocation(const UpdateNode::Update& aUpdate);
 
     };
 }
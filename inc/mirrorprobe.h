@@ -0,0 +1,71 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef MIRRORPROBE_H
+#define MIRRORPROBE_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QUrl>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QNetworkReply>
+
+// the first bytes of the file requested from each mirror to measure its throughput
+#define UPDATENODE_MIRROR_PROBE_SIZE    (64 * 1024)
+#define UPDATENODE_MIRROR_PROBE_TIMEOUT 3000
+
+namespace UpdateNode
+{
+    class MirrorProbe : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            MirrorProbe(const QList<QUrl>& aCandidates, QObject* parent = 0);
+            ~MirrorProbe();
+
+        public:
+            void start();
+            void abort();
+            QList<QUrl> candidates() const;
+
+        signals:
+            void finished(const QList<QUrl>& aRanked);
+
+        private slots:
+            void probeFinished();
+            void timeout();
+
+        private:
+            void measure(QNetworkReply* aReply);
+            void finish();
+
+        private:
+            QList<QUrl> m_listCandidates;
+            QMap<QNetworkReply*, QUrl> m_mapProbes;
+            QElapsedTimer m_oElapsed;
+            QTimer m_oTimeout;
+    };
+}
+#endif // MIRRORPROBE_H
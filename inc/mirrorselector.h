@@ -0,0 +1,74 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef MIRRORSELECTOR_H
+#define MIRRORSELECTOR_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QUrl>
+#include <QStringList>
+
+// a download which does not receive any data for this many milliseconds switches to the next mirror
+#define UPDATENODE_MIRROR_STALL         5000
+// weight of the latest throughput of a mirror in its stored throughput
+#define UPDATENODE_MIRROR_SMOOTHING     0.5
+// number of mirrors whose throughput is stored for the next runs
+#define UPDATENODE_MIRROR_MAXIMUM       32
+
+namespace UpdateNode
+{
+    class MirrorSelector : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit MirrorSelector();
+
+        public:
+            static MirrorSelector* m_pInstance;
+            static MirrorSelector* Instance();
+
+        public:
+            QList<QUrl> candidates(const QUrl& aUrl, const QStringList& aMirrors) const;
+            QUrl rewrite(const QUrl& aUrl) const;
+            QList<QUrl> rank(const QList<QUrl>& aCandidates) const;
+            bool isKnown(const QUrl& aUrl) const;
+
+            double throughput(const QUrl& aUrl) const;
+            void addThroughput(const QUrl& aUrl, double aBytesPerSecond);
+
+            static QString key(const QUrl& aUrl);
+
+        public slots:
+            void save();
+
+        private:
+            void load();
+
+        private:
+            QMap<QString, double> m_mapThroughput;
+            QStringList m_listRecent;
+    };
+}
+#endif // MIRRORSELECTOR_H
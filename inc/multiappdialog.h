@@ -24,11 +24,17 @@
 #define DIALOG_H
 
 #include <QDialog>
+#include <QMap>
 #include <QProcess>
 #include <QTextEdit>
 #include <QTreeWidgetItem>
 #include "updatenode_service.h"
-#include "commander.h"
+#include "installscheduler.h"
+#include "downloadqueue.h"
+#include "transferstats.h"
+
+// number of updates, which are downloaded ahead while an installer is running
+#define UPDATENODE_PIPELINE_WINDOW 2
 
 namespace Ui
 {
@@ -46,7 +52,10 @@ class MultiAppDialog : public QDialog
         void initView();
 
     private:
-        void install();
+        void fillPipeline();
+        void showWaiting();
+        void stopPipeline(const QString& aError);
+        void finishInstall();
         void updateView(UpdateNode::Config* aConfig = NULL);
         void updateCounter();
 
@@ -56,6 +65,7 @@ class MultiAppDialog : public QDialog
     public slots:
         void serviceDone();
         void serviceDoneManager();
+        void updateParsed(UpdateNode::Config* aConfig, const UpdateNode::Update& aUpdate);
         void refresh();
         void cancelProgress();
         void contextMenu(const QPoint& pos);
@@ -67,18 +77,23 @@ class MultiAppDialog : public QDialog
         void checkSelection();
         void onClose();
 
-        void processError();
-        void processOutput();
-        void updateExit(int aExitCode, QProcess::ExitStatus aExitStatus);
+        void installStarted(int aInstall);
+        void installFailed(int aInstall);
+        void installOutput(int aInstall, const QString& aText, bool aError);
+        void updateExit(int aInstall, int aExitCode, QProcess::ExitStatus aExitStatus);
 
     private:
         Ui::DialogUpdate* m_pUI;
         UpdateNode::Service* m_pService;
-        UpdateNode::Downloader* m_pDownloader;
+        UpdateNode::DownloadQueue* m_pDownloads;
+        UpdateNode::TransferStats* m_pStats;
 
-        QList<UpdateNode::Update> m_oReadyUpdates;
+        QList<QTreeWidgetItem*> m_listPipeline;
+        QList<QTreeWidgetItem*> m_listDownloading;
+        QList<QTreeWidgetItem*> m_listDownloaded;
+        QMap<QTreeWidgetItem*, int> m_mapInstalls;
         UpdateNode::Update m_oCurrentUpdate;
-        UpdateNode::Commander m_oCommander;
+        UpdateNode::InstallScheduler* m_pScheduler;
         QTreeWidgetItem* m_pCurrentItem;
         QTreeWidgetItem* m_pIgnoredItem;
 
@@ -87,7 +102,6 @@ class MultiAppDialog : public QDialog
         int m_iError;
 
         int m_iNewUpdates;
-        bool m_bIsInstalling;
 };
 
 #endif // DIALOG_H
@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef NETWORKSESSION_H
+#define NETWORKSESSION_H
+
+#include <QObject>
+#include <QMap>
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QUrl>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QSslError>
+#include <QHostInfo>
+
+// TLS session tickets can be read from and set on QSslConfiguration since Qt 5.2
+#if QT_VERSION >= 0x050200 && !defined(QT_NO_SSL)
+#define UPDATENODE_TLS_SESSION_SUPPORTED
+#endif
+
+// connections can be opened without a request since Qt 5.2
+#if QT_VERSION >= 0x050200
+#define UPDATENODE_CONNECT_TO_HOST_SUPPORTED
+#endif
+
+namespace UpdateNode
+{
+    class NetworkSession : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit NetworkSession();
+
+        public:
+            static NetworkSession* m_pInstance;
+            static NetworkSession* Instance();
+
+        public:
+            QNetworkAccessManager* manager();
+
+            QNetworkReply* get(QNetworkRequest aRequest);
+            QNetworkReply* head(QNetworkRequest aRequest);
+
+            void warmUp(const QUrl& aUrl);
+
+            int handshakes() const;
+            int requests() const;
+
+        public slots:
+            void save();
+
+        private slots:
+            void encrypted(QNetworkReply* reply);
+            void finished(QNetworkReply* reply);
+            void sslErrors(QNetworkReply* reply, const QList<QSslError>& errors);
+            void hostFound(const QHostInfo& aHostInfo);
+
+        private:
+            void prepare(QNetworkRequest& aRequest);
+            void firstRequest();
+            void load();
+            static QString sessionKey(const QUrl& url);
+
+        private:
+            QNetworkAccessManager m_oManager;
+            QMap<QString, QByteArray> m_mapTickets;
+            QMap<QString, QDateTime> m_mapTicketExpiry;
+            QStringList m_listWarmedUp;
+            QElapsedTimer m_oStartup;
+            bool m_bFirstRequest;
+            int m_iHandshakes;
+            int m_iRequests;
+    };
+}
+#endif // NETWORKSESSION_H
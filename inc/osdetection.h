@@ -38,6 +38,15 @@ namespace UpdateNode {
             static QString getLinuxVersion();
             static QString getOthersVersion();
 
+        private:
+            static QString getBootId();
+            static QString getKernelRelease();
+            static QString detectArch();
+            static void detect();
+
+        private:
+            static QString m_strOS;
+            static QString m_strArch;
     };
 }
 
@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef PARTFILE_H
+#define PARTFILE_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <QCryptographicHash>
+
+#define UPDATENODE_PART_SUFFIX ".part"
+
+// SHA-256 is available in QCryptographicHash since Qt 5
+#if QT_VERSION >= 0x050000
+#define UPDATENODE_FILE_HASH_SUPPORTED
+#endif
+
+namespace UpdateNode
+{
+    class PartFile
+    {
+        public:
+            PartFile(const QString& aFileName);
+            ~PartFile();
+
+        public:
+            bool open();
+            bool resume(qint64 aOffset);
+            bool write(const QByteArray& aData);
+            bool checkpoint();
+            bool commit();
+            void discard();
+
+            void setExpectedHash(const QString& aHash);
+            QString hash() const;
+
+            QString fileName() const;
+            QString partFileName() const;
+            qint64 size() const;
+            qint64 syncedSize() const;
+            QString errorString() const;
+
+        public:
+            static bool sync(QFile& aFile);
+            static bool replace(const QString& aFrom, const QString& aTo);
+            static QCryptographicHash* createHash();
+
+        private:
+            QString m_strFileName;
+            QString m_strError;
+            QString m_strExpectedHash;
+            QCryptographicHash* m_pHash;
+            QFile   m_oFile;
+            qint64  m_iSize;
+            qint64  m_iSynced;
+    };
+}
+#endif // PARTFILE_H
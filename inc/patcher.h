@@ -0,0 +1,51 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef PATCHER_H
+#define PATCHER_H
+
+#include <QString>
+
+#define UPDATENODE_PATCH_MAGIC  "UNPATCH1"
+#define UPDATENODE_PATCH_COPY   'C'
+#define UPDATENODE_PATCH_INSERT 'I'
+#define UPDATENODE_PATCH_END    'E'
+
+namespace UpdateNode
+{
+    class Patcher
+    {
+        public:
+            Patcher();
+
+        public:
+            bool apply(const QString& aBase, const QString& aPatch, const QString& aTarget, const QString& aExpectedHash);
+
+            QString hash() const;
+            QString errorString() const;
+
+        private:
+            QString m_strHash;
+            QString m_strError;
+    };
+}
+#endif // PATCHER_H
@@ -0,0 +1,61 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QObject>
+#include <QList>
+#include <QNetworkReply>
+
+#include "update.h"
+#include "downloadqueue.h"
+
+namespace UpdateNode
+{
+    class Prefetcher : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit Prefetcher(QObject* parent = 0);
+
+        public:
+            void start(const QList<UpdateNode::Update>& aUpdates);
+            int ready() const;
+            int failed() const;
+
+            static QList<UpdateNode::Update> pending();
+
+        signals:
+            void finished();
+
+        private slots:
+            void downloadDone(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString);
+
+        private:
+            UpdateNode::DownloadQueue* m_pDownloads;
+            int m_iReady;
+            int m_iFailed;
+    };
+}
+#endif // PREFETCHER_H
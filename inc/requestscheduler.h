@@ -0,0 +1,95 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QUrl>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+// default budgets of the phases of a request in milliseconds, see ScheduledReply
+#define UPDATENODE_CONNECT_BUDGET       5000
+#define UPDATENODE_TTFB_BUDGET          10000
+#define UPDATENODE_BODY_BUDGET          10000
+
+#define UPDATENODE_RETRIES              2
+#define UPDATENODE_BACKOFF              500
+
+// a hedged request is sent once a request takes longer than this percentile of the recorded latencies
+#define UPDATENODE_HEDGE_PERCENTILE     95
+#define UPDATENODE_HEDGE_MIN_SAMPLES    5
+#define UPDATENODE_HEDGE_DELAY          3000
+#define UPDATENODE_LATENCY_SAMPLES      32
+
+namespace UpdateNode
+{
+    class RequestScheduler : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit RequestScheduler();
+
+        public:
+            static RequestScheduler* m_pInstance;
+            static RequestScheduler* Instance();
+
+        public:
+            QNetworkReply* get(const QNetworkRequest& aRequest);
+
+            void setBudgets(int aConnect, int aFirstByte, int aBody);
+            int connectBudget() const;
+            int firstByteBudget() const;
+            int bodyBudget() const;
+
+            void setRetries(int aRetries, int aBackoff);
+            int retries() const;
+            int backoff(int aAttempt) const;
+
+            void setAlternateHost(const QUrl& aUrl);
+            QUrl alternateUrl(const QUrl& aUrl) const;
+
+            void setHedgeDelay(int aMilliSec);
+            int hedgeDelay() const;
+            void addLatency(int aMilliSec);
+
+        public slots:
+            void save();
+
+        private:
+            void load();
+
+        private:
+            int m_iConnect;
+            int m_iFirstByte;
+            int m_iBody;
+            int m_iRetries;
+            int m_iBackoff;
+            int m_iHedgeDelay;
+            QUrl m_oAlternateHost;
+            QList<int> m_listLatencies;
+    };
+}
+#endif // REQUESTSCHEDULER_H
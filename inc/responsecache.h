@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QString>
+#include <QList>
+#include <QUrl>
+#include <QDateTime>
+#include <QDataStream>
+
+#include "config.h"
+
+#define UPDATENODE_RESPONSE_MAGIC   0x554e5253
+#define UPDATENODE_RESPONSE_VERSION 3
+
+namespace UpdateNode
+{
+    class ResponseCache
+    {
+        public:
+            ResponseCache(const QUrl& aUrl);
+
+        public:
+            bool load();
+            bool save();
+            void remove();
+
+            bool isLoaded() const;
+            bool isFresh(int aTtl) const;
+            void restore(UpdateNode::Config* aConfig) const;
+
+            void setValidators(const QString& aETag, const QString& aLastModified);
+            QString getETag() const;
+            QString getLastModified() const;
+
+            void setBodyHash(const QString& aHash);
+            QString getBodyHash() const;
+
+            void setStatus(int aStatus, const QString& aStatusString);
+            int getStatus() const;
+            QString getStatusString() const;
+
+            void setProduct(const UpdateNode::Product& aProduct);
+            UpdateNode::Product getProduct() const;
+            void setVersion(const UpdateNode::ProductVersion& aVersion);
+            UpdateNode::ProductVersion getVersion() const;
+            void setUpdates(const QList<UpdateNode::Update>& aUpdates);
+            QList<UpdateNode::Update> getUpdates() const;
+            void setMessages(const QList<UpdateNode::Message>& aMessages);
+            QList<UpdateNode::Message> getMessages() const;
+
+            QString fileName() const;
+
+            static QList<QUrl> storedHosts(int aMax);
+
+        private:
+            static void write(QDataStream& aStream, const UpdateNode::ProductVersion& aVersion);
+            static void read(QDataStream& aStream, UpdateNode::ProductVersion& aVersion);
+
+        private:
+            QString m_strFileName;
+            QString m_strETag;
+            QString m_strLastModified;
+            QString m_strBodyHash;
+            QString m_strStatus;
+            QDateTime m_oTime;
+            int m_iStatus;
+            bool m_bLoaded;
+
+            UpdateNode::Product m_oProduct;
+            UpdateNode::ProductVersion m_oVersion;
+            QList<UpdateNode::Update> m_listUpdates;
+            QList<UpdateNode::Message> m_listMessages;
+    };
+}
+#endif // RESPONSECACHE_H
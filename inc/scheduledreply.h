@@ -0,0 +1,88 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef SCHEDULEDREPLY_H
+#define SCHEDULEDREPLY_H
+
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QList>
+#include <QMap>
+
+namespace UpdateNode
+{
+    class ScheduledReply : public QNetworkReply
+    {
+        Q_OBJECT
+
+        public:
+            ScheduledReply(const QNetworkRequest& aRequest, QObject* parent = 0);
+            ~ScheduledReply();
+
+            enum Phase { PHASE_CONNECT = 0, PHASE_FIRST_BYTE, PHASE_BODY };
+
+        public:
+            void abort();
+            qint64 bytesAvailable() const;
+            bool isSequential() const;
+
+            int attempts() const;
+            bool isHedged() const;
+
+        protected:
+            qint64 readData(char* data, qint64 maxSize);
+
+        private slots:
+            void start();
+            void hedge();
+            void attemptEncrypted();
+            void attemptMetaDataChanged();
+            void attemptReadyRead();
+            void attemptFinished();
+            void phaseTimeout();
+
+        private:
+            void launch(const QUrl& aUrl);
+            void enterPhase(QNetworkReply* aAttempt, Phase aPhase);
+            bool isRetryable(QNetworkReply* aAttempt) const;
+            void commit(QNetworkReply* aAttempt);
+            void drop(QNetworkReply* aAttempt);
+            void complete(QNetworkReply::NetworkError aError, const QString& aErrorString);
+
+        private:
+            QList<QNetworkReply*> m_listAttempts;
+            QMap<QNetworkReply*, Phase> m_mapPhase;
+            QMap<QNetworkReply*, QTimer*> m_mapTimer;
+            QMap<QTimer*, QNetworkReply*> m_mapTimerAttempt;
+            QNetworkReply* m_pCommitted;
+            QElapsedTimer m_oElapsed;
+            QTimer m_oHedgeTimer;
+            QTimer m_oBackoffTimer;
+            QByteArray m_oBuffer;
+            int m_iAttempts;
+            bool m_bHedged;
+            QList<QNetworkReply*> m_listTimedOut;
+    };
+}
+#endif // SCHEDULEDREPLY_H
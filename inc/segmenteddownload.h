@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef SEGMENTEDDOWNLOAD_H
+#define SEGMENTEDDOWNLOAD_H
+
+#include <QObject>
+#include <QFile>
+#include <QList>
+#include <QMap>
+#include <QUrl>
+#include <QNetworkReply>
+#include <QCryptographicHash>
+
+#include "networksession.h"
+
+#define UPDATENODE_SEGMENT_MINIMUM  (1024 * 1024)
+#define UPDATENODE_SEGMENT_MAXIMUM  6
+#define UPDATENODE_SEGMENT_RETRIES  3
+// appended to the part file name, holds the progress of each segment of an aborted download
+#define UPDATENODE_SEGMENT_CHECKPOINT ".segments"
+
+namespace UpdateNode
+{
+    class SegmentedDownload : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            SegmentedDownload(const QUrl& aUrl, const QString& aFileName, int aSegments, QObject* aParent = 0);
+            ~SegmentedDownload();
+
+        public:
+            void start();
+            void abort();
+
+            void setExpectedHash(const QString& aHash);
+            QString hash() const;
+
+            QUrl url() const;
+            QString fileName() const;
+            qint64 size() const;
+            int segments() const;
+
+        signals:
+            void finished(QNetworkReply::NetworkError aError, const QString& aErrorString);
+            void unsupported();
+            void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+
+        private slots:
+            void probeFinished();
+            void segmentReadyRead();
+            void segmentFinished();
+
+        private:
+            struct Segment
+            {
+                qint64 m_iStart;
+                qint64 m_iEnd;
+                qint64 m_iWritten;
+                int    m_iRetries;
+            };
+
+            void startSegment(int aIndex);
+            void readSegment(QNetworkReply* reply, bool aAll);
+            bool checkSegment(QNetworkReply* aReply, int aIndex);
+            void updateHash(qint64 aOffset, const QByteArray& aData);
+            bool restoreCheckpoint();
+            void storeCheckpoint();
+            void finish(QNetworkReply::NetworkError aError, const QString& aErrorString);
+
+        private:
+            QUrl    m_oUrl;
+            QString m_strFileName;
+            QFile   m_oFile;
+            QByteArray m_strValidator;
+            QString m_strExpectedHash;
+            QCryptographicHash* m_pHash;
+            qint64  m_iSize;
+            qint64  m_iReceived;
+            qint64  m_iHashed;
+            int     m_iSegments;
+            bool    m_bFinished;
+            bool    m_bResumable;
+
+            QList<Segment> m_listSegments;
+            QMap<QNetworkReply*, int> m_oReplies;
+    };
+}
+#endif // SEGMENTEDDOWNLOAD_H
@@ -33,6 +33,10 @@
 #define UPDATENODE_COMPANY_STR        "UpdateNode"
 #define UPDATENODE_APPLICATION_STR    "Client"
 
+// message states, see Settings::getMessageState
+#define UPDATENODE_MESSAGE_SHOWN      0x01
+#define UPDATENODE_MESSAGE_LOADED     0x02
+
 namespace UpdateNode
 {
     class Settings : public QSettings
@@ -52,6 +56,7 @@ namespace UpdateNode
             bool clean();
 
             void setUpdate(UpdateNode::Update aUpdate, const QString& aLocalFile, int aResult);
+            QString getUpdateResult(const QString& aUpdateCode);
             void setMessage(UpdateNode::Message aMessage, bool aShown, bool aLoaded);
             void setMessage(UpdateNode::Message aMessage, bool aShown);
             void setNewVersion(UpdateNode::Config* config, UpdateNode::Product aProduct, UpdateNode::ProductVersion aVersion);
@@ -64,9 +69,22 @@ namespace UpdateNode
             bool isUpdateIgnored(const QString& aUpdateCode);
 
             bool messageShownAndLoaded(const QString& aMessageCode);
+            int getMessageState(const QString& aMessageCode);
 
-            void setCachedFile(const QString& aCode, const QString& aFilename);
+            void setCachedFile(const QString& aCode, const QString& aFilename, const QString& aHash = QString());
             QString getCachedFile(const QString& aCode);
+            QString getCachedFileHash(const QString& aCode);
+            bool isCachedFileValid(const QString& aCode, const QString& aHash = QString());
+
+            void setUpdateReady(const QString& aCode, bool aReady);
+            bool isUpdateReady(const UpdateNode::Update& aUpdate);
+
+            void setPartialDownload(const QString& aCode, const QString& aPartFile, qint64 aOffset);
+            void setPartialValidator(const QString& aCode, const QString& aValidator);
+            QString getPartialFile(const QString& aCode);
+            qint64 getPartialOffset(const QString& aCode);
+            QString getPartialValidator(const QString& aCode);
+            void removePartialDownload(const QString& aCode);
 
             void setCurrentClientDir(const QString& aClientDir);
             QString getCurrentClientDir();
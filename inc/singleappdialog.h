@@ -27,6 +27,8 @@
 #include <QList>
 #include "updatenode_service.h"
 #include "commander.h"
+#include "downloadqueue.h"
+#include "transferstats.h"
 
 namespace Ui
 {
@@ -60,7 +62,8 @@ class SingleAppDialog : public QDialog
     private:
         Ui::SingleAppDialog* m_pUi;
         UpdateNode::Service* m_pService;
-        UpdateNode::Downloader* m_pDownloader;
+        UpdateNode::DownloadQueue* m_pDownloads;
+        UpdateNode::TransferStats* m_pStats;
 
         QList<UpdateNode::Update> m_oReadyUpdates;
         UpdateNode::Update m_oCurrentUpdate;
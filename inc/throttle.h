@@ -0,0 +1,87 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef THROTTLE_H
+#define THROTTLE_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+// the bucket holds the tokens of this many milliseconds, which limits the size of a burst
+#define UPDATENODE_THROTTLE_BURST       250
+// bytes a waiting download gets at least before it is woken up again
+#define UPDATENODE_THROTTLE_CHUNK       (4 * 1024)
+// rate in bytes per second of background downloads while the service is requested
+#define UPDATENODE_THROTTLE_YIELD_RATE  (16 * 1024)
+
+namespace UpdateNode
+{
+    class Throttle : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit Throttle();
+
+        public:
+            static Throttle* m_pInstance;
+            static Throttle* Instance();
+
+        public:
+            QByteArray read(QNetworkReply* aReply);
+            qint64 acquire(qint64 aBytes);
+
+            void setRate(int aBytesPerSecond);
+            int rate() const;
+
+            void setBackground(bool aBackground);
+            bool isBackground() const;
+            void prepare(QNetworkRequest& aRequest) const;
+
+            void addForeground(QNetworkReply* aReply);
+            bool isYielding() const;
+
+        private slots:
+            void wakeUp();
+            void foregroundFinished();
+
+        private:
+            int effectiveRate() const;
+            void refill();
+            void wait(QNetworkReply* aReply);
+
+        private:
+            int m_iRate;
+            bool m_bBackground;
+            double m_fTokens;
+            QElapsedTimer m_oRefill;
+            QTimer m_oWakeUp;
+            QList<QPointer<QNetworkReply> > m_listWaiting;
+            QList<QNetworkReply*> m_listForeground;
+    };
+}
+#endif // THROTTLE_H
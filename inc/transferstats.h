@@ -0,0 +1,94 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#ifndef TRANSFERSTATS_H
+#define TRANSFERSTATS_H
+
+#include <QObject>
+#include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "downloadjob.h"
+#include "downloadqueue.h"
+
+// the statistics are published at most every 100 ms (10 Hz)
+#define UPDATENODE_STATS_INTERVAL   100
+// weight of the latest throughput sample in the smoothed throughput
+#define UPDATENODE_STATS_SMOOTHING  0.3
+
+namespace UpdateNode
+{
+    class TransferStats : public QObject
+    {
+        Q_OBJECT
+
+        public:
+            explicit TransferStats(UpdateNode::DownloadQueue* aQueue, QObject* parent = 0);
+
+        public:
+            qint64 bytesReceived(UpdateNode::DownloadJob* aJob = NULL) const;
+            qint64 bytesTotal(UpdateNode::DownloadJob* aJob = NULL) const;
+            double rate(UpdateNode::DownloadJob* aJob = NULL) const;
+            double smoothedRate(UpdateNode::DownloadJob* aJob = NULL) const;
+            int eta(UpdateNode::DownloadJob* aJob = NULL) const;
+
+            QString toString() const;
+            void setInterval(int aMsec);
+
+        private slots:
+            void jobStarted(UpdateNode::DownloadJob* aJob);
+            void jobFinished(UpdateNode::DownloadJob* aJob);
+            void jobProgress(qint64 bytesReceived, qint64 bytesTotal);
+            void update();
+
+        signals:
+            void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+            void statsChanged();
+
+        private:
+            struct Sample
+            {
+                Sample() : iReceived(0), iTotal(0), iLastReceived(0), fRate(0), fSmoothed(0) {}
+
+                void update(qint64 aElapsed);
+                int eta() const;
+
+                qint64 iReceived;
+                qint64 iTotal;
+                qint64 iLastReceived;
+                double fRate;
+                double fSmoothed;
+            };
+
+            UpdateNode::DownloadQueue* m_pQueue;
+            QMap<UpdateNode::DownloadJob*, Sample> m_mapJobs;
+            Sample m_oTotal;
+            qint64 m_iDoneReceived;
+            qint64 m_iDoneTotal;
+            int m_iDoneJobs;
+            bool m_bChanged;
+            QTimer m_oTimer;
+            QElapsedTimer m_oElapsed;
+    };
+}
+#endif // TRANSFERSTATS_H
@@ -24,6 +24,7 @@
 #define UPDATE_H
 
 #include <QString>
+#include <QStringList>
 #include "productversion.h"
 
 namespace UpdateNode
@@ -54,6 +55,19 @@ namespace UpdateNode
             void setFileSize(const QString& aFileSize);
             QString getFileSize() const;
 
+            void setFileHash(const QString& aFileHash);
+            QString getFileHash() const;
+
+            void setPatchLink(const QString& aPatchLink);
+            QString getPatchLink() const;
+
+            void setPatchBaseHash(const QString& aBaseHash);
+            QString getPatchBaseHash() const;
+
+            void setMirrors(const QStringList& aMirrors);
+            void addMirror(const QString& aMirror);
+            QStringList getMirrors() const;
+
             void setType(int aType);
             int getType() const;
             Type getTypeEnum();
@@ -64,6 +78,9 @@ namespace UpdateNode
             void setMandatory(bool aMandatoryUpdate);
             bool isMandatory() const;
 
+            void setIndependent(bool aIndependent);
+            bool isIndependent() const;
+
             void setTargetVersion(const ProductVersion& aTarget);
             ProductVersion getTargetVersion() const;
 
@@ -79,9 +96,14 @@ namespace UpdateNode
             QString m_strCode;
 
             QString m_strFileSize;
+            QString m_strFileHash;
+            QString m_strPatchLink;
+            QString m_strPatchBaseHash;
+            QStringList m_listMirrors;
             int m_iType;
             bool m_bAdminRequired;
             bool m_bMandatory;
+            bool m_bIndependent;
 
             ProductVersion m_oTarget;
     };
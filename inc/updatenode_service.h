@@ -24,13 +24,16 @@
 #define _SERVICE_H
 
 #include <QObject>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QSslError>
+#include <QCryptographicHash>
+#include <QPair>
 
 #include "config.h"
 #include "downloader.h"
 #include "status.h"
+#include "xmlparser.h"
+#include "networksession.h"
+#include "responsecache.h"
 
 #define UPDATENODE_SERVICE_URL "https://www.updatenode.com/api"
 
@@ -48,6 +51,7 @@ namespace UpdateNode
 
             bool checkForUpdates();
             bool checkForUpdates(UpdateNode::Config* aConfig);
+            bool checkForUpdates(const QList<UpdateNode::Config*>& aConfigs);
 
             int status();
             QString statusText() const;
@@ -60,20 +64,42 @@ namespace UpdateNode
             QString notificationTextManager();
         public slots:
             void requestReceived(QNetworkReply* reply);
-            void onSslError(QNetworkReply *reply, const QList<QSslError>& errors);
+
+        private slots:
+            void replyFinished();
+            void dataReceived();
+            void prefetchIcon(UpdateNode::Config* aConfig, const UpdateNode::Product& aProduct);
+            void batchResponseParsed(UpdateNode::Config* aConfig, int aStatus, const QString& aStatusString, bool aComplete);
+            void checkDone();
 
         signals:
             void done();
             void doneManager();
+            void productParsed(UpdateNode::Config* aConfig, const UpdateNode::Product& aProduct);
+            void updateParsed(UpdateNode::Config* aConfig, const UpdateNode::Update& aUpdate);
+
+        private:
+            void restore(UpdateNode::Config* aConfig, UpdateNode::ResponseCache* aCache);
+            void batchReceived(QNetworkReply* reply);
+            QUrl requestUrl(const QList<UpdateNode::Config*>& aConfigs);
+            QNetworkRequest createRequest(const QUrl& aUrl);
+            QUrl digestUrl(const QUrl& aUrl, UpdateNode::ResponseCache* aCache, const QString& aSuffix = QString());
+            void merge(UpdateNode::Config* aConfig, UpdateNode::ResponseCache* aCache, UpdateNode::XmlParser* aParser);
+            UpdateNode::XmlParser* createParser(QNetworkReply* aReply, UpdateNode::Config* aConfig);
+            bool isNotModified(QNetworkReply* aReply, UpdateNode::ResponseCache* aCache) const;
 
         private:
-            QNetworkAccessManager* m_pManager;
             UpdateNode::Downloader* m_pDownloader;
             QMap<QNetworkReply*, Config*> m_mapConfig;
+            QMap<QNetworkReply*, XmlParser*> m_mapParser;
+            QMap<QNetworkReply*, ResponseCache*> m_mapCache;
+            QMap<QNetworkReply*, QCryptographicHash*> m_mapBodyHash;
+            QMap<QNetworkReply*, QList<Config*> > m_mapBatch;
             QList<UpdateNode::Config*> m_listConfigs;
 
             int m_iStatus;
             QString m_strStatus;
+            bool m_bBatchUnsupported;
     };
 }
 
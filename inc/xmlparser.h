@@ -25,8 +25,14 @@
 
 #include <QObject>
 #include <QString>
-#include <QDomDocument>
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QStringList>
+#include <QXmlStreamReader>
 
+#include "product.h"
+#include "productversion.h"
 #include "update.h"
 #include "message.h"
 #include "config.h"
@@ -41,29 +47,76 @@ namespace UpdateNode
             XmlParser(QObject* parent, UpdateNode::Config* aConfig);
             ~XmlParser();
 
+            enum Tag { TAG_UNKNOWN = 0, TAG_STATUS, TAG_PRODUCT, TAG_VERSION, TAG_UPDATES, TAG_UPDATE,
+                       TAG_MESSAGES, TAG_MESSAGE, TAG_CODE, TAG_NAME, TAG_IMAGE, TAG_TITLE, TAG_DESCRIPTION,
+                       TAG_TYPE, TAG_FILE, TAG_COMMAND, TAG_COMMANDLINE, TAG_REQUIRES_ADMIN, TAG_MANDATORY,
+                       TAG_FILE_SIZE, TAG_FILE_HASH, TAG_PATCH, TAG_PATCH_BASE_HASH, TAG_TARGET, TAG_LINK,
+                       TAG_EXTERNAL_LINK, TAG_BATCH, TAG_RESPONSE, TAG_REMOVED, TAG_MIRROR, TAG_INDEPENDENT };
+
         public:
             bool parse(const QString& aXmlData);
+            bool parse(const QByteArray& aXmlData);
+            bool parse(QIODevice* aDevice);
+
+            bool addData(const QByteArray& aData);
+            bool finish();
+
+            void setBatch(const QList<UpdateNode::Config*>& aConfigs);
+            bool isBatch() const;
+            bool isDelta() const;
 
             int getStatus();
             QString getStatusString();
 
-        private:
-            bool parseStatus();
-            bool parseProduct();
-            bool parseVersion();
-            bool parseUpdates();
-            bool parseMessages();
+            UpdateNode::Product product() const;
+            UpdateNode::ProductVersion version() const;
+            QList<UpdateNode::Update> updates() const;
+            QList<UpdateNode::Message> messages() const;
+            QStringList removedUpdates() const;
+            QStringList removedMessages() const;
 
-            UpdateNode::ProductVersion parseVersion(QDomNode aNode);
-            UpdateNode::Update parseUpdate(QDomNode aNode);
-            UpdateNode::Message parseMessage(QDomNode aNode);
+        signals:
+            void productParsed(UpdateNode::Config* aConfig, const UpdateNode::Product& aProduct);
+            void versionParsed(UpdateNode::Config* aConfig, const UpdateNode::ProductVersion& aVersion);
+            void updateParsed(UpdateNode::Config* aConfig, const UpdateNode::Update& aUpdate);
+            void messageParsed(UpdateNode::Config* aConfig, const UpdateNode::Message& aMessage);
+            void responseParsed(UpdateNode::Config* aConfig, int aStatus, const QString& aStatusString, bool aComplete);
 
         private:
-            QDomDocument* m_pDocument;
+            bool process();
+            void startElement(Tag aTag);
+            void endElement(Tag aTag, const QString& aText);
+
+            static Tag tag(const QXmlStreamReader& aReader);
 
+        private:
             int m_iStatus;
             QString m_strStatus;
             UpdateNode::Config* m_pConfig;
+
+            QXmlStreamReader m_oReader;
+            QList<Tag> m_listPath;
+            QString m_strText;
+            int m_iTextDepth;
+            int m_iSections;
+            int m_iSectionDepth;
+            Tag m_eSection;
+            bool m_bSkipSection;
+
+            QList<UpdateNode::Config*> m_listBatch;
+            int m_iResponseDepth;
+            bool m_bBatch;
+            bool m_bDelta;
+
+            UpdateNode::Product m_oProduct;
+            UpdateNode::ProductVersion m_oVersion;
+            UpdateNode::ProductVersion m_oTarget;
+            UpdateNode::Update m_oUpdate;
+            UpdateNode::Message m_oMessage;
+            QList<UpdateNode::Update> m_listUpdates;
+            QList<UpdateNode::Message> m_listMessages;
+            QStringList m_listRemovedUpdates;
+            QStringList m_listRemovedMessages;
     };
 }
 
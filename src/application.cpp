@@ -512,7 +512,7 @@ void Application::checkForUpdates()
 {
     UpdateNode::Config* config = UpdateNode::Config::Instance();
 
-    if(m_strMode != "-check")
+    if(m_strMode != "-check" && m_strMode != "-prefetch")
     {
         showSplashScreen(m_pService, m_strMode);
 
@@ -540,6 +540,15 @@ void Application::checkForUpdates()
             m_oManageDialog.hide();
         }
     }
+    else if(m_strMode == "-prefetch")
+    {
+        if(config->isSingleMode())
+            QObject::connect(m_pService, SIGNAL(done()), this, SLOT(prefetch()));
+        else
+            QObject::connect(m_pService, SIGNAL(doneManager()), this, SLOT(prefetch()));
+
+        QObject::connect(&m_oPrefetcher, SIGNAL(finished()), this, SLOT(afterCheck()));
+    }
     else
     {
         if(config->isSingleMode())
@@ -551,6 +560,16 @@ void Application::checkForUpdates()
     m_pService->checkForUpdates();
 }
 
+/*!
+Slot which is called in case of -prefetch mode, once the check is done. \n
+Downloads all pending updates in background, afterCheck() is called when all of them have ended
+\sa UpdateNode::Prefetcher
+*/
+void Application::prefetch()
+{
+    m_oPrefetcher.start(UpdateNode::Prefetcher::pending());
+}
+
 /*!
 Slot which is called in case of -check mode. \n
 Depends on the config, just returns using silent mode\n
@@ -579,6 +598,9 @@ void Application::afterCheck()
         else
             text = m_pService->notificationTextManager();
 
+        if(m_strMode == "-prefetch" && m_oPrefetcher.ready() > 0)
+            text = tr("%n update(s) ready to install", "", m_oPrefetcher.ready());
+
         if(config->isSystemTray() && (m_pService->returnCode() != 0 || m_pService->returnCodeManager() != 0))
         {
             m_pSystemTray = new UpdateNode::SystemTray();
@@ -0,0 +1,1057 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDirIterator>
+
+#include "archiveextractor.h"
+#include "filecopier.h"
+#include "partfile.h"
+#include "logging.h"
+
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::ArchiveExtractor
+\brief Extracts tar, tar.gz and zip archives while their data arrives
+\n\n
+The archive is passed in chunks of any size by ArchiveExtractor::write, e.g. straight from a download, and
+each entry is written as soon as its data is available. The archive is never held in memory, nor read twice.
+\n Every file is written to a temporary file next to its destination, which is synced and renamed to the
+destination by PartFile::replace, so an existing file is never left truncated. Entries with absolute paths or
+".." components are rejected, links and special files are skipped.
+\n tar.gz archives and deflated zip entries need zlib, which is used if UPDATENODE_ZLIB is defined. Zip entries
+are checked against their CRC-32 then as well.
+\sa Commander::extract, UPDATENODE_EXTRACT_COMMAND
+*/
+
+/*!
+Constructs an ArchiveExtractor object, which extracts to the directory \a aTarget
+*/
+ArchiveExtractor::ArchiveExtractor(const QString& aTarget)
+    : m_strTarget(aTarget)
+{
+    m_eFormat = FORMAT_UNKNOWN;
+    m_eState = STATE_HEADER;
+    m_pFile = NULL;
+    m_iPosition = 0;
+    m_iRemaining = 0;
+    m_iPadding = 0;
+    m_iMode = 0;
+    m_iCrc = 0;
+    m_iExpectedCrc = 0;
+    m_iEntries = 0;
+    m_iMethod = 0;
+    m_iMeta = 0;
+    m_bDescriptor = false;
+    m_bFailed = false;
+#ifdef UPDATENODE_ZLIB
+    memset(&m_oGzip, 0, sizeof(m_oGzip));
+    memset(&m_oInflate, 0, sizeof(m_oInflate));
+    m_bGzip = false;
+    m_bInflate = false;
+#endif
+}
+
+/*!
+Destructs the ArchiveExtractor object. The temporary file of an unfinished entry is removed,
+entries extracted completely stay in place.
+*/
+ArchiveExtractor::~ArchiveExtractor()
+{
+    discardEntry();
+
+#ifdef UPDATENODE_ZLIB
+    if(m_bGzip)
+        inflateEnd(&m_oGzip);
+    if(m_bInflate)
+        inflateEnd(&m_oInflate);
+#endif
+}
+
+/*!
+Extracts the next chunk \a aData of the archive. The format is detected from the first bytes.
+\n Returns false if the archive is not supported, corrupt, contains an unsafe path, or a file cannot be written.
+All further calls fail then as well
+\sa ArchiveExtractor::errorString
+*/
+bool ArchiveExtractor::write(const QByteArray& aData)
+{
+    if(m_bFailed)
+        return false;
+
+    if(m_eFormat != FORMAT_UNKNOWN)
+        return feed(aData);
+
+    m_oInput.append(aData);
+    if(!detect())
+        return !m_bFailed;
+
+    QByteArray input = m_oInput;
+    m_oInput.clear();
+
+    return feed(input);
+}
+
+/*!
+Finishes the extraction after the last chunk has been written. For zip archives, the permissions
+stored in the central directory are applied.
+\n Returns false if the archive ended in the middle of an entry, or extraction failed before
+*/
+bool ArchiveExtractor::finish()
+{
+    if(m_bFailed)
+        return false;
+
+    if(m_eFormat == FORMAT_UNKNOWN)
+        return fail("Unsupported archive format");
+
+    // a tar archive may end without the closing zero blocks
+    if(m_pFile || (m_eState != STATE_END && (m_eState != STATE_HEADER || available() > 0)))
+        return fail("Archive is truncated");
+
+    if(m_eFormat == FORMAT_ZIP)
+        readCentralDirectory();
+
+    return true;
+}
+
+/*!
+Aborts the extraction, all further calls fail
+*/
+void ArchiveExtractor::abort()
+{
+    if(!m_bFailed)
+        fail("Extraction aborted");
+}
+
+/*!
+Extracts the archive file \a aArchive, reading it in chunks of UPDATENODE_EXTRACT_BUFFER bytes
+\n Returns true on success, otherwise false
+*/
+bool ArchiveExtractor::extractFile(const QString& aArchive)
+{
+    QFile file(aArchive);
+    if(!file.open(QIODevice::ReadOnly))
+        return fail(QString("Could not open %1: %2").arg(aArchive).arg(file.errorString()));
+
+    while(!file.atEnd())
+    {
+        QByteArray data = file.read(UPDATENODE_EXTRACT_BUFFER);
+        if(data.isEmpty())
+            return fail(QString("Could not read %1: %2").arg(aArchive).arg(file.errorString()));
+
+        if(!write(data))
+            return false;
+
+        // the rest of a tar archive is padding
+        if(m_eState == STATE_END && m_eFormat != FORMAT_ZIP)
+            break;
+    }
+
+    return finish();
+}
+
+/*!
+Returns the directory the archive is extracted to
+*/
+QString ArchiveExtractor::target() const
+{
+    return m_strTarget;
+}
+
+/*!
+Returns the format of the archive, or FORMAT_UNKNOWN as long as not enough data has been written to detect it
+*/
+ArchiveExtractor::Format ArchiveExtractor::format() const
+{
+    return m_eFormat;
+}
+
+/*!
+Returns the number of files and directories extracted so far
+*/
+int ArchiveExtractor::entries() const
+{
+    return m_iEntries;
+}
+
+/*!
+Returns a human readable description of the last error
+*/
+QString ArchiveExtractor::errorString() const
+{
+    return m_strError;
+}
+
+/*!
+Returns true if archives of format \a aFormat can be extracted. Zip archives are always supported,
+but only with stored entries if UPDATENODE_ZLIB is not defined
+*/
+bool ArchiveExtractor::isSupported(Format aFormat)
+{
+    switch(aFormat)
+    {
+        case FORMAT_TAR:
+        case FORMAT_ZIP:
+            return true;
+        case FORMAT_TAR_GZ:
+#ifdef UPDATENODE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+/*!
+Returns true if the entry name \a aPath stays inside the target directory: it must be relative,
+without drive letter, and must not contain any ".." component
+*/
+bool ArchiveExtractor::isSafePath(const QString& aPath)
+{
+    QString path = QString(aPath).replace('\\', '/');
+
+    if(path.isEmpty() || path.startsWith('/') || (path.size() > 1 && path.at(1) == ':'))
+        return false;
+
+    foreach(QString part, path.split('/'))
+        if(part == "..")
+            return false;
+
+    return true;
+}
+
+/*!
+Returns the directory an archive \a aArchive is extracted to while it is downloaded
+\sa ArchiveExtractor::commitStaged
+*/
+QString ArchiveExtractor::stagingDir(const QString& aArchive)
+{
+    return aArchive + UPDATENODE_EXTRACT_SUFFIX;
+}
+
+/*!
+Moves all files extracted to \a aStaging into \a aTarget, and removes \a aStaging afterwards.
+If \a aMove is false, or a file cannot be renamed, e.g. as the target is on another file system,
+it is copied by UpdateNode::FileCopier instead. Each file is replaced atomically.
+\n Returns true on success, otherwise false
+*/
+bool ArchiveExtractor::commitStaged(const QString& aStaging, const QString& aTarget, bool aMove)
+{
+    QDir staging(aStaging);
+    QStringList entries;
+
+    // the list is taken first, as moving files would change the directories while iterating them
+    QDirIterator it(aStaging, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden, QDirIterator::Subdirectories);
+    while(it.hasNext())
+        entries << it.next();
+
+    foreach(QString entry, entries)
+    {
+        QString target = QDir::cleanPath(aTarget + "/" + staging.relativeFilePath(entry));
+
+        if(QFileInfo(entry).isDir())
+        {
+            if(!QDir().mkpath(target))
+                return false;
+            continue;
+        }
+
+        if(!QDir().mkpath(QFileInfo(target).absolutePath()))
+            return false;
+
+        if(aMove && PartFile::replace(entry, target))
+            continue;
+
+        UpdateNode::FileCopier copier(entry, target);
+        if(!copier.copy())
+        {
+            UpdateNode::Logging() << "Could not install " << target << ": " << copier.errorString();
+            return false;
+        }
+    }
+
+    removeTree(aStaging);
+
+    return true;
+}
+
+/*!
+Removes the directory \a aPath with all its content. Links are removed, but not followed.
+\n Returns true if \a aPath does not exist anymore
+*/
+bool ArchiveExtractor::removeTree(const QString& aPath)
+{
+    QDir dir(aPath);
+    if(!dir.exists())
+        return true;
+
+    foreach(QFileInfo info, dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System))
+    {
+        if(info.isDir() && !info.isSymLink())
+        {
+            if(!removeTree(info.absoluteFilePath()))
+                return false;
+        }
+        else if(!dir.remove(info.fileName()))
+            return false;
+    }
+
+    return QDir().rmdir(aPath);
+}
+
+/*!
+Detects the format of the archive from the data written so far.
+\n Returns false if more data is needed, or the format is not supported
+*/
+bool ArchiveExtractor::detect()
+{
+    if(m_oInput.size() >= 2 && (uchar)m_oInput.at(0) == 0x1f && (uchar)m_oInput.at(1) == 0x8b)
+        m_eFormat = FORMAT_TAR_GZ;
+    else if(m_oInput.size() >= 4 && m_oInput.startsWith("PK\x03\x04"))
+        m_eFormat = FORMAT_ZIP;
+    else if(m_oInput.size() >= 262)
+    {
+        // only POSIX and GNU tar archives carry a magic
+        if(m_oInput.mid(257, 5) != "ustar")
+            return fail("Unsupported archive format");
+        m_eFormat = FORMAT_TAR;
+    }
+    else
+        return false;
+
+    if(!isSupported(m_eFormat))
+        return fail("tar.gz archives are not supported without zlib");
+
+#ifdef UPDATENODE_ZLIB
+    if(m_eFormat == FORMAT_TAR_GZ)
+    {
+        if(inflateInit2(&m_oGzip, 16 + MAX_WBITS) != Z_OK)
+            return fail("Could not initialize zlib");
+        m_bGzip = true;
+    }
+#endif
+
+    return true;
+}
+
+/*!
+Passes \a aData to the parser of the detected format
+*/
+bool ArchiveExtractor::feed(const QByteArray& aData)
+{
+    if(m_eFormat == FORMAT_TAR_GZ)
+        return inflateInput(aData);
+
+    if(m_eState == STATE_END)
+    {
+        // only the central directory of a zip archive is of interest behind the last entry
+        if(m_eFormat == FORMAT_ZIP && m_oBuffer.size() < 16 * 1024 * 1024)
+            m_oBuffer.append(aData);
+        return true;
+    }
+
+    append(aData.constData(), aData.size());
+
+    if(m_eFormat == FORMAT_ZIP)
+        return processZip();
+
+    return processTar();
+}
+
+/*!
+Decompresses the gzip data \a aData in chunks of UPDATENODE_EXTRACT_BUFFER bytes and passes them to the tar parser
+*/
+bool ArchiveExtractor::inflateInput(const QByteArray& aData)
+{
+#ifdef UPDATENODE_ZLIB
+    QByteArray& chunk = output();
+
+    m_oGzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(aData.constData()));
+    m_oGzip.avail_in = aData.size();
+
+    int ret;
+
+    do
+    {
+        m_oGzip.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        m_oGzip.avail_out = chunk.size();
+
+        ret = inflate(&m_oGzip, Z_NO_FLUSH);
+        if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            return fail(QString("Corrupt gzip data: %1").arg(QString::fromLatin1(m_oGzip.msg ? m_oGzip.msg : "")));
+
+        append(chunk.constData(), chunk.size() - m_oGzip.avail_out);
+        if(!processTar())
+            return false;
+    }
+    while(ret == Z_OK && m_eState != STATE_END && (m_oGzip.avail_in > 0 || m_oGzip.avail_out == 0));
+
+    return true;
+#else
+    Q_UNUSED(aData);
+    return fail("tar.gz archives are not supported without zlib");
+#endif
+}
+
+/*!
+Parses as many tar blocks as available
+*/
+bool ArchiveExtractor::processTar()
+{
+    while(true)
+    {
+        if(m_eState == STATE_END)
+        {
+            m_oBuffer.clear();
+            m_iPosition = 0;
+            return true;
+        }
+
+        if(m_eState == STATE_HEADER)
+        {
+            if(available() < 512)
+                return true;
+
+            QByteArray header = m_oBuffer.mid(m_iPosition, 512);
+            m_iPosition += 512;
+
+            if(!readTarHeader(header))
+                return false;
+            continue;
+        }
+
+        qint64 size = qMin(m_iRemaining, (qint64)available());
+        if(size > 0)
+        {
+            if(m_iMeta)
+                m_oMeta.append(current(), size);
+            else if(m_eState == STATE_DATA && !writeEntry(current(), size))
+                return false;
+
+            m_iPosition += size;
+            m_iRemaining -= size;
+        }
+
+        // entries are padded to the block size
+        size = qMin(m_iPadding, (qint64)available());
+        m_iPosition += size;
+        m_iPadding -= size;
+
+        if(m_iRemaining > 0 || m_iPadding > 0)
+            return true;
+
+        if(m_eState == STATE_DATA && !closeEntry())
+            return false;
+
+        if(m_iMeta)
+            readTarMeta();
+
+        m_eState = STATE_HEADER;
+    }
+}
+
+/*!
+Reads the tar header block \a aHeader and prepares the extraction of its entry
+*/
+bool ArchiveExtractor::readTarHeader(const QByteArray& aHeader)
+{
+    if(aHeader.count('\0') == aHeader.size())
+    {
+        m_eState = STATE_END;
+        return true;
+    }
+
+    // the checksum is calculated with spaces in place of the checksum field
+    qint64 sum = 0;
+    for(int i = 0; i < aHeader.size(); i++)
+        sum += (i >= 148 && i < 156) ? ' ' : (uchar)aHeader.at(i);
+
+    qint64 size = tarNumber(aHeader.mid(124, 12));
+    if(sum != tarNumber(aHeader.mid(148, 8)) || size < 0)
+        return fail("Corrupt tar header");
+
+    char type = aHeader.at(156);
+    QString name = tarString(aHeader.mid(0, 100));
+    // the prefix field exists in POSIX archives only, GNU archives use long names instead
+    if(aHeader.mid(257, 6) == QByteArray("ustar\0", 6) && aHeader.at(345) != '\0')
+        name = tarString(aHeader.mid(345, 155)) + "/" + name;
+    if(!m_strLongName.isEmpty())
+        name = m_strLongName;
+    m_strLongName.clear();
+
+    m_iRemaining = size;
+    m_iPadding = (512 - size % 512) % 512;
+    m_iMode = qMax(Q_INT64_C(0), tarNumber(aHeader.mid(100, 8))) & 0777;
+    m_iMeta = 0;
+    m_eState = STATE_SKIP;
+
+    switch(type)
+    {
+        case '0':
+        case '\0':
+        case '7':
+            if(!openEntry(name))
+                return false;
+            m_eState = STATE_DATA;
+            break;
+        case '5':
+            if(!isSafePath(name))
+                return fail(QString("Unsafe path in archive: %1").arg(name));
+            if(!QDir().mkpath(QDir::cleanPath(m_strTarget + "/" + name)))
+                return fail(QString("Could not create directory %1").arg(name));
+            m_iEntries++;
+            break;
+        case 'L':
+        case 'x':
+            // GNU long name, or POSIX extended header of the next entry
+            if(size > 1024 * 1024)
+                return fail("Corrupt tar header");
+            m_iMeta = type;
+            m_oMeta.clear();
+            break;
+        case '1':
+        case '2':
+            UpdateNode::Logging() << "Skipping link " << name;
+            break;
+        default:
+            break;
+    }
+
+    return true;
+}
+
+/*!
+Takes the name of the next entry from a GNU long name or POSIX extended header
+*/
+void ArchiveExtractor::readTarMeta()
+{
+    if(m_iMeta == 'L')
+        m_strLongName = tarString(m_oMeta);
+    else
+    {
+        // records of the form "<length> <key>=<value>\n"
+        int pos = 0;
+        while(pos < m_oMeta.size())
+        {
+            int space = m_oMeta.indexOf(' ', pos);
+            int length = space > pos ? m_oMeta.mid(pos, space - pos).toInt() : 0;
+            if(length <= space - pos + 1 || pos + length > m_oMeta.size())
+                break;
+
+            QByteArray record = m_oMeta.mid(space + 1, length - (space - pos) - 2);
+            if(record.startsWith("path="))
+                m_strLongName = QString::fromUtf8(record.mid(5));
+            pos += length;
+        }
+    }
+
+    m_iMeta = 0;
+    m_oMeta.clear();
+}
+
+/*!
+Parses as many zip entries as available. Stops at the central directory, which is read by ArchiveExtractor::finish
+*/
+bool ArchiveExtractor::processZip()
+{
+    bool progress = true;
+
+    while(progress)
+    {
+        switch(m_eState)
+        {
+            case STATE_HEADER:
+                progress = readZipHeader();
+                break;
+            case STATE_DATA:
+                progress = readZipData();
+                break;
+            case STATE_SKIP:
+                progress = readZipSkip();
+                break;
+            case STATE_DESCRIPTOR:
+                progress = readZipDescriptor();
+                break;
+            default:
+                progress = false;
+                break;
+        }
+    }
+
+    return !m_bFailed;
+}
+
+/*!
+Reads a local file header of a zip archive and prepares the extraction of its entry
+\n Returns false if more data is needed, or the entry cannot be extracted
+*/
+bool ArchiveExtractor::readZipHeader()
+{
+    if(available() < 4)
+        return false;
+
+    quint32 signature = littleEndian(m_oBuffer, m_iPosition, 4);
+    if(signature == 0x02014b50 || signature == 0x06054b50)
+    {
+        m_eState = STATE_END;
+        return false;
+    }
+
+    if(signature != 0x04034b50)
+        return fail("Corrupt zip header");
+
+    if(available() < 30)
+        return false;
+
+    int nameLength = littleEndian(m_oBuffer, m_iPosition + 26, 2);
+    int extraLength = littleEndian(m_oBuffer, m_iPosition + 28, 2);
+    if(available() < 30 + nameLength + extraLength)
+        return false;
+
+    quint32 flags = littleEndian(m_oBuffer, m_iPosition + 6, 2);
+    quint32 compressed = littleEndian(m_oBuffer, m_iPosition + 18, 4);
+    QString name = QString::fromUtf8(m_oBuffer.mid(m_iPosition + 30, nameLength));
+    m_iMethod = littleEndian(m_oBuffer, m_iPosition + 8, 2);
+    m_iExpectedCrc = littleEndian(m_oBuffer, m_iPosition + 14, 4);
+    m_bDescriptor = flags & 0x08;
+    m_iPosition += 30 + nameLength + extraLength;
+
+    if(flags & 0x01)
+        return fail(QString("Encrypted entry %1 is not supported").arg(name));
+    if(compressed == 0xffffffff)
+        return fail("ZIP64 archives are not supported");
+
+    m_iMode = 0;
+    m_iRemaining = compressed;
+
+    if(name.endsWith('/'))
+    {
+        if(!isSafePath(name))
+            return fail(QString("Unsafe path in archive: %1").arg(name));
+        if(!QDir().mkpath(QDir::cleanPath(m_strTarget + "/" + name)))
+            return fail(QString("Could not create directory %1").arg(name));
+        m_iEntries++;
+        m_eState = STATE_SKIP;
+        return true;
+    }
+
+    if(m_iMethod == 0 && m_bDescriptor)
+        return fail(QString("Stored entry %1 without size cannot be extracted").arg(name));
+
+#ifdef UPDATENODE_ZLIB
+    if(m_iMethod == 8)
+    {
+        int ret = m_bInflate ? inflateReset(&m_oInflate) : inflateInit2(&m_oInflate, -MAX_WBITS);
+        if(ret != Z_OK)
+            return fail("Could not initialize zlib");
+        m_bInflate = true;
+    }
+    else
+#endif
+    if(m_iMethod != 0)
+        return fail(QString("Compression method %1 of %2 is not supported").arg(m_iMethod).arg(name));
+
+    if(!openEntry(name))
+        return false;
+
+    m_eState = STATE_DATA;
+    return true;
+}
+
+/*!
+Extracts the data of the current zip entry as far as available
+\n Returns false if more data is needed, or extraction failed
+*/
+bool ArchiveExtractor::readZipData()
+{
+    if(m_iMethod == 0)
+    {
+        qint64 size = qMin(m_iRemaining, (qint64)available());
+        if(size > 0 && !writeEntry(current(), size))
+            return false;
+
+        m_iPosition += size;
+        m_iRemaining -= size;
+
+        if(m_iRemaining > 0)
+            return false;
+
+        m_eState = STATE_HEADER;
+        return closeEntry();
+    }
+
+#ifdef UPDATENODE_ZLIB
+    // with a data descriptor, the size is unknown and the end of the deflate stream ends the entry
+    qint64 input = m_bDescriptor ? available() : qMin(m_iRemaining, (qint64)available());
+    if(input == 0)
+        return false;
+
+    QByteArray& chunk = output();
+    int ret;
+
+    m_oInflate.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(current()));
+    m_oInflate.avail_in = input;
+
+    do
+    {
+        m_oInflate.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        m_oInflate.avail_out = chunk.size();
+
+        ret = inflate(&m_oInflate, Z_NO_FLUSH);
+        if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            return fail(QString("Corrupt deflate data: %1").arg(QString::fromLatin1(m_oInflate.msg ? m_oInflate.msg : "")));
+
+        if(!writeEntry(chunk.constData(), chunk.size() - m_oInflate.avail_out))
+            return false;
+    }
+    while(ret == Z_OK && (m_oInflate.avail_in > 0 || m_oInflate.avail_out == 0));
+
+    qint64 consumed = input - m_oInflate.avail_in;
+    m_iPosition += consumed;
+    m_iRemaining -= consumed;
+
+    if(ret != Z_STREAM_END)
+    {
+        if(!m_bDescriptor && m_iRemaining == 0)
+            return fail("Corrupt deflate data");
+        return false;
+    }
+
+    if(m_bDescriptor)
+    {
+        m_eState = STATE_DESCRIPTOR;
+        return true;
+    }
+
+    m_eState = STATE_HEADER;
+    return closeEntry();
+#else
+    return fail("Deflated zip entries are not supported without zlib");
+#endif
+}
+
+/*!
+Reads the data descriptor behind a zip entry, which holds its CRC-32, and finishes the entry
+\n Returns false if more data is needed, or the entry is corrupt
+*/
+bool ArchiveExtractor::readZipDescriptor()
+{
+    // the signature of the descriptor is optional
+    if(available() < 16)
+        return false;
+
+    int offset = littleEndian(m_oBuffer, m_iPosition, 4) == 0x08074b50 ? 4 : 0;
+    m_iExpectedCrc = littleEndian(m_oBuffer, m_iPosition + offset, 4);
+    m_iPosition += offset + 12;
+
+    m_eState = STATE_HEADER;
+    return !m_pFile || closeEntry();
+}
+
+/*!
+Skips the data of a zip entry which is not extracted, e.g. a directory
+\n Returns false if more data is needed
+*/
+bool ArchiveExtractor::readZipSkip()
+{
+    qint64 size = qMin(m_iRemaining, (qint64)available());
+    m_iPosition += size;
+    m_iRemaining -= size;
+
+    if(m_iRemaining > 0)
+        return false;
+
+    m_eState = m_bDescriptor ? STATE_DESCRIPTOR : STATE_HEADER;
+    return true;
+}
+
+/*!
+Applies the Unix permissions stored in the central directory of a zip archive to the extracted files.
+Local file headers do not carry permissions, so this is only possible once the whole archive has been read.
+*/
+void ArchiveExtractor::readCentralDirectory()
+{
+    int pos = m_iPosition;
+
+    while(pos + 46 <= m_oBuffer.size() && littleEndian(m_oBuffer, pos, 4) == 0x02014b50)
+    {
+        quint32 system = littleEndian(m_oBuffer, pos + 4, 2) >> 8;
+        int nameLength = littleEndian(m_oBuffer, pos + 28, 2);
+        int extraLength = littleEndian(m_oBuffer, pos + 30, 2);
+        int commentLength = littleEndian(m_oBuffer, pos + 32, 2);
+        quint32 attributes = littleEndian(m_oBuffer, pos + 38, 4);
+        QString name = QString::fromUtf8(m_oBuffer.mid(pos + 46, nameLength));
+
+        // only archives created on Unix carry permissions
+        if(system == 3 && m_mapFiles.contains(name))
+            applyMode(m_mapFiles.value(name), (attributes >> 16) & 0777);
+
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+
+    m_oBuffer.clear();
+    m_iPosition = 0;
+}
+
+/*!
+Appends \a aSize bytes of \a aData to the data to be parsed. The data parsed already is dropped once
+per chunk only, not once per entry, so archives with many small entries are not copied over and over.
+*/
+void ArchiveExtractor::append(const char* aData, qint64 aSize)
+{
+    if(m_iPosition > 0)
+    {
+        m_oBuffer.remove(0, m_iPosition);
+        m_iPosition = 0;
+    }
+
+    m_oBuffer.append(aData, aSize);
+}
+
+/*!
+Returns the buffer of UPDATENODE_EXTRACT_BUFFER bytes data is inflated to, which is allocated once only
+*/
+QByteArray& ArchiveExtractor::output()
+{
+    if(m_oOutput.isEmpty())
+        m_oOutput.resize(UPDATENODE_EXTRACT_BUFFER);
+
+    return m_oOutput;
+}
+
+/*!
+Returns the number of bytes not parsed yet
+*/
+int ArchiveExtractor::available() const
+{
+    return m_oBuffer.size() - m_iPosition;
+}
+
+/*!
+Returns the first byte not parsed yet
+*/
+const char* ArchiveExtractor::current() const
+{
+    return m_oBuffer.constData() + m_iPosition;
+}
+
+/*!
+Removes the temporary file of the entry currently extracted
+*/
+void ArchiveExtractor::discardEntry()
+{
+    if(!m_pFile)
+        return;
+
+    m_pFile->close();
+    QFile::remove(m_pFile->fileName());
+    delete m_pFile;
+    m_pFile = NULL;
+}
+
+/*!
+Opens a temporary file for the entry \a aName next to its destination
+*/
+bool ArchiveExtractor::openEntry(const QString& aName)
+{
+    if(!isSafePath(aName))
+        return fail(QString("Unsafe path in archive: %1").arg(aName));
+
+    QFileInfo info(QDir::cleanPath(m_strTarget + "/" + aName));
+    if(!QDir().mkpath(info.absolutePath()))
+        return fail(QString("Could not create directory %1").arg(info.absolutePath()));
+
+    m_pFile = new QTemporaryFile(info.absolutePath() + "/." + info.fileName() + ".XXXXXX");
+    m_pFile->setAutoRemove(false);
+
+    if(!m_pFile->open())
+    {
+        QString error = m_pFile->errorString();
+        delete m_pFile;
+        m_pFile = NULL;
+        return fail(QString("Could not create %1: %2").arg(info.filePath()).arg(error));
+    }
+
+    m_strEntry = info.filePath();
+    m_mapFiles[aName] = m_strEntry;
+#ifdef UPDATENODE_ZLIB
+    m_iCrc = crc32(0, NULL, 0);
+#endif
+
+    return true;
+}
+
+/*!
+Writes \a aSize bytes of \a aData to the current entry
+*/
+bool ArchiveExtractor::writeEntry(const char* aData, qint64 aSize)
+{
+    if(aSize == 0)
+        return true;
+
+    if(m_pFile->write(aData, aSize) != aSize)
+        return fail(QString("Could not write %1: %2").arg(m_strEntry).arg(m_pFile->errorString()));
+
+#ifdef UPDATENODE_ZLIB
+    m_iCrc = crc32(m_iCrc, reinterpret_cast<const Bytef*>(aData), aSize);
+#endif
+
+    return true;
+}
+
+/*!
+Syncs the current entry, and moves it to its destination
+*/
+bool ArchiveExtractor::closeEntry()
+{
+#ifdef UPDATENODE_ZLIB
+    if(m_eFormat == FORMAT_ZIP && m_iCrc != m_iExpectedCrc)
+        return fail(QString("Checksum mismatch for %1").arg(m_strEntry));
+#endif
+
+    bool synced = PartFile::sync(*m_pFile);
+    QString temporary = m_pFile->fileName();
+    m_pFile->close();
+
+    applyMode(temporary, m_iMode);
+
+    if(!synced || !PartFile::replace(temporary, m_strEntry))
+        return fail(QString("Could not move %1 to %2").arg(temporary).arg(m_strEntry));
+
+    delete m_pFile;
+    m_pFile = NULL;
+    m_iEntries++;
+
+    return true;
+}
+
+/*!
+Stores \a aError, removes the current temporary file and stops the extraction
+\n Always returns false
+*/
+bool ArchiveExtractor::fail(const QString& aError)
+{
+    m_strError = aError;
+    m_bFailed = true;
+
+    discardEntry();
+
+    return false;
+}
+
+/*!
+Returns the value of the numeric tar header field \a aField, which is octal or, for large values, base-256
+\n Returns -1 if the field is invalid
+*/
+qint64 ArchiveExtractor::tarNumber(const QByteArray& aField)
+{
+    if(!aField.isEmpty() && ((uchar)aField.at(0) & 0x80))
+    {
+        qint64 value = (uchar)aField.at(0) & 0x7f;
+        for(int i = 1; i < aField.size(); i++)
+            value = (value << 8) | (uchar)aField.at(i);
+        return value;
+    }
+
+    QByteArray field = aField;
+    if(field.indexOf('\0') > -1)
+        field.truncate(field.indexOf('\0'));
+    field = field.trimmed();
+
+    if(field.isEmpty())
+        return 0;
+
+    bool ok;
+    qint64 value = field.toLongLong(&ok, 8);
+
+    return ok ? value : -1;
+}
+
+/*!
+Returns the zero terminated string of the tar header field \a aField
+*/
+QString ArchiveExtractor::tarString(const QByteArray& aField)
+{
+    int end = aField.indexOf('\0');
+    return QString::fromUtf8(end > -1 ? aField.left(end) : aField);
+}
+
+/*!
+Returns the unsigned little endian number of \a aSize bytes at \a aOffset of \a aData
+*/
+quint32 ArchiveExtractor::littleEndian(const QByteArray& aData, int aOffset, int aSize)
+{
+    quint32 value = 0;
+    for(int i = aSize - 1; i >= 0; i--)
+        value = (value << 8) | (uchar)aData.at(aOffset + i);
+    return value;
+}
+
+/*!
+Returns UPDATENODE_EXTRACT_MODE, masked by the umask of the process like any newly created file
+*/
+quint32 ArchiveExtractor::defaultMode()
+{
+#ifdef Q_OS_UNIX
+    mode_t mask = ::umask(0);
+    ::umask(mask);
+    return UPDATENODE_EXTRACT_MODE & ~mask;
+#else
+    return UPDATENODE_EXTRACT_MODE;
+#endif
+}
+
+/*!
+Sets the permissions of \a aFile to the Unix mode \a aMode. A mode of 0, as for zip entries created on Windows,
+stands for ArchiveExtractor::defaultMode: the temporary files are created readable by the user only, which is
+not what an installed file should be
+*/
+void ArchiveExtractor::applyMode(const QString& aFile, quint32 aMode)
+{
+    if(aMode == 0)
+        aMode = defaultMode();
+
+    QFile::Permissions permissions;
+    if(aMode & 0400) permissions |= QFile::ReadOwner | QFile::ReadUser;
+    if(aMode & 0200) permissions |= QFile::WriteOwner | QFile::WriteUser;
+    if(aMode & 0100) permissions |= QFile::ExeOwner | QFile::ExeUser;
+    if(aMode & 0040) permissions |= QFile::ReadGroup;
+    if(aMode & 0020) permissions |= QFile::WriteGroup;
+    if(aMode & 0010) permissions |= QFile::ExeGroup;
+    if(aMode & 0004) permissions |= QFile::ReadOther;
+    if(aMode & 0002) permissions |= QFile::WriteOther;
+    if(aMode & 0001) permissions |= QFile::ExeOther;
+
+    QFile::setPermissions(aFile, permissions);
+}
@@ -0,0 +1,293 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStringList>
+#include <QMap>
+#include <QCryptographicHash>
+
+#include "cachemanager.h"
+#include "localfile.h"
+#include "partfile.h"
+#include "archiveextractor.h"
+#include "config.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::CacheManager
+\brief Content addressed store for downloaded update files
+\n\n
+Each file is stored once by its SHA-256 checksum as "<blob path>/<sha256>/<file name>", no matter
+how many products or keys refer to it. An index next to the blobs maps urls and update codes to
+checksums and remembers when a blob has been used last.
+\n CacheManager::evict removes the least recently used blobs once the cache exceeds its quota.
+Blobs of updates which have not been installed yet are pinned and never evicted.
+\sa LocalFile::getBlobPath
+*/
+
+/*!
+Constructs a CacheManager working on the index in LocalFile::getBlobPath
+*/
+CacheManager::CacheManager()
+    : m_oIndex(LocalFile::getBlobPath() + QDir::separator() + UPDATENODE_CACHE_INDEX, QSettings::IniFormat)
+{
+}
+
+/*!
+Moves the downloaded file \a aFileName with checksum \a aHash into the cache. If the same content
+is already stored, \a aFileName is removed instead. The blob is indexed by \a aUrl and \a aCode and
+pinned until the update is installed.
+\n Returns the location of the blob, or an empty string if the file could not be stored
+\sa CacheManager::unpin
+*/
+QString CacheManager::store(const QString& aFileName, const QString& aHash, const QUrl& aUrl, const QString& aCode)
+{
+    if(aHash.isEmpty() || !QFile::exists(aFileName))
+        return QString();
+
+    QString hash = aHash.toLower();
+    QString blob = find(hash);
+
+    if(!blob.isEmpty())
+    {
+        UpdateNode::Logging() << aFileName << " is already cached as " << blob;
+        QFile::remove(aFileName);
+    }
+    else
+    {
+        QString dir = LocalFile::getBlobPath() + QDir::separator() + hash;
+        blob = QDir::toNativeSeparators(dir + QDir::separator() + QFileInfo(aFileName).fileName());
+
+        if(!QDir().mkpath(dir) || !PartFile::replace(aFileName, blob))
+        {
+            UpdateNode::Logging() << "Could not move " << aFileName << " into the cache";
+            return QString();
+        }
+
+        m_oIndex.setValue("Blobs/" + hash + "/File", QFileInfo(blob).fileName());
+        m_oIndex.setValue("Blobs/" + hash + "/Size", QFileInfo(blob).size());
+    }
+
+    if(!aUrl.isEmpty())
+        m_oIndex.setValue("Urls/" + QCryptographicHash::hash(aUrl.toEncoded(), QCryptographicHash::Md5).toHex(), hash);
+
+    use(hash, aCode);
+    evict(UpdateNode::Config::Instance()->getCacheQuota());
+
+    return blob;
+}
+
+/*!
+Returns the location of the blob with checksum \a aHash and marks it as used. Returns an empty
+string if the blob is not in the cache, or has been modified
+*/
+QString CacheManager::find(const QString& aHash)
+{
+    if(aHash.isEmpty())
+        return QString();
+
+    QString hash = aHash.toLower();
+    QString blob = blobFile(hash);
+
+    if(blob.isEmpty())
+        return QString();
+
+    if(QFileInfo(blob).size() != m_oIndex.value("Blobs/" + hash + "/Size", -1).toLongLong())
+    {
+        UpdateNode::Logging() << "Cached file " << blob << " has been modified";
+        remove(hash);
+        return QString();
+    }
+
+    m_oIndex.setValue("Blobs/" + hash + "/Used", QDateTime::currentDateTime());
+
+    return blob;
+}
+
+/*!
+Returns the location of the blob which has been downloaded from \a aUrl, or an empty string
+\sa CacheManager::find
+*/
+QString CacheManager::findByUrl(const QUrl& aUrl)
+{
+    return find(m_oIndex.value("Urls/" + QCryptographicHash::hash(aUrl.toEncoded(), QCryptographicHash::Md5).toHex()).toString());
+}
+
+/*!
+Marks the blob with checksum \a aHash as used by the update \a aCode of the current key and pins it
+*/
+void CacheManager::use(const QString& aHash, const QString& aCode)
+{
+    QString hash = aHash.toLower();
+
+    m_oIndex.setValue("Blobs/" + hash + "/Used", QDateTime::currentDateTime());
+
+    if(aCode.isEmpty())
+        return;
+
+    // a new version of the update does not need the old file anymore
+    QString previous = m_oIndex.value("Codes/" + pinId(aCode)).toString();
+    if(!previous.isEmpty() && previous != hash)
+        unpin(aCode);
+
+    m_oIndex.setValue("Codes/" + pinId(aCode), hash);
+
+    QStringList pins = m_oIndex.value("Blobs/" + hash + "/Pins").toStringList();
+    if(!pins.contains(pinId(aCode)))
+        m_oIndex.setValue("Blobs/" + hash + "/Pins", pins << pinId(aCode));
+}
+
+/*!
+Releases the pin of update \a aCode of the current key, e.g. after it has been installed.
+The blob stays in the cache until it gets evicted
+*/
+void CacheManager::unpin(const QString& aCode)
+{
+    QString hash = m_oIndex.value("Codes/" + pinId(aCode)).toString();
+
+    if(hash.isEmpty())
+        return;
+
+    QStringList pins = m_oIndex.value("Blobs/" + hash + "/Pins").toStringList();
+    pins.removeAll(pinId(aCode));
+    m_oIndex.setValue("Blobs/" + hash + "/Pins", pins);
+}
+
+/*!
+Returns true if the blob with checksum \a aHash is needed by an update which has not been installed yet
+*/
+bool CacheManager::isPinned(const QString& aHash)
+{
+    return !m_oIndex.value("Blobs/" + aHash.toLower() + "/Pins").toStringList().isEmpty();
+}
+
+/*!
+Returns the size of all blobs in bytes
+*/
+qint64 CacheManager::size()
+{
+    qint64 total = 0;
+
+    m_oIndex.beginGroup("Blobs");
+    QStringList hashes = m_oIndex.childGroups();
+    m_oIndex.endGroup();
+
+    foreach(QString hash, hashes)
+        total += m_oIndex.value("Blobs/" + hash + "/Size").toLongLong();
+
+    return total;
+}
+
+/*!
+Removes the least recently used blobs until the cache is smaller than \a aQuota bytes. Pinned
+blobs are never removed. A quota of 0 disables the eviction
+*/
+void CacheManager::evict(qint64 aQuota)
+{
+    if(aQuota <= 0)
+        return;
+
+    qint64 total = size();
+    if(total <= aQuota)
+        return;
+
+    m_oIndex.beginGroup("Blobs");
+    QStringList hashes = m_oIndex.childGroups();
+    m_oIndex.endGroup();
+
+    // oldest first
+    QMap<QDateTime, QString> candidates;
+    foreach(QString hash, hashes)
+        if(!isPinned(hash))
+            candidates.insertMulti(m_oIndex.value("Blobs/" + hash + "/Used").toDateTime(), hash);
+
+    foreach(QString hash, candidates.values())
+    {
+        if(total <= aQuota)
+            break;
+
+        UpdateNode::Logging() << "Evicting " << hash << " from the cache";
+        total -= m_oIndex.value("Blobs/" + hash + "/Size").toLongLong();
+        remove(hash);
+    }
+}
+
+/*!
+Returns the file of the blob with checksum \a aHash, or an empty string if it does not exist
+*/
+QString CacheManager::blobFile(const QString& aHash)
+{
+    QString name = m_oIndex.value("Blobs/" + aHash + "/File").toString();
+
+    if(name.isEmpty())
+        return QString();
+
+    QString blob = QDir::toNativeSeparators(LocalFile::getBlobPath() + QDir::separator() + aHash + QDir::separator() + name);
+
+    if(!QFile::exists(blob))
+    {
+        remove(aHash);
+        return QString();
+    }
+
+    return blob;
+}
+
+/*!
+Returns the identifier of update \a aCode of the current key, used to pin blobs
+*/
+QString CacheManager::pinId(const QString& aCode) const
+{
+    return UpdateNode::Config::Instance()->getKeyHashed() + "_" + aCode;
+}
+
+/*!
+Deletes the blob with checksum \a aHash and all references to it from the index
+*/
+void CacheManager::remove(const QString& aHash)
+{
+    QDir dir(LocalFile::getBlobPath() + QDir::separator() + aHash);
+    foreach(QString file, dir.entryList(QDir::Files))
+        dir.remove(file);
+    // archives extracted while downloading, see ArchiveExtractor::stagingDir
+    foreach(QString staging, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        ArchiveExtractor::removeTree(dir.filePath(staging));
+    QDir(LocalFile::getBlobPath()).rmdir(aHash);
+
+    m_oIndex.remove("Blobs/" + aHash);
+
+    QStringList groups;
+    groups << "Urls" << "Codes";
+    foreach(QString group, groups)
+    {
+        m_oIndex.beginGroup(group);
+        foreach(QString key, m_oIndex.childKeys())
+            if(m_oIndex.value(key).toString() == aHash)
+                m_oIndex.remove(key);
+        m_oIndex.endGroup();
+    }
+}
@@ -21,6 +21,7 @@
 ****************************************************************************/
 
 #include <QCoreApplication>
+#include <QEventLoop>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
@@ -37,6 +38,9 @@
 
 #include "wincommander.h"
 #include "commander.h"
+#include "elevatedhelper.h"
+#include "filecopier.h"
+#include "archiveextractor.h"
 #include "settings.h"
 #include "localfile.h"
 #include "version.h"
@@ -126,6 +130,16 @@ UN_LANG             | Language set in unclient, or system\n language if no langu
 UN_OS               | Operating system's name and version | Windows 6.2
 UN_ARCH             | Operating system's architecture     | x86
 UN_CUSTOM           | Custom request value                | NoServer
+\n\n
+Built-in Commands
+-------------------------
+If the command of an update is one of the following, no external program is started. The commandline
+needs to contain exactly two parameters then:
+\n
+Command             | Description                         | Commandline
+-------------       | -------------                       | -------------
+UN_COPY_COMMAND     | Copies a file, see Commander::copy  | "[UN_FILE]" "/opt/product/bin/tool"
+UN_EXTRACT_COMMAND  | Extracts a tar, tar.gz or zip archive\n to a directory, see Commander::extract | "[UN_FILE]" "/opt/product"
 
 */
 
@@ -136,6 +150,13 @@ Commander::Commander(QObject *parent)
     : QObject(parent)
 {
     m_bCopy = false;
+    m_bExtract = false;
+#ifdef UPDATENODE_HELPER_SUPPORTED
+    m_bHelper = true;
+#else
+    m_bHelper = false;
+#endif
+    m_iHelperRequest = 0;
     m_pProcess = new QProcess(this);
     connect(m_pProcess, SIGNAL(readyReadStandardError()), this, SIGNAL(processError()));
     connect(m_pProcess, SIGNAL(readyReadStandardOutput()), this, SIGNAL(processOutput()));
@@ -188,6 +209,16 @@ void Commander::setUpdate(const Update &aUpdate)
     m_oUpdate = aUpdate;
 }
 
+/*!
+Sets whether updates requiring admin privileges are run through UpdateNode::ElevatedHelper \a aHelper,
+so the password is asked only once for all updates. Enabled by default where UPDATENODE_HELPER_SUPPORTED is defined,
+otherwise each update is elevated on its own
+*/
+void Commander::setElevatedHelper(bool aHelper)
+{
+    m_bHelper = aHelper;
+}
+
 /*!
 Checks whether the current process is already elevated, or not
 */
@@ -208,11 +239,19 @@ bool Commander::run(const UpdateNode::Update& aUpdate)
     QStringList commandParameters;
 
     m_bCopy = false;
+    m_bExtract = false;
     m_oUpdate = aUpdate;
 
     command = setCommandBasedOnOS();
 
-    QString filename = UpdateNode::LocalFile::getDownloadLocation(m_oUpdate.getDownloadLink());
+#ifdef UPDATENODE_HELPER_SUPPORTED
+    // the helper is elevated already, the command is passed to it as if no elevation was needed
+    bool helper = m_bHelper && !command.isEmpty() && UpdateNode::ElevatedHelper::Instance()->start(command);
+    if(helper)
+        command.clear();
+#endif
+
+    QString filename = UpdateNode::LocalFile::getUpdateLocation(m_oUpdate);
     QFile file(filename);
     file.setPermissions(QFile::ExeUser | QFile::ReadUser | QFile::WriteUser);
 
@@ -233,30 +272,48 @@ bool Commander::run(const UpdateNode::Update& aUpdate)
 
     commandParameters.removeAll("");
 
-    if(m_bCopy && commandParameters.size() == 2 && (!m_oUpdate.isAdminRequired() || UpdateNode::Commander::isProcessElevated()))
+    // copy and extract are built into unclient, elevated they are run as "unclient -copy" or "unclient -extract"
+    bool builtin = m_bCopy || m_bExtract;
+    QString option = m_bCopy ? "-copy" : "-extract";
+
+    if(builtin && commandParameters.size() == 2 && (!m_oUpdate.isAdminRequired() || UpdateNode::Commander::isProcessElevated()))
     {
-        bool ret = copy(commandParameters.at(0), commandParameters.at(1));
+        bool ret = m_bCopy ? copy(commandParameters.at(0), commandParameters.at(1)) : extract(commandParameters.at(0), commandParameters.at(1));
         if(ret)
             emit updateExit(0, QProcess::NormalExit);
         else
             emit updateExit(-1, QProcess::NormalExit);
     }
-    else if(m_bCopy && commandParameters.size() != 2)
+#ifdef UPDATENODE_HELPER_SUPPORTED
+    else if(builtin && commandParameters.size() == 2 && helper)
     {
-        UpdateNode::Logging() << "Copy command needs two parameters for source and destination file. Forgot quotes?";
+        // done by the elevated helper itself, without starting unclient -copy or -extract for it
+        connectHelper();
+        if(m_bCopy)
+            m_iHelperRequest = UpdateNode::ElevatedHelper::Instance()->copy(commandParameters.at(0), commandParameters.at(1));
+        else
+            m_iHelperRequest = UpdateNode::ElevatedHelper::Instance()->extract(commandParameters.at(0), commandParameters.at(1));
+    }
+#endif
+    else if(builtin && commandParameters.size() != 2)
+    {
+        if(m_bCopy)
+            UpdateNode::Logging() << "Copy command needs two parameters for source and destination file. Forgot quotes?";
+        else
+            UpdateNode::Logging() << "Extract command needs two parameters for archive and target directory. Forgot quotes?";
         UpdateNode::Logging() << "Parameters are: " << commandParameters.join(" ");
         emit updateExit(-2, QProcess::NormalExit);
         return false;
     }
     else
     {
-        // if copy is here, it needs to be run as root. Adjust the parameter
-        if(m_bCopy)
+        // if copy or extract is here, it needs to be run as root. Adjust the parameter
+        if(builtin)
         {
             if(command.isEmpty())
             {
                 command = qApp->applicationFilePath();
-                commandParameters.insert(0, "-copy");
+                commandParameters.insert(0, option);
             }
             else
             {
@@ -266,16 +323,16 @@ bool Commander::run(const UpdateNode::Update& aUpdate)
                     description = m_oUpdate.getTitle() ;
 
                 if(command.indexOf("gksudo")>-1)
-                    commandParameters = splitCommandLine("--description \"" + description + "\"\"" + resolve(qApp->applicationFilePath() + " -copy\" " + m_oUpdate.getCommandLine()));
+                    commandParameters = splitCommandLine("--description \"" + description + "\"\"" + resolve(qApp->applicationFilePath() + " " + option + "\" " + m_oUpdate.getCommandLine()));
                 if(command.indexOf("kdesudo")>-1)
-                    commandParameters = splitCommandLine("--comment \"" + description + " needs administrative privileges. Please enter your password.\"\"" + resolve(qApp->applicationFilePath() + " -copy\" " + m_oUpdate.getCommandLine()));
+                    commandParameters = splitCommandLine("--comment \"" + description + " needs administrative privileges. Please enter your password.\"\"" + resolve(qApp->applicationFilePath() + " " + option + "\" " + m_oUpdate.getCommandLine()));
                 else if(command.indexOf("pkexec")>-1)
-                    commandParameters = splitCommandLine(resolve(qApp->applicationFilePath() + " -copy " + m_oUpdate.getCommandLine()));
+                    commandParameters = splitCommandLine(resolve(qApp->applicationFilePath() + " " + option + " " + m_oUpdate.getCommandLine()));
                 else
-                    commandParameters = splitCommandLine("\"" + resolve(qApp->applicationFilePath() + " -copy\" " + m_oUpdate.getCommandLine()));
+                    commandParameters = splitCommandLine("\"" + resolve(qApp->applicationFilePath() + " " + option + "\" " + m_oUpdate.getCommandLine()));
 
 #else
-                commandParameters.insert(0, "-copy");
+                commandParameters.insert(0, option);
                 commandParameters.insert(0, qApp->applicationFilePath());
 #endif
             }
@@ -284,6 +341,15 @@ bool Commander::run(const UpdateNode::Update& aUpdate)
         UpdateNode::Logging() << "command:" << command;
         UpdateNode::Logging() << "commandline (without quotes):" << commandParameters.join(" ");
 
+#ifdef UPDATENODE_HELPER_SUPPORTED
+        if(helper)
+        {
+            connectHelper();
+            m_iHelperRequest = UpdateNode::ElevatedHelper::Instance()->run(command, commandParameters, QDir::currentPath());
+            return true;
+        }
+#endif
+
 #ifdef Q_OS_WIN // Windows
         if(m_oUpdate.isAdminRequired() && !UpdateNode::WinCommander::isProcessElevated())
         {
@@ -328,6 +394,14 @@ Waits forever until the current running process is not finished
 */
 bool Commander::waitForFinished()
 {
+    if(m_iHelperRequest)
+    {
+        QEventLoop loop;
+        connect(this, SIGNAL(updateExit(int, QProcess::ExitStatus)), &loop, SLOT(quit()));
+        loop.exec();
+        return true;
+    }
+
     return m_pProcess->waitForFinished(-1);
 }
 
@@ -342,8 +416,10 @@ int Commander::getReturnCode()
 /*!
 Copies a file from \a aFrom to \a aTo. Both parameters needs to be files, not directories.
 \n
+The file is copied by UpdateNode::FileCopier: \a aTo is replaced atomically, so it is never left truncated.
+\n
 Returns true if the copy command was successfully, or false in case the destination \a aTo
-file cannot be deleted or the copy command failes due to another reasons
+file cannot be replaced or the copy command failes due to another reasons
 */
 bool Commander::copy(const QString& aFrom, const QString& aTo)
 {
@@ -352,20 +428,63 @@ bool Commander::copy(const QString& aFrom, const QString& aTo)
     if(aFrom.isEmpty() || aTo.isEmpty())
         return false;
 
-    QFile file(aFrom);
-    QFile destFile(aTo);
+    if(!QFileInfo(aFrom).isFile() || QFileInfo(aTo).isDir())
+        return false;
 
-    if(!file.exists())
+    UpdateNode::FileCopier copier(aFrom, aTo);
+    if(!copier.copy())
+    {
+        UpdateNode::Logging() << "Copy failed: " << copier.errorString();
         return false;
+    }
 
-    if(QFileInfo(destFile).isFile() && destFile.exists())
-        if(!destFile.remove())
-            return false;
+    UpdateNode::Logging() << "Copied with " << UpdateNode::FileCopier::strategyName(copier.strategy());
+    return true;
+}
 
-    if(file.copy(aTo))
-        return true;
-    else
+/*!
+Extracts the tar, tar.gz or zip archive \a aArchive into the directory \a aTarget, which is created if needed.
+\n
+If UpdateNode::Downloader extracted the archive already while downloading it, the staged files are only moved
+to \a aTarget. Otherwise the archive is extracted by UpdateNode::ArchiveExtractor now. Either way, each file in
+\a aTarget is replaced atomically.
+\n
+Returns true if all entries were extracted, or false in case the archive is not supported, corrupt, contains
+an entry outside of \a aTarget, or a file cannot be written
+*/
+bool Commander::extract(const QString& aArchive, const QString& aTarget)
+{
+    UpdateNode::Logging() << QString("Extracting %1 to %2").arg(aArchive).arg(aTarget);
+
+    if(aArchive.isEmpty() || aTarget.isEmpty())
+        return false;
+
+    if(!QFileInfo(aArchive).isFile() || QFileInfo(aTarget).isFile())
+        return false;
+
+    // an elevated process copies the staged files, so they do not keep the owner and permissions of the user
+    QString staging = UpdateNode::ArchiveExtractor::stagingDir(aArchive);
+    if(QFileInfo(staging).isDir())
+    {
+        if(UpdateNode::ArchiveExtractor::commitStaged(staging, aTarget, !isProcessElevated()))
+        {
+            UpdateNode::Logging() << "Installed files extracted during download";
+            return true;
+        }
+
+        UpdateNode::Logging() << "Could not install the files extracted during download, extracting " << aArchive;
+        UpdateNode::ArchiveExtractor::removeTree(staging);
+    }
+
+    UpdateNode::ArchiveExtractor extractor(aTarget);
+    if(!extractor.extractFile(aArchive))
+    {
+        UpdateNode::Logging() << "Extraction failed: " << extractor.errorString();
         return false;
+    }
+
+    UpdateNode::Logging() << "Extracted " << extractor.entries() << " entries";
+    return true;
 }
 
 /*!
@@ -373,7 +492,10 @@ Returns data which has been written to stderr
 */
 QString Commander::readStdErr() const
 {
-    return m_pProcess->readAllStandardError();
+    QByteArray data = m_pProcess->readAllStandardError() + m_oHelperStdErr;
+    m_oHelperStdErr.clear();
+
+    return data;
 }
 
 /*!
@@ -381,12 +503,58 @@ Returns data which has been written to stdout
 */
 QString Commander::readStdOut() const
 {
-    return m_pProcess->readAllStandardOutput();
+    QByteArray data = m_pProcess->readAllStandardOutput() + m_oHelperStdOut;
+    m_oHelperStdOut.clear();
+
+    return data;
+}
+
+/*!
+Connects to the results of UpdateNode::ElevatedHelper
+*/
+void Commander::connectHelper()
+{
+    UpdateNode::ElevatedHelper* elevatedHelper = UpdateNode::ElevatedHelper::Instance();
+    connect(elevatedHelper, SIGNAL(output(int, const QByteArray&, bool)), SLOT(helperOutput(int, const QByteArray&, bool)), Qt::UniqueConnection);
+    connect(elevatedHelper, SIGNAL(finished(int, int, QProcess::ExitStatus)), SLOT(helperFinished(int, int, QProcess::ExitStatus)), Qt::UniqueConnection);
+}
+
+/*!
+Slot called when a command run by UpdateNode::ElevatedHelper has written \a aData to stdout, or to stderr if \a aError is true
+*/
+void Commander::helperOutput(int aRequest, const QByteArray& aData, bool aError)
+{
+    if(aRequest != m_iHelperRequest)
+        return;
+
+    if(aError)
+    {
+        m_oHelperStdErr.append(aData);
+        emit processError();
+    }
+    else
+    {
+        m_oHelperStdOut.append(aData);
+        emit processOutput();
+    }
+}
+
+/*!
+Slot called when a command run by UpdateNode::ElevatedHelper has ended
+*/
+void Commander::helperFinished(int aRequest, int aExitCode, QProcess::ExitStatus aExitStatus)
+{
+    if(aRequest != m_iHelperRequest)
+        return;
+
+    m_iHelperRequest = 0;
+    emit updateExit(aExitCode, aExitStatus);
 }
 
 /*!
 Resolved all variables passed as \a aString and returns the resolved string
-\note [UN_COPY_COMMAND] is a special variable which enforces to execute the UpdateNode::Commander::copy method
+\note [UN_COPY_COMMAND] is a special variable which enforces to execute the UpdateNode::Commander::copy method,
+[UN_EXTRACT_COMMAND] enforces UpdateNode::Commander::extract
 */
 QString Commander::resolve(const QString& aString)
 {
@@ -400,14 +568,18 @@ QString Commander::resolve(const QString& aString)
     theString = theString.replace("[UN_UP_TARGETVERSION]", m_oUpdate.getTargetVersion().getVersion());
     theString = theString.replace("[UN_UP_TARGETCODE]", m_oUpdate.getTargetVersion().getCode());
     theString = theString.replace("[UN_UP_TYPE]", QString::number(m_oUpdate.getType()));
-    theString = theString.replace("[UN_FILE]", UpdateNode::LocalFile::getDownloadLocation(m_oUpdate.getDownloadLink()));
-    theString = theString.replace("[UN_FILE_SIZE]",QString::number( QFileInfo(UpdateNode::LocalFile::getDownloadLocation(m_oUpdate.getDownloadLink())).size()));
-    theString = theString.replace("[UN_FILENAME]", QFileInfo(UpdateNode::LocalFile::getDownloadLocation(m_oUpdate.getDownloadLink())).fileName());
-    theString = theString.replace("[UN_FILEEXT]", QFileInfo(UpdateNode::LocalFile::getDownloadLocation(m_oUpdate.getDownloadLink())).completeSuffix());
+    QString location = UpdateNode::LocalFile::getUpdateLocation(m_oUpdate);
+    theString = theString.replace("[UN_FILE]", location);
+    theString = theString.replace("[UN_FILE_SIZE]",QString::number( QFileInfo(location).size()));
+    theString = theString.replace("[UN_FILENAME]", QFileInfo(location).fileName());
+    theString = theString.replace("[UN_FILEEXT]", QFileInfo(location).completeSuffix());
 
     if(theString.indexOf("[UN_COPY_COMMAND]")>-1)
         m_bCopy = true;
 
+    if(theString.indexOf(UPDATENODE_EXTRACT_COMMAND)>-1)
+        m_bExtract = true;
+
     return resolveGeneral(theString);
 }
 
@@ -31,6 +31,9 @@
 using namespace UpdateNode;
 
 #define DEFAULT_TIMEOUT 20
+#define DEFAULT_CACHE_QUOTA (Q_INT64_C(2048) * 1024 * 1024)
+#define DEFAULT_CONCURRENT_DOWNLOADS 2
+#define DEFAULT_CONCURRENT_INSTALLS 2
 
 /*!
 \class UpdateNode::Config
@@ -67,7 +70,15 @@ Config::Config()
     m_bSingleMode = false;
     m_bRelaunch = false;
     m_bEnforeMessages = false;
+    m_bDeltaSync = false;
+    m_bBackground = false;
     m_iTimeOut = DEFAULT_TIMEOUT;
+    m_iSegments = 1;
+    m_iConcurrentDownloads = DEFAULT_CONCURRENT_DOWNLOADS;
+    m_iConcurrentInstalls = DEFAULT_CONCURRENT_INSTALLS;
+    m_iCacheQuota = DEFAULT_CACHE_QUOTA;
+    m_iResponseTtl = 0;
+    m_iRateLimit = 0;
 }
 
 /*!
@@ -529,6 +540,208 @@ int Config::getTimeOut()
     return m_iTimeOut;
 }
 
+/*!
+Sets the number of parallel connections used for downloading a single update file.
+Values greater than 1 enable segmented downloads
+\sa Config::getSegments, UpdateNode::SegmentedDownload
+*/
+void Config::setSegments(int aSegments)
+{
+    m_iSegments = qMax(1, aSegments);
+}
+
+/*!
+Returns the number of parallel connections per update download
+\sa Config::setSegments
+*/
+int Config::getSegments()
+{
+    return m_iSegments;
+}
+
+/*!
+Sets the maximum size of the download cache in bytes. Least recently used files are removed
+when the cache grows beyond. 0 disables the limit
+\sa Config::getCacheQuota, CacheManager::evict
+*/
+void Config::setCacheQuota(qint64 aBytes)
+{
+    m_iCacheQuota = qMax(Q_INT64_C(0), aBytes);
+}
+
+/*!
+Returns the maximum size of the download cache in bytes (default: 2 GB)
+\sa Config::setCacheQuota
+*/
+qint64 Config::getCacheQuota()
+{
+    return m_iCacheQuota;
+}
+
+/*!
+Sets the number of updates \a aDownloads downloaded at the same time
+\sa Config::getConcurrentDownloads, UpdateNode::DownloadQueue
+*/
+void Config::setConcurrentDownloads(int aDownloads)
+{
+    m_iConcurrentDownloads = qMax(1, aDownloads);
+}
+
+/*!
+Returns the number of updates downloaded at the same time (default: 2)
+\sa Config::setConcurrentDownloads
+*/
+int Config::getConcurrentDownloads()
+{
+    return m_iConcurrentDownloads;
+}
+
+/*!
+Sets the number of independent updates \a aInstalls, which are installed at the same time
+\sa Config::getConcurrentInstalls, UpdateNode::InstallScheduler
+*/
+void Config::setConcurrentInstalls(int aInstalls)
+{
+    m_iConcurrentInstalls = qMax(1, aInstalls);
+}
+
+/*!
+Returns the number of independent updates installed at the same time (default: 2)
+\sa Config::setConcurrentInstalls
+*/
+int Config::getConcurrentInstalls()
+{
+    return m_iConcurrentInstalls;
+}
+
+/*!
+Sets the time in seconds a response of UpdateNode.com is reused without asking the service again.
+0 disables the time, but unchanged responses are still detected by the service
+\sa Config::getResponseTtl, UpdateNode::ResponseCache
+*/
+void Config::setResponseTtl(int aSeconds)
+{
+    m_iResponseTtl = qMax(0, aSeconds);
+}
+
+/*!
+Returns the time in seconds a response is reused without a request (default: 0)
+\sa Config::setResponseTtl
+*/
+int Config::getResponseTtl()
+{
+    return m_iResponseTtl;
+}
+
+/*!
+Sets the alternate host \a aHost of the service, e.g. a second API endpoint. A hedged request is sent to it\n
+if the service takes longer than usual to respond
+\sa Config::getAlternateHost, UpdateNode::RequestScheduler
+*/
+void Config::setAlternateHost(const QString& aHost)
+{
+    m_strAlternateHost = aHost;
+}
+
+/*!
+Returns the alternate host of the service, empty if not set
+\sa Config::setAlternateHost
+*/
+QString Config::getAlternateHost()
+{
+    return m_strAlternateHost;
+}
+
+/*!
+Enables the delta protocol: the client sends a digest of the stored response, and the service\n
+only returns what has been added or removed since
+\sa Config::isDeltaSync, UpdateNode::ResponseCache
+*/
+void Config::setDeltaSync(bool aEnable)
+{
+    m_bDeltaSync = aEnable;
+}
+
+/*!
+Checks if the delta protocol is used
+\sa Config::setDeltaSync
+*/
+bool Config::isDeltaSync()
+{
+    return m_bDeltaSync;
+}
+
+/*!
+Limits the bandwidth of all update downloads together to \a aBytesPerSecond, 0 for no limit.\n
+Requests to the service are not limited
+\sa Config::getRateLimit, UpdateNode::Throttle
+*/
+void Config::setRateLimit(int aBytesPerSecond)
+{
+    m_iRateLimit = qMax(0, aBytesPerSecond);
+}
+
+/*!
+Returns the bandwidth limit of update downloads in bytes per second (default: 0, no limit)
+\sa Config::setRateLimit
+*/
+int Config::getRateLimit()
+{
+    return m_iRateLimit;
+}
+
+/*!
+Enables the background mode: updates are downloaded with a low priority, and slowed down\n
+while requests to the service are running
+\sa Config::isBackground, UpdateNode::Throttle
+*/
+void Config::setBackground(bool aBackground)
+{
+    m_bBackground = aBackground;
+}
+
+/*!
+Checks if updates are downloaded in background mode
+\sa Config::setBackground
+*/
+bool Config::isBackground()
+{
+    return m_bBackground;
+}
+
+/*!
+Sets the URL rewrite rules \a aRules for update downloads, each in the form "<prefix>=<replacement>".\n
+A download link starting with a prefix is also tried with the prefix replaced, e.g. by the URL of an on-prem cache
+\sa Config::getMirrorRewrites, UpdateNode::MirrorSelector
+*/
+void Config::setMirrorRewrites(const QStringList& aRules)
+{
+    m_listMirrorRewrites.clear();
+
+    foreach(QString rule, aRules)
+        addMirrorRewrite(rule);
+}
+
+/*!
+Adds the URL rewrite rule \a aRule in the form "<prefix>=<replacement>"
+\sa Config::setMirrorRewrites
+*/
+void Config::addMirrorRewrite(const QString& aRule)
+{
+    // rules without a prefix are ignored
+    if(aRule.indexOf('=') > 0)
+        m_listMirrorRewrites.append(aRule.trimmed());
+}
+
+/*!
+Returns the URL rewrite rules for update downloads
+\sa Config::setMirrorRewrites
+*/
+QStringList Config::getMirrorRewrites()
+{
+    return m_listMirrorRewrites;
+}
+
 /*!
 Checks if messages are enforced even not running in -messages mode
 \sa Config::setEnforceMessages
@@ -645,6 +858,26 @@ void Config::getParametersFromFile(const QString& aFile)
         setStyleSheet(settings->value("stylesheet").toString());
     if(settings->contains("timeout"))
         setTimeOut(settings->value("timeout").toInt());
+    if(settings->contains("cache_quota"))
+        setCacheQuota(settings->value("cache_quota").toLongLong() * 1024 * 1024);
+    if(settings->contains("segments"))
+        setSegments(settings->value("segments").toInt());
+    if(settings->contains("concurrent_downloads"))
+        setConcurrentDownloads(settings->value("concurrent_downloads").toInt());
+    if(settings->contains("concurrent_installs"))
+        setConcurrentInstalls(settings->value("concurrent_installs").toInt());
+    if(settings->contains("response_ttl"))
+        setResponseTtl(settings->value("response_ttl").toInt());
+    if(settings->contains("alternate_host"))
+        setAlternateHost(settings->value("alternate_host").toString());
+    if(settings->contains("delta_sync"))
+        setDeltaSync(settings->value("delta_sync").toString().toLower()=="true");
+    if(settings->contains("rate_limit"))
+        setRateLimit(settings->value("rate_limit").toInt() * 1024);
+    if(settings->contains("background"))
+        setBackground(settings->value("background").toString().toLower()=="true");
+    if(settings->contains("mirror_rewrite"))
+        setMirrorRewrites(settings->value("mirror_rewrite").toStringList());
     if(settings->contains("custom"))
         setCustomRequestValue(settings->value("custom").toString());
     if(settings->contains("identifier"))
@@ -702,6 +935,26 @@ void Config::setParametersToFile(const QString& aFile, bool aAll /* = true */)
         settings->setValue("stylesheet", getStyleSheet());
     if(getTimeOut()!=DEFAULT_TIMEOUT)
         settings->setValue("timeout", getTimeOut());
+    if(getSegments() > 1)
+        settings->setValue("segments", getSegments());
+    if(getCacheQuota() != DEFAULT_CACHE_QUOTA)
+        settings->setValue("cache_quota", getCacheQuota() / (1024 * 1024));
+    if(getConcurrentDownloads() != DEFAULT_CONCURRENT_DOWNLOADS)
+        settings->setValue("concurrent_downloads", getConcurrentDownloads());
+    if(getConcurrentInstalls() != DEFAULT_CONCURRENT_INSTALLS)
+        settings->setValue("concurrent_installs", getConcurrentInstalls());
+    if(getResponseTtl() > 0)
+        settings->setValue("response_ttl", getResponseTtl());
+    if(!getAlternateHost().isEmpty())
+        settings->setValue("alternate_host", getAlternateHost());
+    if(isDeltaSync())
+        settings->setValue("delta_sync", "true");
+    if(getRateLimit() > 0)
+        settings->setValue("rate_limit", getRateLimit() / 1024);
+    if(isBackground())
+        settings->setValue("background", "true");
+    if(!getMirrorRewrites().isEmpty())
+        settings->setValue("mirror_rewrite", getMirrorRewrites());
     if(!mainIcon().isEmpty())
         settings->setValue("icon", mainIcon());
     if(isEnforceMessages() && aAll)
@@ -22,11 +22,18 @@
 
 #include <QDir>
 #include <QDebug>
+#include <QFileInfo>
+#include <QCoreApplication>
 #include "logging.h"
 #include "downloader.h"
 #include "localfile.h"
 #include "settings.h"
+#include "config.h"
+#include "cachemanager.h"
+#include "patcher.h"
 #include "status.h"
+#include "throttle.h"
+#include "mirrorselector.h"
 
 using namespace UpdateNode;
 
@@ -42,6 +49,18 @@ Constructs an empty Downloader object.
 */
 Downloader::Downloader()
 {
+    // keep unfinished downloads resumable when the application exits, e.g. on time out
+    if(QCoreApplication::instance())
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), SLOT(saveProgress()));
+}
+
+/*!
+Destructs the Downloader object. Unfinished part files are closed, but kept on disk.
+*/
+Downloader::~Downloader()
+{
+    qDeleteAll(m_oPartFiles);
+    qDeleteAll(m_oExtractors);
 }
 
 /*!
@@ -54,12 +73,10 @@ void Downloader::doDownload(const QUrl& url, const QString& aFileName)
 {
     QNetworkRequest request(url);
 
-    connect(&m_oManager, SIGNAL(finished(QNetworkReply*)), SLOT(downloadFileFinished(QNetworkReply*)));
-    connect(&m_oManager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)), SLOT(onSslError(QNetworkReply*,QList<QSslError>)));
-
-    QNetworkReply *reply = m_oManager.get(request);
+    QNetworkReply *reply = UpdateNode::NetworkSession::Instance()->get(request);
 
     m_oCurrentFileDownloads[reply] = aFileName;
+    connect(reply, SIGNAL(finished()), SLOT(fileReplyFinished()));
 }
 
 /*!
@@ -67,32 +84,220 @@ Starts a download for a specified url with an reference to Update object specifi
 \n
 \note aUpdate is only used as an reference for the
 \note done(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString) signal
-\sa Downloader::downloadFinished
+\n
+Returns the network reply of the download, or NULL if the file is taken from the cache or
+downloaded in segments
+\sa Downloader::downloadFinished, Config::setSegments
 */
 QNetworkReply* Downloader::doDownload(const QUrl& url, const UpdateNode::Update& aUpdate)
 {
     UpdateNode::Settings settings;
-    QString cachedFile = settings.getCachedFile(aUpdate.getCode());
-    if(!cachedFile.isEmpty() && QFile::exists(cachedFile))
+    UpdateNode::CacheManager cache;
+
+    if(settings.isCachedFileValid(aUpdate.getCode(), aUpdate.getFileHash()))
     {
+        cache.use(settings.getCachedFileHash(aUpdate.getCode()), aUpdate.getCode());
         emit done(aUpdate, QNetworkReply::NoError, QString());
         return NULL;
     }
 
-    connect(&m_oManager, SIGNAL(finished(QNetworkReply*)), SLOT(downloadFinished(QNetworkReply*)));
-    connect(&m_oManager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)), SLOT(onSslError(QNetworkReply*,QList<QSslError>)));
+    // the same file may have been downloaded for another product or key already
+    QString blob = cache.find(aUpdate.getFileHash());
+    if(!aUpdate.getCode().isEmpty() && !blob.isEmpty())
+    {
+        UpdateNode::Logging() << "Using cached file " << blob << " for " << url.toString();
+        cache.use(aUpdate.getFileHash(), aUpdate.getCode());
+        settings.setCachedFile(aUpdate.getCode(), blob, aUpdate.getFileHash());
+        emit done(aUpdate, QNetworkReply::NoError, QString());
+        return NULL;
+    }
+
+    // with the previous version in the cache, only the difference needs to be downloaded
+    QString base = cache.find(aUpdate.getPatchBaseHash());
+    if(!aUpdate.getPatchLink().isEmpty() && !aUpdate.getFileHash().isEmpty() && !base.isEmpty())
+    {
+        UpdateNode::Logging() << "Downloading patch " << aUpdate.getPatchLink() << " for " << base;
+        return doStreamDownload(QUrl(aUpdate.getPatchLink()), aUpdate, base);
+    }
+
+    return doFullDownload(url, aUpdate);
+}
+
+/*!
+Downloads the complete file \a url of \a aUpdate, in segments if configured
+\sa Config::setSegments
+*/
+QNetworkReply* Downloader::doFullDownload(const QUrl& url, const UpdateNode::Update& aUpdate)
+{
+    UpdateNode::MirrorSelector* mirrors = UpdateNode::MirrorSelector::Instance();
+    QList<QUrl> candidates = mirrors->candidates(url, aUpdate.getMirrors());
+    bool known = true;
+
+    foreach(QUrl candidate, candidates)
+        known = known && mirrors->isKnown(candidate);
+
+    // mirrors which have not been used before are measured first
+    if(candidates.size() > 1 && !known)
+    {
+        UpdateNode::MirrorProbe* probe = new UpdateNode::MirrorProbe(candidates, this);
+        m_oProbes[probe] = aUpdate;
+        connect(probe, SIGNAL(finished(const QList<QUrl>&)), SLOT(mirrorsProbed(const QList<QUrl>&)));
+        probe->start();
+        return NULL;
+    }
+
+    return startFullDownload(mirrors->rank(candidates), aUpdate);
+}
+
+/*!
+Downloads the complete file of \a aUpdate from the first of \a aMirrors, in segments if configured.
+A single stream download switches to the next mirror if it stalls or fails
+\sa Config::setSegments, UpdateNode::MirrorSelector
+*/
+QNetworkReply* Downloader::startFullDownload(QList<QUrl> aMirrors, const UpdateNode::Update& aUpdate)
+{
+    QUrl url = aMirrors.takeFirst();
+
+    if(UpdateNode::Config::Instance()->getSegments() > 1)
+    {
+        doSegmentedDownload(url, aUpdate);
+        return NULL;
+    }
+
+    QNetworkReply* reply = doStreamDownload(url, aUpdate);
+    watch(reply, aMirrors);
+
+    return reply;
+}
+
+/*!
+Measures the throughput of \a reply, and aborts it once it stalls, if there are other mirrors \a aMirrors left
+\sa UPDATENODE_MIRROR_STALL
+*/
+void Downloader::watch(QNetworkReply* reply, const QList<QUrl>& aMirrors)
+{
+    m_oMirrors[reply] = aMirrors;
+    m_oStarted[reply].start();
+    reply->setProperty("offset", m_oRequestedOffsets.value(reply));
+
+    if(aMirrors.isEmpty())
+        return;
+
+    QTimer* timer = new QTimer(reply);
+    timer->setSingleShot(true);
+    timer->setInterval(UPDATENODE_MIRROR_STALL);
+    connect(timer, SIGNAL(timeout()), SLOT(stalled()));
+    timer->start();
+
+    m_oStallTimers[reply] = timer;
+}
+
+/*!
+Downloads \a url in a single stream, continuing an unfinished download of \a aUpdate if possible.
+\n If \a aPatchBase is set, \a url is a patch which is applied on \a aPatchBase once downloaded
+\n An archive of an update using UPDATENODE_EXTRACT_COMMAND is extracted while it is downloaded from the
+beginning, see Downloader::extract
+\sa Downloader::doDownload, UpdateNode::Patcher
+*/
+QNetworkReply* Downloader::doStreamDownload(const QUrl& url, const UpdateNode::Update& aUpdate, const QString& aPatchBase /* = QString() */)
+{
+    UpdateNode::Settings settings;
 
     QNetworkRequest request(url);
+    UpdateNode::Throttle::Instance()->prepare(request);
+
+    // all mirrors share the part file of the download link, so a download continues on another mirror
+    QString link = aPatchBase.isEmpty() && !aUpdate.getDownloadLink().isEmpty() ? aUpdate.getDownloadLink() : url.toString();
+    UpdateNode::PartFile* part = new UpdateNode::PartFile(UpdateNode::LocalFile::getDownloadLocation(link));
+    if(aPatchBase.isEmpty())
+        part->setExpectedHash(aUpdate.getFileHash());
+    QString validator = settings.getPartialValidator(aUpdate.getCode());
+    qint64 offset = 0;
+    bool opened;
+
+    // continue an unfinished download of this update, as long as the server confirms it did not change
+    if(!aUpdate.getCode().isEmpty() && !validator.isEmpty()
+            && settings.getPartialFile(aUpdate.getCode()) == part->partFileName())
+        offset = qMin(settings.getPartialOffset(aUpdate.getCode()), QFileInfo(part->partFileName()).size());
+
+    if(offset > 0 && part->resume(offset))
+    {
+        UpdateNode::Logging() << "Resuming download of " << url.toString() << " at byte " << QString::number(offset);
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(offset) + "-");
+        request.setRawHeader("If-Range", validator.toLatin1());
+        opened = true;
+    }
+    else
+    {
+        offset = 0;
+        opened = part->open();
+    }
 
-    QNetworkReply *reply = m_oManager.get(request);
+    // an extraction of a previous download does not fit to the file downloaded now
+    QString staging = UpdateNode::ArchiveExtractor::stagingDir(part->fileName());
+    UpdateNode::ArchiveExtractor::removeTree(staging);
+    UpdateNode::ArchiveExtractor::removeTree(staging + UPDATENODE_PART_SUFFIX);
 
-    connect(reply, SIGNAL(downloadProgress(qint64,qint64)), SIGNAL(downloadProgress(qint64,qint64)));
+    QNetworkReply *reply = UpdateNode::NetworkSession::Instance()->get(request);
 
     m_oCurrentDownloads[reply] = aUpdate;
+    connect(reply, SIGNAL(finished()), SLOT(replyFinished()));
+
+    if(!aPatchBase.isEmpty())
+        m_oPatchBases[reply] = aPatchBase;
+
+    // keep only a small window of the payload in memory, the rest stays in the socket
+    reply->setReadBufferSize(UPDATENODE_DOWNLOAD_BUFFER_SIZE);
+
+    if(!opened)
+    {
+        delete part;
+        reply->abort();
+    }
+    else
+    {
+        m_oPartFiles[reply] = part;
+        m_oRequestedOffsets[reply] = offset;
+        connect(reply, SIGNAL(readyRead()), SLOT(downloadReadyRead()));
+
+        if(offset == 0 && aPatchBase.isEmpty() && aUpdate.getCommand().contains(UPDATENODE_EXTRACT_COMMAND))
+            m_oExtractors[reply] = new UpdateNode::ArchiveExtractor(staging + UPDATENODE_PART_SUFFIX);
+    }
+
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)), SIGNAL(downloadProgress(qint64,qint64)));
 
     return reply;
 }
 
+/*!
+Downloads \a url over several parallel connections. Falls back to a single stream,
+if the server does not support range requests
+\sa UpdateNode::SegmentedDownload
+*/
+void Downloader::doSegmentedDownload(const QUrl& url, const UpdateNode::Update& aUpdate)
+{
+    UpdateNode::Settings settings;
+
+    // keyed by the download link like a stream download, so another mirror continues the same part file
+    QString link = aUpdate.getDownloadLink().isEmpty() ? url.toString() : aUpdate.getDownloadLink();
+    UpdateNode::SegmentedDownload* download = new UpdateNode::SegmentedDownload(url,
+                                                    UpdateNode::LocalFile::getDownloadLocation(link),
+                                                    UpdateNode::Config::Instance()->getSegments(), this);
+
+    // segments are preallocated, an unfinished single stream download cannot be continued
+    settings.removePartialDownload(aUpdate.getCode());
+    UpdateNode::ArchiveExtractor::removeTree(UpdateNode::ArchiveExtractor::stagingDir(download->fileName()));
+
+    download->setExpectedHash(aUpdate.getFileHash());
+    m_oSegmentedDownloads[download] = aUpdate;
+
+    connect(download, SIGNAL(finished(QNetworkReply::NetworkError,QString)), SLOT(segmentedFinished(QNetworkReply::NetworkError,QString)));
+    connect(download, SIGNAL(unsupported()), SLOT(segmentedUnsupported()));
+    connect(download, SIGNAL(downloadProgress(qint64,qint64)), SIGNAL(downloadProgress(qint64,qint64)));
+
+    download->start();
+}
+
 /*!
 Aborts all current network operations
 */
@@ -104,6 +309,19 @@ void Downloader::cancel()
          i.next();
          i.key()->abort();
     }
+
+    foreach(UpdateNode::SegmentedDownload* download, m_oSegmentedDownloads.keys())
+        download->abort();
+
+    foreach(UpdateNode::MirrorProbe* probe, m_oProbes.keys())
+    {
+        UpdateNode::Update update = m_oProbes.take(probe);
+        probe->abort();
+        probe->deleteLater();
+
+        if(!isDownloading())
+            emit done(update, QNetworkReply::OperationCanceledError, tr("Operation canceled"));
+    }
 }
 
 /*!
@@ -113,23 +331,266 @@ returns true on success, otherwise false
 */
 bool Downloader::saveToDisk(const QString &filename, QIODevice *data, const QString& aCode)
 {
-    QFile file(filename);
+    UpdateNode::PartFile file(filename);
+
+    if(!file.open())
+        return false;
 
-    if (!file.open(QIODevice::WriteOnly))
+    while(!data->atEnd())
     {
-        UpdateNode::Logging() << "Could not open " << filename <<  " for writing: " << file.errorString();
+        if(!file.write(data->read(UPDATENODE_DOWNLOAD_BUFFER_SIZE)))
+        {
+            file.discard();
+            return false;
+        }
+    }
+
+    if(!file.commit())
         return false;
+
+    storeFile(aCode, QUrl(), filename, file.hash());
+
+    return true;
+}
+
+/*!
+Moves the completed download \a aFileName of update \a aCode into the content addressed cache
+and stores it as the cached file of the update. Files without update code, e.g. product icons,
+or without checksum stay where they are
+\sa UpdateNode::CacheManager, Settings::setCachedFile
+*/
+void Downloader::storeFile(const QString& aCode, const QUrl& url, const QString& aFileName, const QString& aHash)
+{
+    UpdateNode::Settings settings;
+    QString file = aFileName;
+
+    if(!aCode.isEmpty())
+    {
+        UpdateNode::CacheManager cache;
+        QString blob = cache.store(aFileName, aHash, url, aCode);
+        if(!blob.isEmpty())
+            file = blob;
+    }
+
+    settings.setCachedFile(aCode, file, aHash);
+}
+
+/*!
+Rebuilds the file of \a aUpdate by applying the downloaded patch \a aPatchFile on \a aBase.
+The result is verified and moved into the cache, the patch is removed.
+\n Returns true on success, otherwise false
+\sa UpdateNode::Patcher
+*/
+bool Downloader::applyPatch(const UpdateNode::Update& aUpdate, const QString& aBase, const QString& aPatchFile)
+{
+    UpdateNode::Patcher patcher;
+    QString target = UpdateNode::LocalFile::getDownloadLocation(aUpdate.getDownloadLink());
+
+    bool patched = patcher.apply(aBase, aPatchFile, target, aUpdate.getFileHash());
+    QFile::remove(aPatchFile);
+
+    if(patched)
+        storeFile(aUpdate.getCode(), QUrl(aUpdate.getDownloadLink()), target, patcher.hash());
+
+    return patched;
+}
+
+/*!
+Slot called whenever new data of an update download arrives. The data is written
+straight into the part file, so the download is never held in memory completely.
+\n Every UPDATENODE_RESUME_CHECKPOINT bytes, the part file is synced and its state
+is stored, so the download can be resumed even if the process gets killed.
+*/
+void Downloader::downloadReadyRead()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    UpdateNode::PartFile* part = m_oPartFiles.value(reply);
+
+    if(!reply || !part)
+        return;
+
+    if(m_oStallTimers.contains(reply))
+        m_oStallTimers.value(reply)->start();
+
+    // error pages are not part of the download
+    if(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 400)
+    {
+        reply->readAll();
+        return;
+    }
+
+    if(m_oRequestedOffsets.contains(reply) && !startWriting(reply, part))
+    {
+        reply->abort();
+        return;
+    }
+
+    QByteArray data = UpdateNode::Throttle::Instance()->read(reply);
+    if(!part->write(data))
+    {
+        reply->abort();
+        return;
     }
 
-    file.write(data->readAll());
-    file.close();
+    extract(reply, data);
+
+    if(part->size() - part->syncedSize() >= UPDATENODE_RESUME_CHECKPOINT)
+        checkpoint(reply, part);
+}
 
+/*!
+Checks the response of an update download before its first byte is written. If a range
+was requested, but the server sends the whole file, the part file starts from the beginning.
+\n The validator (ETag or Last-Modified) of the response is stored, so the download can be
+resumed later on.
+\n Returns false if the part file cannot be reopened
+*/
+bool Downloader::startWriting(QNetworkReply* reply, UpdateNode::PartFile* part)
+{
     UpdateNode::Settings settings;
-    settings.setCachedFile(aCode, filename);
+    QString code = m_oCurrentDownloads.value(reply).getCode();
+    qint64 offset = m_oRequestedOffsets.take(reply);
+
+    if(offset > 0)
+    {
+        // Content-Range: bytes <first>-<last>/<total>
+        QByteArray range = reply->rawHeader("Content-Range");
+        qint64 first = range.mid(range.indexOf(' ') + 1).split('-').at(0).toLongLong();
+
+        if(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206 || first != offset)
+        {
+            UpdateNode::Logging() << "Server ignored the range request, downloading " << reply->url().toString() << " from the beginning";
+
+            if(!part->open())
+                return false;
+        }
+    }
+
+    // weak ETags are not allowed in If-Range
+    QByteArray validator = reply->rawHeader("ETag");
+    if(validator.isEmpty() || validator.startsWith("W/"))
+        validator = reply->rawHeader("Last-Modified");
+
+    settings.setPartialValidator(code, QString::fromLatin1(validator));
+    settings.setPartialDownload(code, part->partFileName(), part->syncedSize());
 
     return true;
 }
 
+/*!
+Syncs the part file of \a reply and stores how many bytes are safely on disk
+\sa Settings::setPartialDownload
+*/
+void Downloader::checkpoint(QNetworkReply* reply, UpdateNode::PartFile* part)
+{
+    if(part->checkpoint())
+    {
+        UpdateNode::Settings settings;
+        settings.setPartialDownload(m_oCurrentDownloads.value(reply).getCode(), part->partFileName(), part->syncedSize());
+    }
+}
+
+/*!
+Extracts the chunk \a aData of the archive downloaded by \a reply into a staging directory next to the
+part file, so extraction overlaps with the download. If the archive cannot be extracted, the staging
+directory is removed and Commander::extract extracts the complete file at install time instead.
+\sa UpdateNode::ArchiveExtractor
+*/
+void Downloader::extract(QNetworkReply* reply, const QByteArray& aData)
+{
+    UpdateNode::ArchiveExtractor* extractor = m_oExtractors.value(reply);
+
+    if(extractor && !extractor->write(aData))
+    {
+        UpdateNode::Logging() << "Could not extract " << reply->url().toString() << " while downloading: " << extractor->errorString();
+        discardExtraction(reply);
+    }
+}
+
+/*!
+Extracts the last chunk \a aData of the archive downloaded by \a reply, and moves the staging directory
+next to the verified archive \a aArchive, where Commander::extract picks it up
+\sa ArchiveExtractor::stagingDir
+*/
+void Downloader::finishExtraction(QNetworkReply* reply, const QByteArray& aData, const QString& aArchive)
+{
+    UpdateNode::ArchiveExtractor* extractor = m_oExtractors.value(reply);
+
+    if(!extractor)
+        return;
+
+    QString staging = UpdateNode::ArchiveExtractor::stagingDir(aArchive);
+    UpdateNode::ArchiveExtractor::removeTree(staging);
+
+    if(!extractor->write(aData) || !extractor->finish())
+        UpdateNode::Logging() << "Could not extract " << reply->url().toString() << " while downloading: " << extractor->errorString();
+    else if(!QDir().rename(extractor->target(), staging))
+        UpdateNode::Logging() << "Could not move " << extractor->target() << " to " << staging;
+    else
+        UpdateNode::Logging() << "Extracted " << QString::number(extractor->entries()) << " entries of " << aArchive << " while downloading";
+
+    discardExtraction(reply);
+}
+
+/*!
+Stops the extraction of the archive downloaded by \a reply and removes its staging directory
+*/
+void Downloader::discardExtraction(QNetworkReply* reply)
+{
+    UpdateNode::ArchiveExtractor* extractor = m_oExtractors.take(reply);
+
+    if(!extractor)
+        return;
+
+    UpdateNode::ArchiveExtractor::removeTree(extractor->target());
+    delete extractor;
+}
+
+/*!
+Stores the state of all running update downloads, so they can be resumed by the next
+call of Downloader::doDownload - even from another process
+\note This slot is called automatically when the application is about to quit
+*/
+void Downloader::saveProgress()
+{
+    QMapIterator<QNetworkReply*, UpdateNode::PartFile*> i(m_oPartFiles);
+    while (i.hasNext())
+    {
+         i.next();
+         if(!m_oRequestedOffsets.contains(i.key()))
+             checkpoint(i.key(), i.value());
+    }
+}
+
+/*!
+Returns true if \a reply failed for a reason which allows to continue the download later on,
+like a connection loss, a time out, or a server side error
+*/
+bool Downloader::isResumable(QNetworkReply* reply)
+{
+    if(reply->error() == QNetworkReply::NoError)
+        return false;
+
+    return reply->error() < QNetworkReply::ContentAccessDenied
+            || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 500;
+}
+
+/*!
+Slot called when a reply of Downloader::doDownload(const QUrl&, const QString&) has finished
+*/
+void Downloader::fileReplyFinished()
+{
+    downloadFileFinished(qobject_cast<QNetworkReply*>(sender()));
+}
+
+/*!
+Slot called when a reply of Downloader::doDownload(const QUrl&, const UpdateNode::Update&) has finished
+*/
+void Downloader::replyFinished()
+{
+    downloadFinished(qobject_cast<QNetworkReply*>(sender()));
+}
+
 /*!
 Slot for doDownload on a file, emits done(QByteArray array, const QString& fileName)
 */
@@ -163,19 +624,114 @@ void Downloader::downloadFinished(QNetworkReply *reply)
     UpdateNode::Update update = m_oCurrentDownloads.value(reply);
 
     QUrl url = reply->url();
+    UpdateNode::PartFile* part = m_oPartFiles.take(reply);
+    QString patchBase = m_oPatchBases.take(reply);
+    bool patched = false;
+    bool stalled = reply->property("stalled").toBool();
+    UpdateNode::Settings settings;
+
+    if(part && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 416)
+    {
+        // the part file does not fit to the file on the server anymore, start over
+        UpdateNode::Logging() << "Unable to resume " << url.toString() << ", downloading it again";
+        part->discard();
+        delete part;
+        discardExtraction(reply);
+        settings.removePartialDownload(update.getCode());
+        m_oRequestedOffsets.remove(reply);
+        m_oCurrentDownloads.remove(reply);
+        m_oStallTimers.remove(reply);
+        m_oStarted.remove(reply);
+        m_oMirrors.remove(reply);
+        reply->deleteLater();
+
+        if(patchBase.isEmpty())
+            doDownload(url, update);
+        else
+            doStreamDownload(url, update, patchBase);
+        return;
+    }
+
     if (reply->error() != QNetworkReply::NoError)
-        UpdateNode::Logging() << "Download of " << url.toEncoded().constData() << " failed: " << reply->errorString();
-    else
     {
-        reply->waitForReadyRead(-1);
+        UpdateNode::Logging() << "Download of " << url.toEncoded().constData() << " failed: " << reply->errorString();
 
-        QString filename;
-        filename = UpdateNode::LocalFile::getDownloadLocation(url.toString());
+        if(part && isResumable(reply) && patchBase.isEmpty())
+        {
+            // keep the part file, the next attempt continues from here
+            if(!m_oRequestedOffsets.contains(reply))
+                checkpoint(reply, part);
+        }
+        else if(part)
+        {
+            part->discard();
+            settings.removePartialDownload(update.getCode());
+        }
+    }
+    else if(part)
+    {
+        qint64 received = part->size() + reply->bytesAvailable() - reply->property("offset").toLongLong();
+        if(m_oStarted.contains(reply) && received > 0)
+            UpdateNode::MirrorSelector::Instance()->addThroughput(url, received * 1000.0 / qMax(Q_INT64_C(1), m_oStarted.value(reply).elapsed()));
+
+        // store whatever is still buffered, then move the part file in place
+        QByteArray data = reply->readAll();
+        if((!m_oRequestedOffsets.contains(reply) || startWriting(reply, part))
+                && part->write(data) && part->commit())
+        {
+            if(patchBase.isEmpty())
+            {
+                storeFile(update.getCode(), url, part->fileName(), part->hash());
+                finishExtraction(reply, data, UpdateNode::LocalFile::getUpdateLocation(update));
+            }
+            else
+                patched = applyPatch(update, patchBase, part->fileName());
+        }
+        else
+        {
+            part->discard();
+            error = QNetworkReply::UnknownContentError;
+            errorString = part->errorString();
+        }
 
-        saveToDisk(filename, reply, update.getCode());
+        settings.removePartialDownload(update.getCode());
     }
 
+    delete part;
+    discardExtraction(reply);
+
+    // only downloads from a mirror chosen by MirrorSelector are watched, not patches
+    bool mirrored = m_oMirrors.contains(reply);
+
+    m_oRequestedOffsets.remove(reply);
     m_oCurrentDownloads.remove(reply);
+    m_oStallTimers.remove(reply);
+    m_oStarted.remove(reply);
+    QList<QUrl> mirrors = m_oMirrors.take(reply);
+
+    // a stalled or failed download continues on the next mirror, from the part file left by this one
+    if(stalled || (isResumable(reply) && reply->error() != QNetworkReply::OperationCanceledError))
+    {
+        if(mirrored)
+            UpdateNode::MirrorSelector::Instance()->addThroughput(url, 0);
+
+        if(!mirrors.isEmpty())
+        {
+            QUrl next = mirrors.takeFirst();
+            UpdateNode::Logging() << "Switching download of " << url.toString() << " to " << next.toString();
+
+            watch(doStreamDownload(next, update), mirrors);
+            reply->deleteLater();
+            return;
+        }
+    }
+
+    // without a usable patch, the complete file is downloaded instead
+    if(!patchBase.isEmpty() && !patched && reply->error() != QNetworkReply::OperationCanceledError)
+    {
+        UpdateNode::Logging() << "Patch " << url.toString() << " failed, downloading " << update.getDownloadLink();
+        doFullDownload(QUrl(update.getDownloadLink()), update);
+    }
 
     if(!isDownloading())
         emit done(update, error, errorString);
@@ -183,27 +739,69 @@ void Downloader::downloadFinished(QNetworkReply *reply)
     reply->deleteLater();
 }
 
+/*!
+Slot called when a segmented download has finished, emits
+\n
+done(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString)
+*/
+void Downloader::segmentedFinished(QNetworkReply::NetworkError aError, const QString& aErrorString)
+{
+    UpdateNode::SegmentedDownload* download = qobject_cast<UpdateNode::SegmentedDownload*>(sender());
+    UpdateNode::Update update = m_oSegmentedDownloads.take(download);
+
+    if(aError == QNetworkReply::NoError)
+        storeFile(update.getCode(), download->url(), download->fileName(), download->hash());
+
+    download->deleteLater();
+
+    if(!isDownloading())
+        emit done(update, aError, aErrorString);
+}
+
+/*!
+Slot called when the server does not support segmented downloads, the file is downloaded in a single stream instead
+*/
+void Downloader::segmentedUnsupported()
+{
+    UpdateNode::SegmentedDownload* download = qobject_cast<UpdateNode::SegmentedDownload*>(sender());
+    UpdateNode::Update update = m_oSegmentedDownloads.take(download);
+
+    download->deleteLater();
+    doStreamDownload(download->url(), update);
+}
+
 /*!
 Checking if there are currently any downloads in progess, or not
 */
 bool Downloader::isDownloading()
 {
-    return m_oCurrentDownloads.size() > 0;
+    return m_oCurrentDownloads.size() > 0 || m_oSegmentedDownloads.size() > 0 || m_oProbes.size() > 0;
 }
 
 /*!
-Slot called on SSL errors
+Slot called when the mirrors of a download have been measured, starts the download from the fastest one
 */
-void Downloader::onSslError(QNetworkReply *reply, const QList<QSslError>& errors)
+void Downloader::mirrorsProbed(const QList<QUrl>& aRanked)
 {
-    QSslError error(QSslError::NoError);
+    UpdateNode::MirrorProbe* probe = qobject_cast<UpdateNode::MirrorProbe*>(sender());
+    UpdateNode::Update update = m_oProbes.take(probe);
 
-    foreach(QSslError error, errors)
-        if(error.error() != QSslError::NoError)
-            UpdateNode::Logging() << error.errorString();
-
-    QList<QSslError> expectedSslErrors;
-    expectedSslErrors.append(error);
-    reply->ignoreSslErrors(expectedSslErrors);
+    probe->deleteLater();
+    startFullDownload(aRanked, update);
 }
 
+/*!
+Slot called when a download has not received any data for UPDATENODE_MIRROR_STALL ms, it is aborted
+and continued on the next mirror
+*/
+void Downloader::stalled()
+{
+    QNetworkReply* reply = m_oStallTimers.key(qobject_cast<QTimer*>(sender()));
+
+    if(!reply)
+        return;
+
+    UpdateNode::Logging() << "Download of " << reply->url().toString() << " stalled";
+    reply->setProperty("stalled", true);
+    reply->abort();
+}
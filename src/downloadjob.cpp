@@ -0,0 +1,200 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include "downloadjob.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::DownloadJob
+\brief Download of a single update within a UpdateNode::DownloadQueue
+\n\n
+A job carries the update to download, its priority, its state and how often it has been retried.
+Its signals report the progress and the end of this download only.
+\sa UpdateNode::DownloadQueue
+*/
+
+/*!
+Constructs a queued DownloadJob for \a aUpdate with priority \a aPriority, higher priorities are downloaded first
+*/
+DownloadJob::DownloadJob(const UpdateNode::Update& aUpdate, int aPriority, QObject* parent /* = 0 */)
+    : QObject(parent)
+{
+    m_oUpdate = aUpdate;
+    m_eState = QUEUED;
+    m_eError = QNetworkReply::NoError;
+    m_iReceived = 0;
+    m_iTotal = 0;
+    m_iPriority = aPriority;
+    m_iRetries = 0;
+}
+
+/*!
+Returns the update downloaded by this job
+*/
+UpdateNode::Update DownloadJob::update() const
+{
+    return m_oUpdate;
+}
+
+/*!
+Returns the download link of the update
+*/
+QUrl DownloadJob::url() const
+{
+    return QUrl(m_oUpdate.getDownloadLink());
+}
+
+/*!
+Returns the priority of the job
+*/
+int DownloadJob::priority() const
+{
+    return m_iPriority;
+}
+
+/*!
+Returns the state of the job
+*/
+DownloadJob::State DownloadJob::state() const
+{
+    return m_eState;
+}
+
+/*!
+Returns true if the job is queued, running or paused, i.e. has not ended yet
+*/
+bool DownloadJob::isActive() const
+{
+    return m_eState == QUEUED || m_eState == RUNNING || m_eState == PAUSED;
+}
+
+/*!
+Sets the state \a aState and emits stateChanged(). Entering one of the final states emits finished()
+*/
+void DownloadJob::setState(State aState)
+{
+    if(m_eState == aState)
+        return;
+
+    m_eState = aState;
+    emit stateChanged(this);
+
+    if(!isActive())
+        emit finished(this);
+}
+
+/*!
+Returns how often the job has been retried
+*/
+int DownloadJob::retries() const
+{
+    return m_iRetries;
+}
+
+/*!
+Queues the job again after a failed attempt
+*/
+void DownloadJob::retry()
+{
+    m_iRetries++;
+    m_eError = QNetworkReply::NoError;
+    m_strError.clear();
+    setState(QUEUED);
+}
+
+/*!
+Returns the error of the last attempt
+*/
+QNetworkReply::NetworkError DownloadJob::error() const
+{
+    return m_eError;
+}
+
+/*!
+Returns a human readable description of the error of the last attempt
+*/
+QString DownloadJob::errorString() const
+{
+    return m_strError;
+}
+
+/*!
+Sets the error \a aError of the last attempt
+*/
+void DownloadJob::setError(QNetworkReply::NetworkError aError, const QString& aErrorString)
+{
+    m_eError = aError;
+    m_strError = aErrorString;
+}
+
+/*!
+Returns the bytes received by the running attempt
+*/
+qint64 DownloadJob::bytesReceived() const
+{
+    return m_iReceived;
+}
+
+/*!
+Returns the bytes expected by the running attempt, 0 or less if unknown
+*/
+qint64 DownloadJob::bytesTotal() const
+{
+    return m_iTotal;
+}
+
+/*!
+Slot receiving the progress of the running attempt, emits downloadProgress()
+*/
+void DownloadJob::setProgress(qint64 aBytesReceived, qint64 aBytesTotal)
+{
+    m_iReceived = aBytesReceived;
+    m_iTotal = aBytesTotal;
+
+    emit downloadProgress(aBytesReceived, aBytesTotal);
+}
+
+/*!
+Returns true if a download failed with \a aError is worth to be retried: a refused or lost connection,
+a time out, a temporary network failure, or a server error (500, 503 and other 5xx except 501).
+\n Qt 4 reports server errors like all other content errors, they are not retried there
+*/
+bool DownloadJob::isTransient(QNetworkReply::NetworkError aError)
+{
+    switch(aError)
+    {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::ProxyTimeoutError:
+#if QT_VERSION >= 0x050300
+        case QNetworkReply::InternalServerError:
+        case QNetworkReply::ServiceUnavailableError:
+        case QNetworkReply::UnknownServerError:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,305 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QTimer>
+
+#include "downloadqueue.h"
+#include "config.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::DownloadQueue
+\brief Queue of update downloads, running a limited number of them at once
+\n\n
+Each update is queued as a UpdateNode::DownloadJob. Jobs are started by priority, and in the order they have
+been queued for the same priority, with at most DownloadQueue::concurrency jobs running at once. Each running
+job has a UpdateNode::Downloader of its own, so the end of a download is reported exactly once, for its job only.
+\n A job failing on a connection loss or a time out is retried up to UPDATENODE_DOWNLOAD_RETRIES times, continuing
+the part file left by the failed attempt. A paused job keeps its part file as well, a segmented download along
+with the progress of its segments, see UpdateNode::SegmentedDownload.
+\n Ended jobs are removed from the queue and deleted once jobFinished() has been emitted.
+\n The progress of the downloads is reported by the jobs, UpdateNode::TransferStats combines it for all jobs of a queue.
+*/
+
+/*!
+Constructs an empty DownloadQueue, running Config::getConcurrentDownloads jobs at once
+*/
+DownloadQueue::DownloadQueue(QObject* parent /* = 0 */)
+    : QObject(parent)
+{
+    m_iConcurrency = UpdateNode::Config::Instance()->getConcurrentDownloads();
+    m_iMaxRetries = UPDATENODE_DOWNLOAD_RETRIES;
+    m_bScheduled = false;
+}
+
+/*!
+Destructs the DownloadQueue, running downloads are aborted but stay resumable
+*/
+DownloadQueue::~DownloadQueue()
+{
+    foreach(UpdateNode::DownloadJob* job, m_mapDownloaders.keys())
+    {
+        UpdateNode::Downloader* downloader = m_mapDownloaders.take(job);
+        disconnect(downloader, 0, this, 0);
+        downloader->cancel();
+        delete downloader;
+    }
+}
+
+/*!
+Queues the download of \a aUpdate with priority \a aPriority. Jobs are started once control returns to the event loop,
+so all jobs queued at once are started by their priority
+\n Returns the job, which is owned by the queue
+*/
+UpdateNode::DownloadJob* DownloadQueue::enqueue(const UpdateNode::Update& aUpdate, int aPriority /* = 0 */)
+{
+    UpdateNode::DownloadJob* job = new UpdateNode::DownloadJob(aUpdate, aPriority, this);
+
+    m_listJobs.append(job);
+
+    if(!m_bScheduled)
+    {
+        m_bScheduled = true;
+        QTimer::singleShot(0, this, SLOT(schedule()));
+    }
+
+    return job;
+}
+
+/*!
+Sets the number of jobs \a aJobs running at once
+*/
+void DownloadQueue::setConcurrency(int aJobs)
+{
+    m_iConcurrency = qMax(1, aJobs);
+    schedule();
+}
+
+/*!
+Returns the number of jobs running at once
+*/
+int DownloadQueue::concurrency() const
+{
+    return m_iConcurrency;
+}
+
+/*!
+Sets how often a job is retried \a aRetries after a transient error
+\sa DownloadJob::isTransient
+*/
+void DownloadQueue::setMaxRetries(int aRetries)
+{
+    m_iMaxRetries = qMax(0, aRetries);
+}
+
+/*!
+Pauses \a aJob. A running download is aborted, but keeps its part file to continue from on DownloadQueue::resume
+*/
+void DownloadQueue::pause(UpdateNode::DownloadJob* aJob)
+{
+    if(aJob->state() == UpdateNode::DownloadJob::RUNNING)
+        stop(aJob, UpdateNode::DownloadJob::PAUSED);
+    else if(aJob->state() == UpdateNode::DownloadJob::QUEUED)
+        aJob->setState(UpdateNode::DownloadJob::PAUSED);
+}
+
+/*!
+Queues the paused job \a aJob again
+*/
+void DownloadQueue::resume(UpdateNode::DownloadJob* aJob)
+{
+    if(aJob->state() != UpdateNode::DownloadJob::PAUSED)
+        return;
+
+    aJob->setState(UpdateNode::DownloadJob::QUEUED);
+    schedule();
+}
+
+/*!
+Cancels \a aJob, it ends with QNetworkReply::OperationCanceledError
+*/
+void DownloadQueue::cancel(UpdateNode::DownloadJob* aJob)
+{
+    if(!aJob->isActive())
+        return;
+
+    aJob->setError(QNetworkReply::OperationCanceledError, tr("Download canceled"));
+
+    if(aJob->state() == UpdateNode::DownloadJob::RUNNING)
+        stop(aJob, UpdateNode::DownloadJob::CANCELED);
+    else
+    {
+        aJob->setState(UpdateNode::DownloadJob::CANCELED);
+        finish(aJob);
+    }
+}
+
+/*!
+Cancels all jobs
+*/
+void DownloadQueue::cancelAll()
+{
+    foreach(UpdateNode::DownloadJob* job, m_listJobs)
+        cancel(job);
+}
+
+/*!
+Returns true as long as there are queued or running jobs. Paused jobs do not count
+*/
+bool DownloadQueue::isBusy() const
+{
+    foreach(UpdateNode::DownloadJob* job, m_listJobs)
+        if(job->state() == UpdateNode::DownloadJob::QUEUED || job->state() == UpdateNode::DownloadJob::RUNNING)
+            return true;
+
+    return false;
+}
+
+/*!
+Returns the number of running jobs
+*/
+int DownloadQueue::running() const
+{
+    return m_mapDownloaders.size();
+}
+
+/*!
+Returns all jobs which have not ended yet
+*/
+QList<UpdateNode::DownloadJob*> DownloadQueue::jobs() const
+{
+    return m_listJobs;
+}
+
+/*!
+Starts queued jobs as long as less than DownloadQueue::concurrency jobs are running
+*/
+void DownloadQueue::schedule()
+{
+    m_bScheduled = false;
+
+    UpdateNode::DownloadJob* job;
+    while(running() < m_iConcurrency && (job = next()))
+        start(job);
+}
+
+/*!
+Returns the queued job with the highest priority, the first one queued for equal priorities
+*/
+UpdateNode::DownloadJob* DownloadQueue::next() const
+{
+    UpdateNode::DownloadJob* next = NULL;
+
+    foreach(UpdateNode::DownloadJob* job, m_listJobs)
+        if(job->state() == UpdateNode::DownloadJob::QUEUED && (!next || job->priority() > next->priority()))
+            next = job;
+
+    return next;
+}
+
+/*!
+Starts the download of \a aJob with a Downloader of its own
+*/
+void DownloadQueue::start(UpdateNode::DownloadJob* aJob)
+{
+    UpdateNode::Downloader* downloader = new UpdateNode::Downloader();
+    m_mapDownloaders[aJob] = downloader;
+
+    connect(downloader, SIGNAL(downloadProgress(qint64,qint64)), aJob, SLOT(setProgress(qint64,qint64)));
+    connect(downloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)),
+            SLOT(downloaderDone(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)));
+
+    aJob->setState(UpdateNode::DownloadJob::RUNNING);
+    emit jobStarted(aJob);
+
+    downloader->doDownload(aJob->url(), aJob->update());
+}
+
+/*!
+Aborts the running download of \a aJob, which enters \a aState once the download has ended
+*/
+void DownloadQueue::stop(UpdateNode::DownloadJob* aJob, UpdateNode::DownloadJob::State aState)
+{
+    UpdateNode::Downloader* downloader = m_mapDownloaders.take(aJob);
+
+    disconnect(downloader, 0, this, 0);
+    disconnect(downloader, 0, aJob, 0);
+    downloader->cancel();
+    downloader->deleteLater();
+
+    aJob->setProgress(0, 0);
+    aJob->setState(aState);
+
+    if(!aJob->isActive())
+        finish(aJob);
+
+    schedule();
+}
+
+/*!
+Slot called when the download of a job has ended. Transient errors are retried
+*/
+void DownloadQueue::downloaderDone(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString)
+{
+    Q_UNUSED(aUpdate);
+
+    UpdateNode::Downloader* downloader = qobject_cast<UpdateNode::Downloader*>(sender());
+    UpdateNode::DownloadJob* job = m_mapDownloaders.key(downloader);
+
+    if(!job)
+        return;
+
+    m_mapDownloaders.remove(job);
+    downloader->deleteLater();
+    job->setError(aError, aErrorString);
+
+    if(UpdateNode::DownloadJob::isTransient(aError) && job->retries() < m_iMaxRetries)
+    {
+        UpdateNode::Logging() << "Retrying download of " << job->url().toString() << ": " << aErrorString;
+        job->retry();
+    }
+    else
+    {
+        job->setState(aError == QNetworkReply::NoError ? UpdateNode::DownloadJob::FINISHED : UpdateNode::DownloadJob::FAILED);
+        finish(job);
+    }
+
+    schedule();
+}
+
+/*!
+Removes the ended job \a aJob from the queue and reports it
+*/
+void DownloadQueue::finish(UpdateNode::DownloadJob* aJob)
+{
+    m_listJobs.removeAll(aJob);
+
+    emit jobFinished(aJob);
+    emit done(aJob->update(), aJob->error(), aJob->errorString());
+
+    aJob->deleteLater();
+
+    if(m_listJobs.isEmpty())
+        emit allDone();
+}
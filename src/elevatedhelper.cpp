@@ -0,0 +1,526 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QUuid>
+#include <QDir>
+
+#if defined(Q_OS_UNIX) && QT_VERSION < 0x050000
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#endif
+
+#include "elevatedhelper.h"
+#include "config.h"
+#include "status.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::ElevatedHelper
+\brief Runs commands, which require administrative privileges, through one elevated helper process
+\n\n
+Without the helper, every update requiring admin privileges is started with its own gksudo, kdesudo or pkexec
+call, and the user is asked for the password once per update. ElevatedHelper::start elevates unclient itself
+in helper mode (UPDATENODE_HELPER_ARGUMENT) instead, once per run. The helper connects back to a local socket
+of this process and runs all commands passed by ElevatedHelper::run, as many at once as requested. File copies,
+permission changes and archive extraction (ElevatedHelper::copy, ElevatedHelper::chmod, ElevatedHelper::extract)
+are done by the helper itself, so they take a round trip on the socket only, instead of starting unclient -copy
+elevated each time.
+\n The helper authenticates with a random token. It is not passed on the command line, which every user can read,
+but in a file only readable by the user, whose name is passed instead. Only the first helper presenting
+the token is accepted, the socket is closed for further connections afterwards. With Qt 4, which cannot restrict
+the socket to the user, the socket is created in a directory only accessible by the user. Since any process of the
+user can read the token file and connect before the helper, the peer of the socket must also run as root, see
+ElevatedHelper::isElevated. The helper quits once the
+connection is closed, or after UPDATENODE_HELPER_IDLE_TIMEOUT without any operation, and its last command has finished,
+see UpdateNode::HelperSession. A request after that starts a new helper, which asks for the password again.
+\n Messages are QDataStream serialized and prefixed by their size, see ElevatedHelper::send.
+*/
+
+ElevatedHelper* ElevatedHelper::m_pInstance = NULL;
+
+/*!
+Returns the ElevatedHelper instance
+*/
+ElevatedHelper* ElevatedHelper::Instance()
+{
+    if(!m_pInstance)
+        m_pInstance = new ElevatedHelper;
+
+    return m_pInstance;
+}
+
+/*!
+Constructs an ElevatedHelper object. The helper is not started before ElevatedHelper::start
+*/
+ElevatedHelper::ElevatedHelper()
+{
+    m_pServer = NULL;
+    m_pSocket = NULL;
+    m_pElevator = NULL;
+    m_pTokenFile = NULL;
+    m_iNextRequest = 1;
+    m_bFailed = false;
+}
+
+/*!
+Destructs the ElevatedHelper object. A running helper quits, once its last command has finished
+*/
+ElevatedHelper::~ElevatedHelper()
+{
+    if(m_pSocket)
+        m_pSocket->disconnectFromServer();
+}
+
+/*!
+Starts the helper with the elevation command \a aElevator, as returned by Commander::setCommandBasedOnOS.
+The password is asked while the commands passed to ElevatedHelper::run are kept until the helper has connected.
+\n Returns true, if the helper is running already or has been started. Returns false, if it cannot be started,
+or has failed before in this run: the commands are then elevated one by one, as without the helper
+*/
+bool ElevatedHelper::start(const QString& aElevator)
+{
+    if(isRunning())
+        return true;
+
+    if(m_bFailed || aElevator.isEmpty())
+        return false;
+
+    m_strToken = QUuid::createUuid().toString();
+    QString name = QString("unclient-helper-%1").arg(QUuid::createUuid().toString().mid(1, 36));
+
+    // QTemporaryFile creates the file readable by the user only
+    m_pTokenFile = new QTemporaryFile(QDir::tempPath() + "/unclient-token-XXXXXX", this);
+    if(!m_pTokenFile->open() || m_pTokenFile->write(m_strToken.toLatin1()) != m_strToken.size() || !m_pTokenFile->flush())
+    {
+        UpdateNode::Logging() << "Could not store the token for the elevated helper: " << m_pTokenFile->errorString();
+        stopListening();
+        m_bFailed = true;
+        return false;
+    }
+
+    m_pServer = new QLocalServer(this);
+#if QT_VERSION >= 0x050000
+    m_pServer->setSocketOptions(QLocalServer::UserAccessOption);
+#elif defined(Q_OS_UNIX)
+    m_strSocketDir = QDir::tempPath() + "/" + name;
+    if(::mkdir(QFile::encodeName(m_strSocketDir).constData(), S_IRWXU) != 0)
+    {
+        UpdateNode::Logging() << "Could not create the directory for the elevated helper socket " << m_strSocketDir;
+        m_strSocketDir.clear();
+        stopListening();
+        m_bFailed = true;
+        return false;
+    }
+    name = m_strSocketDir + "/socket";
+#endif
+    connect(m_pServer, SIGNAL(newConnection()), SLOT(newConnection()));
+
+    if(!m_pServer->listen(name))
+    {
+        UpdateNode::Logging() << "Could not listen for the elevated helper: " << m_pServer->errorString();
+        stopListening();
+        m_bFailed = true;
+        return false;
+    }
+
+    m_pElevator = new QProcess(this);
+    connect(m_pElevator, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(helperExit()));
+
+    UpdateNode::Logging() << "Starting elevated helper with " << aElevator;
+    m_pElevator->start(aElevator, elevatorArguments(aElevator));
+
+    if(!m_pElevator->waitForStarted())
+    {
+        UpdateNode::Logging() << "Could not start the elevated helper: " << m_pElevator->errorString();
+        delete m_pElevator;
+        m_pElevator = NULL;
+        stopListening();
+        m_bFailed = true;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+Returns true while the helper is running, or waiting for the password
+*/
+bool ElevatedHelper::isRunning() const
+{
+    return m_pElevator && m_pElevator->state() != QProcess::NotRunning;
+}
+
+/*!
+Runs \a aCommand with the arguments \a aArguments in the directory \a aWorkingDir with admin privileges.
+ElevatedHelper::start must have been successful before.
+\n Returns the number of the request. Its output is reported by ElevatedHelper::output, its end by
+ElevatedHelper::finished. If the helper ends before, the request finishes with UPDATENODE_PROCERROR_COMMAND_LAUNCH_FAILED
+*/
+int ElevatedHelper::run(const QString& aCommand, const QStringList& aArguments, const QString& aWorkingDir)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << aCommand << aArguments << aWorkingDir;
+
+    return request(MSG_RUN, payload);
+}
+
+/*!
+Copies \a aFrom to \a aTo with admin privileges, as Commander::copy does. No process is started for it.
+\n Returns the number of the request, which finishes with exit code 0 on success, otherwise -1
+\sa ElevatedHelper::run
+*/
+int ElevatedHelper::copy(const QString& aFrom, const QString& aTo)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << aFrom << aTo;
+
+    return request(MSG_COPY, payload);
+}
+
+/*!
+Extracts the archive \a aArchive to \a aTarget with admin privileges, as Commander::extract does. No process is started for it.
+\n Returns the number of the request, which finishes with exit code 0 on success, otherwise -1
+\sa ElevatedHelper::run
+*/
+int ElevatedHelper::extract(const QString& aArchive, const QString& aTarget)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << aArchive << aTarget;
+
+    return request(MSG_EXTRACT, payload);
+}
+
+/*!
+Sets the permissions \a aPermissions of \a aFile with admin privileges.
+\n Returns the number of the request, which finishes with exit code 0 on success, otherwise -1
+\sa ElevatedHelper::run
+*/
+int ElevatedHelper::chmod(const QString& aFile, QFile::Permissions aPermissions)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << aFile << (qint32)aPermissions;
+
+    return request(MSG_CHMOD, payload);
+}
+
+/*!
+Sends the operation \a aType with the serialized arguments \a aPayload, or keeps it until the helper has connected.
+\n Returns the number of the request
+*/
+int ElevatedHelper::request(Message aType, const QByteArray& aPayload)
+{
+    int request = m_iNextRequest++;
+
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    stream << (qint32)aType << (qint32)request;
+    message.append(aPayload);
+
+    m_listRequests.append(request);
+
+    if(m_pSocket)
+        send(m_pSocket, message);
+    else
+        m_listPending.append(message);
+
+    return request;
+}
+
+/*!
+Writes the message \a aMessage, prefixed by its size, to \a aSocket
+*/
+void ElevatedHelper::send(QLocalSocket* aSocket, const QByteArray& aMessage)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << (quint32)aMessage.size();
+
+    aSocket->write(header + aMessage);
+}
+
+/*!
+Reads the next complete message from \a aSocket into \a aMessage.
+\n Returns false if no complete message is available yet. A socket announcing a message larger than
+UPDATENODE_HELPER_MAX_MESSAGE is aborted
+*/
+bool ElevatedHelper::receive(QLocalSocket* aSocket, QByteArray& aMessage)
+{
+    if(aSocket->bytesAvailable() < (qint64)sizeof(quint32))
+        return false;
+
+    quint32 size;
+    QByteArray header = aSocket->peek(sizeof(quint32));
+    QDataStream stream(header);
+    stream >> size;
+
+    if(size > UPDATENODE_HELPER_MAX_MESSAGE)
+    {
+        UpdateNode::Logging() << "Invalid message size " << (int)size;
+        aSocket->abort();
+        return false;
+    }
+
+    if(aSocket->bytesAvailable() < (qint64)(sizeof(quint32) + size))
+        return false;
+
+    aSocket->read(sizeof(quint32));
+    aMessage = aSocket->read(size);
+
+    return true;
+}
+
+/*!
+Slot called when a helper connects. It is accepted after it has sent the token
+*/
+void ElevatedHelper::newConnection()
+{
+    while(m_pServer && m_pServer->hasPendingConnections())
+    {
+        QLocalSocket* socket = m_pServer->nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), SLOT(readMessages()));
+        connect(socket, SIGNAL(disconnected()), SLOT(helperDisconnected()));
+    }
+}
+
+/*!
+Returns true, if the process connected on \a aSocket runs as root, checked with SO_PEERCRED. The token alone
+does not prove the peer to be the helper, any process of the user can read the token file
+*/
+bool ElevatedHelper::isElevated(QLocalSocket* aSocket)
+{
+#ifdef Q_OS_LINUX
+    struct ucred credentials;
+    socklen_t size = sizeof(credentials);
+
+    if(::getsockopt(aSocket->socketDescriptor(), SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0)
+        return false;
+
+    return credentials.uid == 0;
+#else
+    Q_UNUSED(aSocket);
+    return true;
+#endif
+}
+
+/*!
+Slot called when the helper has sent data
+*/
+void ElevatedHelper::readMessages()
+{
+    QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+    QByteArray message;
+
+    while(socket && receive(socket, message))
+    {
+        QDataStream stream(message);
+        qint32 type;
+        qint32 request;
+        stream >> type;
+
+        if(socket != m_pSocket)
+        {
+            QString token;
+            stream >> token;
+
+#ifndef UNITTEST
+            bool elevated = isElevated(socket);
+#else
+            // the tests run the helper session unelevated
+            bool elevated = true;
+#endif
+
+            if(m_pSocket || type != MSG_HELLO || token != m_strToken || !elevated)
+            {
+                UpdateNode::Logging() << "Rejected connection to the elevated helper socket";
+                socket->abort();
+                return;
+            }
+
+            // the server is kept until the helper has ended, it owns the socket
+            m_pSocket = socket;
+            m_pServer->close();
+            delete m_pTokenFile;
+            m_pTokenFile = NULL;
+
+            UpdateNode::Logging() << "Elevated helper connected";
+
+            foreach(QByteArray pending, m_listPending)
+                send(m_pSocket, pending);
+            m_listPending.clear();
+            continue;
+        }
+
+        stream >> request;
+
+        if(type == MSG_STDOUT || type == MSG_STDERR)
+        {
+            QByteArray data;
+            stream >> data;
+            emit output(request, data, type == MSG_STDERR);
+        }
+        else if(type == MSG_FINISHED)
+        {
+            qint32 exitCode;
+            qint32 exitStatus;
+            stream >> exitCode >> exitStatus;
+
+            m_listRequests.removeAll(request);
+            emit finished(request, exitCode, (QProcess::ExitStatus)exitStatus);
+        }
+    }
+}
+
+/*!
+Slot called when the helper has ended, or the elevation has been refused. Outstanding requests fail
+*/
+void ElevatedHelper::helperExit()
+{
+    UpdateNode::Logging() << "Elevated helper ended with exit code " << m_pElevator->exitCode();
+
+    // the password has not been entered, do not ask again for each update
+    if(!m_pSocket)
+        m_bFailed = true;
+
+    if(m_pSocket)
+    {
+        disconnect(m_pSocket, 0, this, 0);
+        m_pSocket->abort();
+        m_pSocket->deleteLater();
+        m_pSocket = NULL;
+    }
+
+    stopListening();
+    m_pElevator->deleteLater();
+    m_pElevator = NULL;
+    m_listPending.clear();
+
+    failAll();
+}
+
+/*!
+Slot called when a connection to the helper socket has been closed. If it was the accepted helper, it has
+been idle for UPDATENODE_HELPER_IDLE_TIMEOUT, or has crashed: outstanding requests fail, and the next
+ElevatedHelper::start launches a new helper
+*/
+void ElevatedHelper::helperDisconnected()
+{
+    QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+    if(!socket)
+        return;
+
+    socket->deleteLater();
+
+    // a rejected connection
+    if(socket != m_pSocket)
+        return;
+
+    UpdateNode::Logging() << "Elevated helper disconnected";
+    m_pSocket = NULL;
+
+    // the helper quits on its own, its elevation process is not waited for
+    if(m_pElevator)
+    {
+        disconnect(m_pElevator, 0, this, 0);
+        if(m_pElevator->state() == QProcess::NotRunning)
+            m_pElevator->deleteLater();
+        else
+            connect(m_pElevator, SIGNAL(finished(int, QProcess::ExitStatus)), m_pElevator, SLOT(deleteLater()));
+        m_pElevator = NULL;
+    }
+
+    stopListening();
+    m_listPending.clear();
+
+    failAll();
+}
+
+/*!
+Finishes all outstanding requests with UPDATENODE_PROCERROR_COMMAND_LAUNCH_FAILED
+*/
+void ElevatedHelper::failAll()
+{
+    QList<int> requests = m_listRequests;
+    m_listRequests.clear();
+
+    foreach(int request, requests)
+        emit finished(request, UPDATENODE_PROCERROR_COMMAND_LAUNCH_FAILED, QProcess::NormalExit);
+}
+
+/*!
+Closes and deletes the socket server of the current helper, its token file and socket directory
+*/
+void ElevatedHelper::stopListening()
+{
+    if(m_pServer)
+    {
+        m_pServer->close();
+        m_pServer->deleteLater();
+        m_pServer = NULL;
+    }
+
+    delete m_pTokenFile;
+    m_pTokenFile = NULL;
+
+    if(!m_strSocketDir.isEmpty())
+    {
+        QDir().rmdir(m_strSocketDir);
+        m_strSocketDir.clear();
+    }
+}
+
+/*!
+Returns the arguments for \a aElevator to start unclient in helper mode
+*/
+QStringList ElevatedHelper::elevatorArguments(const QString& aElevator) const
+{
+    QStringList helper;
+    helper << qApp->applicationFilePath() << UPDATENODE_HELPER_ARGUMENT << m_pServer->fullServerName() << m_pTokenFile->fileName();
+
+    if(aElevator.indexOf("pkexec") > -1)
+        return helper;
+
+    QString description = UpdateNode::Config::Instance()->product().getName();
+    if(description.isEmpty())
+        description = qApp->applicationName();
+
+    // gksudo and kdesudo take the command as a single argument
+    QString command = QString("\"%1\" %2").arg(helper.takeFirst()).arg(helper.join(" "));
+
+    if(aElevator.indexOf("gksudo") > -1)
+        return QStringList() << "--description" << description << command;
+    else if(aElevator.indexOf("kdesudo") > -1)
+        return QStringList() << "--comment" << description + " needs administrative privileges. Please enter your password." << command;
+
+    return QStringList() << command;
+}
@@ -0,0 +1,361 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QList>
+
+#include "filecopier.h"
+#include "partfile.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::FileCopier
+\brief Copies a file atomically, using the fastest way the operating system offers
+\n\n
+The data is written to a temporary file next to the destination, which is synced to disk and renamed to the
+destination by PartFile::replace. The destination is therefore either the old or the complete new file,
+even if the copy is interrupted. The copy gets the permissions of the source.
+\n On Linux, the following strategies are tried in this order, the first one supported by the file systems is used:
+\n
+- STRATEGY_CLONE: the copy shares the data blocks of the source (FICLONE, e.g. on Btrfs or XFS), nothing is copied at all
+- STRATEGY_COPY_RANGE: the kernel copies the data (copy_file_range), server side on network file systems
+- STRATEGY_SENDFILE: the kernel copies the data (sendfile), without passing it through user space
+- STRATEGY_BUFFERED: the data is read and written in chunks of UPDATENODE_COPY_BUFFER
+\n
+Other platforms use STRATEGY_BUFFERED.
+*/
+
+/*!
+Constructs a FileCopier copying \a aFrom to \a aTo
+*/
+FileCopier::FileCopier(const QString& aFrom, const QString& aTo)
+    : m_strFrom(aFrom), m_strTo(aTo)
+{
+    m_eStrategy = STRATEGY_AUTO;
+}
+
+/*!
+Copies the file with \a aStrategy. STRATEGY_AUTO tries all strategies, from the fastest to STRATEGY_BUFFERED.
+\n Returns true on success. On failure the destination is unchanged, see FileCopier::errorString
+*/
+bool FileCopier::copy(Strategy aStrategy /* = STRATEGY_AUTO */)
+{
+    m_strError.clear();
+    m_eStrategy = STRATEGY_AUTO;
+
+    QFile source(m_strFrom);
+    if(!source.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        m_strError = source.errorString();
+        return false;
+    }
+
+    qint64 size = source.size();
+
+    QFileInfo info(m_strTo);
+    QTemporaryFile target(info.absolutePath() + "/." + info.fileName() + ".XXXXXX");
+    target.setAutoRemove(false);
+
+    if(!target.open())
+    {
+        m_strError = target.errorString();
+        return false;
+    }
+
+    QList<Strategy> strategies;
+    if(aStrategy == STRATEGY_AUTO)
+        strategies << STRATEGY_CLONE << STRATEGY_COPY_RANGE << STRATEGY_SENDFILE << STRATEGY_BUFFERED;
+    else
+        strategies << aStrategy;
+
+    bool copied = false;
+    foreach(Strategy strategy, strategies)
+    {
+        if(!isSupported(strategy))
+            continue;
+
+        // a failed strategy may have written some data already
+        if(!source.seek(0) || !rewind(target))
+            break;
+
+        if(copyWith(strategy, source, target, size))
+        {
+            m_eStrategy = strategy;
+            copied = true;
+            break;
+        }
+    }
+
+    if(copied && target.size() != size)
+    {
+        m_strError = QString("%1 has %2 instead of %3 bytes").arg(target.fileName()).arg(target.size()).arg(size);
+        copied = false;
+    }
+
+    if(copied && (!target.setPermissions(source.permissions()) || !PartFile::sync(target)))
+    {
+        m_strError = target.errorString();
+        copied = false;
+    }
+
+    QString temporary = target.fileName();
+    target.close();
+
+    if(!copied)
+    {
+        if(m_strError.isEmpty())
+            m_strError = QString("%1 is not supported").arg(strategyName(aStrategy));
+
+        QFile::remove(temporary);
+        return false;
+    }
+
+    if(!PartFile::replace(temporary, m_strTo))
+    {
+        m_strError = QString("Could not move %1 to %2").arg(temporary).arg(m_strTo);
+        QFile::remove(temporary);
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+Returns the strategy used by the last successful FileCopier::copy, or STRATEGY_AUTO
+*/
+FileCopier::Strategy FileCopier::strategy() const
+{
+    return m_eStrategy;
+}
+
+/*!
+Returns a human readable description of the last error
+*/
+QString FileCopier::errorString() const
+{
+    return m_strError;
+}
+
+/*!
+Returns true, if \a aStrategy is available on this platform. The file systems involved may still not support it
+*/
+bool FileCopier::isSupported(Strategy aStrategy)
+{
+    switch(aStrategy)
+    {
+#ifdef Q_OS_LINUX
+#ifdef FICLONE
+        case STRATEGY_CLONE:        return true;
+#endif
+#ifdef SYS_copy_file_range
+        case STRATEGY_COPY_RANGE:   return true;
+#endif
+        case STRATEGY_SENDFILE:     return true;
+#endif
+        case STRATEGY_AUTO:
+        case STRATEGY_BUFFERED:     return true;
+        default:                    return false;
+    }
+}
+
+/*!
+Returns the name of \a aStrategy
+*/
+QString FileCopier::strategyName(Strategy aStrategy)
+{
+    switch(aStrategy)
+    {
+        case STRATEGY_CLONE:        return "clone";
+        case STRATEGY_COPY_RANGE:   return "copy_file_range";
+        case STRATEGY_SENDFILE:     return "sendfile";
+        case STRATEGY_BUFFERED:     return "buffered";
+        default:                    return "auto";
+    }
+}
+
+/*!
+Copies \a aSize bytes from \a aSource to the empty \a aTarget with \a aStrategy
+*/
+bool FileCopier::copyWith(Strategy aStrategy, QFile& aSource, QFile& aTarget, qint64 aSize)
+{
+    switch(aStrategy)
+    {
+        case STRATEGY_CLONE:        return clone(aSource, aTarget);
+        case STRATEGY_COPY_RANGE:   return copyRange(aSource, aTarget, aSize);
+        case STRATEGY_SENDFILE:     return sendFile(aSource, aTarget, aSize);
+        case STRATEGY_BUFFERED:     return buffered(aSource, aTarget, aSize);
+        default:                    return false;
+    }
+}
+
+/*!
+Lets \a aTarget share the data blocks of \a aSource
+*/
+bool FileCopier::clone(QFile& aSource, QFile& aTarget)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    if(::ioctl(aTarget.handle(), FICLONE, aSource.handle()) == 0)
+        return true;
+
+    setSystemError("FICLONE");
+#else
+    Q_UNUSED(aSource);
+    Q_UNUSED(aTarget);
+#endif
+    return false;
+}
+
+/*!
+Copies \a aSize bytes from \a aSource to \a aTarget within the kernel with copy_file_range
+*/
+bool FileCopier::copyRange(QFile& aSource, QFile& aTarget, qint64 aSize)
+{
+#if defined(Q_OS_LINUX) && defined(SYS_copy_file_range)
+    loff_t in = 0;
+    loff_t out = 0;
+
+    while(in < aSize)
+    {
+        // the system call is used directly, as older C libraries have no wrapper for it
+        long copied = ::syscall(SYS_copy_file_range, aSource.handle(), &in, aTarget.handle(), &out, (size_t)qMin(aSize - (qint64)in, (qint64)0x40000000), 0);
+
+        if(copied < 0 && errno == EINTR)
+            continue;
+
+        if(copied <= 0)
+        {
+            setSystemError("copy_file_range");
+            return false;
+        }
+    }
+
+    return true;
+#else
+    Q_UNUSED(aSource);
+    Q_UNUSED(aTarget);
+    Q_UNUSED(aSize);
+    return false;
+#endif
+}
+
+/*!
+Copies \a aSize bytes from \a aSource to \a aTarget within the kernel with sendfile
+*/
+bool FileCopier::sendFile(QFile& aSource, QFile& aTarget, qint64 aSize)
+{
+#ifdef Q_OS_LINUX
+    off_t offset = 0;
+
+    while(offset < aSize)
+    {
+        // sendfile transfers at most 0x7ffff000 bytes at once
+        ssize_t copied = ::sendfile(aTarget.handle(), aSource.handle(), &offset, (size_t)qMin(aSize - (qint64)offset, (qint64)0x7ffff000));
+
+        if(copied < 0 && errno == EINTR)
+            continue;
+
+        if(copied <= 0)
+        {
+            setSystemError("sendfile");
+            return false;
+        }
+    }
+
+    return true;
+#else
+    Q_UNUSED(aSource);
+    Q_UNUSED(aTarget);
+    Q_UNUSED(aSize);
+    return false;
+#endif
+}
+
+/*!
+Copies \a aSize bytes from \a aSource to \a aTarget in chunks of UPDATENODE_COPY_BUFFER
+*/
+bool FileCopier::buffered(QFile& aSource, QFile& aTarget, qint64 aSize)
+{
+    qint64 written = 0;
+
+    while(written < aSize)
+    {
+        QByteArray data = aSource.read(qMin(aSize - written, (qint64)UPDATENODE_COPY_BUFFER));
+        if(data.isEmpty())
+        {
+            m_strError = aSource.errorString();
+            return false;
+        }
+
+        if(aTarget.write(data) != data.size())
+        {
+            m_strError = aTarget.errorString();
+            return false;
+        }
+
+        written += data.size();
+    }
+
+    return aTarget.flush();
+}
+
+/*!
+Truncates \a aTarget and moves its position to the start
+*/
+bool FileCopier::rewind(QFile& aTarget)
+{
+    if(!aTarget.resize(0) || !aTarget.seek(0))
+    {
+        m_strError = aTarget.errorString();
+        return false;
+    }
+
+#ifdef Q_OS_LINUX
+    // sendfile moves the position of the file descriptor, which QFile does not know about
+    ::lseek(aTarget.handle(), 0, SEEK_SET);
+#endif
+
+    return true;
+}
+
+/*!
+Sets the error string to the last system error of \a aAction
+*/
+void FileCopier::setSystemError(const QString& aAction)
+{
+#ifdef Q_OS_LINUX
+    m_strError = QString("%1 failed: %2").arg(aAction).arg(QString::fromLocal8Bit(::strerror(errno)));
+#else
+    m_strError = QString("%1 failed").arg(aAction);
+#endif
+}
@@ -0,0 +1,298 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QFile>
+#include <QDataStream>
+#include <QStringList>
+
+#include "helpersession.h"
+#include "elevatedhelper.h"
+#include "commander.h"
+#include "status.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::HelperSession
+\brief The elevated side of UpdateNode::ElevatedHelper
+\n\n
+unclient runs a HelperSession, when started with UPDATENODE_HELPER_ARGUMENT by ElevatedHelper::start. The session
+connects to the socket of the client, and runs each requested command in a process of its own. Their output
+and exit codes are sent back to the client. Copies and permission changes are done by the session itself.
+\n When the connection is closed, or no operation has been requested for UPDATENODE_HELPER_IDLE_TIMEOUT, the session
+ends. Running commands are not interrupted: HelperSession::finished is emitted once they have finished.
+*/
+
+/*!
+Constructs a HelperSession object
+*/
+HelperSession::HelperSession(QObject* parent /* = 0 */)
+    : QObject(parent)
+{
+    connect(&m_oSocket, SIGNAL(readyRead()), SLOT(readMessages()));
+    connect(&m_oSocket, SIGNAL(disconnected()), SLOT(disconnected()));
+
+    m_bQuitting = false;
+    m_oIdleTimer.setSingleShot(true);
+    m_oIdleTimer.setInterval(UPDATENODE_HELPER_IDLE_TIMEOUT);
+    connect(&m_oIdleTimer, SIGNAL(timeout()), SLOT(idle()));
+}
+
+/*!
+Destructs the HelperSession object
+*/
+HelperSession::~HelperSession()
+{
+    disconnect(&m_oSocket, 0, this, 0);
+}
+
+/*!
+Connects to the client socket \a aServer and authenticates with \a aToken.
+\n Returns false if the client cannot be reached
+*/
+bool HelperSession::connectToClient(const QString& aServer, const QString& aToken)
+{
+    m_oSocket.connectToServer(aServer);
+
+    if(!m_oSocket.waitForConnected(UPDATENODE_HELPER_CONNECT_TIMEOUT))
+    {
+        UpdateNode::Logging() << "Helper could not connect to " << aServer << ": " << m_oSocket.errorString();
+        return false;
+    }
+
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    stream << (qint32)UpdateNode::ElevatedHelper::MSG_HELLO << aToken;
+
+    UpdateNode::ElevatedHelper::send(&m_oSocket, message);
+    m_oIdleTimer.start();
+
+    return true;
+}
+
+/*!
+Sets the time without any operation, after which the session ends, to \a aMsec milliseconds.
+The default is UPDATENODE_HELPER_IDLE_TIMEOUT
+*/
+void HelperSession::setIdleTimeout(int aMsec)
+{
+    m_oIdleTimer.setInterval(aMsec);
+}
+
+/*!
+Slot called when the client has sent data
+*/
+void HelperSession::readMessages()
+{
+    QByteArray message;
+
+    while(UpdateNode::ElevatedHelper::receive(&m_oSocket, message))
+    {
+        QDataStream stream(message);
+        qint32 type;
+        qint32 request;
+        stream >> type >> request;
+
+        m_oIdleTimer.start();
+
+        if(type == UpdateNode::ElevatedHelper::MSG_RUN)
+        {
+            QString command;
+            QStringList arguments;
+            QString workingDir;
+            stream >> command >> arguments >> workingDir;
+
+            run(request, command, arguments, workingDir);
+        }
+        else if(type == UpdateNode::ElevatedHelper::MSG_COPY)
+        {
+            QString from;
+            QString to;
+            stream >> from >> to;
+
+            sendExit(request, UpdateNode::Commander::copy(from, to) ? 0 : -1, QProcess::NormalExit);
+        }
+        else if(type == UpdateNode::ElevatedHelper::MSG_EXTRACT)
+        {
+            QString archive;
+            QString target;
+            stream >> archive >> target;
+
+            sendExit(request, UpdateNode::Commander::extract(archive, target) ? 0 : -1, QProcess::NormalExit);
+        }
+        else if(type == UpdateNode::ElevatedHelper::MSG_CHMOD)
+        {
+            QString file;
+            qint32 permissions;
+            stream >> file >> permissions;
+
+            UpdateNode::Logging() << QString("Setting permissions of %1 to %2").arg(file).arg(permissions, 0, 16);
+            sendExit(request, QFile::setPermissions(file, (QFile::Permissions)permissions) ? 0 : -1, QProcess::NormalExit);
+        }
+    }
+}
+
+/*!
+Slot called when the client has closed the connection
+*/
+void HelperSession::disconnected()
+{
+    UpdateNode::Logging() << "Client disconnected from helper";
+
+    m_bQuitting = true;
+    quitWhenIdle();
+}
+
+/*!
+Slot called when no operation has been requested for UPDATENODE_HELPER_IDLE_TIMEOUT
+*/
+void HelperSession::idle()
+{
+    // long running installers do not count as idle time
+    if(!m_mapProcesses.isEmpty())
+    {
+        m_oIdleTimer.start();
+        return;
+    }
+
+    UpdateNode::Logging() << "Helper has been idle, closing the connection";
+
+    if(m_oSocket.state() == QLocalSocket::ConnectedState)
+        m_oSocket.disconnectFromServer();
+    else
+        disconnected();
+}
+
+/*!
+Starts \a aCommand for the request \a aRequest
+*/
+void HelperSession::run(int aRequest, const QString& aCommand, const QStringList& aArguments, const QString& aWorkingDir)
+{
+    UpdateNode::Logging() << "helper command:" << aCommand;
+    UpdateNode::Logging() << "helper commandline (without quotes):" << aArguments.join(" ");
+
+    QProcess* process = new QProcess(this);
+    process->setWorkingDirectory(aWorkingDir);
+
+    connect(process, SIGNAL(readyReadStandardOutput()), SLOT(processOutput()));
+    connect(process, SIGNAL(readyReadStandardError()), SLOT(processError()));
+    connect(process, SIGNAL(finished(int, QProcess::ExitStatus)), SLOT(processExit(int, QProcess::ExitStatus)));
+
+    m_mapProcesses[process] = aRequest;
+    process->start(aCommand, aArguments);
+
+    // wait 1 minute for process start, as Commander::run does
+    if(!process->waitForStarted(1000 * 60))
+    {
+        UpdateNode::Logging() << "Error: Update failed to start:" << process->errorString();
+        m_mapProcesses.remove(process);
+        disconnect(process, 0, this, 0);
+        process->kill();
+        process->deleteLater();
+
+        sendExit(aRequest, UPDATENODE_PROCERROR_COMMAND_LAUNCH_FAILED, QProcess::NormalExit);
+    }
+}
+
+/*!
+Slot called when a command has written to stdout
+*/
+void HelperSession::processOutput()
+{
+    QProcess* process = qobject_cast<QProcess*>(sender());
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << process->readAllStandardOutput();
+
+    send(UpdateNode::ElevatedHelper::MSG_STDOUT, m_mapProcesses.value(process), data);
+}
+
+/*!
+Slot called when a command has written to stderr
+*/
+void HelperSession::processError()
+{
+    QProcess* process = qobject_cast<QProcess*>(sender());
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << process->readAllStandardError();
+
+    send(UpdateNode::ElevatedHelper::MSG_STDERR, m_mapProcesses.value(process), data);
+}
+
+/*!
+Slot called when a command has ended
+*/
+void HelperSession::processExit(int aExitCode, QProcess::ExitStatus aExitStatus)
+{
+    QProcess* process = qobject_cast<QProcess*>(sender());
+    int request = m_mapProcesses.take(process);
+    process->deleteLater();
+
+    sendExit(request, aExitCode, aExitStatus);
+    m_oIdleTimer.start();
+
+    if(m_bQuitting)
+        quitWhenIdle();
+}
+
+/*!
+Sends a message of type \a aType for the request \a aRequest with the serialized payload \a aData
+*/
+void HelperSession::send(int aType, int aRequest, const QByteArray& aData)
+{
+    if(m_oSocket.state() != QLocalSocket::ConnectedState)
+        return;
+
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    stream << (qint32)aType << (qint32)aRequest;
+
+    UpdateNode::ElevatedHelper::send(&m_oSocket, message + aData);
+}
+
+/*!
+Sends the end of the request \a aRequest with \a aExitCode and \a aExitStatus
+*/
+void HelperSession::sendExit(int aRequest, int aExitCode, QProcess::ExitStatus aExitStatus)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << (qint32)aExitCode << (qint32)aExitStatus;
+
+    send(UpdateNode::ElevatedHelper::MSG_FINISHED, aRequest, data);
+}
+
+/*!
+Emits HelperSession::finished, once no command is running anymore
+*/
+void HelperSession::quitWhenIdle()
+{
+    if(m_mapProcesses.isEmpty())
+    {
+        m_oIdleTimer.stop();
+        emit finished();
+    }
+}
@@ -0,0 +1,329 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QTimer>
+
+#include "installscheduler.h"
+#include "config.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::InstallScheduler
+\brief Installs updates in their order, running independent updates of different products at the same time
+\n\n
+Updates are added in the order they need to be installed, each with a group, which is the product it belongs to.
+An update is started once it is ready (downloaded, see InstallScheduler::setReady), and
+\n
+- all earlier updates of its group have finished,
+- it is independent (Update::isIndependent) and all earlier updates still running or waiting are independent as well,
+  or it is not independent and all earlier updates have finished,
+- less than InstallScheduler::concurrency updates are running.
+\n
+Without independent updates, all updates are installed one after another, as before.
+Each running update has a UpdateNode::Commander of its own. InstallScheduler::stop drops all waiting updates
+after a failure, running installers are not interrupted.
+*/
+
+/*!
+Constructs an empty InstallScheduler, installing up to Config::getConcurrentInstalls updates at once
+*/
+InstallScheduler::InstallScheduler(QObject* parent /* = 0 */)
+    : QObject(parent)
+{
+    m_iConcurrency = UpdateNode::Config::Instance()->getConcurrentInstalls();
+    m_iNextId = 1;
+    m_bHelper = true;
+    m_bScheduled = false;
+}
+
+/*!
+Destructs the InstallScheduler
+*/
+InstallScheduler::~InstallScheduler()
+{
+    foreach(Install install, m_listInstalls)
+        if(install.m_pCommander)
+            disconnect(install.m_pCommander, 0, this, 0);
+}
+
+/*!
+Adds \a aUpdate of the group \a aGroup behind all updates added before. It is not started before InstallScheduler::setReady.
+\n Returns the id of the install
+*/
+int InstallScheduler::add(const UpdateNode::Update& aUpdate, const QString& aGroup)
+{
+    Install install;
+    install.m_iId = m_iNextId++;
+    install.m_oUpdate = aUpdate;
+    install.m_strGroup = aGroup;
+    install.m_bReady = false;
+    install.m_pCommander = NULL;
+
+    m_listInstalls.append(install);
+
+    return install.m_iId;
+}
+
+/*!
+Marks the install \a aInstall as ready, its update has been downloaded
+*/
+void InstallScheduler::setReady(int aInstall)
+{
+    int index = indexOf(aInstall);
+    if(index < 0)
+        return;
+
+    m_listInstalls[index].m_bReady = true;
+    scheduleLater();
+}
+
+/*!
+Drops all installs, which have not been started yet. Running installers are not interrupted
+*/
+void InstallScheduler::stop()
+{
+    for(int i = m_listInstalls.size() - 1; i >= 0; i--)
+        if(!m_listInstalls.at(i).m_pCommander)
+            m_listInstalls.removeAt(i);
+}
+
+/*!
+Sets the number of installers \a aInstalls running at once
+*/
+void InstallScheduler::setConcurrency(int aInstalls)
+{
+    m_iConcurrency = qMax(1, aInstalls);
+    scheduleLater();
+}
+
+/*!
+Returns the number of installers running at once
+*/
+int InstallScheduler::concurrency() const
+{
+    return m_iConcurrency;
+}
+
+/*!
+Sets whether updates requiring admin privileges are run through UpdateNode::ElevatedHelper \a aHelper (default: true)
+\sa Commander::setElevatedHelper
+*/
+void InstallScheduler::setElevatedHelper(bool aHelper)
+{
+    m_bHelper = aHelper;
+}
+
+/*!
+Returns true as long as installs are waiting or running
+*/
+bool InstallScheduler::isBusy() const
+{
+    return !m_listInstalls.isEmpty();
+}
+
+/*!
+Returns the number of running installers
+*/
+int InstallScheduler::running() const
+{
+    int running = 0;
+
+    foreach(Install install, m_listInstalls)
+        if(install.m_pCommander)
+            running++;
+
+    return running;
+}
+
+/*!
+Returns the update of the install \a aInstall, or an empty update if it has finished already
+*/
+UpdateNode::Update InstallScheduler::update(int aInstall) const
+{
+    int index = indexOf(aInstall);
+    return index < 0 ? UpdateNode::Update() : m_listInstalls.at(index).m_oUpdate;
+}
+
+/*!
+Starts all installs, which may run now
+*/
+void InstallScheduler::schedule()
+{
+    m_bScheduled = false;
+
+    // starting an install may finish others at once, so the search starts over after each one
+    bool started = true;
+    while(started)
+    {
+        started = false;
+
+        for(int i = 0; i < m_listInstalls.size() && !started; i++)
+        {
+            if(isStartable(i))
+            {
+                start(i);
+                started = true;
+            }
+        }
+    }
+}
+
+/*!
+Schedules once control returns to the event loop, so signal handlers may add or stop installs safely
+*/
+void InstallScheduler::scheduleLater()
+{
+    if(!m_bScheduled)
+    {
+        m_bScheduled = true;
+        QTimer::singleShot(0, this, SLOT(schedule()));
+    }
+}
+
+/*!
+Returns true, if the install at \a aIndex is waiting and may be started now
+*/
+bool InstallScheduler::isStartable(int aIndex) const
+{
+    const Install& install = m_listInstalls.at(aIndex);
+
+    if(install.m_pCommander || !install.m_bReady || running() >= m_iConcurrency)
+        return false;
+
+    for(int i = 0; i < aIndex; i++)
+    {
+        const Install& earlier = m_listInstalls.at(i);
+
+        if(earlier.m_strGroup == install.m_strGroup)
+            return false;
+
+        if(!earlier.m_oUpdate.isIndependent() || !install.m_oUpdate.isIndependent())
+            return false;
+    }
+
+    return true;
+}
+
+/*!
+Starts the installer of the install at \a aIndex with a Commander of its own
+*/
+void InstallScheduler::start(int aIndex)
+{
+    int id = m_listInstalls.at(aIndex).m_iId;
+    UpdateNode::Update update = m_listInstalls.at(aIndex).m_oUpdate;
+
+    UpdateNode::Commander* commander = new UpdateNode::Commander(this);
+    commander->setElevatedHelper(m_bHelper);
+    m_listInstalls[aIndex].m_pCommander = commander;
+
+    connect(commander, SIGNAL(processOutput()), SLOT(commanderOutput()));
+    connect(commander, SIGNAL(processError()), SLOT(commanderError()));
+    connect(commander, SIGNAL(updateExit(int, QProcess::ExitStatus)), SLOT(commanderExit(int, QProcess::ExitStatus)));
+
+    UpdateNode::Logging() << "Installing " << update.getTitle();
+    emit started(id);
+
+    if(!commander->run(update))
+    {
+        // the commander may have reported the failure as updateExit already
+        int index = indexOf(id);
+        if(index > -1)
+        {
+            m_listInstalls.removeAt(index);
+            disconnect(commander, 0, this, 0);
+            commander->deleteLater();
+            emit failedToStart(id);
+        }
+    }
+}
+
+/*!
+Slot called when an installer has ended
+*/
+void InstallScheduler::commanderExit(int aExitCode, QProcess::ExitStatus aExitStatus)
+{
+    UpdateNode::Commander* commander = qobject_cast<UpdateNode::Commander*>(sender());
+    int index = indexOf(commander);
+
+    if(index < 0)
+        return;
+
+    int id = m_listInstalls.at(index).m_iId;
+    m_listInstalls.removeAt(index);
+
+    disconnect(commander, 0, this, 0);
+    commander->deleteLater();
+
+    emit finished(id, aExitCode, aExitStatus);
+
+    scheduleLater();
+}
+
+/*!
+Slot called when an installer has written to stdout
+*/
+void InstallScheduler::commanderOutput()
+{
+    UpdateNode::Commander* commander = qobject_cast<UpdateNode::Commander*>(sender());
+    int index = indexOf(commander);
+
+    if(index > -1)
+        emit output(m_listInstalls.at(index).m_iId, commander->readStdOut(), false);
+}
+
+/*!
+Slot called when an installer has written to stderr
+*/
+void InstallScheduler::commanderError()
+{
+    UpdateNode::Commander* commander = qobject_cast<UpdateNode::Commander*>(sender());
+    int index = indexOf(commander);
+
+    if(index > -1)
+        emit output(m_listInstalls.at(index).m_iId, commander->readStdErr(), true);
+}
+
+/*!
+Returns the index of the install \a aInstall, or -1
+*/
+int InstallScheduler::indexOf(int aInstall) const
+{
+    for(int i = 0; i < m_listInstalls.size(); i++)
+        if(m_listInstalls.at(i).m_iId == aInstall)
+            return i;
+
+    return -1;
+}
+
+/*!
+Returns the index of the install run by \a aCommander, or -1
+*/
+int InstallScheduler::indexOf(UpdateNode::Commander* aCommander) const
+{
+    for(int i = 0; i < m_listInstalls.size(); i++)
+        if(m_listInstalls.at(i).m_pCommander == aCommander)
+            return i;
+
+    return -1;
+}
@@ -70,3 +70,49 @@ QString LocalFile::getCachePath()
 {
     return QDir::toNativeSeparators(getDownloadPath() + QDir::separator() + "cache");
 }
+
+/*!
+Returns the path of the content addressed download cache. In contrast to LocalFile::getCachePath,
+this path is shared between all keys, so identical files are stored only once
+\sa UpdateNode::CacheManager
+*/
+QString LocalFile::getBlobPath()
+{
+    UpdateNode::Settings settings;
+    QString path = settings.getDownloadPath() + QDir::separator() + "UpdateNode" + QDir::separator() + "blobs";
+
+    if(!QDir(path).exists())
+        QDir().mkpath(path);
+
+    return QDir::toNativeSeparators(path);
+}
+
+/*!
+Returns the path where the last responses of UpdateNode.com are stored, a subfolder of the download path
+\sa UpdateNode::ResponseCache
+*/
+QString LocalFile::getResponsePath()
+{
+    QString path = getDownloadPath() + QDir::separator() + "responses";
+
+    if(!QDir(path).exists())
+        QDir().mkpath(path);
+
+    return QDir::toNativeSeparators(path);
+}
+
+/*!
+Returns the location of the downloaded file of \a aUpdate: the cached file if there is one,
+otherwise LocalFile::getDownloadLocation of its download link
+\sa Settings::getCachedFile
+*/
+QString LocalFile::getUpdateLocation(const UpdateNode::Update& aUpdate)
+{
+    UpdateNode::Settings settings;
+    QString cachedFile = settings.getCachedFile(aUpdate.getCode());
+
+    if(!aUpdate.getCode().isEmpty() && !cachedFile.isEmpty() && QFile::exists(cachedFile))
+        return cachedFile;
+
+    return getDownloadLocation(aUpdate.getDownloadLink());
+}
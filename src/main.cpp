@@ -30,11 +30,18 @@
 #include "status.h"
 #include "limittimer.h"
 #include "helpdialog.h"
+#include "networksession.h"
+#include "responsecache.h"
+#include "helpersession.h"
+#include "elevatedhelper.h"
 
 #ifndef APP_COPYRIGHT
 #define APP_COPYRIGHT "(C) 2014 UpdateNode UG (haftungsbeschränkt). All rights reserved."
 #endif
 
+// number of download hosts of the last responses connected to at start up
+#define UPDATENODE_WARMUP_HOSTS 4
+
 int printHelp()
 {
     QString version = QString("%1.%2.%3.%4").arg(APP_VERSION_HIGH).arg(APP_VERSION_LOW).arg(APP_VERSION_REV).arg(APP_VERSION_BUILD);
@@ -46,6 +53,7 @@ int printHelp()
             + "  -update         \truns single update mode only\n"
             + "  -download       \truns single update mode only, but exits after download\n"
             + "  -execute        \texecutes the downloaded single update (relates to -download)\n"
+            + "  -prefetch       \tchecks and downloads updates in background (with -st: shows a tray icon)\n"
             + "  -messages       \truns message mode only\n"
             + "  -manager        \truns update manager mode\n"
             + "  -register       \tregistrates the current version\n"
@@ -63,10 +71,20 @@ int printHelp()
             + "  -c <custom>    \tcustom request value\n"
             + "  -s             \tsilent mode\n"
             + "  -r             \trelaunch client in temp directory (self update)\n"
-            + "  -st            \tsystem tray icon (-check mode only)\n"
+            + "  -st            \tsystem tray icon (-check and -prefetch mode only)\n"
             + "  -http          \tdo not use a secure SSL connection (not recommended)\n"
             + "  -em            \tenforce additional messages mode before terminating\n"
             + "  -to <seconds>  \tsets timeout for update check in seconds (default: 20)\n"
+            + "  -seg <count>   \tdownloads updates over <count> parallel connections (max. 6)\n"
+            + "  -quota <MB>    \tlimits the download cache size in MB, 0 for no limit (default: 2048)\n"
+            + "  -dl <count>    \tdownloads up to <count> updates at the same time (default: 2)\n"
+            + "  -inst <count>  \tinstalls up to <count> independent updates at the same time (default: 2)\n"
+            + "  -ttl <sec>     \treuses the last check result for <sec> seconds without a request\n"
+            + "  -alt <url>     \tsends a hedged request to <url> if the service responds slowly\n"
+            + "  -delta         \tonly requests what has changed since the last check\n"
+            + "  -rate <KB/s>   \tlimits the bandwidth of update downloads in KB/s\n"
+            + "  -bg            \tdownloads updates in background, yielding to other requests\n"
+            + "  -mirror <rule> \talso tries download links with <prefix>=<replacement> applied\n"
             + "  -log <file>    \tenables logging\n"
             + "  -qss <file>    \ttakes stylesheet definition from file\n"
             + "  -config <file> \tloads parameter settings from file\n"
@@ -105,7 +123,46 @@ int main(int argc, char *argv[])
         return UPDATENODE_PROCERROR_WRONG_PARAMETER;
     }
 
+    if(argc > 1 && strcmp(argv[1],"-extract") == 0)
+    {
+        // check for extract command, which is run elevated for updates requiring admin privileges
+        QCoreApplication app(argc, argv);
+        QStringList args = app.arguments();
+        if(args.size()>=4)
+        {
+            if(UpdateNode::Commander::extract(args.at(2), args.at(3)))
+                return 0;
+            else
+                return -1;
+        }
+        UpdateNode::Logging() << "Error -extract called with: " << app.arguments().join(" ");
+        return UPDATENODE_PROCERROR_WRONG_PARAMETER;
+    }
+
+    if(argc > 3 && strcmp(argv[1], UPDATENODE_HELPER_ARGUMENT) == 0)
+    {
+        // elevated helper, started once by UpdateNode::ElevatedHelper
+        QCoreApplication app(argc, argv);
+        QStringList args = app.arguments();
+        // the token is passed in a file only readable by the user, not on the command line
+        QFile tokenFile(args.at(3));
+        if(!tokenFile.open(QIODevice::ReadOnly))
+            return UPDATENODE_PROCERROR_WRONG_PARAMETER;
+        QString token = QString::fromLatin1(tokenFile.readAll()).trimmed();
+        tokenFile.close();
+
+        UpdateNode::HelperSession session;
+        QObject::connect(&session, SIGNAL(finished()), &app, SLOT(quit()));
+        if(!session.connectToClient(args.at(2), token))
+            return UPDATENODE_PROCERROR_WRONG_PARAMETER;
+        return app.exec();
+    }
+
     QApplication a(argc, argv);
+
+    // starts the clock for the time to the first request
+    UpdateNode::NetworkSession::Instance();
+
     UpdateNode::Application un_app;
 
     a.setQuitOnLastWindowClosed(false);
@@ -189,6 +246,26 @@ int main(int argc, char *argv[])
             config->setCustomRequestValue(arguments.at(i+1));
         else if(argument == "-to" && hasNext)
             config->setTimeOut(arguments.at(i+1).toInt());
+        else if(argument == "-seg" && hasNext)
+            config->setSegments(arguments.at(i+1).toInt());
+        else if(argument == "-quota" && hasNext)
+            config->setCacheQuota(arguments.at(i+1).toLongLong() * 1024 * 1024);
+        else if(argument == "-dl" && hasNext)
+            config->setConcurrentDownloads(arguments.at(i+1).toInt());
+        else if(argument == "-inst" && hasNext)
+            config->setConcurrentInstalls(arguments.at(i+1).toInt());
+        else if(argument == "-ttl" && hasNext)
+            config->setResponseTtl(arguments.at(i+1).toInt());
+        else if(argument == "-alt" && hasNext)
+            config->setAlternateHost(arguments.at(i+1));
+        else if(argument == "-delta")
+            config->setDeltaSync(true);
+        else if(argument == "-rate" && hasNext)
+            config->setRateLimit(arguments.at(i+1).toInt() * 1024);
+        else if(argument == "-bg")
+            config->setBackground(true);
+        else if(argument == "-mirror" && hasNext)
+            config->addMirrorRewrite(arguments.at(i+1));
         else if(argument == "-qss" && hasNext)
             config->setStyleSheet(arguments.at(i+1));
         else if(argument == "-log" && hasNext)
@@ -203,7 +280,8 @@ int main(int argc, char *argv[])
             return printHelp();
         else if(argument == "-update" || argument == "-messages"
                 || argument == "-register" || argument == "-unregister" || argument == "-manager"
-                || argument == "-check" || argument == "-download" || argument == "-execute" || argument == "-clean")
+                || argument == "-check" || argument == "-download" || argument == "-execute" || argument == "-clean"
+                || argument == "-prefetch")
             mode = argument;
     }
 
@@ -239,6 +317,11 @@ int main(int argc, char *argv[])
            return settings.unRegisterVersion() ? 0 : 1;
     }
 
+    // resolve and connect to the service and the known download hosts while the dialogs are set up
+    UpdateNode::NetworkSession::Instance()->warmUp(config->getHost().isEmpty() ? QUrl(UPDATENODE_SERVICE_URL) : QUrl::fromUserInput(config->getHost()));
+    foreach(QUrl url, UpdateNode::ResponseCache::storedHosts(UPDATENODE_WARMUP_HOSTS))
+        UpdateNode::NetworkSession::Instance()->warmUp(url);
+
     if(!relaunched)
         settings.setCurrentClientDir(qApp->applicationDirPath());
 
@@ -248,7 +331,15 @@ int main(int argc, char *argv[])
         return 0;
     }
 
-    if(mode != "-manager" && mode != "-check")
+    // prefetching runs unattended and must not get in the way of the user's traffic
+    if(mode == "-prefetch")
+    {
+        config->setBackground(true);
+        if(!config->isSystemTray())
+            config->setSilent(true);
+    }
+
+    if(mode != "-manager" && mode != "-check" && mode != "-prefetch")
     {
         if(config->getVersion().isEmpty() && config->getProductCode().isEmpty()
                 && config->getVersionCode().isEmpty())
@@ -263,7 +354,7 @@ int main(int argc, char *argv[])
             un_app.killOther();
     }
 
-    if(mode == "-check" && config->isSystemTray())
+    if((mode == "-check" && config->isSystemTray()) || mode == "-prefetch")
         un_app.setVisible(false);
     else
         un_app.setVisible();
@@ -271,7 +362,7 @@ int main(int argc, char *argv[])
     un_app.installTranslations();
     un_app.installStyleSheet();
 
-    if(mode == "-manager" || mode.isEmpty() || (mode == "-check" && !config->isSingleMode()))
+    if(mode == "-manager" || mode.isEmpty() || ((mode == "-check" || mode == "-prefetch") && !config->isSingleMode()))
     {
         if(config->getVersion().isEmpty() && config->getVersionCode().isEmpty() && config->getProductCode().isEmpty())
             settings.getRegisteredVersion();
@@ -0,0 +1,173 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QNetworkRequest>
+
+#include "mirrorprobe.h"
+#include "mirrorselector.h"
+#include "networksession.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::MirrorProbe
+\brief Measures the throughput of the mirrors of a download, which have not been used before
+\n\n
+The first UPDATENODE_MIRROR_PROBE_SIZE bytes of the file are requested from all unknown mirrors at once. The
+throughput is measured from the start of the requests, so a mirror which is slow to connect is ranked down as well.
+Mirrors which have not delivered the probe after UPDATENODE_MIRROR_PROBE_TIMEOUT ms are rated with what they have
+delivered so far.
+\n Once all mirrors are measured, finished() is emitted with the candidates ranked by UpdateNode::MirrorSelector.
+*/
+
+/*!
+Constructs a MirrorProbe for \a aCandidates
+*/
+MirrorProbe::MirrorProbe(const QList<QUrl>& aCandidates, QObject* parent /* = 0 */)
+    : QObject(parent), m_listCandidates(aCandidates)
+{
+    m_oTimeout.setSingleShot(true);
+    m_oTimeout.setInterval(UPDATENODE_MIRROR_PROBE_TIMEOUT);
+    connect(&m_oTimeout, SIGNAL(timeout()), SLOT(timeout()));
+}
+
+/*!
+Destructs the MirrorProbe, running probes are aborted
+*/
+MirrorProbe::~MirrorProbe()
+{
+    abort();
+}
+
+/*!
+Sends the probe requests to all candidates without a recorded throughput
+*/
+void MirrorProbe::start()
+{
+    m_oElapsed.start();
+
+    foreach(QUrl candidate, m_listCandidates)
+    {
+        if(UpdateNode::MirrorSelector::Instance()->isKnown(candidate))
+            continue;
+
+        QNetworkRequest request(candidate);
+        request.setRawHeader("Range", "bytes=0-" + QByteArray::number(UPDATENODE_MIRROR_PROBE_SIZE - 1));
+
+        QNetworkReply* reply = UpdateNode::NetworkSession::Instance()->get(request);
+        reply->setReadBufferSize(UPDATENODE_MIRROR_PROBE_SIZE);
+
+        m_mapProbes[reply] = candidate;
+        connect(reply, SIGNAL(readyRead()), SLOT(probeFinished()));
+        connect(reply, SIGNAL(finished()), SLOT(probeFinished()));
+    }
+
+    m_oTimeout.start(m_mapProbes.isEmpty() ? 0 : UPDATENODE_MIRROR_PROBE_TIMEOUT);
+}
+
+/*!
+Aborts all running probes, finished() is not emitted anymore
+*/
+void MirrorProbe::abort()
+{
+    m_oTimeout.stop();
+
+    foreach(QNetworkReply* reply, m_mapProbes.keys())
+    {
+        disconnect(reply, 0, this, 0);
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    m_mapProbes.clear();
+}
+
+/*!
+Returns all candidates of the probe
+*/
+QList<QUrl> MirrorProbe::candidates() const
+{
+    return m_listCandidates;
+}
+
+/*!
+Slot called when a probe has data or has finished. A server ignoring the range sends the whole file,
+so the probe ends as soon as enough data has arrived
+*/
+void MirrorProbe::probeFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+
+    if(!m_mapProbes.contains(reply))
+        return;
+
+    if(!reply->isFinished() && reply->bytesAvailable() < UPDATENODE_MIRROR_PROBE_SIZE)
+        return;
+
+    measure(reply);
+
+    if(m_mapProbes.isEmpty())
+        finish();
+}
+
+/*!
+Slot called when the probes take too long, the remaining mirrors are rated with the data received so far
+*/
+void MirrorProbe::timeout()
+{
+    foreach(QNetworkReply* reply, m_mapProbes.keys())
+        measure(reply);
+
+    finish();
+}
+
+/*!
+Records the throughput of the probe \a aReply and removes it
+*/
+void MirrorProbe::measure(QNetworkReply* aReply)
+{
+    QUrl url = m_mapProbes.take(aReply);
+    int status = aReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    double throughput = 0;
+
+    // a mirror which responds with an error is rated like a stalled one
+    if(aReply->error() == QNetworkReply::NoError && (status == 200 || status == 206))
+        throughput = aReply->bytesAvailable() * 1000.0 / qMax(Q_INT64_C(1), m_oElapsed.elapsed());
+
+    UpdateNode::Logging() << "Mirror " << url.toString() << ": " << QString::number(throughput / 1024, 'f', 0) << " KB/s";
+    UpdateNode::MirrorSelector::Instance()->addThroughput(url, throughput);
+
+    disconnect(aReply, 0, this, 0);
+    if(!aReply->isFinished())
+        aReply->abort();
+    aReply->deleteLater();
+}
+
+/*!
+Emits finished() with the ranked candidates
+*/
+void MirrorProbe::finish()
+{
+    m_oTimeout.stop();
+    emit finished(UpdateNode::MirrorSelector::Instance()->rank(m_listCandidates));
+}
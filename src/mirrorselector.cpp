@@ -0,0 +1,217 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QSettings>
+#include <QPair>
+#include <QtAlgorithms>
+
+#include "mirrorselector.h"
+#include "settings.h"
+#include "config.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::MirrorSelector
+\brief Chooses the mirror an update is downloaded from, by the throughput measured before
+\n\n
+The candidates of a download are its link, the \<mirror\> links of the update, and all of them rewritten by
+the rules of Config::setMirrorRewrites. The throughput of each mirror is recorded on every download and stored
+for the next runs, so once all candidates are known, the fastest one is chosen without probing.
+\sa UpdateNode::MirrorProbe, Update::getMirrors
+*/
+
+/*!
+Global instance of the MirrorSelector pointer
+*/
+MirrorSelector* MirrorSelector::m_pInstance = NULL;
+
+/*!
+Retrieves the global MirrorSelector class instance as an pointer. If no instance is present,
+a new one will be created in this method
+*/
+MirrorSelector* MirrorSelector::Instance()
+{
+    if(!m_pInstance)
+        m_pInstance = new MirrorSelector;
+
+    return m_pInstance;
+}
+
+/*!
+Constructs a MirrorSelector and loads the throughput recorded by the last runs
+*/
+MirrorSelector::MirrorSelector()
+    : QObject(0)
+{
+    if(QCoreApplication::instance())
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), SLOT(save()));
+
+    load();
+}
+
+/*!
+Returns all links the file \a aUrl can be downloaded from: rewritten links first, as they usually point to
+a nearby cache, followed by \a aUrl and its mirrors \a aMirrors
+*/
+QList<QUrl> MirrorSelector::candidates(const QUrl& aUrl, const QStringList& aMirrors) const
+{
+    QList<QUrl> sources;
+    QList<QUrl> candidates;
+
+    sources.append(aUrl);
+    foreach(QString mirror, aMirrors)
+        sources.append(QUrl(mirror));
+
+    foreach(QUrl source, sources)
+    {
+        QUrl rewritten = rewrite(source);
+        if(rewritten != source && !candidates.contains(rewritten))
+            candidates.append(rewritten);
+    }
+
+    foreach(QUrl source, sources)
+        if(source.isValid() && !candidates.contains(source))
+            candidates.append(source);
+
+    return candidates;
+}
+
+/*!
+Applies the first matching rule of Config::getMirrorRewrites on \a aUrl. Returns \a aUrl if no rule matches
+*/
+QUrl MirrorSelector::rewrite(const QUrl& aUrl) const
+{
+    QString link = aUrl.toString();
+
+    foreach(QString rule, UpdateNode::Config::Instance()->getMirrorRewrites())
+    {
+        QString prefix = rule.section('=', 0, 0);
+        if(link.startsWith(prefix))
+            return QUrl(rule.section('=', 1) + link.mid(prefix.length()));
+    }
+
+    return aUrl;
+}
+
+static bool fasterThan(const QPair<double, QUrl>& aLeft, const QPair<double, QUrl>& aRight)
+{
+    return aLeft.first > aRight.first;
+}
+
+/*!
+Returns \a aCandidates ordered by their recorded throughput, the fastest first. Mirrors without a recorded
+throughput follow in their original order
+*/
+QList<QUrl> MirrorSelector::rank(const QList<QUrl>& aCandidates) const
+{
+    QList<QPair<double, QUrl> > scored;
+    foreach(QUrl candidate, aCandidates)
+        scored.append(qMakePair(throughput(candidate), candidate));
+
+    qStableSort(scored.begin(), scored.end(), fasterThan);
+
+    QList<QUrl> ranked;
+    for(int i = 0; i < scored.size(); i++)
+        ranked.append(scored.at(i).second);
+
+    return ranked;
+}
+
+/*!
+Checks if a throughput has been recorded for the mirror of \a aUrl
+*/
+bool MirrorSelector::isKnown(const QUrl& aUrl) const
+{
+    return m_mapThroughput.contains(key(aUrl));
+}
+
+/*!
+Returns the recorded throughput in bytes per second of the mirror of \a aUrl, or -1 if unknown
+*/
+double MirrorSelector::throughput(const QUrl& aUrl) const
+{
+    return m_mapThroughput.value(key(aUrl), -1);
+}
+
+/*!
+Records the throughput \a aBytesPerSecond measured for the mirror of \a aUrl. A stalled download is recorded with 0
+\sa UPDATENODE_MIRROR_SMOOTHING
+*/
+void MirrorSelector::addThroughput(const QUrl& aUrl, double aBytesPerSecond)
+{
+    QString mirror = key(aUrl);
+    double previous = m_mapThroughput.value(mirror, -1);
+
+    if(previous < 0)
+        m_mapThroughput[mirror] = aBytesPerSecond;
+    else
+        m_mapThroughput[mirror] = UPDATENODE_MIRROR_SMOOTHING * aBytesPerSecond + (1 - UPDATENODE_MIRROR_SMOOTHING) * previous;
+
+    // only the mirrors used recently are kept
+    m_listRecent.removeAll(mirror);
+    m_listRecent.append(mirror);
+    while(m_listRecent.size() > UPDATENODE_MIRROR_MAXIMUM)
+        m_mapThroughput.remove(m_listRecent.takeFirst());
+}
+
+/*!
+Returns the key a mirror of \a aUrl is recorded with: its scheme, host and port
+*/
+QString MirrorSelector::key(const QUrl& aUrl)
+{
+    return QString("%1://%2:%3").arg(aUrl.scheme().toLower()).arg(aUrl.host().toLower())
+            .arg(aUrl.port(aUrl.scheme().toLower() == "https" ? 443 : 80));
+}
+
+/*!
+Stores the recorded throughput for the next run
+*/
+void MirrorSelector::save()
+{
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+    QStringList mirrors;
+
+    foreach(QString mirror, m_listRecent)
+        mirrors.append(mirror + " " + QString::number(m_mapThroughput.value(mirror), 'f', 0));
+
+    settings.setValue("Network/Mirrors", mirrors.join(","));
+}
+
+/*!
+Loads the throughput stored by MirrorSelector::save
+*/
+void MirrorSelector::load()
+{
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+
+    foreach(QString mirror, settings.value("Network/Mirrors").toString().split(",", QString::SkipEmptyParts))
+    {
+        QStringList values = mirror.split(" ");
+        if(values.size() != 2)
+            continue;
+
+        m_mapThroughput[values.at(0)] = values.at(1).toDouble();
+        m_listRecent.append(values.at(0));
+    }
+}
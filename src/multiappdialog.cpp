@@ -57,14 +57,18 @@ MultiAppDialog::MultiAppDialog(QWidget *parent) :
 
     m_oTextEdit.hide();
 
-    connect(&m_oCommander, SIGNAL(processError()), this, SLOT(processError()));
-    connect(&m_oCommander, SIGNAL(processError()), this, SLOT(processOutput()));
-    connect(&m_oCommander, SIGNAL(updateExit(int, QProcess::ExitStatus)), this, SLOT(updateExit(int, QProcess::ExitStatus)));
+    m_pScheduler = new UpdateNode::InstallScheduler(this);
 
-    m_pDownloader = new UpdateNode::Downloader();
+    connect(m_pScheduler, SIGNAL(started(int)), SLOT(installStarted(int)));
+    connect(m_pScheduler, SIGNAL(failedToStart(int)), SLOT(installFailed(int)));
+    connect(m_pScheduler, SIGNAL(output(int, const QString&, bool)), SLOT(installOutput(int, const QString&, bool)));
+    connect(m_pScheduler, SIGNAL(finished(int, int, QProcess::ExitStatus)), SLOT(updateExit(int, int, QProcess::ExitStatus)));
 
-    connect(m_pDownloader, SIGNAL(downloadProgress(qint64,qint64)), SLOT(downloadProgress(qint64, qint64)));
-    connect(m_pDownloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), SLOT(downloadDone(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)));
+    m_pDownloads = new UpdateNode::DownloadQueue(this);
+    m_pStats = new UpdateNode::TransferStats(m_pDownloads, this);
+
+    connect(m_pStats, SIGNAL(downloadProgress(qint64,qint64)), SLOT(downloadProgress(qint64, qint64)));
+    connect(m_pDownloads, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), SLOT(downloadDone(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)));
 
     m_pUI->labelProgress->hide();
     m_pUI->toolCancel->hide();
@@ -100,6 +104,8 @@ void MultiAppDialog::init(UpdateNode::Service* aService)
 
     connect(m_pService, SIGNAL(done()), SLOT(serviceDone()));
     connect(m_pService, SIGNAL(doneManager()), SLOT(serviceDoneManager()));
+    connect(m_pService, SIGNAL(updateParsed(UpdateNode::Config*, const UpdateNode::Update&)),
+            SLOT(updateParsed(UpdateNode::Config*, const UpdateNode::Update&)));
 }
 
 void MultiAppDialog::initView()
@@ -261,8 +267,8 @@ void MultiAppDialog::serviceDoneManager()
 
 void MultiAppDialog::cancelProgress()
 {
-    if(m_pDownloader->isDownloading())
-        m_pDownloader->cancel();
+    if(m_pDownloads->isBusy())
+        m_pDownloads->cancelAll();
 }
 
 void MultiAppDialog::updateView(UpdateNode::Config* aConfig /* = NULL */)
@@ -329,6 +335,41 @@ void MultiAppDialog::updateView(UpdateNode::Config* aConfig /* = NULL */)
     adjustSize();
 }
 
+/*!
+Slot called for each update \a aUpdate of \a aConfig as soon as it has been parsed.
+While the dialog is shown, e.g. on Refresh, the update is listed right away. The rows can not be
+checked until the check is done, then the view is rebuilt by serviceDone() or serviceDoneManager()
+*/
+void MultiAppDialog::updateParsed(UpdateNode::Config* aConfig, const UpdateNode::Update& aUpdate)
+{
+    if(!isVisible() || UpdateNode::Settings().isUpdateIgnored(aUpdate.getCode()))
+        return;
+
+    QTreeWidgetItem* product = NULL;
+    for(int i = 0; i < m_pUI->treeUpdate->topLevelItemCount() && !product; i++)
+    {
+        if(m_pUI->treeUpdate->topLevelItem(i)->data(0, Qt::UserRole+1).value<UpdateNode::Config*>() == aConfig)
+            product = m_pUI->treeUpdate->topLevelItem(i);
+    }
+
+    if(!product)
+    {
+        QFont font;
+        font.setPointSize(qApp->font().pointSize()+1);
+
+        product = new QTreeWidgetItem(m_pUI->treeUpdate);
+        product->setFont(0, font);
+        product->setText(0, aConfig->product().getName());
+        product->setData(0, Qt::UserRole+1, QVariant::fromValue(aConfig));
+        product->setFlags(Qt::ItemIsEnabled);
+        product->setExpanded(true);
+    }
+
+    QTreeWidgetItem* updateItem = new QTreeWidgetItem(product);
+    updateItem->setText(0, aUpdate.getTitle() + tr(" (Size: %1)").arg(aUpdate.getFileSize()));
+    updateItem->setFlags(Qt::NoItemFlags);
+}
+
 void MultiAppDialog::updateCounter()
 {
     QString strMessage;
@@ -365,6 +406,9 @@ void MultiAppDialog::refresh()
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
     m_pUI->pshCheck->setDisabled(true);
 
+    // updates are listed by updateParsed() while the response arrives
+    initView();
+
     m_pService->checkForUpdates();
 
     m_pUI->pshCheck->setDisabled(false);
@@ -372,35 +416,140 @@ void MultiAppDialog::refresh()
     adjustSize();
 }
 
+/*!
+Installs all checked updates in the order of the tree.
+\n The installation is pipelined: while installers are running, the next UPDATENODE_PIPELINE_WINDOW updates
+are already downloaded. Downloaded updates are passed to UpdateNode::InstallScheduler, which installs
+independent updates of different products at the same time and all others one after another.
+The pipeline stops on the first failed download or installation.
+*/
 void MultiAppDialog::startInstall()
 {
     m_pUI->labelProgress->show();
-    m_pUI->toolCancel->show();
-    m_pUI->progressBar->show();
     m_pUI->pshUpdate->hide();
     m_pUI->pshCheck->hide();
 
     m_pUI->progressBar->setValue(0);
-    
-    m_oReadyUpdates.clear();
-    m_bIsInstalling = false;
+
+    m_listPipeline.clear();
+    m_listDownloading.clear();
+    m_listDownloaded.clear();
+    m_mapInstalls.clear();
 
     m_pUI->treeUpdate->clearSelection();
 
     QTreeWidgetItemIterator it(m_pUI->treeUpdate, QTreeWidgetItemIterator::Checked | QTreeWidgetItemIterator::Enabled);
-    if(*it)
+    while(*it)
     {
         UpdateNode::Logging() << (*it)->text(0);
-        m_pCurrentItem = (*it);
-        m_pCurrentItem->setSelected(true);
-        UpdateNode::Update update = m_pCurrentItem->data(0, Qt::UserRole).value<UpdateNode::Update>();
-        m_pUI->labelProgress->setText(tr("Downloading update %1 ...").arg(update.getTitle()));
-        m_pDownloader->doDownload(update.getDownloadLink(), update);
+
+        UpdateNode::Update update = (*it)->data(0, Qt::UserRole).value<UpdateNode::Update>();
+        UpdateNode::Config* config = (*it)->data(0, Qt::UserRole+1).value<UpdateNode::Config*>();
+
+        // updates of the same product are never installed at the same time
+        m_mapInstalls[*it] = m_pScheduler->add(update, config ? config->product().getCode() : QString());
+        m_listPipeline.append(*it);
+        ++it;
+    }
+
+    if(m_listPipeline.isEmpty())
+    {
+        finishInstall();
         return;
     }
 
+    fillPipeline();
+    showWaiting();
+}
+
+/*!
+Starts the downloads of the next updates in the pipeline, up to UPDATENODE_PIPELINE_WINDOW updates ahead
+of the installers, which may run now. Prefetched updates need no download.
+*/
+void MultiAppDialog::fillPipeline()
+{
+    int window = qMin(m_listPipeline.size(), UPDATENODE_PIPELINE_WINDOW + qMax(0, m_pScheduler->concurrency() - m_pScheduler->running()));
+
+    for(int i = 0; i < window; i++)
+    {
+        QTreeWidgetItem* item = m_listPipeline.at(i);
+        if(m_listDownloading.contains(item) || m_listDownloaded.contains(item))
+            continue;
+
+        UpdateNode::Update update = item->data(0, Qt::UserRole).value<UpdateNode::Update>();
+
+        // prefetched updates are installed without any network transfer
+        if(UpdateNode::Settings().isUpdateReady(update))
+        {
+            m_listDownloaded.append(item);
+            m_pScheduler->setReady(m_mapInstalls.value(item));
+            continue;
+        }
+
+        if(!m_pDownloads->isBusy())
+        {
+            m_pUI->progressBar->setValue(0);
+            m_pUI->progressBar->show();
+            m_pUI->toolCancel->show();
+        }
+
+        // equal priorities keep the order of the pipeline
+        m_listDownloading.append(item);
+        m_pDownloads->enqueue(update);
+    }
+}
+
+/*!
+Shows which download the pipeline is waiting for, while no installer is running
+*/
+void MultiAppDialog::showWaiting()
+{
+    if(m_pScheduler->running() > 0 || m_listPipeline.isEmpty())
+        return;
+
+    QTreeWidgetItem* item = m_listPipeline.first();
+    m_pUI->treeUpdate->clearSelection();
+    item->setSelected(true);
+
+    m_pUI->labelProgress->setText(tr("Downloading update %1 ...").arg(item->data(0, Qt::UserRole).value<UpdateNode::Update>().getTitle()));
+}
+
+/*!
+Stops the pipeline after a failure. Pending downloads are canceled and waiting updates are not installed anymore,
+running installers are not interrupted. \a aError is shown once no installer is running anymore.
+*/
+void MultiAppDialog::stopPipeline(const QString& aError)
+{
+    m_strErrorString = aError;
+
+    // cleared first, so the canceled downloads are not reported as new failures
+    m_listPipeline.clear();
+    m_listDownloading.clear();
+    m_listDownloaded.clear();
+    m_pScheduler->stop();
+
+    if(m_pDownloads->isBusy())
+        m_pDownloads->cancelAll();
+
+    m_pUI->progressBar->hide();
+    m_pUI->toolCancel->hide();
+
+    if(m_pScheduler->running() == 0)
+    {
+        m_pUI->pshUpdate->show();
+        m_pUI->pshCheck->show();
+        m_pUI->labelProgress->setText(aError);
+    }
+}
+
+/*!
+Shows the result, after the last update of the pipeline has been installed
+*/
+void MultiAppDialog::finishInstall()
+{
     qApp->processEvents();
 
+    m_pUI->treeUpdate->clearSelection();
     m_pUI->toolCancel->hide();
     m_pUI->progressBar->hide();
     m_pUI->pshCheck->show();
@@ -410,86 +559,126 @@ void MultiAppDialog::startInstall()
         m_pUI->labelProgress->setText(tr("All updates have been installed successfully"));
     }
     else
+    {
+        m_pUI->pshUpdate->show();
         m_pUI->labelProgress->setText(m_strErrorString);
+    }
 
     qApp->processEvents();
 }
 
 void MultiAppDialog::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
-    if(m_pUI->progressBar->maximum() <= bytesTotal)
+    if(bytesTotal <= 0)
     {
-        m_pUI->progressBar->setRange(0, bytesTotal);
-        m_pUI->progressBar->setValue(bytesReceived);
+        // size unknown, show a busy indicator
+        m_pUI->progressBar->setRange(0, 0);
+        return;
     }
+
+    // QProgressBar is int based, so the 64 bit values are scaled down. The total is partly estimated
+    // while downloads are waiting, the bar only moves forward
+    m_pUI->progressBar->setRange(0, UPDATENODE_PROGRESS_RANGE);
+    m_pUI->progressBar->setValue(qMax(m_pUI->progressBar->value(), (int)(bytesReceived * UPDATENODE_PROGRESS_RANGE / bytesTotal)));
+
+    QString stats = m_pStats->toString();
+    m_pUI->progressBar->setFormat(stats.isEmpty() ? QString("%p%") : QString("%p%  (%1)").arg(stats));
 }
 
 void MultiAppDialog::downloadDone(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString)
 {
-    m_oReadyUpdates.append(aUpdate);
+    QTreeWidgetItem* item = NULL;
+    for(int i = 0; i < m_listDownloading.size() && !item; i++)
+    {
+        if(m_listDownloading.at(i)->data(0, Qt::UserRole).value<UpdateNode::Update>().getCode() == aUpdate.getCode())
+            item = m_listDownloading.at(i);
+    }
 
-    if(aError != QNetworkReply::NoError)
+    // not part of the pipeline anymore
+    if(!item)
+        return;
+
+    m_listDownloading.removeOne(item);
+
+    if(!m_pDownloads->isBusy())
     {
         m_pUI->progressBar->hide();
         m_pUI->toolCancel->hide();
-        m_pUI->pshUpdate->show();
-        m_pUI->pshCheck->show();
-        m_pUI->labelProgress->setText(aErrorString);
-        return;
     }
 
-    m_pUI->progressBar->hide();
-    m_pUI->toolCancel->hide();
+    if(aError != QNetworkReply::NoError)
+    {
+        stopPipeline(aErrorString);
+        return;
+    }
 
-    if(!m_bIsInstalling)
-        install();
+    m_listDownloaded.append(item);
+    m_pScheduler->setReady(m_mapInstalls.value(item));
 }
 
-void MultiAppDialog::install()
+/*!
+Slot called when UpdateNode::InstallScheduler has started the installer of \a aInstall
+*/
+void MultiAppDialog::installStarted(int aInstall)
 {
-    m_bIsInstalling = true;
-
-    m_oTextEdit.clear();
-
-    m_oCurrentUpdate = m_oReadyUpdates.takeFirst();
+    QTreeWidgetItem* item = m_mapInstalls.key(aInstall);
 
-    m_pUI->labelProgress->setText(tr("Installing update \"%1\"").arg(m_oCurrentUpdate.getTitle()));
+    m_listPipeline.removeOne(item);
+    m_listDownloaded.removeOne(item);
 
-    if(!m_oCommander.run(m_oCurrentUpdate))
+    if(m_pScheduler->running() == 1)
     {
-        m_pCurrentItem->setTextColor(0, QColor("red"));
-
-        QMessageBox::critical(this, m_oCurrentUpdate.getTitle(), tr("Update failed:<br>%1").arg(tr("Unable to execute the command!")));
+        m_oTextEdit.clear();
+        m_pUI->treeUpdate->clearSelection();
+    }
 
-        m_pCurrentItem->setCheckState(0, Qt::Unchecked);
-        m_pCurrentItem->setFlags(Qt::NoItemFlags);
-        m_bIsInstalling = false;
+    item->setSelected(true);
+    m_pUI->labelProgress->setText(tr("Installing update \"%1\"").arg(m_pScheduler->update(aInstall).getTitle()));
 
-        m_pUI->labelProgress->show();
-        m_pUI->labelProgress->setText(tr("Unable to execute the command!"));
-        m_strErrorString = m_pUI->labelProgress->text();
-        m_iError = UPDATENODE_PROCERROR_COMMAND_LAUNCH_FAILED;
-    }
+    fillPipeline();
 }
 
-void MultiAppDialog::processError()
+/*!
+Slot called when UpdateNode::InstallScheduler was not able to start the installer of \a aInstall
+*/
+void MultiAppDialog::installFailed(int aInstall)
 {
-    m_oTextEdit.setTextColor(Qt::red);
-    m_oTextEdit.append(m_oCommander.readStdErr());
-    m_oTextEdit.show();
+    m_pCurrentItem = m_mapInstalls.key(aInstall);
+    m_oCurrentUpdate = m_pCurrentItem->data(0, Qt::UserRole).value<UpdateNode::Update>();
+    m_mapInstalls.remove(m_pCurrentItem);
+
+    m_pCurrentItem->setTextColor(0, QColor("red"));
+
+    QMessageBox::critical(this, m_oCurrentUpdate.getTitle(), tr("Update failed:<br>%1").arg(tr("Unable to execute the command!")));
+
+    m_pCurrentItem->setCheckState(0, Qt::Unchecked);
+    m_pCurrentItem->setFlags(Qt::NoItemFlags);
+
+    m_pUI->labelProgress->show();
+    stopPipeline(tr("Unable to execute the command!"));
+    m_iError = UPDATENODE_PROCERROR_COMMAND_LAUNCH_FAILED;
 }
 
-void MultiAppDialog::processOutput()
+/*!
+Slot called when an installer has written \a aText to stdout, or to stderr if \a aError is true
+*/
+void MultiAppDialog::installOutput(int aInstall, const QString& aText, bool aError)
 {
-    m_oTextEdit.setTextColor(Qt::darkBlue);
-    m_oTextEdit.append(m_oCommander.readStdOut());
+    Q_UNUSED(aInstall);
+
+    m_oTextEdit.setTextColor(aError ? Qt::red : Qt::darkBlue);
+    m_oTextEdit.append(aText);
     m_oTextEdit.show();
 }
 
-void MultiAppDialog::updateExit(int aExitCode, QProcess::ExitStatus aExitStatus)
+void MultiAppDialog::updateExit(int aInstall, int aExitCode, QProcess::ExitStatus aExitStatus)
 {
     UpdateNode::Settings settings;
 
+    m_pCurrentItem = m_mapInstalls.key(aInstall);
+    m_oCurrentUpdate = m_pCurrentItem->data(0, Qt::UserRole).value<UpdateNode::Update>();
+    m_mapInstalls.remove(m_pCurrentItem);
+
     if(aExitStatus == QProcess::NormalExit)
     {
         if(aExitCode == 0)
@@ -512,8 +701,6 @@ void MultiAppDialog::updateExit(int aExitCode, QProcess::ExitStatus aExitStatus)
         }
         else
         {
-            m_pUI->pshUpdate->show();
-            m_pUI->pshCheck->show();
             m_pUI->labelProgress->setText(tr("Update '%1' failed with error %2").arg(m_oCurrentUpdate.getTitle()).arg(aExitCode));
 
             UpdateNode::Logging() << m_oCurrentUpdate.getTitle() << "update failed - ErrorCode " << aExitCode;
@@ -526,19 +713,23 @@ void MultiAppDialog::updateExit(int aExitCode, QProcess::ExitStatus aExitStatus)
         m_pCurrentItem->setTextColor(0, QColor("red"));
     }
 
-    settings.setUpdate(m_oCurrentUpdate, UpdateNode::LocalFile::getDownloadLocation(m_oCurrentUpdate.getDownloadLink()), aExitCode);
+    settings.setUpdate(m_oCurrentUpdate, UpdateNode::LocalFile::getUpdateLocation(m_oCurrentUpdate), aExitCode);
 
     m_pCurrentItem->setCheckState(0, Qt::Unchecked);
     m_pCurrentItem->setFlags(Qt::NoItemFlags);
-    m_bIsInstalling = false;
 
     adjustSize();
 
     if(aExitCode==0)
-        startInstall();
+    {
+        if(m_listPipeline.isEmpty() && !m_pScheduler->isBusy())
+            finishInstall();
+        else
+            showWaiting();
+    }
     else
     {
-        m_strErrorString = m_pUI->labelProgress->text();
+        stopPipeline(m_pUI->labelProgress->text());
         m_iError = UPDATENODE_PROCERROR_UPDATE_EXEC_FAILED;
         return;
     }
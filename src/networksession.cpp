@@ -0,0 +1,329 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QSettings>
+#include <QSslConfiguration>
+#include <QStringList>
+
+#include "networksession.h"
+#include "settings.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::NetworkSession
+\brief Process wide network transport, shared by all classes talking to the network
+\n\n
+All requests of Service, Downloader, SegmentedDownload and the message view run through a single
+QNetworkAccessManager, so keep-alive connections and TLS sessions are reused between them.
+\n TLS session tickets are stored in the settings when the application quits, which allows the next
+run to resume the sessions instead of doing full handshakes.
+\n The API host and the download hosts can be resolved and connected with NetworkSession::warmUp while
+the application is still starting up.
+*/
+
+/*!
+Global instance of the NetworkSession pointer
+*/
+NetworkSession* NetworkSession::m_pInstance = NULL;
+
+/*!
+Retrieves the global NetworkSession class instance as an pointer. If no instance is present,
+a new one will be created in this method
+*/
+NetworkSession* NetworkSession::Instance()
+{
+    if(!m_pInstance)
+        m_pInstance = new NetworkSession;
+
+    return m_pInstance;
+}
+
+/*!
+Constructs a NetworkSession and loads the TLS sessions stored by the last run. The time to the first
+request is measured from here, so the instance should be created early
+*/
+NetworkSession::NetworkSession()
+    : QObject(0)
+{
+    m_oStartup.start();
+    m_bFirstRequest = true;
+    m_iHandshakes = 0;
+    m_iRequests = 0;
+
+    connect(&m_oManager, SIGNAL(finished(QNetworkReply*)), SLOT(finished(QNetworkReply*)));
+    connect(&m_oManager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)), SLOT(sslErrors(QNetworkReply*,QList<QSslError>)));
+#if QT_VERSION >= 0x050100
+    connect(&m_oManager, SIGNAL(encrypted(QNetworkReply*)), SLOT(encrypted(QNetworkReply*)));
+#endif
+
+    if(QCoreApplication::instance())
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), SLOT(save()));
+
+    load();
+}
+
+/*!
+Returns the shared QNetworkAccessManager, e.g. to be set on a web view
+\note Requests sent directly through the manager may be answered from a cache set on it
+\sa NetworkSession::get
+*/
+QNetworkAccessManager* NetworkSession::manager()
+{
+    return &m_oManager;
+}
+
+/*!
+Sends a GET request for \a aRequest, bypassing any cache and offering the stored TLS session of the host
+*/
+QNetworkReply* NetworkSession::get(QNetworkRequest aRequest)
+{
+    firstRequest();
+    prepare(aRequest);
+
+    return m_oManager.get(aRequest);
+}
+
+/*!
+Sends a HEAD request for \a aRequest
+\sa NetworkSession::get
+*/
+QNetworkReply* NetworkSession::head(QNetworkRequest aRequest)
+{
+    firstRequest();
+    prepare(aRequest);
+
+    return m_oManager.head(aRequest);
+}
+
+/*!
+Resolves the host of \a aUrl and opens a connection to it (including the TLS handshake for HTTPS) in the
+background, so the first request to the host does not have to wait for it. Each host is only warmed up once.
+\n Before Qt 5.2, only the host name is resolved
+*/
+void NetworkSession::warmUp(const QUrl& aUrl)
+{
+    if(aUrl.host().isEmpty() || (aUrl.scheme() != "https" && aUrl.scheme() != "http"))
+        return;
+
+    QString key = aUrl.scheme() + "://" + sessionKey(aUrl);
+    if(m_listWarmedUp.contains(key))
+        return;
+
+    m_listWarmedUp.append(key);
+    UpdateNode::Logging() << "Warming up " << aUrl.host() << " after " << (int)m_oStartup.elapsed() << "ms";
+
+#ifdef UPDATENODE_CONNECT_TO_HOST_SUPPORTED
+    if(aUrl.scheme() == "https")
+    {
+#ifndef QT_NO_SSL
+        QNetworkRequest request(aUrl);
+        prepare(request);
+        m_oManager.connectToHostEncrypted(aUrl.host(), aUrl.port(443), request.sslConfiguration());
+#endif
+    }
+    else
+        m_oManager.connectToHost(aUrl.host(), aUrl.port(80));
+#else
+    QHostInfo::lookupHost(aUrl.host(), this, SLOT(hostFound(QHostInfo)));
+#endif
+}
+
+/*!
+Slot called when a host name resolved by NetworkSession::warmUp has been looked up
+*/
+void NetworkSession::hostFound(const QHostInfo& aHostInfo)
+{
+    if(aHostInfo.error() != QHostInfo::NoError)
+        UpdateNode::Logging() << "Could not resolve " << aHostInfo.hostName() << ": " << aHostInfo.errorString();
+}
+
+/*!
+Logs the time from the start of the session to its first request
+*/
+void NetworkSession::firstRequest()
+{
+    if(!m_bFirstRequest)
+        return;
+
+    m_bFirstRequest = false;
+    UpdateNode::Logging() << "Time to first request: " << (int)m_oStartup.elapsed() << "ms";
+}
+
+/*!
+Returns the number of full TLS handshakes done in this run
+*/
+int NetworkSession::handshakes() const
+{
+    return m_iHandshakes;
+}
+
+/*!
+Returns the number of finished HTTPS requests in this run. Requests without a handshake of their own
+were sent over a reused connection
+*/
+int NetworkSession::requests() const
+{
+    return m_iRequests;
+}
+
+/*!
+Update checks and downloads always need the current data, and must not fill the disk cache of
+the message view. The stored TLS session of the host is offered for new connections
+*/
+void NetworkSession::prepare(QNetworkRequest& aRequest)
+{
+    aRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    aRequest.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+
+#ifdef UPDATENODE_TLS_SESSION_SUPPORTED
+    if(aRequest.url().scheme() != "https")
+        return;
+
+    QSslConfiguration configuration = aRequest.sslConfiguration();
+    configuration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    QString key = sessionKey(aRequest.url());
+    if(m_mapTickets.contains(key))
+        configuration.setSessionTicket(m_mapTickets.value(key));
+
+    aRequest.setSslConfiguration(configuration);
+#endif
+}
+
+/*!
+Slot called for each new encrypted connection, i.e. for each full or resumed TLS handshake
+*/
+void NetworkSession::encrypted(QNetworkReply* reply)
+{
+    m_iHandshakes++;
+
+#ifdef DEBUG
+    UpdateNode::Logging() << "TLS handshake #" << m_iHandshakes << " with " << reply->url().host();
+#else
+    Q_UNUSED(reply);
+#endif
+}
+
+/*!
+Slot called for each finished request. Keeps the latest TLS session of the host, with TLS 1.3 it
+is only known after the handshake
+*/
+void NetworkSession::finished(QNetworkReply* reply)
+{
+    if(reply->url().scheme() != "https")
+        return;
+
+    m_iRequests++;
+
+#ifdef UPDATENODE_TLS_SESSION_SUPPORTED
+    QSslConfiguration configuration = reply->sslConfiguration();
+    QString key = sessionKey(reply->url());
+
+    if(!configuration.sessionTicket().isEmpty())
+    {
+        m_mapTickets[key] = configuration.sessionTicket();
+        m_mapTicketExpiry[key] = QDateTime::currentDateTime().addSecs(qMax(0, configuration.sessionTicketLifeTimeHint()));
+    }
+#endif
+}
+
+/*!
+Slot called on SSL errors
+*/
+void NetworkSession::sslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
+{
+    QSslError error(QSslError::NoError);
+
+    foreach(QSslError error, errors)
+        if(error.error() != QSslError::NoError)
+            UpdateNode::Logging() << error.errorString();
+
+    QList<QSslError> expectedSslErrors;
+    expectedSslErrors.append(error);
+    reply->ignoreSslErrors(expectedSslErrors);
+}
+
+/*!
+Stores the TLS sessions for the next run and logs the number of handshakes
+*/
+void NetworkSession::save()
+{
+    UpdateNode::Logging() << "Network: " << m_iHandshakes << " TLS handshake(s) for " << m_iRequests << " HTTPS request(s), "
+                          << qMax(0, m_iRequests - m_iHandshakes) << " on reused connections";
+
+#ifdef UPDATENODE_TLS_SESSION_SUPPORTED
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+    QDateTime now = QDateTime::currentDateTime();
+
+    settings.remove("TlsSessions");
+    settings.beginGroup("TlsSessions");
+
+    foreach(QString key, m_mapTickets.keys())
+    {
+        if(m_mapTicketExpiry.value(key) <= now)
+            continue;
+
+        settings.setValue(key + "/Ticket", m_mapTickets.value(key).toBase64());
+        settings.setValue(key + "/Expires", m_mapTicketExpiry.value(key));
+    }
+
+    settings.endGroup();
+#endif
+}
+
+/*!
+Loads the TLS sessions stored by NetworkSession::save, skipping expired ones
+*/
+void NetworkSession::load()
+{
+#ifdef UPDATENODE_TLS_SESSION_SUPPORTED
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+    QDateTime now = QDateTime::currentDateTime();
+
+    settings.beginGroup("TlsSessions");
+
+    foreach(QString key, settings.childGroups())
+    {
+        QDateTime expires = settings.value(key + "/Expires").toDateTime();
+        QByteArray ticket = QByteArray::fromBase64(settings.value(key + "/Ticket").toByteArray());
+
+        if(expires > now && !ticket.isEmpty())
+        {
+            m_mapTickets[key] = ticket;
+            m_mapTicketExpiry[key] = expires;
+        }
+    }
+
+    settings.endGroup();
+#endif
+}
+
+/*!
+Returns the key the TLS session of the host of \a url is stored under
+*/
+QString NetworkSession::sessionKey(const QUrl& url)
+{
+    return url.host() + "_" + QString::number(url.port(443));
+}
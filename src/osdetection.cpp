@@ -24,14 +24,16 @@
 #include <QSysInfo>
 #include <QFile>
 #include <QTextStream>
-#include <QProcess>
 #include <QStringList>
 #include <QProcessEnvironment>
 #include <QSettings>
 #include <stdlib.h>
+#include "settings.h"
 #ifdef Q_OS_WIN
 #include <Windows.h>
 #include <lm.h>
+#else
+#include <sys/utsname.h>
 #endif
 
 using namespace UpdateNode;
@@ -39,8 +41,14 @@ using namespace UpdateNode;
 /*!
 \class UpdateNode::OSDetection
 \brief OSDetection returns the informationa about the used OS
+\n\n
+The OS and architecture are detected once per run. On Linux, they are additionally stored \n
+together with the boot id, so the next runs until a reboot don't need to detect them again.
 */
 
+QString OSDetection::m_strOS;
+QString OSDetection::m_strArch;
+
 /*!
 Returns the used Windows version, like "Windows 6.2", or "Unknown Windows" when the version \n
 information cannot be accessed
@@ -100,7 +108,7 @@ QString OSDetection::getMacVersion()
 }
 
 /*!
-Returns the used Linux version, first tries to get lsb-release, os-release and last "uname -r". \n
+Returns the used Linux version, first tries to get lsb-release, os-release and last the kernel release. \n
 Additionally, env variable DESKTOP_SESSION is taken. If there is no information available about \n
 the current version "Linux (unknown)" is returned.
 */
@@ -130,15 +138,10 @@ QString OSDetection::getLinuxVersion()
         }
     }
 
-    QStringList fullKernelVersion;
-    QProcess proc;
-    proc.start("uname -r");
+    QStringList fullKernelVersion = getKernelRelease().split(".");
 
-    proc.waitForFinished(-1);
-
-    if(proc.exitCode()==0)
+    if(fullKernelVersion.size() >= 2)
     {
-        fullKernelVersion = QString(proc.readAll()).split(".");
         QString kernelVersion = fullKernelVersion.at(0) + "." + fullKernelVersion.at(1);
         return  QString("Linux ") + kernelVersion + " (" + QString( QProcessEnvironment::systemEnvironment().value("DESKTOP_SESSION", "unknown")) + ")";
     }
@@ -146,7 +149,6 @@ QString OSDetection::getLinuxVersion()
         return  QString("Linux (" + QString( QProcessEnvironment::systemEnvironment().value("DESKTOP_SESSION", "unknown")) + ")");
 }
 
-
 /*!
 Returns "Unsupported OS"
 */
@@ -156,7 +158,7 @@ QString OSDetection::getOthersVersion()
 }
 
 /*!
-Returns the OS name based on the used system, calling the following methods:
+Returns the OS name based on the used system, calling the following methods once per run:
 \sa UpdateNode::OSDetection::getLinuxVersion
 \sa UpdateNode::OSDetection::getWindowsVersion
 \sa UpdateNode::OSDetection::getMacVersion
@@ -164,50 +166,122 @@ Returns the OS name based on the used system, calling the following methods:
 */
 QString OSDetection::getOS()
 {
+    if(m_strOS.isEmpty())
+        detect();
+
+    return m_strOS;
+}
+
+/*!
+Returns the processor architecture of the used OS \n
+Default value for Windows is x86, for Mac nad Linux its "unknown"
+*/
+QString OSDetection::getArch()
+{
+    if(m_strArch.isEmpty())
+        detect();
+
+    return m_strArch;
+}
+
+/*!
+Detects OS and architecture, or takes them from the settings if they have been stored \n
+since the last boot
+\sa UpdateNode::OSDetection::getBootId
+*/
+void OSDetection::detect()
+{
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+    QString bootId = getBootId();
+
+    // the Linux version contains the desktop session, which may differ between runs
+    if(!bootId.isEmpty())
+        bootId += "/" + QProcessEnvironment::systemEnvironment().value("DESKTOP_SESSION", "unknown");
+
+    if(!bootId.isEmpty() && settings.value("System/BootId").toString() == bootId)
+    {
+        m_strOS = settings.value("System/OS").toString();
+        m_strArch = settings.value("System/Arch").toString();
+
+        if(!m_strOS.isEmpty() && !m_strArch.isEmpty())
+            return;
+    }
+
 #ifdef Q_OS_LINUX
-    return UpdateNode::OSDetection::getLinuxVersion();
+    m_strOS = UpdateNode::OSDetection::getLinuxVersion();
 #else
 #ifdef Q_OS_WIN
-    return UpdateNode::OSDetection::getWindowsVersion();
+    m_strOS = UpdateNode::OSDetection::getWindowsVersion();
 #else
 #ifdef Q_OS_MACX
-    return UpdateNode::OSDetection::getMacVersion();
+    m_strOS = UpdateNode::OSDetection::getMacVersion();
 #else
-    return UpdateNode::OSDetection::getOthersVersion();
+    m_strOS = UpdateNode::OSDetection::getOthersVersion();
 #endif
 #endif
 #endif
+    m_strArch = detectArch();
+
+    if(!bootId.isEmpty())
+    {
+        settings.setValue("System/BootId", bootId);
+        settings.setValue("System/OS", m_strOS);
+        settings.setValue("System/Arch", m_strArch);
+    }
 }
 
 /*!
-Returns the processor architecture of the used OS \n
-Default value for Windows is x86, for Mac nad Linux its "unknown"
+Returns the processor architecture, without caching
+\sa UpdateNode::OSDetection::getArch
 */
-QString OSDetection::getArch()
+QString OSDetection::detectArch()
 {
 #ifdef Q_OS_WIN
     return QProcessEnvironment::systemEnvironment().value("PROCESSOR_ARCHITECTURE", "x86");
 #else
-#ifdef Q_OS_LINUX
-    QProcess proc;
-    proc.start("uname -m");
-
-    proc.waitForFinished(-1);
+    struct utsname name;
 
-    if(proc.exitCode()==0)
-        return QString(proc.readAll());
-    else
+    if(::uname(&name) != 0)
         return "unknown";
+
+    QString machine = QString::fromLatin1(name.machine).trimmed();
+#ifdef Q_OS_MACX
+    // same values as "uname -p"
+    if(machine == "x86_64" || machine == "i386")
+        return "i386";
+    else if(machine.startsWith("arm"))
+        return "arm";
+#endif
+    return machine.isEmpty() ? QString("unknown") : machine;
+#endif
+}
+
+/*!
+Returns the release of the running kernel, like "uname -r", or an empty string on Windows
+*/
+QString OSDetection::getKernelRelease()
+{
+#ifdef Q_OS_WIN
+    return QString();
 #else
-    QProcess proc;
-    proc.start("uname -p");
+    struct utsname name;
 
-    proc.waitForFinished(-1);
+    if(::uname(&name) != 0)
+        return QString();
 
-    if(proc.exitCode()==0)
-        return QString(proc.readAll());
-    else
-        return "unknown";
+    return QString::fromLatin1(name.release).trimmed();
 #endif
+}
+
+/*!
+Returns an id changing with every boot, or an empty string if the system provides none
+*/
+QString OSDetection::getBootId()
+{
+#ifdef Q_OS_LINUX
+    QFile bootId("/proc/sys/kernel/random/boot_id");
+    if(bootId.open(QIODevice::ReadOnly))
+        return QString::fromLatin1(bootId.readAll()).trimmed();
 #endif
+    return QString();
 }
@@ -0,0 +1,343 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QDir>
+#include <QFileInfo>
+
+#include "partfile.h"
+#include "logging.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <stdio.h>
+#endif
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::PartFile
+\brief Writes a download into "<file>.part" and moves it to its final location once complete
+\n\n
+Data is written straight to disk as it arrives, so a download never needs to be kept in memory.
+The final file is only replaced by PartFile::commit, after all data has been synced to disk.
+Until then, a previous version of the file stays untouched.
+\n The SHA-256 checksum is computed on the fly while the data is written, so the file
+never needs to be read again for verification.
+*/
+
+/*!
+Constructs a PartFile object for the final file name \a aFileName
+*/
+PartFile::PartFile(const QString& aFileName)
+    : m_strFileName(aFileName)
+{
+    m_iSize = 0;
+    m_iSynced = 0;
+    m_pHash = createHash();
+    m_oFile.setFileName(partFileName());
+}
+
+/*!
+Destructs the PartFile object. An uncommitted part file is closed, but kept on disk.
+*/
+PartFile::~PartFile()
+{
+    if(m_oFile.isOpen())
+        m_oFile.close();
+
+    delete m_pHash;
+}
+
+/*!
+Opens (and truncates) the part file for writing.
+\n Returns false if the file cannot be opened
+*/
+bool PartFile::open()
+{
+    if(m_oFile.isOpen())
+        m_oFile.close();
+
+    m_iSize = 0;
+    m_iSynced = 0;
+
+    if(m_pHash)
+        m_pHash->reset();
+
+    if(!m_oFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_strError = m_oFile.errorString();
+        UpdateNode::Logging() << "Could not open " << partFileName() << " for writing: " << m_strError;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+Opens an existing part file and continues writing at \a aOffset. Everything behind
+\a aOffset is cut off, so the file may be resumed from the last PartFile::checkpoint
+even if more data has been written before.
+\n The data already on disk is read once to continue the checksum.
+\n Returns false if the file cannot be opened, or is shorter than \a aOffset
+*/
+bool PartFile::resume(qint64 aOffset)
+{
+    if(m_oFile.isOpen())
+        m_oFile.close();
+
+    if(!m_oFile.open(QIODevice::ReadWrite))
+    {
+        m_strError = m_oFile.errorString();
+        UpdateNode::Logging() << "Could not open " << partFileName() << " for resuming: " << m_strError;
+        return false;
+    }
+
+    if(m_oFile.size() < aOffset || !m_oFile.resize(aOffset) || !m_oFile.seek(aOffset))
+    {
+        m_strError = QString("Could not resume %1 at %2").arg(partFileName()).arg(aOffset);
+        m_oFile.close();
+        return false;
+    }
+
+    if(m_pHash)
+    {
+        m_pHash->reset();
+        m_oFile.seek(0);
+        while(m_oFile.pos() < aOffset)
+        {
+            QByteArray data = m_oFile.read(qMin(aOffset - m_oFile.pos(), (qint64)(256 * 1024)));
+            if(data.isEmpty())
+            {
+                m_strError = m_oFile.errorString();
+                m_oFile.close();
+                return false;
+            }
+            m_pHash->addData(data);
+        }
+    }
+
+    m_iSize = aOffset;
+    m_iSynced = aOffset;
+
+    return true;
+}
+
+/*!
+Appends \a aData to the part file
+\n Returns false if not all data could be written
+*/
+bool PartFile::write(const QByteArray& aData)
+{
+    if(aData.isEmpty())
+        return true;
+
+    if(m_oFile.write(aData) != aData.size())
+    {
+        m_strError = m_oFile.errorString();
+        UpdateNode::Logging() << "Could not write to " << partFileName() << ": " << m_strError;
+        return false;
+    }
+
+    m_iSize += aData.size();
+
+    if(m_pHash)
+        m_pHash->addData(aData);
+
+    return true;
+}
+
+/*!
+Syncs all data written so far to disk. After a crash, the part file can be resumed at
+PartFile::syncedSize
+*/
+bool PartFile::checkpoint()
+{
+    if(!m_oFile.isOpen() || !sync(m_oFile))
+        return false;
+
+    m_iSynced = m_iSize;
+
+    return true;
+}
+
+/*!
+Flushes and syncs the part file and renames it atomically to PartFile::fileName
+\n Returns true on success, otherwise false. On failure the part file is removed
+*/
+bool PartFile::commit()
+{
+    if(!m_oFile.isOpen())
+    {
+        m_strError = "File is not open";
+        return false;
+    }
+
+    bool synced = sync(m_oFile);
+    m_oFile.close();
+
+    if(!m_strExpectedHash.isEmpty())
+    {
+        if(!m_pHash)
+            UpdateNode::Logging() << "SHA-256 is not supported, " << fileName() << " cannot be verified";
+        else if(hash() != m_strExpectedHash)
+        {
+            m_strError = QString("Checksum mismatch for %1: expected %2, got %3").arg(fileName()).arg(m_strExpectedHash).arg(hash());
+            UpdateNode::Logging() << m_strError;
+            discard();
+            return false;
+        }
+    }
+
+    if(!synced || !replace(partFileName(), fileName()))
+    {
+        m_strError = QString("Could not move %1 to %2").arg(partFileName()).arg(fileName());
+        UpdateNode::Logging() << m_strError;
+        discard();
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+Closes and removes the part file
+*/
+void PartFile::discard()
+{
+    if(m_oFile.isOpen())
+        m_oFile.close();
+
+    m_oFile.remove();
+    m_iSize = 0;
+    m_iSynced = 0;
+
+    if(m_pHash)
+        m_pHash->reset();
+}
+
+/*!
+Sets the SHA-256 checksum \a aHash (hex) the complete file must have. PartFile::commit
+fails if the checksum of the written data differs
+*/
+void PartFile::setExpectedHash(const QString& aHash)
+{
+    m_strExpectedHash = aHash.toLower();
+}
+
+/*!
+Returns the SHA-256 checksum (hex) of the data written so far, or an empty string
+if SHA-256 is not supported
+*/
+QString PartFile::hash() const
+{
+    if(!m_pHash)
+        return QString();
+
+    return QString::fromLatin1(m_pHash->result().toHex());
+}
+
+/*!
+Returns the final file name
+*/
+QString PartFile::fileName() const
+{
+    return m_strFileName;
+}
+
+/*!
+Returns the name of the file the data is written to until PartFile::commit is called
+*/
+QString PartFile::partFileName() const
+{
+    return m_strFileName + UPDATENODE_PART_SUFFIX;
+}
+
+/*!
+Returns the number of bytes in the part file, including resumed data
+*/
+qint64 PartFile::size() const
+{
+    return m_iSize;
+}
+
+/*!
+Returns the number of bytes which are known to be on disk
+\sa PartFile::checkpoint
+*/
+qint64 PartFile::syncedSize() const
+{
+    return m_iSynced;
+}
+
+/*!
+Returns a human readable description of the last error
+*/
+QString PartFile::errorString() const
+{
+    return m_strError;
+}
+
+/*!
+Flushes Qt's buffer and forces the operating system to write \a aFile to disk
+*/
+bool PartFile::sync(QFile& aFile)
+{
+    if(!aFile.flush())
+        return false;
+
+#ifdef Q_OS_WIN
+    return _commit(aFile.handle()) == 0;
+#else
+    return ::fsync(aFile.handle()) == 0;
+#endif
+}
+
+/*!
+Renames \a aFrom to \a aTo, replacing \a aTo if it exists. On Windows and Unix, the
+replacement is atomic: \a aTo is either the old, or the new file, but never missing or truncated.
+*/
+bool PartFile::replace(const QString& aFrom, const QString& aTo)
+{
+#ifdef Q_OS_WIN
+    return MoveFileExW((const wchar_t*)QDir::toNativeSeparators(aFrom).utf16(),
+                       (const wchar_t*)QDir::toNativeSeparators(aTo).utf16(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return ::rename(QFile::encodeName(aFrom).constData(), QFile::encodeName(aTo).constData()) == 0;
+#endif
+}
+
+/*!
+Creates a SHA-256 hash object, or returns NULL if SHA-256 is not supported
+\sa UPDATENODE_FILE_HASH_SUPPORTED
+*/
+QCryptographicHash* PartFile::createHash()
+{
+#ifdef UPDATENODE_FILE_HASH_SUPPORTED
+    return new QCryptographicHash(QCryptographicHash::Sha256);
+#else
+    return NULL;
+#endif
+}
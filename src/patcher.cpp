@@ -0,0 +1,175 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QFile>
+#include <QDataStream>
+
+#include "patcher.h"
+#include "partfile.h"
+#include "downloader.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::Patcher
+\brief Rebuilds an update file from a previous version and a binary patch
+\n\n
+A patch is a sequence of operations on the base file, all numbers are big endian:
+\n "UNPATCH1" <quint64 target size>
+\n 'C' <quint64 offset> <quint64 length> - copies length bytes at offset of the base file
+\n 'I' <quint64 length> <data> - inserts the following length bytes of the patch
+\n 'E' - end of the patch
+\n\n
+Base and patch are read sequentially in chunks, the result is written through a PartFile, so
+neither file needs to fit into memory and the result is verified before it replaces anything.
+*/
+
+/*!
+Constructs a Patcher object
+*/
+Patcher::Patcher()
+{
+}
+
+/*!
+Applies the patch \a aPatch on \a aBase and writes the result to \a aTarget. The result must
+have the SHA-256 checksum \a aExpectedHash.
+\n Returns true on success, otherwise false. On failure, \a aTarget is not modified
+*/
+bool Patcher::apply(const QString& aBase, const QString& aPatch, const QString& aTarget, const QString& aExpectedHash)
+{
+    QFile base(aBase);
+    QFile patch(aPatch);
+    UpdateNode::PartFile target(aTarget);
+
+    m_strHash.clear();
+    m_strError.clear();
+
+    if(!base.open(QIODevice::ReadOnly) || !patch.open(QIODevice::ReadOnly))
+    {
+        m_strError = QString("Could not open %1 or %2").arg(aBase).arg(aPatch);
+        return false;
+    }
+
+    target.setExpectedHash(aExpectedHash);
+    if(!target.open())
+    {
+        m_strError = target.errorString();
+        return false;
+    }
+
+    QDataStream stream(&patch);
+    stream.setByteOrder(QDataStream::BigEndian);
+
+    QByteArray magic(qstrlen(UPDATENODE_PATCH_MAGIC), 0);
+    quint64 size = 0;
+
+    if(stream.readRawData(magic.data(), magic.size()) != magic.size() || magic != UPDATENODE_PATCH_MAGIC)
+        m_strError = "Unknown patch format";
+    else
+        stream >> size;
+
+    while(m_strError.isEmpty())
+    {
+        quint8 operation = 0;
+        quint64 offset = 0;
+        quint64 length = 0;
+
+        stream >> operation;
+
+        if(operation == UPDATENODE_PATCH_END)
+            break;
+        else if(operation == UPDATENODE_PATCH_COPY)
+        {
+            stream >> offset >> length;
+
+            if(stream.status() != QDataStream::Ok || length > (quint64)base.size() || offset > (quint64)base.size() - length || !base.seek(offset))
+            {
+                m_strError = "Patch does not fit to the base file";
+                break;
+            }
+
+            while(length > 0 && m_strError.isEmpty())
+            {
+                QByteArray data = base.read(qMin(length, (quint64)UPDATENODE_DOWNLOAD_BUFFER_SIZE));
+                if(data.isEmpty() || !target.write(data))
+                    m_strError = "Could not copy from the base file";
+                length -= data.size();
+            }
+        }
+        else if(operation == UPDATENODE_PATCH_INSERT)
+        {
+            stream >> length;
+
+            QByteArray data;
+            while(length > 0 && m_strError.isEmpty())
+            {
+                data.resize((int)qMin(length, (quint64)UPDATENODE_DOWNLOAD_BUFFER_SIZE));
+                if(stream.readRawData(data.data(), data.size()) != data.size() || !target.write(data))
+                    m_strError = "Patch is truncated";
+                length -= data.size();
+            }
+        }
+        else
+            m_strError = "Patch is corrupt";
+
+        if(stream.status() != QDataStream::Ok && m_strError.isEmpty())
+            m_strError = "Patch is truncated";
+    }
+
+    if(m_strError.isEmpty() && (quint64)target.size() != size)
+        m_strError = QString("Patched file has %1 bytes instead of %2").arg(target.size()).arg(size);
+
+    if(!m_strError.isEmpty())
+    {
+        UpdateNode::Logging() << "Could not apply " << aPatch << ": " << m_strError;
+        target.discard();
+        return false;
+    }
+
+    if(!target.commit())
+    {
+        m_strError = target.errorString();
+        return false;
+    }
+
+    m_strHash = target.hash();
+
+    return true;
+}
+
+/*!
+Returns the SHA-256 checksum (hex) of the last patched file
+*/
+QString Patcher::hash() const
+{
+    return m_strHash;
+}
+
+/*!
+Returns a human readable description of the last error
+*/
+QString Patcher::errorString() const
+{
+    return m_strError;
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QTimer>
+
+#include "prefetcher.h"
+#include "throttle.h"
+#include "settings.h"
+#include "config.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::Prefetcher
+\brief Downloads pending updates ahead of time, so a later -update or -manager run installs them right away
+\n\n
+Used by the -prefetch mode. The updates are downloaded in background mode (see UpdateNode::Throttle) and
+verified against their checksum like any other download. Each verified update is marked as ready by
+Settings::setUpdateReady, the dialogs then pass it to UpdateNode::Commander without downloading it again.
+*/
+
+/*!
+Constructs an idle Prefetcher
+*/
+Prefetcher::Prefetcher(QObject* parent /* = 0 */)
+    : QObject(parent)
+{
+    m_iReady = 0;
+    m_iFailed = 0;
+
+    m_pDownloads = new UpdateNode::DownloadQueue(this);
+
+    connect(m_pDownloads, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)),
+            SLOT(downloadDone(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)));
+    connect(m_pDownloads, SIGNAL(allDone()), SIGNAL(finished()));
+}
+
+/*!
+Downloads all \a aUpdates which are not ready yet, mandatory updates first. Emits finished() once all have ended
+*/
+void Prefetcher::start(const QList<UpdateNode::Update>& aUpdates)
+{
+    UpdateNode::Settings settings;
+    UpdateNode::Throttle::Instance()->setBackground(true);
+
+    foreach(UpdateNode::Update update, aUpdates)
+    {
+        if(settings.isUpdateReady(update))
+            m_iReady++;
+        else if(!update.getDownloadLink().isEmpty())
+            m_pDownloads->enqueue(update, update.isMandatory() ? 1 : 0);
+    }
+
+    if(!m_pDownloads->isBusy())
+        QTimer::singleShot(0, this, SIGNAL(finished()));
+}
+
+/*!
+Returns the number of updates which are ready to be installed
+*/
+int Prefetcher::ready() const
+{
+    return m_iReady;
+}
+
+/*!
+Returns the number of updates which could not be prefetched
+*/
+int Prefetcher::failed() const
+{
+    return m_iFailed;
+}
+
+/*!
+Returns all updates of the checked products which are not ignored
+*/
+QList<UpdateNode::Update> Prefetcher::pending()
+{
+    UpdateNode::Config* config = UpdateNode::Config::Instance();
+    UpdateNode::Settings settings;
+    QList<UpdateNode::Config*> configurations;
+    QList<UpdateNode::Update> updates;
+
+    if(config->isSingleMode())
+        configurations.append(config);
+    else
+        configurations = config->configurations();
+
+    foreach(UpdateNode::Config* configuration, configurations)
+        foreach(UpdateNode::Update update, configuration->updates())
+            if(update.isMandatory() || !settings.isUpdateIgnored(update.getCode()))
+                updates.append(update);
+
+    return updates;
+}
+
+/*!
+Slot called when the download of \a aUpdate has ended, marks it as ready on success
+*/
+void Prefetcher::downloadDone(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString)
+{
+    if(aError != QNetworkReply::NoError)
+    {
+        UpdateNode::Logging() << "Prefetching " << aUpdate.getCode() << " failed: " << aErrorString;
+        m_iFailed++;
+        return;
+    }
+
+    UpdateNode::Logging() << "Update " << aUpdate.getCode() << " is ready to install";
+    UpdateNode::Settings().setUpdateReady(aUpdate.getCode(), true);
+    m_iReady++;
+}
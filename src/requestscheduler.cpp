@@ -0,0 +1,254 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QSettings>
+#include <QStringList>
+#include <QtAlgorithms>
+
+#include "requestscheduler.h"
+#include "scheduledreply.h"
+#include "throttle.h"
+#include "settings.h"
+#include "config.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::RequestScheduler
+\brief Sends requests with per phase deadlines, retries and hedged requests
+\n\n
+Each request is split into phases (connect, first byte, body), each with a budget of its own. A request
+which runs out of its budget before the response has started, or which is answered with a server error
+or 429 (Too Many Requests), is retried with an exponential backoff,
+so a single stalled connection does not cost the whole run. If an alternate host is set, a hedged
+request is sent to it once the first request takes longer than most requests before.
+\n The overall timeout (-to) of UpdateNode::LimitTimer stays the outer bound.
+\sa UpdateNode::ScheduledReply
+*/
+
+/*!
+Global instance of the RequestScheduler pointer
+*/
+RequestScheduler* RequestScheduler::m_pInstance = NULL;
+
+/*!
+Retrieves the global RequestScheduler class instance as an pointer. If no instance is present,
+a new one will be created in this method
+*/
+RequestScheduler* RequestScheduler::Instance()
+{
+    if(!m_pInstance)
+        m_pInstance = new RequestScheduler;
+
+    return m_pInstance;
+}
+
+/*!
+Constructs a RequestScheduler with the default budgets and loads the latencies recorded by the last runs
+*/
+RequestScheduler::RequestScheduler()
+    : QObject(0)
+{
+    m_iConnect = UPDATENODE_CONNECT_BUDGET;
+    m_iFirstByte = UPDATENODE_TTFB_BUDGET;
+    m_iBody = UPDATENODE_BODY_BUDGET;
+    m_iRetries = UPDATENODE_RETRIES;
+    m_iBackoff = UPDATENODE_BACKOFF;
+    m_iHedgeDelay = UPDATENODE_HEDGE_DELAY;
+
+    if(!UpdateNode::Config::Instance()->getAlternateHost().isEmpty())
+        m_oAlternateHost = QUrl::fromUserInput(UpdateNode::Config::Instance()->getAlternateHost());
+
+    qsrand(QDateTime::currentDateTime().toTime_t() ^ (uint)QCoreApplication::applicationPid());
+
+    if(QCoreApplication::instance())
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), SLOT(save()));
+
+    load();
+}
+
+/*!
+Sends a GET request for \a aRequest. The returned reply behaves like a reply of QNetworkAccessManager,
+but may be served by a retried or hedged request
+*/
+QNetworkReply* RequestScheduler::get(const QNetworkRequest& aRequest)
+{
+    QNetworkReply* reply = new UpdateNode::ScheduledReply(aRequest);
+
+    // requests to the service are never throttled, background downloads give way to them instead
+    UpdateNode::Throttle::Instance()->addForeground(reply);
+
+    return reply;
+}
+
+/*!
+Sets the budgets in milliseconds for connecting (\a aConnect), waiting for the response header (\a aFirstByte)
+and the longest pause while receiving the body (\a aBody)
+*/
+void RequestScheduler::setBudgets(int aConnect, int aFirstByte, int aBody)
+{
+    m_iConnect = aConnect;
+    m_iFirstByte = aFirstByte;
+    m_iBody = aBody;
+}
+
+/*!
+Returns the budget for connecting, including the DNS lookup and the TLS handshake
+*/
+int RequestScheduler::connectBudget() const
+{
+    return m_iConnect;
+}
+
+/*!
+Returns the budget for waiting for the response header, once connected
+*/
+int RequestScheduler::firstByteBudget() const
+{
+    return m_iFirstByte;
+}
+
+/*!
+Returns the longest pause while receiving the body
+*/
+int RequestScheduler::bodyBudget() const
+{
+    return m_iBody;
+}
+
+/*!
+Sets the number of retries \a aRetries of a request, and the base delay \a aBackoff in milliseconds before the first retry
+*/
+void RequestScheduler::setRetries(int aRetries, int aBackoff)
+{
+    m_iRetries = qMax(0, aRetries);
+    m_iBackoff = qMax(0, aBackoff);
+}
+
+/*!
+Returns the number of retries of a request
+*/
+int RequestScheduler::retries() const
+{
+    return m_iRetries;
+}
+
+/*!
+Returns the delay in milliseconds before retry \a aAttempt (1 for the first retry). The delay doubles
+with each retry, and half of it is random, so clients failing at the same time do not retry at the same time
+*/
+int RequestScheduler::backoff(int aAttempt) const
+{
+    int delay = m_iBackoff << qMin(qMax(0, aAttempt - 1), 10);
+
+    return delay / 2 + (delay > 1 ? qrand() % (delay / 2 + 1) : 0);
+}
+
+/*!
+Sets the alternate host \a aUrl hedged requests are sent to, an empty url disables hedged requests
+\sa Config::setAlternateHost
+*/
+void RequestScheduler::setAlternateHost(const QUrl& aUrl)
+{
+    m_oAlternateHost = aUrl;
+}
+
+/*!
+Returns the url of the hedged request for \a aUrl: the same query on the alternate host, or an empty
+url if no alternate host is set
+*/
+QUrl RequestScheduler::alternateUrl(const QUrl& aUrl) const
+{
+    if(m_oAlternateHost.isEmpty())
+        return QUrl();
+
+    QUrl url(m_oAlternateHost);
+#if QT_VERSION >= 0x050000
+    url.setQuery(aUrl.query(QUrl::FullyEncoded), QUrl::StrictMode);
+#else
+    url.setEncodedQuery(aUrl.encodedQuery());
+#endif
+
+    return url;
+}
+
+/*!
+Sets the delay \a aMilliSec of a hedged request, used as long as not enough latencies have been recorded
+*/
+void RequestScheduler::setHedgeDelay(int aMilliSec)
+{
+    m_iHedgeDelay = aMilliSec;
+}
+
+/*!
+Returns the delay in milliseconds after which a hedged request is sent: the UPDATENODE_HEDGE_PERCENTILE
+percentile of the recorded latencies, but no later than the first attempt runs out of its budget
+*/
+int RequestScheduler::hedgeDelay() const
+{
+    if(m_listLatencies.size() < UPDATENODE_HEDGE_MIN_SAMPLES)
+        return qMin(m_iHedgeDelay, m_iConnect + m_iFirstByte);
+
+    QList<int> latencies = m_listLatencies;
+    qSort(latencies);
+
+    return qMin(latencies.at((latencies.size() - 1) * UPDATENODE_HEDGE_PERCENTILE / 100), m_iConnect + m_iFirstByte);
+}
+
+/*!
+Records the time \a aMilliSec until the response header of a request has arrived
+*/
+void RequestScheduler::addLatency(int aMilliSec)
+{
+    m_listLatencies.append(aMilliSec);
+
+    while(m_listLatencies.size() > UPDATENODE_LATENCY_SAMPLES)
+        m_listLatencies.removeFirst();
+}
+
+/*!
+Stores the recorded latencies for the next run, a single run usually sends only a few requests
+*/
+void RequestScheduler::save()
+{
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+    QStringList latencies;
+
+    foreach(int latency, m_listLatencies)
+        latencies.append(QString::number(latency));
+
+    settings.setValue("Network/Latencies", latencies.join(","));
+}
+
+/*!
+Loads the latencies stored by RequestScheduler::save
+*/
+void RequestScheduler::load()
+{
+    QSettings settings(UPDATENODE_COMPANY_STR, UPDATENODE_APPLICATION_STR, 0);
+
+    foreach(QString latency, settings.value("Network/Latencies").toString().split(",", QString::SkipEmptyParts))
+        addLatency(latency.toInt());
+}
@@ -0,0 +1,446 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QStringList>
+
+#include "responsecache.h"
+#include "localfile.h"
+#include "partfile.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::ResponseCache
+\brief Stores the last parsed response of UpdateNode.com for a request
+\n\n
+Each request url (key, product, version, ...) has its own entry in LocalFile::getResponsePath, holding
+the ETag and Last-Modified validators, a checksum of the response body and a snapshot of the parsed
+product, version, updates and messages.
+\n With the validators, the service may answer "304 Not Modified" and the snapshot is used instead
+of a response. An unchanged body is detected by its checksum, the snapshot is then kept instead of rebuilt.
+\sa Service::checkForUpdates, Config::setResponseTtl
+*/
+
+/*!
+Constructs a ResponseCache object for the request \a aUrl. Call ResponseCache::load to read the entry
+*/
+ResponseCache::ResponseCache(const QUrl& aUrl)
+{
+    m_iStatus = -1;
+    m_bLoaded = false;
+    m_strFileName = LocalFile::getResponsePath() + QDir::separator()
+            + QString::fromLatin1(QCryptographicHash::hash(aUrl.toEncoded(), QCryptographicHash::Md5).toHex());
+}
+
+/*!
+Reads the stored entry
+\n Returns false if there is no entry, or it cannot be read
+*/
+bool ResponseCache::load()
+{
+    QFile file(m_strFileName);
+
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+
+    if(magic != UPDATENODE_RESPONSE_MAGIC || version != UPDATENODE_RESPONSE_VERSION)
+        return false;
+
+    QString name, code, icon;
+    qint32 status, count;
+
+    stream >> m_oTime >> m_strETag >> m_strLastModified >> m_strBodyHash >> status >> m_strStatus;
+    m_iStatus = status;
+
+    stream >> name >> code >> icon;
+    m_oProduct.setName(name);
+    m_oProduct.setCode(code);
+    m_oProduct.setIconUrl(icon);
+
+    read(stream, m_oVersion);
+
+    m_listUpdates.clear();
+    stream >> count;
+    for(int i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+    {
+        UpdateNode::Update update;
+        UpdateNode::ProductVersion target;
+        QString title, description, link, command, commandLine, updateCode, size, hash, patch, base;
+        QStringList mirrors;
+        qint32 type;
+        bool admin, mandatory, independent;
+
+        stream >> title >> description >> link >> command >> commandLine >> updateCode
+               >> size >> hash >> patch >> base >> mirrors >> type >> admin >> mandatory >> independent;
+        read(stream, target);
+
+        update.setTitle(title);
+        update.setDescription(description);
+        update.setDownloadLink(link);
+        update.setCommand(command);
+        update.setCommandLine(commandLine);
+        update.setCode(updateCode);
+        update.setFileSize(size);
+        update.setFileHash(hash);
+        update.setPatchLink(patch);
+        update.setPatchBaseHash(base);
+        update.setMirrors(mirrors);
+        update.setType(type);
+        update.setRequiresAdmin(admin);
+        update.setMandatory(mandatory);
+        update.setIndependent(independent);
+        update.setTargetVersion(target);
+
+        m_listUpdates.append(update);
+    }
+
+    m_listMessages.clear();
+    stream >> count;
+    for(int i = 0; i < count && stream.status() == QDataStream::Ok; i++)
+    {
+        UpdateNode::Message message;
+        QString title, text, link, messageCode;
+        bool external;
+
+        stream >> title >> text >> link >> messageCode >> external;
+
+        message.setTitle(title);
+        message.setMessage(text);
+        message.setLink(link);
+        message.setCode(messageCode);
+        message.setOpenExternal(external);
+
+        m_listMessages.append(message);
+    }
+
+    m_bLoaded = stream.status() == QDataStream::Ok;
+
+    if(!m_bLoaded)
+        UpdateNode::Logging() << "Ignoring damaged response cache " << m_strFileName;
+
+    return m_bLoaded;
+}
+
+/*!
+Writes the entry with the current time, replacing the previous one atomically
+\n Returns true on success, otherwise false
+*/
+bool ResponseCache::save()
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    m_oTime = QDateTime::currentDateTime();
+
+    stream << (quint32)UPDATENODE_RESPONSE_MAGIC << (quint32)UPDATENODE_RESPONSE_VERSION;
+    stream << m_oTime << m_strETag << m_strLastModified << m_strBodyHash << (qint32)m_iStatus << m_strStatus;
+    stream << m_oProduct.getName() << m_oProduct.getCode() << m_oProduct.getIconUrl();
+    write(stream, m_oVersion);
+
+    stream << (qint32)m_listUpdates.size();
+    foreach(UpdateNode::Update update, m_listUpdates)
+    {
+        stream << update.getTitle() << update.getDescription() << update.getDownloadLink()
+               << update.getCommand() << update.getCommandLine() << update.getCode()
+               << update.getFileSize() << update.getFileHash() << update.getPatchLink() << update.getPatchBaseHash()
+               << update.getMirrors() << (qint32)update.getType() << update.isAdminRequired() << update.isMandatory() << update.isIndependent();
+        write(stream, update.getTargetVersion());
+    }
+
+    stream << (qint32)m_listMessages.size();
+    foreach(UpdateNode::Message message, m_listMessages)
+        stream << message.getTitle() << message.getMessage() << message.getLink() << message.getCode() << message.isOpenExternal();
+
+    UpdateNode::PartFile file(m_strFileName);
+
+    if(!file.open() || !file.write(data) || !file.commit())
+    {
+        UpdateNode::Logging() << "Could not store response cache " << m_strFileName << ": " << file.errorString();
+        file.discard();
+        return false;
+    }
+
+    m_bLoaded = true;
+
+    return true;
+}
+
+/*!
+Removes the stored entry
+*/
+void ResponseCache::remove()
+{
+    QFile::remove(m_strFileName);
+    m_bLoaded = false;
+}
+
+/*!
+Returns true if the entry has been read or written successfully
+*/
+bool ResponseCache::isLoaded() const
+{
+    return m_bLoaded;
+}
+
+/*!
+Returns true if the entry has been stored less than \a aTtl seconds ago. Always false for \a aTtl 0
+*/
+bool ResponseCache::isFresh(int aTtl) const
+{
+    if(!m_bLoaded || aTtl <= 0)
+        return false;
+
+    QDateTime now = QDateTime::currentDateTime();
+
+    return m_oTime <= now && m_oTime.addSecs(aTtl) > now;
+}
+
+/*!
+Fills \a aConfig with the stored product, version, updates and messages, like UpdateNode::XmlParser does
+*/
+void ResponseCache::restore(UpdateNode::Config* aConfig) const
+{
+    aConfig->setProduct(m_oProduct);
+    aConfig->setVersion(m_oVersion);
+
+    foreach(UpdateNode::Update update, m_listUpdates)
+        aConfig->addUpdate(update);
+
+    foreach(UpdateNode::Message message, m_listMessages)
+        aConfig->addMessage(message);
+}
+
+/*!
+Sets the ETag \a aETag and the Last-Modified date \a aLastModified of the response
+*/
+void ResponseCache::setValidators(const QString& aETag, const QString& aLastModified)
+{
+    m_strETag = aETag;
+    m_strLastModified = aLastModified;
+}
+
+/*!
+Returns the ETag of the stored response, to be sent as If-None-Match
+*/
+QString ResponseCache::getETag() const
+{
+    return m_strETag;
+}
+
+/*!
+Returns the Last-Modified date of the stored response, to be sent as If-Modified-Since
+*/
+QString ResponseCache::getLastModified() const
+{
+    return m_strLastModified;
+}
+
+/*!
+Sets the checksum \a aHash (hex) of the response body
+*/
+void ResponseCache::setBodyHash(const QString& aHash)
+{
+    m_strBodyHash = aHash;
+}
+
+/*!
+Returns the checksum (hex) of the stored response body
+*/
+QString ResponseCache::getBodyHash() const
+{
+    return m_strBodyHash;
+}
+
+/*!
+Sets the service status \a aStatus and its description \a aStatusString
+*/
+void ResponseCache::setStatus(int aStatus, const QString& aStatusString)
+{
+    m_iStatus = aStatus;
+    m_strStatus = aStatusString;
+}
+
+/*!
+Returns the stored service status
+*/
+int ResponseCache::getStatus() const
+{
+    return m_iStatus;
+}
+
+/*!
+Returns the description of the stored service status
+*/
+QString ResponseCache::getStatusString() const
+{
+    return m_strStatus;
+}
+
+/*!
+Sets the parsed product \a aProduct
+*/
+void ResponseCache::setProduct(const UpdateNode::Product& aProduct)
+{
+    m_oProduct = aProduct;
+}
+
+/*!
+Returns the stored product
+*/
+UpdateNode::Product ResponseCache::getProduct() const
+{
+    return m_oProduct;
+}
+
+/*!
+Sets the parsed current version \a aVersion
+*/
+void ResponseCache::setVersion(const UpdateNode::ProductVersion& aVersion)
+{
+    m_oVersion = aVersion;
+}
+
+/*!
+Returns the stored current version
+*/
+UpdateNode::ProductVersion ResponseCache::getVersion() const
+{
+    return m_oVersion;
+}
+
+/*!
+Sets the parsed updates \a aUpdates
+*/
+void ResponseCache::setUpdates(const QList<UpdateNode::Update>& aUpdates)
+{
+    m_listUpdates = aUpdates;
+}
+
+/*!
+Returns the stored updates
+*/
+QList<UpdateNode::Update> ResponseCache::getUpdates() const
+{
+    return m_listUpdates;
+}
+
+/*!
+Sets the parsed messages \a aMessages
+*/
+void ResponseCache::setMessages(const QList<UpdateNode::Message>& aMessages)
+{
+    m_listMessages = aMessages;
+}
+
+/*!
+Returns the stored messages
+*/
+QList<UpdateNode::Message> ResponseCache::getMessages() const
+{
+    return m_listMessages;
+}
+
+/*!
+Returns the file the entry is stored in
+*/
+QString ResponseCache::fileName() const
+{
+    return m_strFileName;
+}
+
+/*!
+Writes \a aVersion to \a aStream
+*/
+void ResponseCache::write(QDataStream& aStream, const UpdateNode::ProductVersion& aVersion)
+{
+    aStream << aVersion.getCode() << aVersion.getName() << aVersion.getVersion();
+}
+
+/*!
+Reads \a aVersion from \a aStream
+*/
+void ResponseCache::read(QDataStream& aStream, UpdateNode::ProductVersion& aVersion)
+{
+    QString code, name, version;
+
+    aStream >> code >> name >> version;
+
+    aVersion.setCode(code);
+    aVersion.setName(name);
+    aVersion.setVersion(version);
+}
+
+/*!
+Returns up to \a aMax distinct hosts (scheme, host and port) of the downloads and icons in all stored
+responses, e.g. to connect to them before they are needed
+\sa NetworkSession::warmUp
+*/
+QList<QUrl> ResponseCache::storedHosts(int aMax)
+{
+    QList<QUrl> hosts;
+    QDir dir(LocalFile::getResponsePath());
+
+    foreach(QString name, dir.entryList(QDir::Files))
+    {
+        UpdateNode::ResponseCache cache((QUrl()));
+        cache.m_strFileName = dir.absoluteFilePath(name);
+
+        if(!cache.load())
+            continue;
+
+        QStringList links;
+        links.append(cache.getProduct().getIconUrl());
+        foreach(UpdateNode::Update update, cache.getUpdates())
+            links << update.getDownloadLink() << update.getPatchLink() << update.getMirrors();
+
+        foreach(QString link, links)
+        {
+            QUrl url(link);
+            if(url.host().isEmpty())
+                continue;
+
+            QUrl host;
+            host.setScheme(url.scheme());
+            host.setHost(url.host());
+            host.setPort(url.port());
+
+            if(!hosts.contains(host))
+                hosts.append(host);
+
+            if(hosts.size() >= aMax)
+                return hosts;
+        }
+    }
+
+    return hosts;
+}
@@ -0,0 +1,411 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <string.h>
+
+#include "scheduledreply.h"
+#include "requestscheduler.h"
+#include "networksession.h"
+#include "logging.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::ScheduledReply
+\brief Reply of RequestScheduler::get, served by the first of possibly several attempts
+\n\n
+A request passes three phases, each with a budget of its own: connecting (including DNS and the TLS
+handshake), waiting for the response header, and receiving the body, where the budget is the longest
+pause between two chunks.
+\n An attempt failing or running out of its budget before its response has started is retried after
+a backoff, up to RequestScheduler::retries times. A hedged attempt to the alternate host may run in parallel,
+the first attempt with a response header is used, all others are aborted. Once the body is being received,
+the request is not retried anymore, since its data has already been passed on.
+\n A response with status 5xx or 429 (Too Many Requests) is not used while retries are left, the request is
+retried after a backoff instead. The response of the last attempt is passed on as it is.
+\n Connecting is a phase of its own for HTTPS only, where the end of the TLS handshake is signaled.
+For HTTP, it is part of waiting for the response header.
+*/
+
+/*!
+Constructs a ScheduledReply and starts the first attempt of \a aRequest
+*/
+ScheduledReply::ScheduledReply(const QNetworkRequest& aRequest, QObject* parent /* = 0 */)
+    : QNetworkReply(parent)
+{
+    m_pCommitted = NULL;
+    m_iAttempts = 0;
+    m_bHedged = false;
+
+    setRequest(aRequest);
+    setUrl(aRequest.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    open(QIODevice::ReadOnly);
+
+    m_oHedgeTimer.setSingleShot(true);
+    m_oBackoffTimer.setSingleShot(true);
+    connect(&m_oHedgeTimer, SIGNAL(timeout()), SLOT(hedge()));
+    connect(&m_oBackoffTimer, SIGNAL(timeout()), SLOT(start()));
+
+    m_oElapsed.start();
+    start();
+
+    if(!UpdateNode::RequestScheduler::Instance()->alternateUrl(aRequest.url()).isEmpty())
+        m_oHedgeTimer.start(UpdateNode::RequestScheduler::Instance()->hedgeDelay());
+}
+
+/*!
+Destructs the ScheduledReply and aborts all running attempts
+*/
+ScheduledReply::~ScheduledReply()
+{
+    foreach(QNetworkReply* attempt, m_listAttempts)
+        drop(attempt);
+}
+
+/*!
+Aborts all attempts and finishes the reply with QNetworkReply::OperationCanceledError
+*/
+void ScheduledReply::abort()
+{
+    foreach(QNetworkReply* attempt, m_listAttempts)
+        drop(attempt);
+
+    complete(QNetworkReply::OperationCanceledError, "Operation canceled");
+}
+
+/*!
+Returns the number of bytes which can be read
+*/
+qint64 ScheduledReply::bytesAvailable() const
+{
+    return m_oBuffer.size() + QNetworkReply::bytesAvailable();
+}
+
+/*!
+The reply is a sequential device
+*/
+bool ScheduledReply::isSequential() const
+{
+    return true;
+}
+
+/*!
+Returns the number of attempts sent to the host of the request, not counting the hedged attempt
+*/
+int ScheduledReply::attempts() const
+{
+    return m_iAttempts;
+}
+
+/*!
+Returns true if a hedged attempt has been sent to the alternate host
+\sa RequestScheduler::setAlternateHost
+*/
+bool ScheduledReply::isHedged() const
+{
+    return m_bHedged;
+}
+
+/*!
+Reads up to \a maxSize bytes of the received data into \a data
+*/
+qint64 ScheduledReply::readData(char* data, qint64 maxSize)
+{
+    qint64 size = qMin(maxSize, (qint64)m_oBuffer.size());
+
+    memcpy(data, m_oBuffer.constData(), size);
+    m_oBuffer.remove(0, size);
+
+    return size;
+}
+
+/*!
+Starts the next attempt on the host of the request
+*/
+void ScheduledReply::start()
+{
+    m_iAttempts++;
+    launch(request().url());
+}
+
+/*!
+Starts the hedged attempt on the alternate host, unless a response has started already
+*/
+void ScheduledReply::hedge()
+{
+    if(m_pCommitted || isFinished())
+        return;
+
+    UpdateNode::Logging() << "No response after " << (int)m_oElapsed.elapsed() << "ms, sending a hedged request";
+
+    m_bHedged = true;
+    launch(UpdateNode::RequestScheduler::Instance()->alternateUrl(request().url()));
+}
+
+/*!
+Sends an attempt of the request to \a aUrl
+*/
+void ScheduledReply::launch(const QUrl& aUrl)
+{
+    QNetworkRequest request(this->request());
+    request.setUrl(aUrl);
+
+    QNetworkReply* attempt = UpdateNode::NetworkSession::Instance()->get(request);
+    QTimer* timer = new QTimer(this);
+    timer->setSingleShot(true);
+
+    m_listAttempts.append(attempt);
+    m_mapTimer[attempt] = timer;
+    m_mapTimerAttempt[timer] = attempt;
+
+    connect(timer, SIGNAL(timeout()), SLOT(phaseTimeout()));
+    connect(attempt, SIGNAL(metaDataChanged()), SLOT(attemptMetaDataChanged()));
+    connect(attempt, SIGNAL(readyRead()), SLOT(attemptReadyRead()));
+    connect(attempt, SIGNAL(finished()), SLOT(attemptFinished()));
+
+#if QT_VERSION >= 0x050100
+    if(aUrl.scheme() == "https")
+    {
+        connect(attempt, SIGNAL(encrypted()), SLOT(attemptEncrypted()));
+        enterPhase(attempt, PHASE_CONNECT);
+        return;
+    }
+#endif
+
+    enterPhase(attempt, PHASE_FIRST_BYTE);
+}
+
+/*!
+Starts the deadline of phase \a aPhase of \a aAttempt
+*/
+void ScheduledReply::enterPhase(QNetworkReply* aAttempt, Phase aPhase)
+{
+    UpdateNode::RequestScheduler* scheduler = UpdateNode::RequestScheduler::Instance();
+    int budget = 0;
+
+    switch(aPhase)
+    {
+        case PHASE_CONNECT:
+            budget = scheduler->connectBudget();
+            break;
+        case PHASE_FIRST_BYTE:
+            // without a connect phase of its own, connecting is part of this phase
+            budget = scheduler->firstByteBudget() + (m_mapPhase.contains(aAttempt) ? 0 : scheduler->connectBudget());
+            break;
+        case PHASE_BODY:
+            budget = scheduler->bodyBudget();
+            break;
+    }
+
+    m_mapPhase[aAttempt] = aPhase;
+    m_mapTimer.value(aAttempt)->start(budget);
+}
+
+/*!
+Slot called when the TLS handshake of an attempt is done
+*/
+void ScheduledReply::attemptEncrypted()
+{
+    QNetworkReply* attempt = qobject_cast<QNetworkReply*>(sender());
+
+    if(m_mapPhase.value(attempt) == PHASE_CONNECT)
+        enterPhase(attempt, PHASE_FIRST_BYTE);
+}
+
+/*!
+Slot called when the response header of an attempt has arrived. The first attempt with a response is used
+*/
+void ScheduledReply::attemptMetaDataChanged()
+{
+    QNetworkReply* attempt = qobject_cast<QNetworkReply*>(sender());
+
+    if(!m_pCommitted && !isRetryable(attempt))
+        commit(attempt);
+}
+
+/*!
+Slot called when a chunk of the body of an attempt has arrived
+*/
+void ScheduledReply::attemptReadyRead()
+{
+    QNetworkReply* attempt = qobject_cast<QNetworkReply*>(sender());
+
+    if(!m_pCommitted && !isRetryable(attempt))
+        commit(attempt);
+
+    if(attempt != m_pCommitted)
+        return;
+
+    m_oBuffer += attempt->readAll();
+    enterPhase(attempt, PHASE_BODY);
+
+    emit readyRead();
+}
+
+/*!
+Slot called when an attempt has finished. A failed attempt is retried after a backoff, unless\n
+its response has started already, or no retries are left
+*/
+void ScheduledReply::attemptFinished()
+{
+    QNetworkReply* attempt = qobject_cast<QNetworkReply*>(sender());
+    bool timedOut = m_listTimedOut.contains(attempt);
+    QNetworkReply::NetworkError error = timedOut ? QNetworkReply::TimeoutError : attempt->error();
+    QString errorString = timedOut ? QString("Timeout after %1ms").arg(m_oElapsed.elapsed()) : attempt->errorString();
+
+    if(!m_pCommitted && attempt->error() == QNetworkReply::NoError && !isRetryable(attempt))
+        commit(attempt);
+
+    if(attempt == m_pCommitted)
+    {
+        QByteArray data = attempt->readAll();
+        drop(attempt);
+
+        if(!data.isEmpty())
+        {
+            m_oBuffer += data;
+            emit readyRead();
+        }
+
+        complete(error, errorString);
+        return;
+    }
+
+    UpdateNode::Logging() << "Request to " << attempt->url().host() << " failed: " << errorString;
+    drop(attempt);
+
+    // another attempt is still running, or about to be sent
+    if(!m_listAttempts.isEmpty() || m_oBackoffTimer.isActive() || isFinished())
+        return;
+
+    if(m_iAttempts <= UpdateNode::RequestScheduler::Instance()->retries())
+    {
+        int delay = UpdateNode::RequestScheduler::Instance()->backoff(m_iAttempts);
+        UpdateNode::Logging() << "Retrying in " << delay << "ms";
+        m_oBackoffTimer.start(delay);
+        return;
+    }
+
+    complete(error, errorString);
+}
+
+/*!
+Slot called when an attempt has run out of the budget of its current phase. The attempt is aborted
+*/
+void ScheduledReply::phaseTimeout()
+{
+    QNetworkReply* attempt = m_mapTimerAttempt.value(qobject_cast<QTimer*>(sender()));
+
+    if(!attempt)
+        return;
+
+    static const char* phases[] = { "connecting", "waiting for the response", "receiving the response" };
+    UpdateNode::Logging() << "Timeout while " << phases[m_mapPhase.value(attempt)] << " (" << attempt->url().host() << ")";
+
+    m_listTimedOut.append(attempt);
+    attempt->abort();
+}
+
+/*!
+Returns true, if \a aAttempt has been answered with a server error or 429 (Too Many Requests) and retries are left.
+Such a response is not used, the request is retried instead
+*/
+bool ScheduledReply::isRetryable(QNetworkReply* aAttempt) const
+{
+    int status = aAttempt->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if(status < 500 && status != 429)
+        return false;
+
+    return m_iAttempts <= UpdateNode::RequestScheduler::Instance()->retries();
+}
+
+/*!
+Uses \a aAttempt for the reply: its header is taken over and all other attempts are aborted
+*/
+void ScheduledReply::commit(QNetworkReply* aAttempt)
+{
+    m_pCommitted = aAttempt;
+    m_oHedgeTimer.stop();
+    m_oBackoffTimer.stop();
+
+    UpdateNode::RequestScheduler::Instance()->addLatency(m_oElapsed.elapsed());
+
+    foreach(QNetworkReply* attempt, m_listAttempts)
+        if(attempt != aAttempt)
+            drop(attempt);
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, aAttempt->attribute(QNetworkRequest::HttpStatusCodeAttribute));
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, aAttempt->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    setAttribute(QNetworkRequest::RedirectionTargetAttribute, aAttempt->attribute(QNetworkRequest::RedirectionTargetAttribute));
+    setHeader(QNetworkRequest::ContentLengthHeader, aAttempt->header(QNetworkRequest::ContentLengthHeader));
+    setHeader(QNetworkRequest::ContentTypeHeader, aAttempt->header(QNetworkRequest::ContentTypeHeader));
+
+    foreach(QByteArray header, aAttempt->rawHeaderList())
+        setRawHeader(header, aAttempt->rawHeader(header));
+
+    enterPhase(aAttempt, PHASE_BODY);
+
+    emit metaDataChanged();
+}
+
+/*!
+Stops tracking \a aAttempt, aborting it if it is still running
+*/
+void ScheduledReply::drop(QNetworkReply* aAttempt)
+{
+    QTimer* timer = m_mapTimer.take(aAttempt);
+
+    if(timer)
+    {
+        m_mapTimerAttempt.remove(timer);
+        timer->deleteLater();
+    }
+
+    m_listAttempts.removeAll(aAttempt);
+    m_listTimedOut.removeAll(aAttempt);
+    m_mapPhase.remove(aAttempt);
+
+    disconnect(aAttempt, 0, this, 0);
+    if(!aAttempt->isFinished())
+        aAttempt->abort();
+    aAttempt->deleteLater();
+}
+
+/*!
+Finishes the reply with \a aError
+*/
+void ScheduledReply::complete(QNetworkReply::NetworkError aError, const QString& aErrorString)
+{
+    m_oHedgeTimer.stop();
+    m_oBackoffTimer.stop();
+
+    if(isFinished())
+        return;
+
+    if(aError != QNetworkReply::NoError)
+        setError(aError, aErrorString);
+
+    setFinished(true);
+    emit finished();
+}
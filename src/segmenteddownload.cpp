@@ -0,0 +1,544 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include <QNetworkRequest>
+#include <QDataStream>
+#include <QFileInfo>
+
+#include "segmenteddownload.h"
+#include "downloader.h"
+#include "partfile.h"
+#include "logging.h"
+#include "throttle.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::SegmentedDownload
+\brief Downloads a single file over several parallel connections
+\n\n
+The size of the file is probed with a HEAD request first. The target file is then
+preallocated and split into byte ranges, which are fetched in parallel. Each segment
+is written at its own offset, so the result is byte-identical to a single-stream download.
+A failed segment is retried on its own, continuing where it stopped.
+\n The SHA-256 checksum follows the contiguous part of the file from its beginning: data at that
+position is hashed as it arrives, data which has been written ahead by later segments is read
+back once the preceding segment is complete.
+\n An aborted or interrupted download keeps its part file, along with the progress of each segment in a checkpoint
+file (UPDATENODE_SEGMENT_CHECKPOINT). The next SegmentedDownload of the same file continues each segment where
+it stopped, as long as the server still reports the same size and validator. Without a strong validator, the file
+cannot be continued safely and is removed.
+\n If the server does not announce a content length and range support, unsupported() is
+emitted and the caller has to fall back to a plain download.
+\note QNetworkAccessManager opens at most six connections per host, therefore the
+number of segments is limited to UPDATENODE_SEGMENT_MAXIMUM
+*/
+
+/*!
+Constructs a SegmentedDownload for \a aUrl, which will be stored as \a aFileName and
+fetched in up to \a aSegments parallel segments
+*/
+SegmentedDownload::SegmentedDownload(const QUrl& aUrl, const QString& aFileName, int aSegments, QObject* aParent /* = 0 */)
+    : QObject(aParent), m_oUrl(aUrl), m_strFileName(aFileName)
+{
+    m_iSize = 0;
+    m_iReceived = 0;
+    m_iHashed = 0;
+    m_iSegments = aSegments;
+    m_bFinished = false;
+    m_bResumable = false;
+    m_pHash = PartFile::createHash();
+}
+
+/*!
+Destructs the SegmentedDownload. An unfinished download is removed from disk.
+*/
+SegmentedDownload::~SegmentedDownload()
+{
+    if(m_oFile.isOpen())
+    {
+        m_oFile.close();
+        m_oFile.remove();
+    }
+
+    delete m_pHash;
+}
+
+/*!
+Starts the download by probing the size of the file
+*/
+void SegmentedDownload::start()
+{
+    QNetworkRequest request(m_oUrl);
+    QNetworkReply* reply = UpdateNode::NetworkSession::Instance()->head(request);
+
+    m_oReplies[reply] = -1;
+    connect(reply, SIGNAL(finished()), SLOT(probeFinished()));
+}
+
+/*!
+Aborts all running segments. The unfinished file is kept to be continued later
+*/
+void SegmentedDownload::abort()
+{
+    m_bResumable = true;
+
+    if(!m_bFinished)
+        finish(QNetworkReply::OperationCanceledError, "Operation canceled");
+}
+
+/*!
+Sets the SHA-256 checksum \a aHash (hex) the complete file must have
+\sa PartFile::setExpectedHash
+*/
+void SegmentedDownload::setExpectedHash(const QString& aHash)
+{
+    m_strExpectedHash = aHash.toLower();
+}
+
+/*!
+Returns the SHA-256 checksum (hex) of the downloaded file, or an empty string
+if the download is incomplete or SHA-256 is not supported
+*/
+QString SegmentedDownload::hash() const
+{
+    if(!m_pHash || m_iHashed != m_iSize)
+        return QString();
+
+    return QString::fromLatin1(m_pHash->result().toHex());
+}
+
+/*!
+Returns the url of the download
+*/
+QUrl SegmentedDownload::url() const
+{
+    return m_oUrl;
+}
+
+/*!
+Returns the file name the download is stored to
+*/
+QString SegmentedDownload::fileName() const
+{
+    return m_strFileName;
+}
+
+/*!
+Returns the size of the file, as announced by the server. Returns 0 until the probe has finished
+*/
+qint64 SegmentedDownload::size() const
+{
+    return m_iSize;
+}
+
+/*!
+Returns the number of segments actually used. Returns 0 until the probe has finished
+*/
+int SegmentedDownload::segments() const
+{
+    return m_listSegments.size();
+}
+
+/*!
+Slot called when the HEAD request has finished. Splits the file into segments and starts them
+*/
+void SegmentedDownload::probeFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    m_oReplies.remove(reply);
+    reply->deleteLater();
+
+    if(m_bFinished)
+        return;
+
+    m_iSize = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+
+    if(reply->error() != QNetworkReply::NoError
+            || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200
+            || reply->rawHeader("Accept-Ranges").toLower() != "bytes"
+            || m_iSize <= 0)
+    {
+        UpdateNode::Logging() << "Segmented download of " << m_oUrl.toString() << " is not supported by the server";
+        QFile::remove(m_strFileName + UPDATENODE_PART_SUFFIX + UPDATENODE_SEGMENT_CHECKPOINT);
+        m_bFinished = true;
+        emit unsupported();
+        return;
+    }
+
+    // If-Range makes sure all segments are taken from the same version of the file
+    m_strValidator = reply->rawHeader("ETag");
+    if(m_strValidator.isEmpty() || m_strValidator.startsWith("W/"))
+        m_strValidator = reply->rawHeader("Last-Modified");
+
+    m_oFile.setFileName(m_strFileName + UPDATENODE_PART_SUFFIX);
+
+    if(restoreCheckpoint())
+    {
+        UpdateNode::Logging() << "Resuming download of " << m_oUrl.toString() << " at " << QString::number(m_iReceived)
+                              << " of " << QString::number(m_iSize) << " bytes";
+
+        // the contiguous part written before is hashed again from the file
+        updateHash(-1, QByteArray());
+        emit downloadProgress(m_iReceived, m_iSize);
+    }
+    else
+    {
+        if(!m_oFile.open(QIODevice::ReadWrite | QIODevice::Truncate) || !m_oFile.resize(m_iSize))
+        {
+            finish(QNetworkReply::UnknownContentError, m_oFile.errorString());
+            return;
+        }
+
+        int count = (int)qMin((qint64)m_iSegments, m_iSize / UPDATENODE_SEGMENT_MINIMUM);
+        count = qBound(1, count, UPDATENODE_SEGMENT_MAXIMUM);
+
+        qint64 length = m_iSize / count;
+        for(int i = 0; i < count; i++)
+        {
+            Segment segment;
+            segment.m_iStart = i * length;
+            segment.m_iEnd = (i == count - 1) ? m_iSize - 1 : (i + 1) * length - 1;
+            segment.m_iWritten = 0;
+            segment.m_iRetries = 0;
+            m_listSegments.append(segment);
+        }
+
+        UpdateNode::Logging() << "Downloading " << m_oUrl.toString() << " in " << m_listSegments.size() << " segments";
+    }
+
+    for(int i = 0; i < m_listSegments.size(); i++)
+        if(m_listSegments.at(i).m_iStart + m_listSegments.at(i).m_iWritten <= m_listSegments.at(i).m_iEnd)
+            startSegment(i);
+
+    // all segments had been complete before
+    if(m_oReplies.isEmpty())
+        finish(QNetworkReply::NoError, QString());
+}
+
+/*!
+Continues the download from the checkpoint of an aborted download of the same file, if the server reports
+the same size and validator. Opens the part file and fills the segments on success.
+\n Returns false if there is no usable checkpoint, the download then starts from scratch
+\sa SegmentedDownload::storeCheckpoint
+*/
+bool SegmentedDownload::restoreCheckpoint()
+{
+    QFile checkpoint(m_oFile.fileName() + UPDATENODE_SEGMENT_CHECKPOINT);
+    if(!checkpoint.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&checkpoint);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    QByteArray validator;
+    qint64 size;
+    qint32 count;
+    stream >> validator >> size >> count;
+
+    QList<Segment> segments;
+    qint64 next = 0;
+    for(int i = 0; i < count && stream.status() == QDataStream::Ok && count <= UPDATENODE_SEGMENT_MAXIMUM; i++)
+    {
+        Segment segment;
+        stream >> segment.m_iStart >> segment.m_iEnd >> segment.m_iWritten;
+        segment.m_iRetries = 0;
+
+        // the segments have to cover the file without gaps
+        if(segment.m_iStart != next || segment.m_iEnd < segment.m_iStart || segment.m_iWritten < 0
+                || segment.m_iWritten > segment.m_iEnd - segment.m_iStart + 1)
+            break;
+
+        next = segment.m_iEnd + 1;
+        segments.append(segment);
+    }
+
+    checkpoint.close();
+    checkpoint.remove();
+
+    if(stream.status() != QDataStream::Ok || validator.isEmpty() || validator != m_strValidator || size != m_iSize
+            || segments.isEmpty() || segments.size() != count || next != m_iSize
+            || QFileInfo(m_oFile.fileName()).size() != m_iSize || !m_oFile.open(QIODevice::ReadWrite))
+        return false;
+
+    m_listSegments = segments;
+    m_iReceived = 0;
+    foreach(Segment segment, m_listSegments)
+        m_iReceived += segment.m_iWritten;
+
+    return true;
+}
+
+/*!
+Stores the progress of each segment next to the part file, for SegmentedDownload::restoreCheckpoint.
+The part file is synced before, so the checkpoint never claims data, which is not on disk
+*/
+void SegmentedDownload::storeCheckpoint()
+{
+    QFile checkpoint(m_oFile.fileName() + UPDATENODE_SEGMENT_CHECKPOINT);
+
+    if(!PartFile::sync(m_oFile) || !checkpoint.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        UpdateNode::Logging() << "Could not store the progress of " << m_oFile.fileName();
+        return;
+    }
+
+    QDataStream stream(&checkpoint);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << m_strValidator << m_iSize << (qint32)m_listSegments.size();
+
+    foreach(Segment segment, m_listSegments)
+        stream << segment.m_iStart << segment.m_iEnd << segment.m_iWritten;
+}
+
+/*!
+Requests the missing part of segment \a aIndex
+*/
+void SegmentedDownload::startSegment(int aIndex)
+{
+    const Segment& segment = m_listSegments.at(aIndex);
+
+    QNetworkRequest request(m_oUrl);
+    request.setRawHeader("Range", "bytes=" + QByteArray::number(segment.m_iStart + segment.m_iWritten)
+                         + "-" + QByteArray::number(segment.m_iEnd));
+    if(!m_strValidator.isEmpty())
+        request.setRawHeader("If-Range", m_strValidator);
+    UpdateNode::Throttle::Instance()->prepare(request);
+
+    QNetworkReply* reply = UpdateNode::NetworkSession::Instance()->get(request);
+    reply->setReadBufferSize(UPDATENODE_DOWNLOAD_BUFFER_SIZE);
+
+    m_oReplies[reply] = aIndex;
+    connect(reply, SIGNAL(readyRead()), SLOT(segmentReadyRead()));
+    connect(reply, SIGNAL(finished()), SLOT(segmentFinished()));
+}
+
+/*!
+Returns true if \a aReply delivers the requested range of segment \a aIndex. If the file has
+changed on the server, the response contains the whole file instead.
+*/
+bool SegmentedDownload::checkSegment(QNetworkReply* aReply, int aIndex)
+{
+    const Segment& segment = m_listSegments.at(aIndex);
+
+    // Content-Range: bytes <first>-<last>/<total>
+    QByteArray range = aReply->rawHeader("Content-Range");
+    QList<QByteArray> values = range.mid(range.indexOf(' ') + 1).split('/');
+
+    return aReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 206
+            && values.size() == 2 && values.at(1).toLongLong() == m_iSize
+            && values.at(0).split('-').at(0).toLongLong() == segment.m_iStart + segment.m_iWritten;
+}
+
+/*!
+Slot called whenever data of a segment arrives, writes it at the segment's offset
+*/
+void SegmentedDownload::segmentReadyRead()
+{
+    readSegment(qobject_cast<QNetworkReply*>(sender()), false);
+}
+
+/*!
+Writes the data of \a reply at its segment's offset. Unless \a aAll is set, only as much data
+as UpdateNode::Throttle allows is read
+*/
+void SegmentedDownload::readSegment(QNetworkReply* reply, bool aAll)
+{
+    if(m_bFinished || !m_oReplies.contains(reply))
+        return;
+
+    // error pages are not part of the file, the segment is retried when finished
+    if(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 400)
+    {
+        reply->readAll();
+        return;
+    }
+
+    int index = m_oReplies.value(reply);
+    Segment& segment = m_listSegments[index];
+
+    if(reply->property("checked").isNull())
+    {
+        if(!checkSegment(reply, index))
+        {
+            finish(QNetworkReply::UnknownContentError, "The file has changed on the server during the download");
+            return;
+        }
+        reply->setProperty("checked", true);
+    }
+
+    QByteArray data = aAll ? reply->readAll() : UpdateNode::Throttle::Instance()->read(reply);
+    qint64 offset = segment.m_iStart + segment.m_iWritten;
+
+    if(offset + data.size() > segment.m_iEnd + 1)
+    {
+        finish(QNetworkReply::UnknownContentError, "The server sent more data than requested");
+        return;
+    }
+
+    if(!m_oFile.seek(offset) || m_oFile.write(data) != data.size())
+    {
+        finish(QNetworkReply::UnknownContentError, m_oFile.errorString());
+        return;
+    }
+
+    segment.m_iWritten += data.size();
+    m_iReceived += data.size();
+
+    updateHash(offset, data);
+
+    emit downloadProgress(m_iReceived, m_iSize);
+}
+
+/*!
+Advances the checksum after \a aData has been written at \a aOffset
+*/
+void SegmentedDownload::updateHash(qint64 aOffset, const QByteArray& aData)
+{
+    if(!m_pHash)
+        return;
+
+    if(aOffset == m_iHashed)
+    {
+        m_pHash->addData(aData);
+        m_iHashed += aData.size();
+    }
+
+    // catch up with data the following segments have written in the meantime
+    qint64 length = m_listSegments.at(0).m_iEnd + 1;
+    while(m_iHashed < m_iSize)
+    {
+        const Segment& segment = m_listSegments.at((int)qMin(m_iHashed / length, (qint64)m_listSegments.size() - 1));
+        qint64 available = segment.m_iStart + segment.m_iWritten;
+
+        if(m_iHashed >= available || !m_oFile.seek(m_iHashed))
+            break;
+
+        QByteArray data = m_oFile.read(qMin(available - m_iHashed, (qint64)UPDATENODE_DOWNLOAD_BUFFER_SIZE));
+        if(data.isEmpty())
+            break;
+
+        m_pHash->addData(data);
+        m_iHashed += data.size();
+    }
+}
+
+/*!
+Slot called when a segment has finished. Incomplete segments are retried up to
+UPDATENODE_SEGMENT_RETRIES times, the download is finished once all segments are complete.
+*/
+void SegmentedDownload::segmentFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
+
+    // data held back by the throttle is still in the reply
+    if(reply->bytesAvailable() > 0)
+        readSegment(reply, true);
+
+    if(m_bFinished || !m_oReplies.contains(reply))
+        return;
+
+    int index = m_oReplies.take(reply);
+    Segment& segment = m_listSegments[index];
+
+    if(segment.m_iStart + segment.m_iWritten <= segment.m_iEnd)
+    {
+        QNetworkReply::NetworkError error = reply->error();
+        bool transient = error == QNetworkReply::NoError
+                || error < QNetworkReply::ContentAccessDenied
+                || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 500;
+
+        if(transient && segment.m_iRetries < UPDATENODE_SEGMENT_RETRIES)
+        {
+            segment.m_iRetries++;
+            UpdateNode::Logging() << "Segment " << index << " of " << m_oUrl.toString() << " incomplete, retrying";
+            startSegment(index);
+            return;
+        }
+
+        // a connection loss or a server error, the next attempt continues from the checkpoint
+        m_bResumable = transient;
+        finish(error == QNetworkReply::NoError ? QNetworkReply::UnknownContentError : error,
+               error == QNetworkReply::NoError ? QString("Segment %1 is incomplete").arg(index) : reply->errorString());
+        return;
+    }
+
+    if(m_oReplies.isEmpty())
+        finish(QNetworkReply::NoError, QString());
+}
+
+/*!
+Stops all segments and moves the completed file in place, or removes it on \a aError.
+If the download has been aborted, or a segment has run out of retries on a connection loss or a server error,
+the file is kept with a checkpoint instead, see SegmentedDownload::restoreCheckpoint.
+Emits finished()
+*/
+void SegmentedDownload::finish(QNetworkReply::NetworkError aError, const QString& aErrorString)
+{
+    QNetworkReply::NetworkError error = aError;
+    QString errorString = aErrorString;
+
+    m_bFinished = true;
+
+    QList<QNetworkReply*> replies = m_oReplies.keys();
+    m_oReplies.clear();
+    foreach(QNetworkReply* reply, replies)
+        reply->abort();
+
+    if(error == QNetworkReply::NoError && !m_strExpectedHash.isEmpty())
+    {
+        if(!m_pHash)
+            UpdateNode::Logging() << "SHA-256 is not supported, " << m_strFileName << " cannot be verified";
+        else if(hash() != m_strExpectedHash)
+        {
+            error = QNetworkReply::UnknownContentError;
+            errorString = QString("Checksum mismatch for %1: expected %2, got %3").arg(m_strFileName).arg(m_strExpectedHash).arg(hash());
+        }
+    }
+
+    // an aborted or interrupted download keeps its part file, if the server can confirm the file has not changed when continuing
+    bool resumable = m_bResumable && !m_strValidator.isEmpty() && !m_listSegments.isEmpty();
+
+    if(m_oFile.isOpen())
+    {
+        if(resumable)
+            storeCheckpoint();
+
+        bool synced = error == QNetworkReply::NoError && PartFile::sync(m_oFile);
+        m_oFile.close();
+
+        if(error == QNetworkReply::NoError && (!synced || !PartFile::replace(m_oFile.fileName(), m_strFileName)))
+        {
+            error = QNetworkReply::UnknownContentError;
+            errorString = QString("Could not move %1 to %2").arg(m_oFile.fileName()).arg(m_strFileName);
+        }
+
+        if(error != QNetworkReply::NoError && !resumable)
+            m_oFile.remove();
+    }
+
+    if(error != QNetworkReply::NoError)
+        UpdateNode::Logging() << "Segmented download of " << m_oUrl.toString() << " failed: " << errorString;
+
+    emit finished(error, errorString);
+}
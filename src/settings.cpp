@@ -26,8 +26,12 @@
 #include <QSettings>
 #include <QUuid>
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
 #include "settings.h"
 #include "config.h"
+#include "logging.h"
+#include "cachemanager.h"
 
 using namespace UpdateNode;
 
@@ -192,6 +196,22 @@ void Settings::setUpdate(UpdateNode::Update aUpdate, const QString& aLocalFile,
     this->setValue( id + "Result" , aResult);
     this->setValue( id + "File" , aLocalFile);
     this->setValue( id + "Type" , aUpdate.getType());
+
+    // the file of an installed update may be evicted from the cache
+    if(aResult == 0)
+    {
+        UpdateNode::CacheManager cache;
+        cache.unpin(aUpdate.getCode());
+    }
+}
+
+/*!
+Returns the result stored for the update \aaUpdateCode, or an empty string if it has not been run yet
+\sa Settings::setUpdate
+*/
+QString Settings::getUpdateResult(const QString& aUpdateCode)
+{
+    return this->value( m_strUpdate + aUpdateCode + "/Result" ).toString();
 }
 
 /*!
@@ -225,6 +245,23 @@ bool Settings::messageShownAndLoaded(const QString& aMessageCode)
     return this->value( id + "Shown" , false).toBool() && this->value( id + "Loaded" , false).toBool();
 }
 
+/*!
+Returns the state of the message \aaMessageCode as combination of UPDATENODE_MESSAGE_SHOWN and \n
+UPDATENODE_MESSAGE_LOADED
+*/
+int Settings::getMessageState(const QString& aMessageCode)
+{
+    QString id = m_strMessage + aMessageCode + "/";
+    int state = 0;
+
+    if(this->value( id + "Shown" , false).toBool())
+        state |= UPDATENODE_MESSAGE_SHOWN;
+    if(this->value( id + "Loaded" , false).toBool())
+        state |= UPDATENODE_MESSAGE_LOADED;
+
+    return state;
+}
+
 /*!
 Maps the current product version specified in \aconfig to information from \n
 parameters \aaProduct and \aaVersion
@@ -370,17 +407,24 @@ QString Settings::getVersionCode(UpdateNode::Config* aConfig /* = null */)
 }
 
 /*!
-Stores a cached file for a given update code \aaCode and it's \aaFilename
+Stores a cached file for a given update code \aaCode and it's \aaFilename. Along with the
+SHA-256 checksum \aaHash, the size and modification time of the file are stored, so the
+cache can be validated without reading the file again
 \sa Settings::getCachedFile
+\sa Settings::isCachedFileValid
 */
-void Settings::setCachedFile(const QString& aCode, const QString& aFilename)
+void Settings::setCachedFile(const QString& aCode, const QString& aFilename, const QString& aHash /* = QString() */)
 {
     if(aCode.isEmpty())
         return;
 
     QString id = m_strUpdate + aCode + "/";
+    QFileInfo info(aFilename);
 
     this->setValue( id + "File" , aFilename);
+    this->setValue( id + "Hash" , aHash);
+    this->setValue( id + "Size" , info.size());
+    this->setValue( id + "Modified" , info.lastModified());
 }
 
 /*!
@@ -394,6 +438,148 @@ QString Settings::getCachedFile(const QString& aCode)
     return this->value( id + "File").toString();
 }
 
+/*!
+Returns the SHA-256 checksum of the cached file for a given update code \aaCode
+\sa Settings::setCachedFile
+*/
+QString Settings::getCachedFileHash(const QString& aCode)
+{
+    QString id = m_strUpdate + aCode + "/";
+
+    return this->value( id + "Hash").toString();
+}
+
+/*!
+Checks if the cached file for a given update code \aaCode can be used: it must still have
+the size and modification time it had when it was downloaded, and - if both are known - its
+checksum must match \aaHash
+\sa Settings::setCachedFile
+*/
+bool Settings::isCachedFileValid(const QString& aCode, const QString& aHash /* = QString() */)
+{
+    QString id = m_strUpdate + aCode + "/";
+    QString file = getCachedFile(aCode);
+    QFileInfo info(file);
+
+    if(aCode.isEmpty() || file.isEmpty() || !info.exists())
+        return false;
+
+    if(info.size() != this->value( id + "Size", -1).toLongLong()
+            || info.lastModified() != this->value( id + "Modified").toDateTime())
+    {
+        UpdateNode::Logging() << "Cached file " << file << " has been modified";
+        return false;
+    }
+
+    QString hash = this->value( id + "Hash").toString();
+    if(!aHash.isEmpty() && !hash.isEmpty() && aHash.compare(hash, Qt::CaseInsensitive) != 0)
+    {
+        UpdateNode::Logging() << "Cached file " << file << " does not match the checksum of the update";
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+Marks the update \aaCode as downloaded and verified ahead of time by the -prefetch mode
+\sa Settings::isUpdateReady, UpdateNode::Prefetcher
+*/
+void Settings::setUpdateReady(const QString& aCode, bool aReady)
+{
+    if(aCode.isEmpty())
+        return;
+
+    this->setValue( m_strUpdate + aCode + "/Ready" , aReady);
+}
+
+/*!
+Checks if the update \aaUpdate has been prefetched and its cached file can still be used,
+so it can be installed without any network transfer
+\sa Settings::setUpdateReady
+*/
+bool Settings::isUpdateReady(const UpdateNode::Update& aUpdate)
+{
+    return this->value( m_strUpdate + aUpdate.getCode() + "/Ready", false).toBool()
+            && isCachedFileValid(aUpdate.getCode(), aUpdate.getFileHash());
+}
+
+/*!
+Stores the state of an unfinished download for a given update code \aaCode: the part file
+\aaPartFile and the number of bytes \aaOffset which are safely written to it
+\sa Settings::getPartialFile
+\sa Settings::getPartialOffset
+*/
+void Settings::setPartialDownload(const QString& aCode, const QString& aPartFile, qint64 aOffset)
+{
+    if(aCode.isEmpty())
+        return;
+
+    QString id = m_strUpdate + aCode + "/Partial/";
+
+    this->setValue( id + "File" , aPartFile);
+    this->setValue( id + "Offset" , aOffset);
+}
+
+/*!
+Stores the validator (ETag or Last-Modified) of an unfinished download for a given update code \aaCode
+\sa Settings::getPartialValidator
+*/
+void Settings::setPartialValidator(const QString& aCode, const QString& aValidator)
+{
+    if(aCode.isEmpty())
+        return;
+
+    QString id = m_strUpdate + aCode + "/Partial/";
+
+    this->setValue( id + "Validator" , aValidator);
+}
+
+/*!
+Returns the part file of an unfinished download for a given update code \aaCode
+\sa Settings::setPartialDownload
+*/
+QString Settings::getPartialFile(const QString& aCode)
+{
+    QString id = m_strUpdate + aCode + "/Partial/";
+
+    return this->value( id + "File").toString();
+}
+
+/*!
+Returns the number of bytes already downloaded for a given update code \aaCode
+\sa Settings::setPartialDownload
+*/
+qint64 Settings::getPartialOffset(const QString& aCode)
+{
+    QString id = m_strUpdate + aCode + "/Partial/";
+
+    return this->value( id + "Offset", 0).toLongLong();
+}
+
+/*!
+Returns the validator of an unfinished download for a given update code \aaCode
+\sa Settings::setPartialValidator
+*/
+QString Settings::getPartialValidator(const QString& aCode)
+{
+    QString id = m_strUpdate + aCode + "/Partial/";
+
+    return this->value( id + "Validator").toString();
+}
+
+/*!
+Removes the state of an unfinished download for a given update code \aaCode
+\sa Settings::setPartialDownload
+*/
+void Settings::removePartialDownload(const QString& aCode)
+{
+    if(aCode.isEmpty())
+        return;
+
+    this->remove(m_strUpdate + aCode + "/Partial");
+}
+
 /*!
 Sets the current client dir, specified by \aaClientDir
 \sa Settings::getCurrentClientDir
@@ -417,6 +603,13 @@ void Settings::setIgnoreUpdate(const QString& aUpdateCode, bool aIgnore)
     QString id = m_strUpdate + aUpdateCode + "/";
 
     this->setValue( id + "Ignore" , aIgnore);
+
+    // an ignored update does not need its file anymore
+    if(aIgnore)
+    {
+        UpdateNode::CacheManager cache;
+        cache.unpin(aUpdateCode);
+    }
 }
 
 bool Settings::isUpdateIgnored(const QString& aUpdateCode)
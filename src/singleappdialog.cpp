@@ -52,10 +52,11 @@ SingleAppDialog::SingleAppDialog(QWidget *parent) :
     connect(&m_oCommander, SIGNAL(processError()), this, SLOT(processOutput()));
     connect(&m_oCommander, SIGNAL(updateExit(int, QProcess::ExitStatus)), this, SLOT(updateExit(int, QProcess::ExitStatus)));
 
-    m_pDownloader = new UpdateNode::Downloader();
+    m_pDownloads = new UpdateNode::DownloadQueue(this);
+    m_pStats = new UpdateNode::TransferStats(m_pDownloads, this);
 
-    connect(m_pDownloader, SIGNAL(downloadProgress(qint64,qint64)), SLOT(downloadProgress(qint64, qint64)));
-    connect(m_pDownloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), SLOT(downloadDone(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)));
+    connect(m_pStats, SIGNAL(downloadProgress(qint64,qint64)), SLOT(downloadProgress(qint64, qint64)));
+    connect(m_pDownloads, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), SLOT(downloadDone(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)));
 
     connect(this, SIGNAL(rejected()), SLOT(onClose()));
     connect(m_pUi->pushButton, SIGNAL(clicked()), SLOT(onClose()));
@@ -67,8 +68,8 @@ SingleAppDialog::SingleAppDialog(QWidget *parent) :
 
 SingleAppDialog::~SingleAppDialog()
 {
-    if(m_pDownloader->isDownloading())
-        m_pDownloader->cancel();
+    if(m_pDownloads->isBusy())
+        m_pDownloads->cancelAll();
 
     delete m_pUi;
 }
@@ -83,16 +84,27 @@ void SingleAppDialog::init(UpdateNode::Service* aService, bool aDownloadOnly, bo
 
 void SingleAppDialog::download()
 {
+    UpdateNode::Settings settings;
     QList<UpdateNode::Update> update_list = UpdateNode::Config::Instance()->updates();
     for(int i = 0; i < update_list.size(); i++)
     {
+        // prefetched updates are installed without any network transfer
+        if(settings.isUpdateReady(update_list.at(i)))
+        {
+            m_oReadyUpdates.append(update_list.at(i));
+            continue;
+        }
+
         if(update_list.size() == 1)
             m_pUi->labelProgress->setText(tr("Downloading update ..."));
         else
             m_pUi->labelProgress->setText(tr("Downloading updates"));
 
-        m_pDownloader->doDownload(update_list.at(i).getDownloadLink(), update_list.at(i));
+        m_pDownloads->enqueue(update_list.at(i));
     }
+
+    if(!m_pDownloads->isBusy())
+        install();
 }
 
 void SingleAppDialog::install()
@@ -178,7 +190,6 @@ void SingleAppDialog::serviceDone()
             update = update_list.at(0);
 
         UpdateNode::Settings settings;
-        QString cachedFile = settings.getCachedFile(update.getCode());
 
         if(!config->isSilent())
         {
@@ -186,7 +197,7 @@ void SingleAppDialog::serviceDone()
             show();
         }
 
-        if(update.getCode().isEmpty() || !QFile::exists(cachedFile))
+        if(update.getCode().isEmpty() || !settings.isCachedFileValid(update.getCode(), update.getFileHash()))
         {
             qApp->exit(UPDATENODE_PROCERROR_RUN_DOWNLOAD_FIRST);
             return;
@@ -229,7 +240,7 @@ void SingleAppDialog::updateExit(int aExitCode, QProcess::ExitStatus aExitStatus
 {
     UpdateNode::Settings settings;
 
-    settings.setUpdate(m_oCurrentUpdate, UpdateNode::LocalFile::getDownloadLocation(m_oCurrentUpdate.getDownloadLink()), aExitCode);
+    settings.setUpdate(m_oCurrentUpdate, UpdateNode::LocalFile::getUpdateLocation(m_oCurrentUpdate), aExitCode);
 
     if(aExitStatus == QProcess::NormalExit)
     {
@@ -279,11 +290,20 @@ void SingleAppDialog::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
         show();
     }
 
-    if(m_pUi->progressBar->maximum() <= bytesTotal)
+    if(bytesTotal <= 0)
     {
-        m_pUi->progressBar->setRange(0, bytesTotal);
-        m_pUi->progressBar->setValue(bytesReceived);
+        // size unknown, show a busy indicator
+        m_pUi->progressBar->setRange(0, 0);
+        return;
     }
+
+    // QProgressBar is int based, so the 64 bit values are scaled down. The total is partly estimated
+    // while downloads are waiting, the bar only moves forward
+    m_pUi->progressBar->setRange(0, UPDATENODE_PROGRESS_RANGE);
+    m_pUi->progressBar->setValue(qMax(m_pUi->progressBar->value(), (int)(bytesReceived * UPDATENODE_PROGRESS_RANGE / bytesTotal)));
+
+    QString stats = m_pStats->toString();
+    m_pUi->progressBar->setFormat(stats.isEmpty() ? QString("%p%") : QString("%p%  (%1)").arg(stats));
 }
 
 void SingleAppDialog::downloadDone(const UpdateNode::Update& aUpdate, QNetworkReply::NetworkError aError, const QString& aErrorString)
@@ -297,7 +317,7 @@ void SingleAppDialog::downloadDone(const UpdateNode::Update& aUpdate, QNetworkRe
         return;
     }
 
-    if(!m_pDownloader->isDownloading())
+    if(!m_pDownloads->isBusy())
         install();
 }
 
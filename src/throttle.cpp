@@ -0,0 +1,237 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include "throttle.h"
+#include "config.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::Throttle
+\brief Limits the bandwidth of update downloads with a token bucket
+\n\n
+Downloads take their data from the reply with Throttle::read, which only hands out as many bytes as there are
+tokens in the bucket. The rest stays in the reply, and as the read buffer of the reply is limited, the socket
+stops reading as well, so the sender is slowed down by TCP itself. A waiting reply is woken up again by emitting
+its readyRead() signal once enough tokens are available.
+\n The bucket is shared by all downloads of the process, so the limit applies to all of them together, no matter
+if they are streamed, resumed or segmented. Requests to the service do not take their data from the bucket.
+\n In background mode, downloads are requested with a low priority and yield to the requests of the service:
+as long as one of them is running, downloads are slowed down to UPDATENODE_THROTTLE_YIELD_RATE.
+\sa Config::setRateLimit, Config::setBackground
+*/
+
+/*!
+Global instance of the Throttle pointer
+*/
+Throttle* Throttle::m_pInstance = NULL;
+
+/*!
+Retrieves the global Throttle class instance as an pointer. If no instance is present,
+a new one will be created in this method
+*/
+Throttle* Throttle::Instance()
+{
+    if(!m_pInstance)
+        m_pInstance = new Throttle;
+
+    return m_pInstance;
+}
+
+/*!
+Constructs a Throttle with the rate limit and the background mode of UpdateNode::Config
+*/
+Throttle::Throttle()
+    : QObject(0)
+{
+    m_iRate = UpdateNode::Config::Instance()->getRateLimit();
+    m_bBackground = UpdateNode::Config::Instance()->isBackground();
+    m_fTokens = 0;
+    m_oRefill.start();
+
+    m_oWakeUp.setSingleShot(true);
+    connect(&m_oWakeUp, SIGNAL(timeout()), SLOT(wakeUp()));
+}
+
+/*!
+Reads as much data from \a aReply as the bucket allows. If data is left in \a aReply, its
+readyRead() signal is emitted again once there are enough tokens
+*/
+QByteArray Throttle::read(QNetworkReply* aReply)
+{
+    qint64 available = aReply->bytesAvailable();
+    qint64 granted = acquire(available);
+
+    if(granted < available)
+    {
+        wait(aReply);
+        return aReply->read(granted);
+    }
+
+    return aReply->readAll();
+}
+
+/*!
+Takes up to \a aBytes tokens from the bucket and returns the number of bytes which may be read now
+*/
+qint64 Throttle::acquire(qint64 aBytes)
+{
+    if(effectiveRate() <= 0)
+        return aBytes;
+
+    refill();
+
+    qint64 granted = qMin(aBytes, (qint64)m_fTokens);
+    m_fTokens -= granted;
+
+    return granted;
+}
+
+/*!
+Sets the rate limit of all downloads together to \a aBytesPerSecond, 0 for no limit
+*/
+void Throttle::setRate(int aBytesPerSecond)
+{
+    refill();
+    m_iRate = qMax(0, aBytesPerSecond);
+}
+
+/*!
+Returns the rate limit in bytes per second, 0 if downloads are not limited
+*/
+int Throttle::rate() const
+{
+    return m_iRate;
+}
+
+/*!
+Enables or disables the background mode \a aBackground
+*/
+void Throttle::setBackground(bool aBackground)
+{
+    m_bBackground = aBackground;
+}
+
+/*!
+Checks if downloads run in background mode
+*/
+bool Throttle::isBackground() const
+{
+    return m_bBackground;
+}
+
+/*!
+Prepares the download request \a aRequest, in background mode it gets a low priority
+*/
+void Throttle::prepare(QNetworkRequest& aRequest) const
+{
+    if(m_bBackground)
+        aRequest.setPriority(QNetworkRequest::LowPriority);
+}
+
+/*!
+Registers \a aReply as a foreground request, background downloads yield to it until it has finished
+*/
+void Throttle::addForeground(QNetworkReply* aReply)
+{
+    m_listForeground.append(aReply);
+
+    connect(aReply, SIGNAL(finished()), SLOT(foregroundFinished()));
+    connect(aReply, SIGNAL(destroyed()), SLOT(foregroundFinished()));
+}
+
+/*!
+Checks if background downloads currently yield to a foreground request
+*/
+bool Throttle::isYielding() const
+{
+    return m_bBackground && !m_listForeground.isEmpty();
+}
+
+/*!
+Returns the rate currently applied, 0 if unlimited
+*/
+int Throttle::effectiveRate() const
+{
+    if(isYielding())
+        return m_iRate > 0 ? qMin(m_iRate, UPDATENODE_THROTTLE_YIELD_RATE) : UPDATENODE_THROTTLE_YIELD_RATE;
+
+    return m_iRate;
+}
+
+/*!
+Adds the tokens for the time passed since the last refill
+*/
+void Throttle::refill()
+{
+    int rate = effectiveRate();
+    qint64 elapsed = m_oRefill.restart();
+
+    if(rate <= 0)
+        return;
+
+    double capacity = qMax((double)UPDATENODE_THROTTLE_CHUNK, (double)rate * UPDATENODE_THROTTLE_BURST / 1000);
+    m_fTokens = qMin(capacity, m_fTokens + (double)rate * elapsed / 1000);
+}
+
+/*!
+Queues \a aReply until there are tokens for UPDATENODE_THROTTLE_CHUNK bytes
+*/
+void Throttle::wait(QNetworkReply* aReply)
+{
+    if(!m_listWaiting.contains(aReply))
+        m_listWaiting.append(aReply);
+
+    if(m_oWakeUp.isActive())
+        return;
+
+    int rate = qMax(1, effectiveRate());
+    m_oWakeUp.start(qMax(10, (int)((UPDATENODE_THROTTLE_CHUNK - m_fTokens) * 1000 / rate)));
+}
+
+/*!
+Slot called once there are tokens again, lets the waiting replies read. The order is rotated
+on every call, so all downloads get their share
+*/
+void Throttle::wakeUp()
+{
+    if(m_listWaiting.size() > 1)
+        m_listWaiting.append(m_listWaiting.takeFirst());
+
+    QList<QPointer<QNetworkReply> > waiting = m_listWaiting;
+    m_listWaiting.clear();
+
+    foreach(QPointer<QNetworkReply> reply, waiting)
+        if(reply && reply->bytesAvailable() > 0)
+            QMetaObject::invokeMethod(reply, "readyRead");
+}
+
+/*!
+Slot called when a foreground request has finished
+*/
+void Throttle::foregroundFinished()
+{
+    m_listForeground.removeAll(static_cast<QNetworkReply*>(sender()));
+
+    if(m_listForeground.isEmpty() && !m_listWaiting.isEmpty() && !m_oWakeUp.isActive())
+        m_oWakeUp.start(0);
+}
@@ -0,0 +1,277 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 UpdateNode UG (haftungsbeschränkt)
+** Contact: code@updatenode.com
+**
+** This file is part of the UpdateNode Client.
+**
+** Commercial License Usage
+** Licensees holding valid commercial UpdateNode license may use this file
+** under the terms of the the Apache License, Version 2.0
+** Full license description file: LICENSE.COM
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation. Please review the following information to ensure the
+** GNU General Public License version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+** Full license description file: LICENSE.GPL
+**
+****************************************************************************/
+
+#include "transferstats.h"
+
+using namespace UpdateNode;
+
+/*!
+\class UpdateNode::TransferStats
+\brief Combines the progress of all jobs of a UpdateNode::DownloadQueue
+\n\n
+Progress reported by the running jobs is only stored, and published at most every UPDATENODE_STATS_INTERVAL ms
+by downloadProgress() and statsChanged(), no matter how often the network reports progress. The overall
+progress includes jobs which have already ended, and jobs still waiting in the queue with the average size of
+the jobs whose size is known, so it does not jump back when a download ends and the next one starts.
+\n For each job and overall, the throughput of the last interval (TransferStats::rate) and an exponentially
+smoothed throughput (TransferStats::smoothedRate) are available. The smoothed throughput is used for the
+remaining time (TransferStats::eta).
+*/
+
+/*!
+Constructs a TransferStats object, collecting the progress of all jobs started by \a aQueue
+*/
+TransferStats::TransferStats(UpdateNode::DownloadQueue* aQueue, QObject* parent /* = 0 */)
+    : QObject(parent)
+{
+    m_pQueue = aQueue;
+    m_iDoneReceived = 0;
+    m_iDoneTotal = 0;
+    m_iDoneJobs = 0;
+    m_bChanged = false;
+
+    m_oTimer.setInterval(UPDATENODE_STATS_INTERVAL);
+    connect(&m_oTimer, SIGNAL(timeout()), SLOT(update()));
+
+    connect(aQueue, SIGNAL(jobStarted(UpdateNode::DownloadJob*)), SLOT(jobStarted(UpdateNode::DownloadJob*)));
+    connect(aQueue, SIGNAL(jobFinished(UpdateNode::DownloadJob*)), SLOT(jobFinished(UpdateNode::DownloadJob*)));
+}
+
+/*!
+Returns the number of bytes received by \a aJob, or by all jobs if \a aJob is NULL
+*/
+qint64 TransferStats::bytesReceived(UpdateNode::DownloadJob* aJob /* = NULL */) const
+{
+    return aJob ? m_mapJobs.value(aJob).iReceived : m_oTotal.iReceived;
+}
+
+/*!
+Returns the size of \a aJob, or of all jobs if \a aJob is NULL.
+\n Returns -1 if the size is unknown
+*/
+qint64 TransferStats::bytesTotal(UpdateNode::DownloadJob* aJob /* = NULL */) const
+{
+    if(aJob)
+        return m_mapJobs.value(aJob).iTotal > 0 ? m_mapJobs.value(aJob).iTotal : -1;
+
+    return m_oTotal.iTotal;
+}
+
+/*!
+Returns the throughput in bytes per second of \a aJob, or of all jobs if \a aJob is NULL, during the last interval
+*/
+double TransferStats::rate(UpdateNode::DownloadJob* aJob /* = NULL */) const
+{
+    return aJob ? m_mapJobs.value(aJob).fRate : m_oTotal.fRate;
+}
+
+/*!
+Returns the smoothed throughput in bytes per second of \a aJob, or of all jobs if \a aJob is NULL
+\sa UPDATENODE_STATS_SMOOTHING
+*/
+double TransferStats::smoothedRate(UpdateNode::DownloadJob* aJob /* = NULL */) const
+{
+    return aJob ? m_mapJobs.value(aJob).fSmoothed : m_oTotal.fSmoothed;
+}
+
+/*!
+Returns the remaining seconds of \a aJob, or of all jobs if \a aJob is NULL.
+\n Returns -1 if the size or the throughput is unknown
+*/
+int TransferStats::eta(UpdateNode::DownloadJob* aJob /* = NULL */) const
+{
+    return aJob ? m_mapJobs.value(aJob).eta() : m_oTotal.eta();
+}
+
+/*!
+Returns the overall throughput and remaining time as human readable text, like "1.5 MB/s, 0:42 remaining".
+\n Returns an empty string as long as the throughput is unknown
+*/
+QString TransferStats::toString() const
+{
+    double rate = smoothedRate();
+    if(rate < 1)
+        return QString();
+
+    QString text;
+    if(rate >= 1024 * 1024)
+        text = tr("%1 MB/s").arg(rate / (1024 * 1024), 0, 'f', 1);
+    else
+        text = tr("%1 KB/s").arg(rate / 1024, 0, 'f', 0);
+
+    int seconds = eta();
+    if(seconds >= 0)
+        text += tr(", %1:%2 remaining").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+
+    return text;
+}
+
+/*!
+Sets the interval \a aMsec between two updates of the statistics
+*/
+void TransferStats::setInterval(int aMsec)
+{
+    m_oTimer.setInterval(qMax(1, aMsec));
+}
+
+/*!
+Slot called when \a aJob is started, or restarted after a retry
+*/
+void TransferStats::jobStarted(UpdateNode::DownloadJob* aJob)
+{
+    if(!m_mapJobs.contains(aJob))
+        m_mapJobs.insert(aJob, Sample());
+
+    connect(aJob, SIGNAL(downloadProgress(qint64,qint64)), SLOT(jobProgress(qint64,qint64)), Qt::UniqueConnection);
+
+    if(!m_oTimer.isActive())
+    {
+        m_oElapsed.start();
+        m_oTimer.start();
+    }
+}
+
+/*!
+Slot called when \a aJob has ended. The bytes it has received stay part of the overall progress.
+Once the last job has ended, the final progress is published right away
+*/
+void TransferStats::jobFinished(UpdateNode::DownloadJob* aJob)
+{
+    if(!m_mapJobs.contains(aJob))
+        return;
+
+    Sample sample = m_mapJobs.take(aJob);
+
+    // a canceled or failed job is counted with the bytes it got, so the overall progress can still complete
+    m_iDoneReceived += sample.iReceived;
+    m_iDoneTotal += sample.iReceived;
+    if(sample.iReceived > 0)
+        m_iDoneJobs++;
+    m_bChanged = true;
+
+    if(m_mapJobs.isEmpty())
+        update();
+}
+
+/*!
+Slot called on every progress of a job, only stores the values until the next update
+*/
+void TransferStats::jobProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    UpdateNode::DownloadJob* job = qobject_cast<UpdateNode::DownloadJob*>(sender());
+    if(!job || !m_mapJobs.contains(job))
+        return;
+
+    Sample& sample = m_mapJobs[job];
+    sample.iReceived = bytesReceived;
+    sample.iTotal = bytesTotal;
+
+    m_bChanged = true;
+}
+
+/*!
+Slot called every UPDATENODE_STATS_INTERVAL ms while jobs are running, updates the throughput and publishes the statistics
+*/
+void TransferStats::update()
+{
+    qint64 elapsed = m_oElapsed.restart();
+
+    m_oTotal.iReceived = m_iDoneReceived;
+    m_oTotal.iTotal = m_iDoneTotal;
+
+    qint64 knownTotal = m_iDoneTotal;
+    int knownJobs = m_iDoneJobs;
+
+    QMap<UpdateNode::DownloadJob*, Sample>::iterator it;
+    for(it = m_mapJobs.begin(); it != m_mapJobs.end(); ++it)
+    {
+        it->update(elapsed);
+
+        m_oTotal.iReceived += it->iReceived;
+
+        // as long as the size of one download is unknown, the total is unknown
+        if(it->iTotal <= 0 && it->iReceived > 0)
+            m_oTotal.iTotal = -1;
+        else if(m_oTotal.iTotal >= 0)
+            m_oTotal.iTotal += qMax(it->iTotal, it->iReceived);
+
+        if(it->iTotal > 0)
+        {
+            knownTotal += it->iTotal;
+            knownJobs++;
+        }
+    }
+
+    // jobs which have not been started yet are expected to be of the average size
+    if(m_oTotal.iTotal >= 0 && knownJobs > 0)
+    {
+        foreach(UpdateNode::DownloadJob* job, m_pQueue->jobs())
+        {
+            if(job->state() == UpdateNode::DownloadJob::QUEUED && !m_mapJobs.contains(job))
+                m_oTotal.iTotal += knownTotal / knownJobs;
+        }
+    }
+
+    if(m_mapJobs.isEmpty())
+    {
+        qint64 total = m_oTotal.iTotal;
+
+        m_oTimer.stop();
+        m_oTotal = Sample();
+        m_oTotal.iReceived = m_iDoneReceived;
+        m_oTotal.iTotal = total;
+        m_oTotal.iLastReceived = m_iDoneReceived;
+    }
+    else
+        m_oTotal.update(elapsed);
+
+    if(m_bChanged)
+        emit downloadProgress(m_oTotal.iReceived, m_oTotal.iTotal);
+
+    m_bChanged = false;
+    emit statsChanged();
+}
+
+/*!
+Updates the throughput with the bytes received during the last \a aElapsed ms
+*/
+void TransferStats::Sample::update(qint64 aElapsed)
+{
+    if(aElapsed <= 0)
+        return;
+
+    // a restarted download may report less than before
+    fRate = qMax(Q_INT64_C(0), iReceived - iLastReceived) * 1000.0 / aElapsed;
+    fSmoothed = fSmoothed == 0 ? fRate : UPDATENODE_STATS_SMOOTHING * fRate + (1 - UPDATENODE_STATS_SMOOTHING) * fSmoothed;
+    iLastReceived = iReceived;
+}
+
+/*!
+Returns the remaining seconds at the smoothed throughput, or -1 if unknown
+*/
+int TransferStats::Sample::eta() const
+{
+    if(iTotal <= 0 || fSmoothed < 1)
+        return -1;
+
+    return (int)((qMax(Q_INT64_C(0), iTotal - iReceived) + fSmoothed - 1) / fSmoothed);
+}
@@ -41,6 +41,7 @@ Update::Update()
 {
     m_bAdminRequired = false;
     m_bMandatory = false;
+    m_bIndependent = false;
     m_iType = 1;
 }
 
@@ -259,3 +260,105 @@ void Update::setMandatory(bool aMandatoryUpdate)
     m_bMandatory = aMandatoryUpdate;
 }
 
+/*!
+Sets the SHA-256 checksum of the update file as a hex string. When set, a downloaded
+or cached file is only used if its checksum matches
+\sa Update::getFileHash
+*/
+void Update::setFileHash(const QString& aFileHash)
+{
+    m_strFileHash = aFileHash.trimmed().toLower();
+}
+
+/*!
+Returns the SHA-256 checksum of the update file. The returned string is empty when the
+server did not provide a checksum
+\sa Update::setFileHash
+*/
+QString Update::getFileHash() const
+{
+    return m_strFileHash;
+}
+
+/*!
+Sets the download link of a binary patch, which rebuilds the update file from a previous version
+\sa Update::setPatchBaseHash, UpdateNode::Patcher
+*/
+void Update::setPatchLink(const QString& aPatchLink)
+{
+    m_strPatchLink = aPatchLink;
+}
+
+/*!
+Returns the download link of the binary patch. The returned string is empty when there is no patch
+\sa Update::setPatchLink
+*/
+QString Update::getPatchLink() const
+{
+    return m_strPatchLink;
+}
+
+/*!
+Sets the SHA-256 checksum of the file the patch has to be applied on
+\sa Update::setPatchLink
+*/
+void Update::setPatchBaseHash(const QString& aBaseHash)
+{
+    m_strPatchBaseHash = aBaseHash.trimmed().toLower();
+}
+
+/*!
+Returns the SHA-256 checksum of the file the patch has to be applied on
+\sa Update::setPatchBaseHash
+*/
+QString Update::getPatchBaseHash() const
+{
+    return m_strPatchBaseHash;
+}
+
+/*!
+Sets the links of mirrors \a aMirrors, which serve the same file as the download link
+\sa Update::getMirrors, UpdateNode::MirrorSelector
+*/
+void Update::setMirrors(const QStringList& aMirrors)
+{
+    m_listMirrors = aMirrors;
+}
+
+/*!
+Adds the link of a mirror \a aMirror, which serves the same file as the download link
+\sa Update::setMirrors
+*/
+void Update::addMirror(const QString& aMirror)
+{
+    if(!aMirror.trimmed().isEmpty() && !m_listMirrors.contains(aMirror.trimmed()))
+        m_listMirrors.append(aMirror.trimmed());
+}
+
+/*!
+Returns the links of all mirrors of the download link. The returned list is empty when there are no mirrors
+\sa Update::setMirrors
+*/
+QStringList Update::getMirrors() const
+{
+    return m_listMirrors;
+}
+
+/*!
+Sets whether the update is independent \a aIndependent of the updates of other products.
+Independent updates of different products may be installed at the same time. By default an update is not independent
+\sa Update::isIndependent, UpdateNode::InstallScheduler
+*/
+void Update::setIndependent(bool aIndependent)
+{
+    m_bIndependent = aIndependent;
+}
+
+/*!
+Returns true, if the update may be installed at the same time as independent updates of other products
+\sa Update::setIndependent
+*/
+bool Update::isIndependent() const
+{
+    return m_bIndependent;
+}
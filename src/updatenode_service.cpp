@@ -26,6 +26,9 @@
 #include <QNetworkReply>
 #include <QNetworkProxyFactory>
 #include <QSslConfiguration>
+#include <QCryptographicHash>
+#include <QTimer>
+#include <QFile>
 
 #include "qglobal.h"
 #if QT_VERSION >= 0x050000
@@ -41,6 +44,8 @@
 #include "osdetection.h"
 #include "logging.h"
 #include "limittimer.h"
+#include "responsecache.h"
+#include "requestscheduler.h"
 
 using namespace UpdateNode;
 
@@ -57,9 +62,9 @@ Constructs a Service object
 Service::Service(QObject* parent)
     : QObject(parent)
 {
-    m_pManager = NULL;
     m_pDownloader = NULL;
     m_iStatus = -1;
+    m_bBatchUnsupported = false;
 
     // Use system proxy settings - if set
     QNetworkProxyFactory::setUseSystemConfiguration(true);
@@ -73,8 +78,8 @@ Destructs the Service object
 */
 Service::~Service()
 {
-    m_pManager->deleteLater();
-    m_pDownloader->deleteLater();
+    if(m_pDownloader)
+        m_pDownloader->deleteLater();
 }
 
 /*!
@@ -89,20 +94,12 @@ bool Service::checkForUpdates()
 
     m_iStatus = -1;
 
-    if(!m_pManager)
-    {
-        m_pManager = new QNetworkAccessManager(this);
-
-        connect(m_pManager, SIGNAL(finished(QNetworkReply*)),
-                this, SLOT(requestReceived(QNetworkReply*)));
-        connect(m_pManager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)),
-                this, SLOT(onSslError(QNetworkReply*,QList<QSslError>)));
-    }
-
     m_mapConfig.clear();
 
     if(config->isSingleMode())
         return checkForUpdates(config);
+    else if(config->configurations().size() > 1 && !m_bBatchUnsupported)
+        return checkForUpdates(config->configurations());
     else
     {
         bool result = true;
@@ -123,76 +120,507 @@ Checks for updates with parameters specified by \aaConfig
 bool Service::checkForUpdates(UpdateNode::Config* aConfig)
 {
     UpdateNode::Config* globalConfig = UpdateNode::Config::Instance();
-    UpdateNode::Settings settings;
-
-    QNetworkRequest request;
-    QUrl url(UPDATENODE_SERVICE_URL);
 
     if(!globalConfig->getHost().isEmpty())
+        UpdateNode::Logging() << "WARNING: Running in HTTP mode";
+
+    QUrl url = requestUrl(QList<UpdateNode::Config*>() << aConfig);
+    QNetworkRequest request = createRequest(url);
+
+    // the last response is reused without a request within its time to live, otherwise the service validates it
+    UpdateNode::ResponseCache* cache = new UpdateNode::ResponseCache(url);
+    if(cache->load())
     {
+        if(cache->isFresh(globalConfig->getResponseTtl()))
+        {
+            UpdateNode::Logging() << "Using the stored response, time to live: " << globalConfig->getResponseTtl() << "s";
+            restore(aConfig, cache);
+            delete cache;
+            QTimer::singleShot(0, this, SLOT(checkDone()));
+            return true;
+        }
+
+        if(!cache->getETag().isEmpty())
+            request.setRawHeader("If-None-Match", cache->getETag().toLatin1());
+        if(!cache->getLastModified().isEmpty())
+            request.setRawHeader("If-Modified-Since", cache->getLastModified().toLatin1());
+
+        // the stored response is the base of a delta response, the cache entry stays keyed by the plain url
+        if(globalConfig->isDeltaSync())
+            request.setUrl(digestUrl(url, cache));
+    }
+
+    QNetworkReply* reply = UpdateNode::RequestScheduler::Instance()->get(request);
+
+    m_mapConfig[reply] = aConfig;
+    m_mapCache[reply] = cache;
+    m_mapBodyHash[reply] = new QCryptographicHash(QCryptographicHash::Sha1);
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+
+    // parse the response while it arrives
+    createParser(reply, aConfig);
+
+    return true;
+}
+
+/*!
+Checks for updates of all \a aConfigs in a single request. The service answers with a <batch> element,\n
+containing a <response index="..."> element for each product. Products with a stored response within\n
+its time to live are not requested again. For the other stored responses, the request carries their digest,\n
+see Service::digestUrl, and the service answers with a delta response for the product.
+\n Products missing in the response are checked with a request of their own, see Service::batchReceived
+\sa Service::checkForUpdates(UpdateNode::Config* aConfig)
+*/
+bool Service::checkForUpdates(const QList<UpdateNode::Config*>& aConfigs)
+{
+    UpdateNode::Config* globalConfig = UpdateNode::Config::Instance();
+    QList<UpdateNode::Config*> configs;
+
+    if(!globalConfig->getHost().isEmpty())
         UpdateNode::Logging() << "WARNING: Running in HTTP mode";
+
+    foreach(UpdateNode::Config* config, aConfigs)
+    {
+        UpdateNode::ResponseCache cache(requestUrl(QList<UpdateNode::Config*>() << config));
+
+        if(cache.load() && cache.isFresh(globalConfig->getResponseTtl()))
+            restore(config, &cache);
+        else
+            configs.append(config);
+    }
+
+    if(configs.size() < 2)
+    {
+        foreach(UpdateNode::Config* config, configs)
+            checkForUpdates(config);
+
+        QTimer::singleShot(0, this, SLOT(checkDone()));
+        return true;
+    }
+
+    UpdateNode::Logging() << "Checking " << configs.size() << " products in a single request";
+
+    // a product with a stored response gets a delta response, the validators of a single request do not apply here
+    QUrl url = requestUrl(configs);
+    if(globalConfig->isDeltaSync())
+    {
+        for(int i = 0; i < configs.size(); i++)
+        {
+            UpdateNode::ResponseCache cache(requestUrl(QList<UpdateNode::Config*>() << configs.at(i)));
+            if(cache.load())
+                url = digestUrl(url, &cache, "_" + QString::number(i));
+        }
+    }
+
+    QNetworkReply* reply = UpdateNode::RequestScheduler::Instance()->get(createRequest(url));
+
+    m_mapBatch[reply] = configs;
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+
+    UpdateNode::XmlParser* parser = createParser(reply, NULL);
+    parser->setBatch(configs);
+    connect(parser, SIGNAL(responseParsed(UpdateNode::Config*, int, const QString&, bool)),
+            this, SLOT(batchResponseParsed(UpdateNode::Config*, int, const QString&, bool)));
+
+    return true;
+}
+
+/*!
+Builds the request url for \a aConfigs. A single product is checked with the plain request, several products\n
+are checked with a batched request, which numbers the product parameters like "productCode_0"
+*/
+QUrl Service::requestUrl(const QList<UpdateNode::Config*>& aConfigs)
+{
+    UpdateNode::Config* globalConfig = UpdateNode::Config::Instance();
+    UpdateNode::Settings settings;
+    QList<QPair<QString, QString> > items;
+    QUrl url(UPDATENODE_SERVICE_URL);
+
+    if(!globalConfig->getHost().isEmpty())
         url = url.fromUserInput(globalConfig->getHost());
+
+    items.append(qMakePair(QString("key"), globalConfig->getKey()));
+
+    if(!globalConfig->getTestKey().isEmpty())
+        items.append(qMakePair(QString("test"), globalConfig->getTestKey()));
+
+    items.append(qMakePair(QString("id"), settings.uuid()));
+    items.append(qMakePair(QString("os"), UpdateNode::OSDetection::getOS()));
+    items.append(qMakePair(QString("arch"), UpdateNode::OSDetection::getArch()));
+    items.append(qMakePair(QString("lang"), globalConfig->getLanguage()));
+    items.append(qMakePair(QString("custom"), globalConfig->getCustomRequestValue()));
+    items.append(qMakePair(QString("ident"), globalConfig->getIdentifier()));
+
+    if(aConfigs.size() > 1)
+        items.append(qMakePair(QString("batch"), QString::number(aConfigs.size())));
+
+    for(int i = 0; i < aConfigs.size(); i++)
+    {
+        QString suffix = aConfigs.size() > 1 ? "_" + QString::number(i) : QString();
+
+        if(aConfigs.at(i)->getVersionCode().isEmpty())
+        {
+            items.append(qMakePair("productCode" + suffix, settings.getProductCode(aConfigs.at(i))));
+            items.append(qMakePair("productVersion" + suffix, settings.getProductVersion(aConfigs.at(i))));
+        }
+        else
+            items.append(qMakePair("versionCode" + suffix, settings.getVersionCode(aConfigs.at(i))));
     }
 
 #if QT_VERSION >= 0x050000
     QUrlQuery url_query;
-    url_query.addQueryItem("key", globalConfig->getKey());
+    url_query.setQueryItems(items);
+    url.setQuery(url_query);
+#else
+    url.setQueryItems(items);
+#endif
 
-    if(!globalConfig->getTestKey().isEmpty())
-        url_query.addQueryItem("test", globalConfig->getTestKey());
+    return url;
+}
 
-    url_query.addQueryItem("id", settings.uuid());
-    url_query.addQueryItem("os", UpdateNode::OSDetection::getOS());
-    url_query.addQueryItem("arch", UpdateNode::OSDetection::getArch());
-    url_query.addQueryItem("lang", globalConfig->getLanguage());
-    url_query.addQueryItem("custom", globalConfig->getCustomRequestValue());
-    url_query.addQueryItem("ident", globalConfig->getIdentifier());
+/*!
+Appends a digest of the response stored in \a aCache to \a aUrl: the codes of its updates with their stored\n
+results, the codes of its messages with their state and its version code. The service answers with a delta\n
+response, see Service::merge. In a batched request, the parameters carry the suffix \a aSuffix of the product,\n
+like "known_updates_0"
+\sa Settings::getUpdateResult, Settings::getMessageState
+*/
+QUrl Service::digestUrl(const QUrl& aUrl, UpdateNode::ResponseCache* aCache, const QString& aSuffix /* = QString() */)
+{
+    UpdateNode::Settings settings;
+    QStringList updates;
+    QStringList messages;
+    QUrl url(aUrl);
 
-    if(aConfig->getVersionCode().isEmpty())
+    foreach(UpdateNode::Update update, aCache->getUpdates())
     {
-        url_query.addQueryItem("productCode", settings.getProductCode(aConfig));
-        url_query.addQueryItem("productVersion", settings.getProductVersion(aConfig));
+        QString result = settings.getUpdateResult(update.getCode());
+        updates.append(result.isEmpty() ? update.getCode() : update.getCode() + ":" + result);
     }
-    else
-        url_query.addQueryItem("versionCode", settings.getVersionCode(aConfig));
 
+    foreach(UpdateNode::Message message, aCache->getMessages())
+        messages.append(message.getCode() + ":" + QString::number(settings.getMessageState(message.getCode())));
+
+#if QT_VERSION >= 0x050000
+    QUrlQuery url_query(url);
+    url_query.addQueryItem("delta" + aSuffix, "1");
+    url_query.addQueryItem("known_version" + aSuffix, aCache->getVersion().getCode());
+    url_query.addQueryItem("known_updates" + aSuffix, updates.join(","));
+    url_query.addQueryItem("known_messages" + aSuffix, messages.join(","));
     url.setQuery(url_query);
 #else
-    url.addQueryItem("key", globalConfig->getKey());
+    url.addQueryItem("delta" + aSuffix, "1");
+    url.addQueryItem("known_version" + aSuffix, aCache->getVersion().getCode());
+    url.addQueryItem("known_updates" + aSuffix, updates.join(","));
+    url.addQueryItem("known_messages" + aSuffix, messages.join(","));
+#endif
 
-    if(!globalConfig->getTestKey().isEmpty())
-        url.addQueryItem("test", globalConfig->getTestKey());
+    return url;
+}
+
+/*!
+Merges the delta response parsed by \a aParser into the response stored in \a aCache. The changes have already\n
+been added to \a aConfig while parsing, the unchanged updates and messages of the stored response are added\n
+here, emitting the same signals as the parser
+\sa XmlParser::isDelta
+*/
+void Service::merge(UpdateNode::Config* aConfig, UpdateNode::ResponseCache* aCache, UpdateNode::XmlParser* aParser)
+{
+    QStringList updateCodes = aParser->removedUpdates();
+    QStringList messageCodes = aParser->removedMessages();
+    QList<UpdateNode::Update> updates = aParser->updates();
+    QList<UpdateNode::Message> messages = aParser->messages();
 
-    url.addQueryItem("id", settings.uuid());
-    url.addQueryItem("os", UpdateNode::OSDetection::getOS());
-    url.addQueryItem("arch", UpdateNode::OSDetection::getArch());
-    url.addQueryItem("lang", globalConfig->getLanguage());
-    url.addQueryItem("custom", globalConfig->getCustomRequestValue());
-    url.addQueryItem("ident", globalConfig->getIdentifier());
+    foreach(UpdateNode::Update update, updates)
+        updateCodes.append(update.getCode());
+    foreach(UpdateNode::Message message, messages)
+        messageCodes.append(message.getCode());
 
-    if(aConfig->getVersionCode().isEmpty())
+    foreach(UpdateNode::Update update, aCache->getUpdates())
     {
-        url.addQueryItem("productCode", settings.getProductCode(aConfig));
-        url.addQueryItem("productVersion", settings.getProductVersion(aConfig));
+        if(updateCodes.contains(update.getCode()))
+            continue;
+
+        updates.append(update);
+        aConfig->addUpdate(update);
+        emit updateParsed(aConfig, update);
     }
-    else
-        url.addQueryItem("versionCode", settings.getVersionCode(aConfig));
 
-#endif
-    request.setUrl(url);
+    foreach(UpdateNode::Message message, aCache->getMessages())
+    {
+        if(messageCodes.contains(message.getCode()))
+            continue;
+
+        messages.append(message);
+        aConfig->addMessage(message);
+    }
+
+    UpdateNode::Logging() << "Delta response: " << aParser->updates().size() << " updates and " << aParser->messages().size()
+                          << " messages changed, " << aParser->removedUpdates().size() + aParser->removedMessages().size() << " removed";
+
+    aCache->setUpdates(updates);
+    aCache->setMessages(messages);
+}
+
+/*!
+Creates the request for \a url
+*/
+QNetworkRequest Service::createRequest(const QUrl& url)
+{
+    QNetworkRequest request(url);
 
 #ifdef DEBUG
     UpdateNode::Logging() << "REQUEST: " << url.toString();
 #endif
 
     request.setRawHeader("charset", "utf-8" );
-    request.setRawHeader("User-Agent", QString("UpdateNode Client %1.%2.%3 (%4)").arg(APP_VERSION_HIGH).arg(APP_VERSION_LOW).arg(APP_VERSION_REV).arg(globalConfig->getOS()).toLatin1());
+    request.setRawHeader("User-Agent", QString("UpdateNode Client %1.%2.%3 (%4)").arg(APP_VERSION_HIGH).arg(APP_VERSION_LOW).arg(APP_VERSION_REV).arg(UpdateNode::Config::Instance()->getOS()).toLatin1());
 
-    QNetworkReply* reply = m_pManager->get(request);
+    return request;
+}
 
-    m_mapConfig[reply] = aConfig;
+/*!
+Creates the parser for the response of \a reply, filling \a aConfig, and forwards its signals
+*/
+UpdateNode::XmlParser* Service::createParser(QNetworkReply* reply, UpdateNode::Config* aConfig)
+{
+    UpdateNode::XmlParser* parser = new UpdateNode::XmlParser(this, aConfig);
+    m_mapParser[reply] = parser;
+
+    connect(parser, SIGNAL(productParsed(UpdateNode::Config*, const UpdateNode::Product&)),
+            this, SLOT(prefetchIcon(UpdateNode::Config*, const UpdateNode::Product&)));
+    connect(parser, SIGNAL(productParsed(UpdateNode::Config*, const UpdateNode::Product&)),
+            this, SIGNAL(productParsed(UpdateNode::Config*, const UpdateNode::Product&)));
+    connect(parser, SIGNAL(updateParsed(UpdateNode::Config*, const UpdateNode::Update&)),
+            this, SIGNAL(updateParsed(UpdateNode::Config*, const UpdateNode::Update&)));
+    connect(reply, SIGNAL(readyRead()), this, SLOT(dataReceived()));
+
+    return parser;
+}
 
-    return true;
+/*!
+Slot called when a part of the response has arrived. The data is passed on to the
+UpdateNode::XmlParser of the request, which emits productParsed() and updateParsed()
+for each element completed by the data.
+\n A body carrying the ETag of the stored response is not parsed at all, see Service::isNotModified.
+Otherwise the data is hashed alongside, a body equal to the stored response without an ETag is
+still parsed, since its elements have been passed on before the end of the body is known. Only
+rebuilding the stored snapshot is skipped then, see Service::requestReceived
+*/
+void Service::dataReceived()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    UpdateNode::XmlParser* parser = m_mapParser.value(reply);
+
+    if(!parser || reply->error() != QNetworkReply::NoError)
+        return;
+
+    int v = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (v < 200 || v >= 300)
+        return;
+
+    if(isNotModified(reply, m_mapCache.value(reply)))
+    {
+        reply->readAll();
+        return;
+    }
+
+    QByteArray data = reply->readAll();
+    if(m_mapBodyHash.contains(reply))
+        m_mapBodyHash.value(reply)->addData(data);
+
+    parser->addData(data);
+}
+
+/*!
+Returns true, if \a reply has been answered with the entity stored in \a aCache, although it has been
+validated with If-None-Match. Some servers and proxies answer with the full body and the same ETag
+instead of "304 Not Modified"
+*/
+bool Service::isNotModified(QNetworkReply* reply, UpdateNode::ResponseCache* aCache) const
+{
+    if(!aCache || !aCache->isLoaded() || aCache->getETag().isEmpty())
+        return false;
+
+    return reply->rawHeader("ETag") == aCache->getETag().toLatin1();
+}
+
+/*!
+Fills \a aConfig with the response stored in \a aCache, emitting the same signals as the parser.
+The product icon is only downloaded, if it is missing in Product::getLocalIcon
+\sa UpdateNode::ResponseCache
+*/
+void Service::restore(UpdateNode::Config* aConfig, UpdateNode::ResponseCache* aCache)
+{
+    m_iStatus = aCache->getStatus();
+    m_strStatus = aCache->getStatusString();
+
+    aCache->restore(aConfig);
+
+    emit productParsed(aConfig, aCache->getProduct());
+    foreach(UpdateNode::Update update, aCache->getUpdates())
+        emit updateParsed(aConfig, update);
+
+    // the icon has been downloaded along with the stored response
+    if(!QFile::exists(aCache->getProduct().getLocalIcon()))
+        prefetchIcon(aConfig, aCache->getProduct());
+}
+
+/*!
+Slot called as soon as the product definition \a aProduct of \a aConfig has been parsed. The icon is\n
+downloaded while the rest of the response is still arriving
+\sa Service::requestReceived
+*/
+void Service::prefetchIcon(UpdateNode::Config* aConfig, const UpdateNode::Product& aProduct)
+{
+    Q_UNUSED(aConfig);
+
+    if(aProduct.getIconUrl().isEmpty())
+        return;
+
+    if(!m_pDownloader)
+    {
+        m_pDownloader = new UpdateNode::Downloader();
+        connect(m_pDownloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), this, SLOT(checkDone()));
+    }
+
+    m_pDownloader->doDownload(aProduct.getIconUrl(), UpdateNode::Update());
+}
+
+/*!
+Emits done() for single app mode, or doneManager() for multi app mode, once all requests\n
+have been returned and all icons have been downloaded
+*/
+void Service::checkDone()
+{
+    if(!m_mapConfig.isEmpty() || !m_mapBatch.isEmpty() || (m_pDownloader && m_pDownloader->isDownloading()))
+        return;
+
+    if(UpdateNode::Config::Instance()->isSingleMode())
+        emit done();
+    else
+        emit doneManager();
+}
+
+/*!
+Slot called when a reply of Service::checkForUpdates has finished
+\sa Service::requestReceived
+*/
+void Service::replyFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+
+    if(m_mapBatch.contains(reply))
+        batchReceived(reply);
+    else
+        requestReceived(reply);
+}
+
+/*!
+Slot called when the response for \a aConfig within a batched response has been parsed.\n
+Complete responses are stored for Service::checkForUpdates(UpdateNode::Config* aConfig)
+\sa UpdateNode::ResponseCache
+*/
+void Service::batchResponseParsed(UpdateNode::Config* aConfig, int aStatus, const QString& aStatusString, bool aComplete)
+{
+    UpdateNode::XmlParser* parser = qobject_cast<UpdateNode::XmlParser*>(sender());
+    QNetworkReply* reply = m_mapParser.key(parser);
+
+    // an incomplete response is requested again, see Service::batchReceived
+    if(!aComplete && aStatus == 0)
+        return;
+
+    // a delta response is completed by the stored response, without it the product is requested again
+    UpdateNode::ResponseCache cache(requestUrl(QList<UpdateNode::Config*>() << aConfig));
+    bool delta = aStatus == 0 && parser->isDelta();
+    if(delta && !cache.load())
+    {
+        UpdateNode::Logging() << "Delta response without a stored response for " << aConfig->getProductCode();
+        return;
+    }
+
+    m_mapBatch[reply].removeAll(aConfig);
+
+    if(aStatus != 0 || m_iStatus < 0)
+    {
+        m_iStatus = aStatus;
+        m_strStatus = aStatusString;
+    }
+    UpdateNode::Logging() << "UpdateNode RESULT: " << aStatusString << "(" << aStatus << ")";
+
+    if(aStatus != 0)
+        return;
+
+    if(delta)
+        merge(aConfig, &cache, parser);
+    else
+    {
+        cache.setUpdates(parser->updates());
+        cache.setMessages(parser->messages());
+    }
+
+    // the validators and the body hash belong to the whole batch, they are not stored for the product
+    cache.setValidators(QString(), QString());
+    cache.setBodyHash(QString());
+    cache.setStatus(aStatus, aStatusString);
+    cache.setProduct(parser->product());
+    cache.setVersion(parser->version());
+    cache.save();
+}
+
+/*!
+Slot called when a batched request has been returned. Products without a response in the batch\n
+are checked with a request of their own. If the service does not answer with a <batch> element,\n
+batched requests are not used again.
+\sa Service::checkForUpdates(const QList<UpdateNode::Config*>& aConfigs)
+*/
+void Service::batchReceived(QNetworkReply* reply)
+{
+    reply->deleteLater();
+
+    UpdateNode::XmlParser* parser = m_mapParser.value(reply);
+    parser->deleteLater();
+
+    bool received = false;
+    if(reply->error() == QNetworkReply::NoError)
+    {
+        int v = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (v >= 200 && v < 300) // Success
+        {
+            received = true;
+            parser->addData(reply->readAll());
+            parser->finish();
+        }
+    }
+    else
+        UpdateNode::Logging() << "ERROR: " << reply->errorString();
+
+    m_mapParser.remove(reply);
+    QList<UpdateNode::Config*> missing = m_mapBatch.take(reply);
+
+#ifndef UNITTEST
+    if(m_iStatus > 0)
+    {
+        qApp->exit(UPDATENODE_PROCERROR_SERVICE_ERROR);
+        return;
+    }
+#endif
+
+    if(received && !parser->isBatch())
+    {
+        UpdateNode::Logging() << "Batched requests are not supported, checking each product on its own";
+        m_bBatchUnsupported = true;
+    }
+
+    foreach(UpdateNode::Config* config, missing)
+    {
+        // drop what has been parsed from an incomplete response
+        if(parser->isBatch())
+            config->clear();
+        checkForUpdates(config);
+    }
+
+    checkDone();
 }
 
 /*!
@@ -200,28 +628,78 @@ Slot called when the request has been returned. Emits done() for single app mode
 for multi app mode.
 \note If the returned product definition contains an icon, the signal is emitted after the icon\n
 has been downloaded
+\sa Service::checkDone
 */
 void Service::requestReceived(QNetworkReply* reply)
 {
     reply->deleteLater();
 
     UpdateNode::Config* config = m_mapConfig[reply];
+    UpdateNode::XmlParser* parser = m_mapParser.take(reply);
+    UpdateNode::ResponseCache* cache = m_mapCache.take(reply);
+    QCryptographicHash* hash = m_mapBodyHash.take(reply);
+    parser->deleteLater();
 
     if(reply->error() == QNetworkReply::NoError)
     {
         int v = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-        if (v >= 200 && v < 300) // Success
+        if (v == 304 && cache->isLoaded()) // Not modified
+        {
+            UpdateNode::Logging() << "UpdateNode RESULT: not modified";
+            restore(config, cache);
+            cache->save();
+        }
+        else if (v >= 200 && v < 300 && isNotModified(reply, cache)) // Same entity, the body has not been parsed
         {
-            QString replyText = QString::fromUtf8(reply->readAll());
+            UpdateNode::Logging() << "UpdateNode RESULT: unchanged";
+            restore(config, cache);
+            cache->save();
+        }
+        else if (v >= 200 && v < 300) // Success
+        {
+            QByteArray data = reply->readAll();
+            hash->addData(data);
+            parser->addData(data);
+            QString bodyHash = QString::fromLatin1(hash->result().toHex());
 
-            UpdateNode::XmlParser* parser = new UpdateNode::XmlParser(this, config);
-            parser->parse(replyText);
+            cache->setValidators(QString::fromLatin1(reply->rawHeader("ETag")), QString::fromLatin1(reply->rawHeader("Last-Modified")));
+
+            bool valid = parser->finish();
             m_strStatus = parser->getStatusString();
             m_iStatus = parser->getStatus();
             UpdateNode::Logging() << "UpdateNode RESULT: " << parser->getStatusString() << "(" << parser->getStatus() << ")";
+
+            if(valid && parser->getStatus() == 0)
+            {
+                // the same body as stored, the snapshot is kept and only its time and validators are renewed
+                bool unchanged = cache->isLoaded() && bodyHash == cache->getBodyHash();
+                if(unchanged)
+                    UpdateNode::Logging() << "UpdateNode RESULT: unchanged";
+
+                if(parser->isDelta() && cache->isLoaded())
+                    merge(config, cache, parser);
+                else if(!unchanged)
+                {
+                    cache->setUpdates(parser->updates());
+                    cache->setMessages(parser->messages());
+                }
+
+                if(!unchanged)
+                {
+                    cache->setBodyHash(bodyHash);
+                    cache->setStatus(parser->getStatus(), parser->getStatusString());
+                    cache->setProduct(parser->product());
+                    cache->setVersion(parser->version());
+                }
+                cache->save();
+            }
+            else
+                cache->remove();
 #ifndef UNITTEST
-            if(parser->getStatus()!=0)
+            if(m_iStatus!=0)
             {
+                delete cache;
+                delete hash;
                 qApp->exit(UPDATENODE_PROCERROR_SERVICE_ERROR);
                 return;
             }
@@ -231,6 +709,8 @@ void Service::requestReceived(QNetworkReply* reply)
         {
             // Error
             UpdateNode::Logging() << "ERROR: Redirection not supported";
+            delete cache;
+            delete hash;
             return;
         }
     }
@@ -240,27 +720,12 @@ void Service::requestReceived(QNetworkReply* reply)
         UpdateNode::Logging() << "ERROR: " << reply->errorString();
     }
 
-    m_mapConfig.remove(reply);
-
-    if(reply->error() == QNetworkReply::NoError && !config->product().getIconUrl().isEmpty())
-    {
-        if(!m_pDownloader)
-            m_pDownloader = new UpdateNode::Downloader();
+    delete cache;
+    delete hash;
 
-        if(UpdateNode::Config::Instance()->isSingleMode())
-            connect(m_pDownloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), this, SIGNAL(done()));
-        else if(m_mapConfig.size()==0)
-            connect(m_pDownloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), this, SIGNAL(doneManager()));
+    m_mapConfig.remove(reply);
 
-        m_pDownloader->doDownload(config->product().getIconUrl(), UpdateNode::Update());
-    }
-    else
-    {
-        if(UpdateNode::Config::Instance()->isSingleMode())
-            emit done();
-        else if(m_mapConfig.size()==0)
-            emit doneManager();
-    }
+    checkDone();
 }
 
 /*!
@@ -381,22 +846,6 @@ QString Service::notificationTextManager()
     return text;
 }
 
-/*!
-Slot called on SSL errors
-*/
-void Service::onSslError(QNetworkReply *reply, const QList<QSslError>& errors)
-{
-    QSslError error(QSslError::NoError);
-
-    foreach(QSslError error, errors)
-        if(error.error() != QSslError::NoError)
-            UpdateNode::Logging() << error.errorString();
-
-    QList<QSslError> expectedSslErrors;
-    expectedSslErrors.append(error);
-    reply->ignoreSslErrors(expectedSslErrors);
-}
-
 /*!
 Returns the service status error code
 */
@@ -24,6 +24,7 @@
 #include "config.h"
 #include "settings.h"
 #include "localfile.h"
+#include "networksession.h"
 
 #ifdef QT_WEBKIT_LIB
 #include "qglobal.h"
@@ -59,9 +60,11 @@ UserMessages::UserMessages(QWidget *parent) :
 
 	m_bFromRight = false;
 
+#ifdef QT_WEBKIT_LIB
+    // share connections and TLS sessions with the update check, only the message view uses the cache
     QNetworkDiskCache* cache = new QNetworkDiskCache(this);
     cache->setCacheDirectory(UpdateNode::LocalFile::getCachePath());
-#ifdef QT_WEBKIT_LIB
+    ui->webView->page()->setNetworkAccessManager(UpdateNode::NetworkSession::Instance()->manager());
     ui->webView->page()->networkAccessManager()->setCache(cache);
     ui->webView->page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
     connect(ui->webView, SIGNAL(linkClicked(const QUrl&)), SLOT(openLink(const QUrl&)));
@@ -82,7 +85,8 @@ UserMessages::UserMessages(QWidget *parent) :
 UserMessages::~UserMessages()
 {
 #ifdef QT_WEBKIT_LIB
-    delete ui->webView->page()->networkAccessManager()->cache();
+    // deletes the cache
+    ui->webView->page()->networkAccessManager()->setCache(NULL);
 #endif
     delete ui;
 }
@@ -91,11 +95,6 @@ void UserMessages::init(UpdateNode::Service* aService)
 {
     m_pService = aService;
     connect(m_pService, SIGNAL(done()), SLOT(serviceDone()));
-
-#ifdef QT_WEBKIT_LIB
-    connect(ui->webView->page()->networkAccessManager(), SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)),
-            m_pService, SLOT(onSslError(QNetworkReply*,QList<QSslError>)));
-#endif
 }
 
 void UserMessages::serviceDone()
@@ -22,18 +22,32 @@
 
 #include <stdlib.h>
 #include <QString>
+#include <QHash>
 #include "logging.h"
-#include <QDomElement>
 #include "xmlparser.h"
 
 using namespace UpdateNode;
 
+// the sections every response has to contain
+#define SECTION_STATUS      0x01
+#define SECTION_PRODUCT     0x02
+#define SECTION_VERSION     0x04
+#define SECTION_UPDATES     0x08
+#define SECTION_MESSAGES    0x10
+#define SECTION_ALL         0x1f
+
+// optional section of a delta response, see XmlParser::isDelta
+#define SECTION_REMOVED     0x20
+
 /*!
 \class UpdateNode::XmlParser
 \brief Class to parse the returned xml data returned by UpdateNode.com
 \n\n
 UpdateNode::XmlParser is parsing the xml data and filling the data into the provided
 UpdateNode::Config configuration.
+\n The data is read in a single pass using QXmlStreamReader, without building a document tree.
+It may be fed in chunks while it arrives with XmlParser::addData, each product, update and message
+is signaled as soon as its element is complete.
 */
 
 /*!
@@ -42,8 +56,16 @@ Constructs an empty XmlParser object.
 XmlParser::XmlParser(QObject* parent, UpdateNode::Config* aConfig)
     : QObject(parent)
 {
-    m_pDocument = NULL;
+    m_iStatus = -1;
     m_pConfig = aConfig;
+    m_iSections = 0;
+    m_iSectionDepth = 0;
+    m_eSection = TAG_UNKNOWN;
+    m_bSkipSection = false;
+    m_iTextDepth = 0;
+    m_iResponseDepth = 0;
+    m_bBatch = false;
+    m_bDelta = false;
 }
 
 /*!
@@ -51,8 +73,6 @@ Desctructs a XmlParser object.
 */
 XmlParser::~XmlParser()
 {
-    if(m_pDocument)
-        delete m_pDocument;
 }
 
 /*!
@@ -75,258 +95,443 @@ The method returns true if xml is valid and all parts have been parsed correctly
 */
 bool XmlParser::parse(const QString& aXmlData)
 {
-    QString errorMsg;
-    int errorLine;
-    int errorColumn;
-
-    m_pDocument = new QDomDocument();
-
-    if(m_pDocument->setContent(aXmlData, &errorMsg, &errorLine, &errorColumn))
-    {
-        if(!parseStatus() || !parseProduct() || !parseVersion() || !parseUpdates() || !parseMessages())
-            return false;
-    }
-    else
-    {
-        UpdateNode::Logging() << "ERROR: " << errorMsg << "(Line " << errorLine << " - Column " << errorColumn << ")";
-        return false;
-    }
+    m_oReader.addData(aXmlData);
 
-    return true;
+    return process() && finish();
 }
 
 /*!
- * XmlParser::parseStatus is reading the status block
- * \return true on success, otherwise false
- * \sa UpdateNode::XmlParser::getStatus
- * \sa UpdateNode::XmlParser::getStatusString
- */
-bool XmlParser::parseStatus()
+Parses the raw (encoded) xml data \a aXmlData, without converting it to a QString first
+\sa XmlParser::parse(const QString&)
+*/
+bool XmlParser::parse(const QByteArray& aXmlData)
 {
-    QDomNodeList list = m_pDocument->elementsByTagName("status");
-
-    if(list.isEmpty())
-        return false;
-
-    QDomNode status = list.at(0);
-
-    QDomNode n = status.firstChild();
-    while(!n.isNull())
-    {
-        QDomElement e = n.toElement();
-
-        if(e.tagName()=="code")
-            m_iStatus = e.text().toInt();
-        else if(e.tagName()=="message")
-            m_strStatus = e.text();
-
-        n = n.nextSibling();
-    }
-
-    return true;
+    return addData(aXmlData) && finish();
 }
 
 /*!
- * XmlParser::parseProduct is reading the product block
- * \return true on success, otherwise false
- */
- bool XmlParser::parseProduct()
+Parses the xml data read from \a aDevice, e.g. a finished QNetworkReply
+\sa XmlParser::parse(const QString&)
+*/
+bool XmlParser::parse(QIODevice* aDevice)
 {
-    QDomNodeList list = m_pDocument->elementsByTagName("product");
-
-    if(list.isEmpty())
-        return false;
+    return addData(aDevice->readAll()) && finish();
+}
 
-    UpdateNode::Product product;
+/*!
+Feeds the next chunk \a aData of the xml data into the parser, e.g. on QNetworkReply::readyRead.
+\n Every element which is complete afterwards is parsed and signaled right away, the remaining
+data is kept until the next call. Call XmlParser::finish once all data has been added.
+\n Returns false if the data added so far is not well-formed
+\sa XmlParser::productParsed, XmlParser::updateParsed, XmlParser::messageParsed
+*/
+bool XmlParser::addData(const QByteArray& aData)
+{
+    m_oReader.addData(aData);
 
-    QDomNode productNode = list.at(0);
+    return process();
+}
 
-    QDomNode n = productNode.firstChild();
-    while(!n.isNull())
+/*!
+Ends the parsing started with XmlParser::addData
+\n Returns true if the xml data is complete and all parts have been parsed correctly, otherwise false.
+For a batched response, true is returned if the data is complete and contains a <batch> element
+*/
+bool XmlParser::finish()
+{
+    if(m_oReader.error() == QXmlStreamReader::PrematureEndOfDocumentError)
     {
-        QDomElement e = n.toElement();
-
-        if(e.tagName()=="code")
-            product.setCode(e.text());
-        else if(e.tagName()=="name")
-            product.setName(e.text());
-        else if(e.tagName()=="image")
-            product.setIconUrl(e.text());
-
-        n = n.nextSibling();
+        UpdateNode::Logging() << "ERROR: Incomplete response (Line " << (int)m_oReader.lineNumber() << " - Column " << (int)m_oReader.columnNumber() << ")";
+        return false;
     }
 
-    m_pConfig->setProduct(product);
+    if(!m_listBatch.isEmpty())
+        return !m_oReader.hasError() && m_bBatch;
 
-    return true;
+    return !m_oReader.hasError() && (m_iSections & SECTION_ALL) == SECTION_ALL;
 }
 
 /*!
-* XmlParser::parseVersion a common method for reading the version block
-* \return UpdateNode::ProductVersion
+Expects a batched response for \a aConfigs: a <batch> element containing a <response index="..."> element
+for each product, in the format of a single response. Each response fills the configuration at its index,
+and responseParsed() is emitted at its end
+\sa Service::checkForUpdates(const QList<UpdateNode::Config*>&)
 */
-UpdateNode::ProductVersion XmlParser::parseVersion(QDomNode aNode)
+void XmlParser::setBatch(const QList<UpdateNode::Config*>& aConfigs)
 {
-    UpdateNode::ProductVersion version;
-
-    QDomNode n = aNode.firstChild();
-    while(!n.isNull())
-    {
-        QDomElement e = n.toElement();
-
-        if(e.tagName()=="code")
-            version.setCode(e.text());
-        else if(e.tagName()=="name")
-            version.setName(e.text());
-        else if(e.tagName()=="version")
-            version.setVersion(e.text());
-
-        n = n.nextSibling();
-    }
-
-    return version;
+    m_listBatch = aConfigs;
+    m_pConfig = NULL;
 }
 
 /*!
-* XmlParser::parseVersion is reading the current version block
-* \return true on success, otherwise false
+Returns true if a <batch> element has been found, i.e. the service supports batched requests
 */
-bool XmlParser::parseVersion()
+bool XmlParser::isBatch() const
 {
-    QDomNodeList list = m_pDocument->elementsByTagName("version");
-
-    if(list.isEmpty())
-        return false;
-
-    QDomNode versionNode = list.at(0);
-
-    UpdateNode::ProductVersion version = parseVersion(versionNode);
-
-    m_pConfig->setVersion(version);
+    return m_bBatch;
+}
 
-    return true;
+/*!
+Returns true if the response is a delta response (<updatenode delta="1">). It only contains the updates and\n
+messages which are new or have changed, and the codes of the ones which have been removed in a <removed> section.\n
+Within a batch, each response is a delta response of its own (<response index="..." delta="1">)
+\sa XmlParser::removedUpdates, XmlParser::removedMessages, Config::setDeltaSync
+*/
+bool XmlParser::isDelta() const
+{
+    return m_bDelta;
 }
 
 /*!
-* XmlParser::parseUpdate is reading a single update block
-* \return UpdateNode::Update
+Processes all tokens available in the reader
+\n Returns false on a parse error. Running out of data is not an error, the parser
+continues with the next XmlParser::addData call
 */
-UpdateNode::Update XmlParser::parseUpdate(QDomNode aNode)
+bool XmlParser::process()
 {
-    UpdateNode::Update update;
+    while(!m_oReader.atEnd())
+    {
+        switch(m_oReader.readNext())
+        {
+            case QXmlStreamReader::StartElement:
+                m_listPath.append(tag(m_oReader));
+                startElement(m_listPath.last());
+                break;
+            case QXmlStreamReader::Characters:
+                if(m_iTextDepth > 0)
+                    m_strText += m_oReader.text().toString();
+                break;
+            case QXmlStreamReader::EndElement:
+            {
+                // only the field collecting text gets it, including the text of markup within it
+                QString text;
+                if(m_listPath.size() == m_iTextDepth)
+                {
+                    text = m_strText;
+                    m_strText.clear();
+                    m_iTextDepth = 0;
+                }
+
+                endElement(m_listPath.last(), text);
+                m_listPath.removeLast();
+                break;
+            }
+            default:
+                break;
+        }
+    }
 
-    QDomNode n = aNode.firstChild();
-    while(!n.isNull())
+    if(m_oReader.hasError() && m_oReader.error() != QXmlStreamReader::PrematureEndOfDocumentError)
     {
-        QDomElement e = n.toElement();
-
-        if(e.tagName()=="title")
-            update.setTitle(e.text());
-        else if(e.tagName()=="code")
-            update.setCode(e.text());
-        else if(e.tagName()=="description")
-            update.setDescription(e.text());
-        else if(e.tagName()=="type")
-            update.setType(e.text().toInt());
-        else if(e.tagName()=="file")
-            update.setDownloadLink(e.text());
-        else if(e.tagName()=="command")
-            update.setCommand(e.text());
-        else if(e.tagName()=="commandline")
-            update.setCommandLine(e.text());
-        else if(e.tagName()=="requires_admin")
-            update.setRequiresAdmin(e.text().toInt()==1);
-        else if(e.tagName()=="mandatory")
-            update.setMandatory(e.text().toInt()==1);
-        else if(e.tagName()=="file_size")
-            update.setFileSize(e.text());
-        else if(e.tagName()=="target")
-            update.setTargetVersion(parseVersion(n));
-
-        n = n.nextSibling();
+        UpdateNode::Logging() << "ERROR: " << m_oReader.errorString() << "(Line " << (int)m_oReader.lineNumber() << " - Column " << (int)m_oReader.columnNumber() << ")";
+        return false;
     }
 
-    return update;
+    return true;
 }
 
 /*!
-* XmlParser::parseMessage is reading a single message block
-* \return UpdateNode::Message
+Called for each start element \a aTag, with XmlParser::m_listPath already containing \a aTag.
+Any element within a section, except for the <update>, <target> and <message> elements holding fields, is a field:
+its text is collected, including the text of markup within it
 */
-UpdateNode::Message XmlParser::parseMessage(QDomNode aNode)
+void XmlParser::startElement(Tag aTag)
 {
-    UpdateNode::Message message;
+    int depth = m_listPath.size();
+
+    if(depth == 1)
+        m_bDelta = m_oReader.attributes().value("delta").toString() == "1";
+
+    if(!m_listBatch.isEmpty() && m_eSection == TAG_UNKNOWN)
+    {
+        if(aTag == TAG_BATCH)
+        {
+            m_bBatch = true;
+            return;
+        }
+
+        // each response of a batch starts from scratch, for the configuration at its index
+        if(aTag == TAG_RESPONSE && m_bBatch)
+        {
+            bool ok;
+            int index = m_oReader.attributes().value("index").toString().toInt(&ok);
+
+            m_pConfig = ok && index >= 0 && index < m_listBatch.size() ? m_listBatch.at(index) : NULL;
+            m_bDelta = m_oReader.attributes().value("delta").toString() == "1";
+            m_iResponseDepth = depth;
+            m_iSections = 0;
+            m_iStatus = -1;
+            m_strStatus.clear();
+            m_oProduct = UpdateNode::Product();
+            m_oVersion = UpdateNode::ProductVersion();
+            m_listUpdates.clear();
+            m_listMessages.clear();
+            m_listRemovedUpdates.clear();
+            m_listRemovedMessages.clear();
+            return;
+        }
+    }
+
+    // in a batch, sections outside of a response are ignored
+    if(!m_pConfig)
+        return;
 
-    QDomNode n = aNode.firstChild();
-    while(!n.isNull())
+    // a section starts with the first occurence of its tag, outside of any other section
+    if(m_eSection == TAG_UNKNOWN)
     {
-        QDomElement e = n.toElement();
-
-        if(e.tagName()=="title")
-            message.setTitle(e.text());
-        else if(e.tagName()=="code")
-            message.setCode(e.text());
-        else if(e.tagName()=="message")
-            message.setMessage(e.text());
-        else if(e.tagName()=="link")
-            message.setLink(e.text());
-        else if(e.tagName()=="external_link")
-            message.setOpenExternal(e.text().toInt()==1);
-
-        n = n.nextSibling();
+        int section = 0;
+        switch(aTag)
+        {
+            case TAG_STATUS:    section = SECTION_STATUS; break;
+            case TAG_PRODUCT:   section = SECTION_PRODUCT; break;
+            case TAG_VERSION:   section = SECTION_VERSION; break;
+            case TAG_UPDATES:   section = SECTION_UPDATES; break;
+            case TAG_MESSAGES:  section = SECTION_MESSAGES; break;
+            case TAG_REMOVED:   section = SECTION_REMOVED; break;
+            default:            return;
+        }
+
+        m_eSection = aTag;
+        m_iSectionDepth = depth;
+        m_bSkipSection = (m_iSections & section) != 0;
+
+        if(aTag == TAG_PRODUCT)
+            m_oProduct = UpdateNode::Product();
+        else if(aTag == TAG_VERSION)
+            m_oVersion = UpdateNode::ProductVersion();
+
+        return;
     }
 
-    return message;
+    // markup within the text of a field
+    if(m_bSkipSection || m_iTextDepth > 0)
+        return;
+
+    if(m_eSection == TAG_UPDATES && depth == m_iSectionDepth + 1 && aTag == TAG_UPDATE)
+        m_oUpdate = UpdateNode::Update();
+    else if(m_eSection == TAG_UPDATES && depth == m_iSectionDepth + 2 && aTag == TAG_TARGET)
+        m_oTarget = UpdateNode::ProductVersion();
+    else if(m_eSection == TAG_MESSAGES && depth == m_iSectionDepth + 1 && aTag == TAG_MESSAGE)
+        m_oMessage = UpdateNode::Message();
+    else
+        m_iTextDepth = depth;
 }
 
 /*!
-* XmlParser::parseUpdates is parsing all updates
-* \return true on success, otherwise false
+Called for each end element \a aTag with its text \a aText, with XmlParser::m_listPath still containing \a aTag.
+\a aText is empty for all elements but fields, see XmlParser::startElement
 */
-bool XmlParser::parseUpdates()
+void XmlParser::endElement(Tag aTag, const QString& aText)
 {
-    QDomNodeList list = m_pDocument->elementsByTagName("updates");
+    if(aTag == TAG_RESPONSE && m_pConfig && !m_listBatch.isEmpty() && m_listPath.size() == m_iResponseDepth)
+    {
+        emit responseParsed(m_pConfig, m_iStatus, m_strStatus, (m_iSections & SECTION_ALL) == SECTION_ALL);
+        m_pConfig = NULL;
+        return;
+    }
 
-    if(list.isEmpty())
-        return false;
+    if(m_eSection == TAG_UNKNOWN)
+        return;
 
-    QDomNode n = list.at(0).firstChild();
-    while(!n.isNull())
+    int level = m_listPath.size() - m_iSectionDepth;
+    Tag parent = level > 0 ? m_listPath.at(m_listPath.size() - 2) : TAG_UNKNOWN;
+
+    if(level == 0)
     {
-        QDomElement e = n.toElement();
+        bool skipped = m_bSkipSection;
+        m_eSection = TAG_UNKNOWN;
+        m_bSkipSection = false;
+
+        if(skipped)
+            return;
+
+        switch(aTag)
+        {
+            case TAG_STATUS:
+                m_iSections |= SECTION_STATUS;
+                break;
+            case TAG_PRODUCT:
+                m_iSections |= SECTION_PRODUCT;
+                m_pConfig->setProduct(m_oProduct);
+                emit productParsed(m_pConfig, m_oProduct);
+                break;
+            case TAG_VERSION:
+                m_iSections |= SECTION_VERSION;
+                m_pConfig->setVersion(m_oVersion);
+                emit versionParsed(m_pConfig, m_oVersion);
+                break;
+            case TAG_UPDATES:
+                m_iSections |= SECTION_UPDATES;
+                break;
+            case TAG_MESSAGES:
+                m_iSections |= SECTION_MESSAGES;
+                break;
+            case TAG_REMOVED:
+                m_iSections |= SECTION_REMOVED;
+                break;
+            default:
+                break;
+        }
+        return;
+    }
 
-        if(e.tagName()=="update")
-            m_pConfig->addUpdate(parseUpdate(n));
+    if(m_bSkipSection)
+        return;
 
-        n = n.nextSibling();
+    switch(m_eSection)
+    {
+        case TAG_STATUS:
+            if(level != 1)
+                break;
+            switch(aTag)
+            {
+                case TAG_CODE:      m_iStatus = aText.toInt(); break;
+                case TAG_MESSAGE:   m_strStatus = aText; break;
+                default:            break;
+            }
+            break;
+
+        case TAG_PRODUCT:
+            if(level != 1)
+                break;
+            switch(aTag)
+            {
+                case TAG_CODE:      m_oProduct.setCode(aText); break;
+                case TAG_NAME:      m_oProduct.setName(aText); break;
+                case TAG_IMAGE:     m_oProduct.setIconUrl(aText); break;
+                default:            break;
+            }
+            break;
+
+        case TAG_UPDATES:
+            if(level == 1 && aTag == TAG_UPDATE)
+            {
+                m_pConfig->addUpdate(m_oUpdate);
+                m_listUpdates.append(m_oUpdate);
+                emit updateParsed(m_pConfig, m_oUpdate);
+            }
+            else if(level == 2 && parent == TAG_UPDATE)
+            {
+                switch(aTag)
+                {
+                    case TAG_TITLE:             m_oUpdate.setTitle(aText); break;
+                    case TAG_CODE:              m_oUpdate.setCode(aText); break;
+                    case TAG_DESCRIPTION:       m_oUpdate.setDescription(aText); break;
+                    case TAG_TYPE:              m_oUpdate.setType(aText.toInt()); break;
+                    case TAG_FILE:              m_oUpdate.setDownloadLink(aText); break;
+                    case TAG_COMMAND:           m_oUpdate.setCommand(aText); break;
+                    case TAG_COMMANDLINE:       m_oUpdate.setCommandLine(aText); break;
+                    case TAG_REQUIRES_ADMIN:    m_oUpdate.setRequiresAdmin(aText.toInt()==1); break;
+                    case TAG_MANDATORY:         m_oUpdate.setMandatory(aText.toInt()==1); break;
+                    case TAG_FILE_SIZE:         m_oUpdate.setFileSize(aText); break;
+                    case TAG_FILE_HASH:         m_oUpdate.setFileHash(aText); break;
+                    case TAG_PATCH:             m_oUpdate.setPatchLink(aText); break;
+                    case TAG_PATCH_BASE_HASH:   m_oUpdate.setPatchBaseHash(aText); break;
+                    case TAG_MIRROR:            m_oUpdate.addMirror(aText); break;
+                    case TAG_INDEPENDENT:       m_oUpdate.setIndependent(aText.toInt()==1); break;
+                    case TAG_TARGET:            m_oUpdate.setTargetVersion(m_oTarget); break;
+                    default:                    break;
+                }
+            }
+            else if(level == 3 && parent == TAG_TARGET)
+            {
+                switch(aTag)
+                {
+                    case TAG_CODE:      m_oTarget.setCode(aText); break;
+                    case TAG_NAME:      m_oTarget.setName(aText); break;
+                    case TAG_VERSION:   m_oTarget.setVersion(aText); break;
+                    default:            break;
+                }
+            }
+            break;
+
+        case TAG_MESSAGES:
+            if(level == 1 && aTag == TAG_MESSAGE)
+            {
+                m_pConfig->addMessage(m_oMessage);
+                m_listMessages.append(m_oMessage);
+                emit messageParsed(m_pConfig, m_oMessage);
+            }
+            else if(level == 2 && parent == TAG_MESSAGE)
+            {
+                switch(aTag)
+                {
+                    case TAG_TITLE:         m_oMessage.setTitle(aText); break;
+                    case TAG_CODE:          m_oMessage.setCode(aText); break;
+                    case TAG_MESSAGE:       m_oMessage.setMessage(aText); break;
+                    case TAG_LINK:          m_oMessage.setLink(aText); break;
+                    case TAG_EXTERNAL_LINK: m_oMessage.setOpenExternal(aText.toInt()==1); break;
+                    default:                break;
+                }
+            }
+            break;
+
+        case TAG_VERSION:
+            if(level != 1)
+                break;
+            switch(aTag)
+            {
+                case TAG_CODE:      m_oVersion.setCode(aText); break;
+                case TAG_NAME:      m_oVersion.setName(aText); break;
+                case TAG_VERSION:   m_oVersion.setVersion(aText); break;
+                default:            break;
+            }
+            break;
+
+        case TAG_REMOVED:
+            if(level == 1 && aTag == TAG_UPDATE)
+                m_listRemovedUpdates.append(aText.trimmed());
+            else if(level == 1 && aTag == TAG_MESSAGE)
+                m_listRemovedMessages.append(aText.trimmed());
+            break;
+
+        default:
+            break;
     }
-
-    return true;
 }
 
 /*!
-* XmlParser::parseMessages is parsing all messages
-* \return true on success, otherwise false
+Returns the Tag of the current element of \a aReader
 */
-bool XmlParser::parseMessages()
+XmlParser::Tag XmlParser::tag(const QXmlStreamReader& aReader)
 {
-    QDomNodeList list = m_pDocument->elementsByTagName("messages");
-
-    if(list.isEmpty())
-        return false;
+    static QHash<QString, Tag> tags;
 
-    QDomNode n = list.at(0).firstChild();
-    while(!n.isNull())
+    if(tags.isEmpty())
     {
-        QDomElement e = n.toElement();
-
-        if(e.tagName()=="message")
-            m_pConfig->addMessage(parseMessage(n));
-
-        n = n.nextSibling();
+        tags.insert("status", TAG_STATUS);
+        tags.insert("product", TAG_PRODUCT);
+        tags.insert("version", TAG_VERSION);
+        tags.insert("updates", TAG_UPDATES);
+        tags.insert("update", TAG_UPDATE);
+        tags.insert("messages", TAG_MESSAGES);
+        tags.insert("message", TAG_MESSAGE);
+        tags.insert("code", TAG_CODE);
+        tags.insert("name", TAG_NAME);
+        tags.insert("image", TAG_IMAGE);
+        tags.insert("title", TAG_TITLE);
+        tags.insert("description", TAG_DESCRIPTION);
+        tags.insert("type", TAG_TYPE);
+        tags.insert("file", TAG_FILE);
+        tags.insert("command", TAG_COMMAND);
+        tags.insert("commandline", TAG_COMMANDLINE);
+        tags.insert("requires_admin", TAG_REQUIRES_ADMIN);
+        tags.insert("mandatory", TAG_MANDATORY);
+        tags.insert("file_size", TAG_FILE_SIZE);
+        tags.insert("file_hash", TAG_FILE_HASH);
+        tags.insert("patch", TAG_PATCH);
+        tags.insert("patch_base_hash", TAG_PATCH_BASE_HASH);
+        tags.insert("target", TAG_TARGET);
+        tags.insert("link", TAG_LINK);
+        tags.insert("external_link", TAG_EXTERNAL_LINK);
+        tags.insert("batch", TAG_BATCH);
+        tags.insert("response", TAG_RESPONSE);
+        tags.insert("removed", TAG_REMOVED);
+        tags.insert("mirror", TAG_MIRROR);
+        tags.insert("independent", TAG_INDEPENDENT);
     }
 
-    return true;
+    return tags.value(aReader.name().toString(), TAG_UNKNOWN);
 }
 
 /*!
@@ -347,3 +552,50 @@ QString XmlParser::getStatusString()
     return m_strStatus;
 }
 
+/*!
+* XmlParser::product returns the parsed product
+*/
+UpdateNode::Product XmlParser::product() const
+{
+    return m_oProduct;
+}
+
+/*!
+* XmlParser::version returns the parsed current version
+*/
+UpdateNode::ProductVersion XmlParser::version() const
+{
+    return m_oVersion;
+}
+
+/*!
+* XmlParser::updates returns all updates parsed so far
+*/
+QList<UpdateNode::Update> XmlParser::updates() const
+{
+    return m_listUpdates;
+}
+
+/*!
+* XmlParser::messages returns all messages parsed so far
+*/
+QList<UpdateNode::Message> XmlParser::messages() const
+{
+    return m_listMessages;
+}
+
+/*!
+* XmlParser::removedUpdates returns the codes of the updates removed by a delta response
+*/
+QStringList XmlParser::removedUpdates() const
+{
+    return m_listRemovedUpdates;
+}
+
+/*!
+* XmlParser::removedMessages returns the codes of the messages removed by a delta response
+*/
+QStringList XmlParser::removedMessages() const
+{
+    return m_listRemovedMessages;
+}
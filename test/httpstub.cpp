@@ -0,0 +1,294 @@
+#include <QCryptographicHash>
+#include <QStringList>
+
+#include "httpstub.h"
+
+#define HTTPSTUB_TICK 10
+
+HttpStub::HttpStub(QObject* aParent /* = 0 */)
+    : QTcpServer(aParent)
+{
+    m_bRanges = true;
+    m_bKeepAlive = false;
+    m_bConditional = true;
+    m_iRate = 0;
+    m_iFailures = 0;
+    m_iUnavailable = 0;
+    m_iRequests = 0;
+    m_iConnections = 0;
+
+    connect(this, SIGNAL(newConnection()), SLOT(onNewConnection()));
+    connect(&m_oTimer, SIGNAL(timeout()), SLOT(onTick()));
+}
+
+/*!
+Serves \a aPayload for requests on \a aPath
+*/
+void HttpStub::setPayload(const QByteArray& aPayload, const QString& aPath /* = "/payload.bin" */)
+{
+    m_oPayloads[aPath] = aPayload;
+}
+
+/*!
+Enables or disables support for range requests
+*/
+void HttpStub::setRangeSupport(bool aEnable)
+{
+    m_bRanges = aEnable;
+}
+
+/*!
+Limits each connection to \a aBytesPerSecond, 0 disables the limit. This simulates
+a TCP stream on a high latency link, which cannot use the full bandwidth.
+*/
+void HttpStub::setRateLimit(int aBytesPerSecond)
+{
+    m_iRate = aBytesPerSecond;
+}
+
+/*!
+The next \a aCount responses with a body are cut off after half of the body
+*/
+void HttpStub::setFailures(int aCount)
+{
+    m_iFailures = aCount;
+}
+
+/*!
+The next \a aCount requests are answered with "503 Service Unavailable"
+*/
+void HttpStub::setUnavailable(int aCount)
+{
+    m_iUnavailable = aCount;
+}
+
+/*!
+Keeps connections open after a response, instead of closing them
+*/
+void HttpStub::setKeepAlive(bool aEnable)
+{
+    m_bKeepAlive = aEnable;
+}
+
+/*!
+Enables or disables If-None-Match. When disabled, the full body is sent along with the ETag,
+like some proxies do
+*/
+void HttpStub::setConditional(bool aEnable)
+{
+    m_bConditional = aEnable;
+}
+
+/*!
+Returns the url of \a aPath on this server
+*/
+QUrl HttpStub::url(const QString& aPath /* = "/payload.bin" */) const
+{
+    return QUrl(QString("http://127.0.0.1:%1%2").arg(serverPort()).arg(aPath));
+}
+
+/*!
+Returns the number of requests received so far
+*/
+int HttpStub::requests() const
+{
+    return m_iRequests;
+}
+
+/*!
+Returns the number of connections accepted so far
+*/
+int HttpStub::connections() const
+{
+    return m_iConnections;
+}
+
+/*!
+Returns the url of the last request, including its query
+*/
+QUrl HttpStub::lastUrl() const
+{
+    return m_oLastUrl;
+}
+
+void HttpStub::onNewConnection()
+{
+    while(hasPendingConnections())
+    {
+        QTcpSocket* socket = nextPendingConnection();
+        m_iConnections++;
+        connect(socket, SIGNAL(readyRead()), SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), SLOT(onDisconnected()));
+    }
+}
+
+void HttpStub::onReadyRead()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+
+    m_oRequests[socket] += socket->readAll();
+
+    next(socket);
+}
+
+/*!
+Responds to the next complete request of \a aSocket, unless a response is still being sent
+*/
+void HttpStub::next(QTcpSocket* aSocket)
+{
+    int end = m_oRequests[aSocket].indexOf("\r\n\r\n");
+    if(end < 0 || m_oPending.contains(aSocket))
+        return;
+
+    QByteArray request = m_oRequests[aSocket].left(end);
+    m_oRequests[aSocket].remove(0, end + 4);
+
+    m_iRequests++;
+    respond(aSocket, request);
+}
+
+void HttpStub::onDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+
+    m_oRequests.remove(socket);
+    m_oPending.remove(socket);
+    m_oDrop.remove(socket);
+    socket->deleteLater();
+}
+
+void HttpStub::respond(QTcpSocket* aSocket, const QByteArray& aRequest)
+{
+    QList<QByteArray> lines = aRequest.split('\n');
+    QList<QByteArray> requestLine = lines.at(0).trimmed().split(' ');
+    QMap<QByteArray, QByteArray> headers;
+
+    for(int i = 1; i < lines.size(); i++)
+    {
+        int colon = lines.at(i).indexOf(':');
+        if(colon > 0)
+            headers[lines.at(i).left(colon).trimmed().toLower()] = lines.at(i).mid(colon + 1).trimmed();
+    }
+
+    QByteArray method = requestLine.at(0);
+    if(requestLine.size() > 1)
+        m_oLastUrl = QUrl::fromEncoded("http://127.0.0.1" + requestLine.at(1));
+    QString path = requestLine.size() > 1 ? QString::fromLatin1(requestLine.at(1)).section('?', 0, 0) : QString();
+    QByteArray status = "200 OK";
+    QByteArray header;
+    QByteArray body;
+
+    if(m_iUnavailable > 0)
+    {
+        m_iUnavailable--;
+        status = "503 Service Unavailable";
+        body = "busy";
+    }
+    else if(!m_oPayloads.contains(path))
+        status = "404 Not Found";
+    else
+    {
+        const QByteArray& payload = m_oPayloads[path];
+        QByteArray etag = "\"" + QCryptographicHash::hash(payload, QCryptographicHash::Md5).toHex() + "\"";
+        qint64 first = 0;
+        qint64 last = payload.size() - 1;
+
+        header += "ETag: " + etag + "\r\n";
+        if(m_bRanges)
+            header += "Accept-Ranges: bytes\r\n";
+
+        if(m_bConditional && headers.value("if-none-match") == etag)
+        {
+            status = "304 Not Modified";
+            first = 0;
+            last = -1;
+        }
+
+        bool ranged = m_bRanges && headers.contains("range") && last >= 0
+                && (!headers.contains("if-range") || headers.value("if-range") == etag);
+
+        if(ranged)
+        {
+            // bytes=<first>-[<last>]
+            QList<QByteArray> range = headers.value("range").mid(6).split('-');
+            first = range.at(0).toLongLong();
+            if(range.size() > 1 && !range.at(1).isEmpty())
+                last = qMin(range.at(1).toLongLong(), last);
+
+            if(first >= payload.size() || first > last)
+            {
+                status = "416 Range Not Satisfiable";
+                header += "Content-Range: bytes */" + QByteArray::number(payload.size()) + "\r\n";
+                first = 0;
+                last = -1;
+            }
+            else
+            {
+                status = "206 Partial Content";
+                header += "Content-Range: bytes " + QByteArray::number(first) + "-" + QByteArray::number(last)
+                        + "/" + QByteArray::number(payload.size()) + "\r\n";
+            }
+        }
+
+        body = payload.mid(first, last - first + 1);
+    }
+
+    header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+
+    m_oPending[aSocket] = "HTTP/1.1 " + status + "\r\n" + header + (m_bKeepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+
+    if(method != "HEAD")
+    {
+        if(m_iFailures > 0 && !body.isEmpty())
+        {
+            m_iFailures--;
+            body.truncate(body.size() / 2);
+            m_oDrop[aSocket] = true;
+        }
+        m_oPending[aSocket] += body;
+    }
+
+    send(aSocket);
+}
+
+void HttpStub::send(QTcpSocket* aSocket)
+{
+    QByteArray& pending = m_oPending[aSocket];
+    int chunk = m_iRate > 0 ? qMax(1, m_iRate * HTTPSTUB_TICK / 1000) : pending.size();
+
+    aSocket->write(pending.left(chunk));
+    pending.remove(0, chunk);
+
+    if(!pending.isEmpty())
+    {
+        if(!m_oTimer.isActive())
+            m_oTimer.start(HTTPSTUB_TICK);
+        return;
+    }
+
+    bool drop = m_oDrop.value(aSocket);
+    m_oPending.remove(aSocket);
+
+    if(drop)
+    {
+        aSocket->flush();
+        aSocket->abort();
+        m_oRequests.remove(aSocket);
+        m_oDrop.remove(aSocket);
+        aSocket->deleteLater();
+    }
+    else if(m_bKeepAlive)
+        next(aSocket);
+    else
+        aSocket->disconnectFromHost();
+}
+
+void HttpStub::onTick()
+{
+    foreach(QTcpSocket* socket, m_oPending.keys())
+        if(m_oPending.contains(socket))
+            send(socket);
+
+    if(m_oPending.isEmpty())
+        m_oTimer.stop();
+}
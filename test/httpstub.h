@@ -0,0 +1,64 @@
+#ifndef HTTPSTUB_H
+#define HTTPSTUB_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QMap>
+#include <QUrl>
+
+/*!
+Minimal HTTP/1.1 server on the loopback interface, used to test downloads without
+internet access. Supports HEAD, GET, single byte ranges with If-Range, a per connection
+rate limit, dropped connections, keep-alive and If-None-Match.
+*/
+class HttpStub : public QTcpServer
+{
+    Q_OBJECT
+
+    public:
+        explicit HttpStub(QObject* aParent = 0);
+
+    public:
+        void setPayload(const QByteArray& aPayload, const QString& aPath = "/payload.bin");
+        void setRangeSupport(bool aEnable);
+        void setRateLimit(int aBytesPerSecond);
+        void setFailures(int aCount);
+        void setUnavailable(int aCount);
+        void setKeepAlive(bool aEnable);
+        void setConditional(bool aEnable);
+
+        QUrl url(const QString& aPath = "/payload.bin") const;
+        int requests() const;
+        int connections() const;
+        QUrl lastUrl() const;
+
+    private slots:
+        void onNewConnection();
+        void onReadyRead();
+        void onDisconnected();
+        void onTick();
+
+    private:
+        void next(QTcpSocket* aSocket);
+        void respond(QTcpSocket* aSocket, const QByteArray& aRequest);
+        void send(QTcpSocket* aSocket);
+
+    private:
+        QMap<QString, QByteArray> m_oPayloads;
+        QMap<QTcpSocket*, QByteArray> m_oRequests;
+        QMap<QTcpSocket*, QByteArray> m_oPending;
+        QMap<QTcpSocket*, bool> m_oDrop;
+        QUrl m_oLastUrl;
+        QTimer m_oTimer;
+        bool m_bRanges;
+        bool m_bKeepAlive;
+        bool m_bConditional;
+        int  m_iRate;
+        int  m_iFailures;
+        int  m_iUnavailable;
+        int  m_iRequests;
+        int  m_iConnections;
+};
+
+#endif // HTTPSTUB_H
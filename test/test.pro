@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += network xml testlib
+QT       += network testlib
 QT       -= gui
 
 TARGET = test
@@ -42,7 +42,28 @@ SOURCES += \
     tst_clienttest.cpp \
     ../src/logging.cpp \
     ../src/updatenode_service.cpp \
-    ../src/limittimer.cpp
+    ../src/limittimer.cpp \
+    ../src/partfile.cpp \
+    ../src/segmenteddownload.cpp \
+    ../src/cachemanager.cpp \
+    ../src/patcher.cpp \
+    ../src/networksession.cpp \
+    ../src/responsecache.cpp \
+    ../src/requestscheduler.cpp \
+    ../src/scheduledreply.cpp \
+    ../src/downloadjob.cpp \
+    ../src/downloadqueue.cpp \
+    ../src/transferstats.cpp \
+    ../src/throttle.cpp \
+    ../src/mirrorselector.cpp \
+    ../src/mirrorprobe.cpp \
+    ../src/prefetcher.cpp \
+    ../src/elevatedhelper.cpp \
+    ../src/helpersession.cpp \
+    ../src/installscheduler.cpp \
+    ../src/filecopier.cpp \
+    ../src/archiveextractor.cpp \
+    httpstub.cpp
 
 DEFINES += SRCDIR=../src
 
@@ -63,7 +84,28 @@ HEADERS += \
     ../inc/version.h \
     ../inc/logging.h \
     ../inc/updatenode_service.h \
-    ../inc/limittimer.h
+    ../inc/limittimer.h \
+    ../inc/partfile.h \
+    ../inc/segmenteddownload.h \
+    ../inc/cachemanager.h \
+    ../inc/patcher.h \
+    ../inc/networksession.h \
+    ../inc/responsecache.h \
+    ../inc/requestscheduler.h \
+    ../inc/scheduledreply.h \
+    ../inc/downloadjob.h \
+    ../inc/downloadqueue.h \
+    ../inc/transferstats.h \
+    ../inc/throttle.h \
+    ../inc/mirrorselector.h \
+    ../inc/mirrorprobe.h \
+    ../inc/prefetcher.h \
+    ../inc/elevatedhelper.h \
+    ../inc/helpersession.h \
+    ../inc/installscheduler.h \
+    ../inc/filecopier.h \
+    ../inc/archiveextractor.h \
+    httpstub.h
 
 macx:SOURCES += ../src/maccommander.cpp
 macx:HEADERS += ../inc/maccommander.h
@@ -72,6 +114,17 @@ win32{
 LIBS+= Shell32.lib Advapi32.lib Netapi32.lib
 }
 
+### zlib is needed for tar.gz archives and deflated zip entries of UpdateNode::ArchiveExtractor
+### on Windows, build with CONFIG+=zlib and zlib in the include and library path to enable them
+unix{
+DEFINES += UPDATENODE_ZLIB
+LIBS += -lz
+}
+win32:zlib{
+DEFINES += UPDATENODE_ZLIB
+LIBS += zlib.lib
+}
+
 macx{
 CONFIG-=app_bundle
 LIBS += -framework CoreFoundation
@@ -23,6 +23,7 @@
 #include <QtCore/QString>
 #include <QtTest/QtTest>
 #include <QDateTime>
+#include <QElapsedTimer>
 
 #include "commander.h"
 #include "update.h"
@@ -33,6 +34,38 @@
 #include "localfile.h"
 #include "settings.h"
 #include "updatenode_service.h"
+#include "partfile.h"
+#include "cachemanager.h"
+#include "patcher.h"
+#include "segmenteddownload.h"
+#include "httpstub.h"
+#include "xmlparser.h"
+#include "osdetection.h"
+#include "networksession.h"
+#include "requestscheduler.h"
+#include "scheduledreply.h"
+#include "downloadqueue.h"
+#include "transferstats.h"
+#include "throttle.h"
+#include "mirrorselector.h"
+#include "prefetcher.h"
+#include "installscheduler.h"
+#include "elevatedhelper.h"
+#include "helpersession.h"
+#include "filecopier.h"
+#include "archiveextractor.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+// QSKIP takes the skip mode as second argument on Qt 4 only
+#if QT_VERSION >= 0x050000
+#define UPDATENODE_SKIP(aMessage) QSKIP(aMessage)
+#else
+#define UPDATENODE_SKIP(aMessage) QSKIP(aMessage, SkipSingle)
+#endif
 
 class ClientTest : public QObject
 {
@@ -51,8 +84,38 @@ private Q_SLOTS:
     void test_settings_register();
     void test_settings_map();
     void test_downloader_download();
+    void test_partfile_commit();
+    void test_partfile_resume();
+    void test_partfile_hash();
+    void test_cachemanager_evict();
+    void test_patcher_apply();
+    void test_segmented_download();
+    void test_segmented_benchmark();
+    void test_xmlparser_incremental();
+    void test_osdetection_cached();
+    void test_networksession_reuse();
+    void test_service_cache();
+    void test_service_batch();
+    void test_service_delta();
+    void test_request_scheduler();
+    void test_networksession_warmup();
+    void test_download_queue();
+    void test_transfer_stats();
+    void test_throttle();
+    void test_mirror_selection();
+    void test_prefetcher();
+    void test_install_scheduler();
+    void test_helper_session();
+    void test_helper_idle();
+    void test_file_copier();
+    void test_file_copier_benchmark();
+    void test_archive_extractor();
     void test_service_check();
 
+private:
+    static QByteArray tarEntry(const QString& aName, const QByteArray& aData, char aType = '0', int aMode = 0644);
+    static QByteArray zipEntry(const QString& aName, const QByteArray& aData);
+
 private:
     UpdateNode::Update update;
     QString workingDir;
@@ -303,12 +366,15 @@ void ClientTest::test_downloader_download()
 
     QVERIFY(reply->error() == QNetworkReply::NoError);
 
-    QVERIFY2(QFile::exists(UpdateNode::LocalFile::getDownloadLocation(url.toString())), qPrintable(UpdateNode::LocalFile::getDownloadLocation(url.toString())));
+    // the file is stored in the content addressed cache, if a checksum is available
+    QString location = UpdateNode::LocalFile::getUpdateLocation(update);
+    QVERIFY2(QFile::exists(location), qPrintable(location));
+    QVERIFY(QFileInfo(location).fileName() == QFileInfo(url.path()).fileName());
 
     reply = downloader.doDownload(url, update);
     QVERIFY(reply == NULL);
 
-    QVERIFY(QFile::remove(UpdateNode::LocalFile::getDownloadLocation(url.toString())));
+    QVERIFY(QFile::remove(location));
 
     // negative test
     url = url.fromUserInput("www.updatenode.com/fail");
@@ -324,6 +390,1647 @@ void ClientTest::test_downloader_download()
     QVERIFY2(!QFile::exists(UpdateNode::LocalFile::getDownloadLocation(url.toString())), qPrintable(UpdateNode::LocalFile::getDownloadLocation(url.toString())));
 }
 
+void ClientTest::test_partfile_commit()
+{
+    QFile::remove("partfile.bin");
+
+    UpdateNode::PartFile part("partfile.bin");
+    QVERIFY(part.open());
+    QVERIFY(QFile::exists(part.partFileName()));
+    QVERIFY(part.write(QByteArray(1000, 'a')));
+    QVERIFY(part.write(QByteArray(24, 'b')));
+    QVERIFY2(part.size() == 1024, qPrintable(QString::number(part.size())));
+    QVERIFY2(!QFile::exists("partfile.bin"), "The final file must not exist before commit");
+    QVERIFY(part.commit());
+    QVERIFY(!QFile::exists(part.partFileName()));
+    QVERIFY(QFileInfo("partfile.bin").size() == 1024);
+
+    // a second download replaces the first file
+    UpdateNode::PartFile second("partfile.bin");
+    QVERIFY(second.open());
+    QVERIFY(second.write("new"));
+    QVERIFY2(QFileInfo("partfile.bin").size() == 1024, "The old file stays untouched until commit");
+    QVERIFY(second.commit());
+    QVERIFY(QFileInfo("partfile.bin").size() == 3);
+
+    // a discarded download keeps the old file
+    UpdateNode::PartFile third("partfile.bin");
+    QVERIFY(third.open());
+    QVERIFY(third.write("discarded"));
+    third.discard();
+    QVERIFY(!QFile::exists(third.partFileName()));
+    QVERIFY(QFileInfo("partfile.bin").size() == 3);
+
+    QVERIFY(QFile::remove("partfile.bin"));
+}
+
+void ClientTest::test_partfile_resume()
+{
+    UpdateNode::Settings settings;
+    QFile::remove("resume.bin");
+
+    UpdateNode::PartFile part("resume.bin");
+    QVERIFY(part.open());
+    QVERIFY(part.write(QByteArray(100, 'a')));
+    QVERIFY(part.checkpoint());
+    QVERIFY(part.write(QByteArray(50, 'x')));
+    QVERIFY(part.syncedSize() == 100);
+
+    settings.setPartialDownload("unittest_resume", part.partFileName(), part.syncedSize());
+    settings.setPartialValidator("unittest_resume", "\"etag\"");
+    QVERIFY(settings.getPartialFile("unittest_resume") == part.partFileName());
+    QVERIFY(settings.getPartialOffset("unittest_resume") == 100);
+    QVERIFY(settings.getPartialValidator("unittest_resume") == "\"etag\"");
+
+    // data behind the last checkpoint is dropped on resume
+    UpdateNode::PartFile resumed("resume.bin");
+    QVERIFY(resumed.resume(settings.getPartialOffset("unittest_resume")));
+    QVERIFY(resumed.size() == 100);
+    QVERIFY(resumed.write(QByteArray(24, 'b')));
+    QVERIFY(resumed.commit());
+    QVERIFY(QFileInfo("resume.bin").size() == 124);
+
+    UpdateNode::PartFile missing("resume.bin");
+    QVERIFY2(!missing.resume(100), "A part file cannot be resumed behind its end");
+
+    settings.removePartialDownload("unittest_resume");
+    QVERIFY(settings.getPartialFile("unittest_resume").isEmpty());
+    QVERIFY(settings.getPartialOffset("unittest_resume") == 0);
+
+    QVERIFY(QFile::remove("resume.bin"));
+}
+
+void ClientTest::test_partfile_hash()
+{
+    UpdateNode::Settings settings;
+    QString sha256abc = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    QFile::remove("hash.bin");
+
+#ifdef UPDATENODE_FILE_HASH_SUPPORTED
+    // a wrong checksum keeps the file from being committed
+    UpdateNode::PartFile wrong("hash.bin");
+    wrong.setExpectedHash(QString(64, '0'));
+    QVERIFY(wrong.open());
+    QVERIFY(wrong.write("abc"));
+    QVERIFY(!wrong.commit());
+    QVERIFY(!QFile::exists("hash.bin"));
+    QVERIFY(!QFile::exists(wrong.partFileName()));
+
+    // the checksum continues over a resumed download
+    {
+        UpdateNode::PartFile interrupted("hash.bin");
+        QVERIFY(interrupted.open());
+        QVERIFY(interrupted.write("ab"));
+        QVERIFY(interrupted.checkpoint());
+    }
+
+    UpdateNode::PartFile part("hash.bin");
+    part.setExpectedHash(sha256abc.toUpper());
+    QVERIFY(part.resume(2));
+    QVERIFY(part.write("c"));
+    QVERIFY2(part.hash() == sha256abc, qPrintable(part.hash()));
+    QVERIFY(part.commit());
+#else
+    UpdateNode::PartFile part("hash.bin");
+    QVERIFY(part.open());
+    QVERIFY(part.write("abc"));
+    QVERIFY(part.hash().isEmpty());
+    QVERIFY(part.commit());
+#endif
+
+    settings.setCachedFile("unittest_hash", "hash.bin", part.hash());
+    QVERIFY(settings.isCachedFileValid("unittest_hash", part.hash()));
+    QVERIFY(settings.isCachedFileValid("unittest_hash"));
+#ifdef UPDATENODE_FILE_HASH_SUPPORTED
+    QVERIFY2(!settings.isCachedFileValid("unittest_hash", QString(64, '1')), "A new checksum on the server invalidates the cache");
+#endif
+
+    // a truncated file is not used anymore
+    QFile file("hash.bin");
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(1));
+    file.close();
+    QVERIFY(!settings.isCachedFileValid("unittest_hash"));
+
+    QVERIFY(QFile::remove("hash.bin"));
+    QVERIFY(!settings.isCachedFileValid("unittest_hash"));
+}
+
+void ClientTest::test_cachemanager_evict()
+{
+    UpdateNode::CacheManager cache;
+    QStringList hashes;
+    QStringList blobs;
+
+    for(int i = 0; i < 3; i++)
+    {
+        QString name = QString("blob%1.bin").arg(i);
+        QString hash = QString(63, 'a') + QString::number(i);
+        QFile file(name);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(file.write(QByteArray(1000, 'x')) == 1000);
+        file.close();
+
+        QString blob = cache.store(name, hash, QUrl("http://updatenode.com/" + name), "unittest_blob" + QString::number(i));
+        QVERIFY2(!blob.isEmpty(), qPrintable(name));
+        QVERIFY(!QFile::exists(name));
+        QVERIFY(QFileInfo(blob).fileName() == name);
+        hashes << hash;
+        blobs << blob;
+    }
+
+    // the same content is stored only once
+    QFile duplicate("duplicate.bin");
+    QVERIFY(duplicate.open(QIODevice::WriteOnly));
+    duplicate.close();
+    QVERIFY(cache.store("duplicate.bin", hashes.at(2), QUrl(), "unittest_duplicate") == blobs.at(2));
+    QVERIFY(!QFile::exists("duplicate.bin"));
+    QVERIFY(cache.findByUrl(QUrl("http://updatenode.com/blob1.bin")) == blobs.at(1));
+
+    // pinned blobs survive, the least recently used unpinned blob goes first
+    cache.unpin("unittest_blob0");
+    cache.unpin("unittest_blob1");
+    QTest::qWait(10);
+    QVERIFY(cache.find(hashes.at(0)) == blobs.at(0));
+    QVERIFY(cache.isPinned(hashes.at(2)));
+
+    cache.evict(cache.size() - 500);
+    QVERIFY(cache.find(hashes.at(1)).isEmpty());
+    QVERIFY(!QFile::exists(blobs.at(1)));
+    QVERIFY(cache.findByUrl(QUrl("http://updatenode.com/blob1.bin")).isEmpty());
+    QVERIFY(QFile::exists(blobs.at(0)));
+
+    cache.evict(1);
+    QVERIFY(!QFile::exists(blobs.at(0)));
+    QVERIFY2(QFile::exists(blobs.at(2)), "Pinned blobs must not be evicted");
+
+    cache.unpin("unittest_blob2");
+    cache.unpin("unittest_duplicate");
+    cache.evict(1);
+    QVERIFY(!QFile::exists(blobs.at(2)));
+}
+
+void ClientTest::test_patcher_apply()
+{
+    QByteArray base(100000, 0);
+    for(int i = 0; i < base.size(); i++)
+        base[i] = (char)(i % 251);
+
+    QByteArray insert("new data of the next release");
+    QByteArray expected = base.left(50000) + insert + base.mid(60000);
+
+    QFile baseFile("patch_base.bin");
+    QVERIFY(baseFile.open(QIODevice::WriteOnly));
+    baseFile.write(base);
+    baseFile.close();
+
+    QByteArray patch;
+    QDataStream stream(&patch, QIODevice::WriteOnly);
+    stream.writeRawData(UPDATENODE_PATCH_MAGIC, qstrlen(UPDATENODE_PATCH_MAGIC));
+    stream << (quint64)expected.size();
+    stream << (quint8)UPDATENODE_PATCH_COPY << (quint64)0 << (quint64)50000;
+    stream << (quint8)UPDATENODE_PATCH_INSERT << (quint64)insert.size();
+    stream.writeRawData(insert.constData(), insert.size());
+    stream << (quint8)UPDATENODE_PATCH_COPY << (quint64)60000 << (quint64)40000;
+    stream << (quint8)UPDATENODE_PATCH_END;
+
+    QFile patchFile("patch.unpatch");
+    QVERIFY(patchFile.open(QIODevice::WriteOnly));
+    patchFile.write(patch);
+    patchFile.close();
+
+    QString expectedHash;
+#ifdef UPDATENODE_FILE_HASH_SUPPORTED
+    expectedHash = QCryptographicHash::hash(expected, QCryptographicHash::Sha256).toHex();
+#endif
+
+    UpdateNode::Patcher patcher;
+    QFile::remove("patched.bin");
+    QVERIFY2(patcher.apply("patch_base.bin", "patch.unpatch", "patched.bin", expectedHash), qPrintable(patcher.errorString()));
+    QVERIFY(patcher.hash() == expectedHash);
+
+    QFile result("patched.bin");
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QVERIFY(result.readAll() == expected);
+    result.close();
+    QVERIFY(QFile::remove("patched.bin"));
+
+#ifdef UPDATENODE_FILE_HASH_SUPPORTED
+    // a different base file results in a checksum mismatch
+    QVERIFY(baseFile.open(QIODevice::WriteOnly));
+    baseFile.write(QByteArray(100000, 'x'));
+    baseFile.close();
+    QVERIFY(!patcher.apply("patch_base.bin", "patch.unpatch", "patched.bin", expectedHash));
+    QVERIFY(!QFile::exists("patched.bin"));
+#endif
+
+    // a patch reaching beyond its base is rejected
+    QVERIFY(baseFile.open(QIODevice::WriteOnly));
+    baseFile.write(base.left(1000));
+    baseFile.close();
+    QVERIFY(!patcher.apply("patch_base.bin", "patch.unpatch", "patched.bin", QString()));
+    QVERIFY(!QFile::exists("patched.bin"));
+
+    QVERIFY(QFile::remove("patch_base.bin"));
+    QVERIFY(QFile::remove("patch.unpatch"));
+}
+
+void ClientTest::test_segmented_download()
+{
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+
+    QByteArray payload(3 * 1024 * 1024 + 123, 0);
+    for(int i = 0; i < payload.size(); i++)
+        payload[i] = (char)(qrand() % 256);
+    stub.setPayload(payload);
+
+    QString fileName = "segmented.bin";
+    QFile::remove(fileName);
+
+    QEventLoop loop;
+    QTimer::singleShot(30000, &loop, SLOT(quit()));
+
+    // two segments get cut off and have to be retried
+    stub.setFailures(2);
+
+    UpdateNode::SegmentedDownload download(stub.url(), fileName, 4);
+    QObject::connect(&download, SIGNAL(finished(QNetworkReply::NetworkError,QString)), &loop, SLOT(quit()));
+    download.start();
+    loop.exec();
+
+    QVERIFY(download.size() == payload.size());
+    QVERIFY2(download.segments() == 3, qPrintable(QString::number(download.segments())));
+    QVERIFY2(stub.requests() == 1 + 3 + 2, qPrintable(QString::number(stub.requests())));
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY2(file.readAll() == payload, "Segmented download is not identical to the payload");
+    file.close();
+    QVERIFY(!QFile::exists(fileName + UPDATENODE_PART_SUFFIX));
+    QVERIFY(QFile::remove(fileName));
+
+    // an aborted download keeps its part file, and is continued from the checkpoint of its segments
+    stub.setRateLimit(1024 * 1024);
+    {
+        UpdateNode::SegmentedDownload paused(stub.url(), fileName, 4);
+        QSignalSpy progress(&paused, SIGNAL(downloadProgress(qint64,qint64)));
+        paused.start();
+
+        QElapsedTimer timer;
+        timer.start();
+        while((progress.isEmpty() || progress.last().at(0).toLongLong() < 512 * 1024) && timer.elapsed() < 10000)
+            QTest::qWait(20);
+        paused.abort();
+    }
+    QVERIFY(QFile::exists(fileName + UPDATENODE_PART_SUFFIX));
+    QVERIFY(QFile::exists(fileName + UPDATENODE_PART_SUFFIX + UPDATENODE_SEGMENT_CHECKPOINT));
+    stub.setRateLimit(0);
+
+    UpdateNode::SegmentedDownload resumed(stub.url(), fileName, 4);
+    QSignalSpy resumedProgress(&resumed, SIGNAL(downloadProgress(qint64,qint64)));
+    QObject::connect(&resumed, SIGNAL(finished(QNetworkReply::NetworkError,QString)), &loop, SLOT(quit()));
+    resumed.start();
+    loop.exec();
+
+    QVERIFY(!resumedProgress.isEmpty());
+    QVERIFY(resumedProgress.first().at(0).toLongLong() >= 512 * 1024);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY2(file.readAll() == payload, "Resumed segmented download is not identical to the payload");
+    file.close();
+    QVERIFY(!QFile::exists(fileName + UPDATENODE_PART_SUFFIX));
+    QVERIFY(!QFile::exists(fileName + UPDATENODE_PART_SUFFIX + UPDATENODE_SEGMENT_CHECKPOINT));
+    QVERIFY(QFile::remove(fileName));
+
+    // segments running out of retries leave the part file for the next attempt as well
+    stub.setFailures(1000);
+    {
+        UpdateNode::SegmentedDownload failing(stub.url(), fileName, 4);
+        QSignalSpy failed(&failing, SIGNAL(finished(QNetworkReply::NetworkError,QString)));
+        QObject::connect(&failing, SIGNAL(finished(QNetworkReply::NetworkError,QString)), &loop, SLOT(quit()));
+        failing.start();
+        loop.exec();
+
+        QVERIFY(failed.count() == 1);
+        QVERIFY(!QFile::exists(fileName));
+    }
+    QVERIFY(QFile::exists(fileName + UPDATENODE_PART_SUFFIX));
+    QVERIFY(QFile::exists(fileName + UPDATENODE_PART_SUFFIX + UPDATENODE_SEGMENT_CHECKPOINT));
+    stub.setFailures(0);
+
+    UpdateNode::SegmentedDownload retried(stub.url(), fileName, 4);
+    QObject::connect(&retried, SIGNAL(finished(QNetworkReply::NetworkError,QString)), &loop, SLOT(quit()));
+    retried.start();
+    loop.exec();
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY2(file.readAll() == payload, "Retried segmented download is not identical to the payload");
+    file.close();
+    QVERIFY(!QFile::exists(fileName + UPDATENODE_PART_SUFFIX + UPDATENODE_SEGMENT_CHECKPOINT));
+    QVERIFY(QFile::remove(fileName));
+
+    // no range support
+    stub.setRangeSupport(false);
+
+    UpdateNode::SegmentedDownload fallback(stub.url(), fileName, 4);
+    QObject::connect(&fallback, SIGNAL(unsupported()), &loop, SLOT(quit()));
+    fallback.start();
+    loop.exec();
+
+    QVERIFY(fallback.segments() == 0);
+    QVERIFY(!QFile::exists(fileName));
+}
+
+void ClientTest::test_segmented_benchmark()
+{
+    // timing dependent, only run with UPDATENODE_BENCHMARK set, test_segmented_download covers correctness
+    if(qgetenv("UPDATENODE_BENCHMARK").isEmpty())
+        UPDATENODE_SKIP("set UPDATENODE_BENCHMARK to run");
+
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+
+    // each connection is limited, like a single TCP stream on a high latency link
+    stub.setRateLimit(2 * 1024 * 1024);
+    stub.setPayload(QByteArray(6 * 1024 * 1024, 'u'));
+
+    QString fileName = "benchmark.bin";
+    QMap<int, double> throughput;
+    QList<int> counts;
+    counts << 1 << 2 << 3 << 6;
+
+    foreach(int count, counts)
+    {
+        QEventLoop loop;
+        QElapsedTimer timer;
+        QTimer::singleShot(30000, &loop, SLOT(quit()));
+
+        UpdateNode::SegmentedDownload download(stub.url(), fileName, count);
+        QObject::connect(&download, SIGNAL(finished(QNetworkReply::NetworkError,QString)), &loop, SLOT(quit()));
+
+        timer.start();
+        download.start();
+        loop.exec();
+
+        QVERIFY(QFileInfo(fileName).size() == 6 * 1024 * 1024);
+        QVERIFY(QFile::remove(fileName));
+
+        throughput[count] = 6.0 * 1000 / qMax((qint64)1, timer.elapsed());
+        qDebug() << count << "segment(s):" << throughput[count] << "MB/s";
+    }
+
+    QVERIFY2(throughput[3] > throughput[1] * 1.5, "Throughput does not scale with the number of segments");
+}
+
+void ClientTest::test_xmlparser_incremental()
+{
+    QByteArray xml("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                   "<updatenode><status><code>0</code><message>OK</message></status>"
+                   "<product><code>p1</code><name>Product</name><image></image></product>"
+                   "<version><code>v1</code><name>One</name><version>1.0</version></version>"
+                   "<updates>"
+                   "<update><code>u1</code><title>Update 1</title><description><![CDATA[<p>first</p>]]></description>"
+                   "<target><code>v2</code><name>Two</name><version>2.0</version></target></update>"
+                   "<update><code>u2</code><title>Update 2</title><description>Fixes <b>crashes</b></description></update>"
+                   "</updates>"
+                   "<messages><message><code>m1</code><title>Message 1</title><message>Text</message></message></messages>"
+                   "</updatenode>");
+
+    UpdateNode::Config config;
+    UpdateNode::XmlParser parser(0, &config);
+    QSignalSpy products(&parser, SIGNAL(productParsed(UpdateNode::Config*, const UpdateNode::Product&)));
+    QSignalSpy updates(&parser, SIGNAL(updateParsed(UpdateNode::Config*, const UpdateNode::Update&)));
+    QSignalSpy messages(&parser, SIGNAL(messageParsed(UpdateNode::Config*, const UpdateNode::Message&)));
+
+    // feed byte by byte, each update is signaled as soon as its element is complete
+    int firstUpdateEnd = xml.indexOf("</update>") + 9;
+    for(int i = 0; i < xml.size(); i++)
+    {
+        QVERIFY(parser.addData(xml.mid(i, 1)));
+        if(i + 1 == firstUpdateEnd - 1)
+            QVERIFY(updates.count() == 0);
+        if(i + 1 == firstUpdateEnd)
+            QVERIFY(updates.count() == 1);
+    }
+
+    QVERIFY(parser.finish());
+    QVERIFY(parser.getStatus() == 0);
+    QVERIFY(parser.getStatusString() == "OK");
+    QVERIFY(products.count() == 1);
+    QVERIFY(updates.count() == 2);
+    QVERIFY(messages.count() == 1);
+    QVERIFY(config.product().getName() == "Product");
+    QVERIFY(config.version().getVersion() == "1.0");
+    QVERIFY(config.updates().size() == 2);
+    QVERIFY(config.updates().at(0).getDescription() == "<p>first</p>");
+    QVERIFY(config.updates().at(0).getTargetVersion().getVersion() == "2.0");
+    QVERIFY(config.updates().at(1).getTitle() == "Update 2");
+    // markup within a field belongs to its text only
+    QVERIFY(config.updates().at(1).getDescription() == "Fixes crashes");
+    QVERIFY(config.updates().at(1).getCode() == "u2");
+    QVERIFY(config.messages().at(0).getMessage() == "Text");
+
+    // a truncated response is not accepted
+    UpdateNode::Config truncated;
+    UpdateNode::XmlParser incomplete(0, &truncated);
+    QVERIFY(incomplete.addData(xml.left(xml.indexOf("<messages>"))));
+    QVERIFY(!incomplete.finish());
+    QVERIFY(truncated.updates().size() == 2);
+}
+
+void ClientTest::test_osdetection_cached()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QString os = UpdateNode::OSDetection::getOS();
+    QString arch = UpdateNode::OSDetection::getArch();
+
+    QVERIFY(!os.isEmpty());
+    QVERIFY(!arch.isEmpty());
+    QVERIFY(arch == arch.trimmed());
+
+    // further calls return the detected values without detecting again
+    for(int i = 0; i < 1000; i++)
+    {
+        QVERIFY(UpdateNode::OSDetection::getOS() == os);
+        QVERIFY(UpdateNode::OSDetection::getArch() == arch);
+    }
+    QVERIFY(timer.elapsed() < 1000);
+}
+
+void ClientTest::test_networksession_reuse()
+{
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setKeepAlive(true);
+    stub.setPayload("first", "/first.txt");
+    stub.setPayload("second", "/second.txt");
+
+    QEventLoop loop;
+    QTimer::singleShot(10000, &loop, SLOT(quit()));
+
+    QNetworkReply* reply = UpdateNode::NetworkSession::Instance()->get(QNetworkRequest(stub.url("/first.txt")));
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(reply->readAll() == "first");
+    reply->deleteLater();
+
+    // a Downloader sends its request over the connection left open by the first request
+    UpdateNode::Update update;
+    update.setCode("networksession_reuse");
+    update.setDownloadLink(stub.url("/second.txt").toString());
+
+    UpdateNode::Downloader downloader;
+    QObject::connect(&downloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), &loop, SLOT(quit()));
+    QVERIFY(downloader.doDownload(stub.url("/second.txt"), update) != NULL);
+    loop.exec();
+
+    QFile file(UpdateNode::LocalFile::getDownloadLocation(update.getDownloadLink()));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.readAll() == "second");
+    file.close();
+    QVERIFY(file.remove());
+
+    QVERIFY(stub.requests() == 2);
+    QVERIFY(stub.connections() == 1);
+}
+
+void ClientTest::test_service_cache()
+{
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setPayload("icon", "/cache_icon.png");
+    stub.setPayload("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<updatenode><status><code>0</code><message>OK</message></status>"
+                    "<product><code>cache</code><name>Cache</name>"
+                    "<image>" + stub.url("/cache_icon.png").toEncoded() + "</image></product>"
+                    "<version><code>v1</code><name>One</name><version>1.0</version></version>"
+                    "<updates><update><code>cache_update</code><title>Cached update</title>"
+                    "<target><code>v2</code><name>Two</name><version>2.0</version></target></update></updates>"
+                    "<messages></messages></updatenode>", "/api");
+
+    UpdateNode::Config* config = UpdateNode::Config::Instance();
+    config->setHost(stub.url("/api").toString());
+    config->setKey("responsecache");
+    config->setProductCode("cache");
+    config->setVersion("1.0");
+    config->setSingleMode(true);
+
+    UpdateNode::Service service;
+    QEventLoop loop;
+    QObject::connect(&service, SIGNAL(done()), &loop, SLOT(quit()));
+    QFile::remove(UpdateNode::LocalFile::getDownloadLocation("cache_icon.png"));
+
+    // the first check stores the response and downloads the icon, the second one is answered with "304 Not Modified"
+    for(int i = 0; i < 2; i++)
+    {
+        config->clear();
+        QVERIFY(service.checkForUpdates());
+        loop.exec();
+        QVERIFY(service.status() == 0);
+        QVERIFY(config->updates().size() == 1);
+        QVERIFY(config->updates().at(0).getTitle() == "Cached update");
+        QVERIFY(config->updates().at(0).getTargetVersion().getVersion() == "2.0");
+        QVERIFY(config->version().getVersion() == "1.0");
+    }
+    QVERIFY(stub.requests() == 3);
+    QVERIFY(QFile::exists(config->product().getLocalIcon()));
+
+    // within the time to live, no request is sent at all, the icon is not downloaded again
+    config->setResponseTtl(60);
+    config->clear();
+    QVERIFY(service.checkForUpdates());
+    loop.exec();
+    QVERIFY(stub.requests() == 3);
+    QVERIFY(config->updates().size() == 1);
+    QVERIFY(config->product().getName() == "Cache");
+
+    // the full body with the stored ETag is not parsed, the stored response is used
+    stub.setConditional(false);
+    config->setResponseTtl(0);
+    config->clear();
+    QVERIFY(service.checkForUpdates());
+    loop.exec();
+    QVERIFY(stub.requests() == 4);
+    QVERIFY(service.status() == 0);
+    QVERIFY(config->updates().size() == 1);
+    QVERIFY(config->updates().at(0).getTitle() == "Cached update");
+
+    QVERIFY(QFile::remove(config->product().getLocalIcon()));
+
+    config->setResponseTtl(0);
+    config->setHost(QString());
+    config->clear();
+}
+
+void ClientTest::test_service_batch()
+{
+    QByteArray response = "<status><code>0</code><message>OK</message></status>"
+                          "<product><code>batch</code><name>Batch</name></product>"
+                          "<version><code>v1</code><name>One</name><version>1.0</version></version>"
+                          "<updates><update><code>batch_update</code><title>Batched update</title>"
+                          "<target><code>v2</code><name>Two</name><version>2.0</version></target></update></updates>"
+                          "<messages></messages>";
+
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setPayload("<?xml version=\"1.0\" encoding=\"UTF-8\"?><batch>"
+                    "<response index=\"0\">" + response + "</response>"
+                    "<response index=\"2\">" + response + "</response>"
+                    "<response index=\"1\">" + response + "</response>"
+                    "</batch>", "/api");
+
+    UpdateNode::Config* config = UpdateNode::Config::Instance();
+    config->setHost(stub.url("/api").toString());
+    config->setKey("batch");
+    config->setResponseTtl(0);
+    config->setSingleMode(false);
+    config->clearConfigurations();
+
+    QList<UpdateNode::Config*> products;
+    for(int i = 0; i < 3; i++)
+    {
+        products.append(new UpdateNode::Config());
+        products.last()->setProductCode(QString("batch_%1").arg(i));
+        products.last()->setVersion("1.0");
+        config->addConfiguration(products.last());
+    }
+
+    // all products are checked with a single request
+    {
+        UpdateNode::Service service;
+        QEventLoop loop;
+        QObject::connect(&service, SIGNAL(doneManager()), &loop, SLOT(quit()));
+
+        QVERIFY(service.checkForUpdates());
+        loop.exec();
+        QVERIFY(stub.requests() == 1);
+        QVERIFY(service.status() == 0);
+        foreach(UpdateNode::Config* product, products)
+        {
+            QVERIFY(product->updates().size() == 1);
+            QVERIFY(product->updates().at(0).getTitle() == "Batched update");
+        }
+    }
+
+    // without support for batched requests, each product is checked on its own
+    stub.setPayload("<?xml version=\"1.0\" encoding=\"UTF-8\"?><updatenode>" + response + "</updatenode>", "/api");
+    {
+        UpdateNode::Service service;
+        QEventLoop loop;
+        QObject::connect(&service, SIGNAL(doneManager()), &loop, SLOT(quit()));
+
+        foreach(UpdateNode::Config* product, products)
+            product->clear();
+
+        QVERIFY(service.checkForUpdates());
+        loop.exec();
+        QVERIFY(stub.requests() == 1 + 1 + 3);
+        foreach(UpdateNode::Config* product, products)
+            QVERIFY(product->updates().size() == 1);
+
+        // the next check does not try again
+        foreach(UpdateNode::Config* product, products)
+            product->clear();
+
+        QVERIFY(service.checkForUpdates());
+        loop.exec();
+        QVERIFY(stub.requests() == 1 + 1 + 3 + 3);
+    }
+
+    // the batched request carries the digests of the stored responses, the delta responses are merged with them
+    QByteArray delta = "<status><code>0</code><message>OK</message></status>"
+                       "<product><code>batch</code><name>Batch</name></product>"
+                       "<version><code>v1</code><name>One</name><version>1.0</version></version>"
+                       "<updates></updates><messages></messages>";
+    stub.setPayload("<?xml version=\"1.0\" encoding=\"UTF-8\"?><batch>"
+                    "<response index=\"0\" delta=\"1\">" + delta + "</response>"
+                    "<response index=\"1\" delta=\"1\">" + delta + "</response>"
+                    "<response index=\"2\" delta=\"1\">" + delta + "</response>"
+                    "</batch>", "/api");
+    config->setDeltaSync(true);
+    {
+        UpdateNode::Service service;
+        QEventLoop loop;
+        QObject::connect(&service, SIGNAL(doneManager()), &loop, SLOT(quit()));
+
+        foreach(UpdateNode::Config* product, products)
+            product->clear();
+
+        QVERIFY(service.checkForUpdates());
+        loop.exec();
+        QVERIFY(stub.requests() == 1 + 1 + 3 + 3 + 1);
+        QVERIFY(stub.lastUrl().toString().contains("known_updates_2=batch_update"));
+        foreach(UpdateNode::Config* product, products)
+        {
+            QVERIFY(product->updates().size() == 1);
+            QVERIFY(product->updates().at(0).getTitle() == "Batched update");
+        }
+    }
+    config->setDeltaSync(false);
+
+    config->clearConfigurations();
+    qDeleteAll(products);
+    config->setSingleMode(true);
+    config->setHost(QString());
+}
+
+void ClientTest::test_service_delta()
+{
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setPayload("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<updatenode><status><code>0</code><message>OK</message></status>"
+                    "<product><code>delta</code><name>Delta</name></product>"
+                    "<version><code>v1</code><name>One</name><version>1.0</version></version>"
+                    "<updates><update><code>delta_1</code><title>First</title></update>"
+                    "<update><code>delta_2</code><title>Second</title></update></updates>"
+                    "<messages><message><code>delta_message</code><title>Message</title></message></messages>"
+                    "</updatenode>", "/api");
+
+    UpdateNode::Config* config = UpdateNode::Config::Instance();
+    config->setHost(stub.url("/api").toString());
+    config->setKey("deltasync");
+    config->setProductCode("delta");
+    config->setVersion("1.0");
+    config->setSingleMode(true);
+    config->setDeltaSync(true);
+
+    UpdateNode::Service service;
+    QEventLoop loop;
+    QObject::connect(&service, SIGNAL(done()), &loop, SLOT(quit()));
+
+    // without a stored response, the full response is requested
+    config->clear();
+    QVERIFY(service.checkForUpdates());
+    loop.exec();
+    QVERIFY(!stub.lastUrl().toString().contains("delta=1"));
+    QVERIFY(config->updates().size() == 2);
+
+    // the service only returns the changes to the digest
+    stub.setPayload("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                    "<updatenode delta=\"1\"><status><code>0</code><message>OK</message></status>"
+                    "<product><code>delta</code><name>Delta</name></product>"
+                    "<version><code>v1</code><name>One</name><version>1.0</version></version>"
+                    "<updates><update><code>delta_3</code><title>Third</title></update></updates>"
+                    "<messages></messages>"
+                    "<removed><update>delta_1</update></removed>"
+                    "</updatenode>", "/api");
+
+    config->clear();
+    QVERIFY(service.checkForUpdates());
+    loop.exec();
+    QVERIFY(stub.lastUrl().toString().contains("delta=1"));
+    QVERIFY(stub.lastUrl().toString().contains("delta_1"));
+    QVERIFY(stub.lastUrl().toString().contains("delta_message"));
+    QVERIFY(service.status() == 0);
+    QVERIFY(config->updates().size() == 2);
+    QVERIFY(config->messages().size() == 1);
+
+    QStringList codes;
+    foreach(UpdateNode::Update update, config->updates())
+        codes.append(update.getCode());
+    QVERIFY(codes.contains("delta_2") && codes.contains("delta_3"));
+
+    // the merged response is stored for the next check
+    config->setResponseTtl(60);
+    config->clear();
+    QVERIFY(service.checkForUpdates());
+    loop.exec();
+    QVERIFY(stub.requests() == 2);
+    QVERIFY(config->updates().size() == 2);
+    QVERIFY(config->messages().size() == 1);
+
+    config->setResponseTtl(0);
+    config->setDeltaSync(false);
+    config->setHost(QString());
+    config->clear();
+}
+
+void ClientTest::test_request_scheduler()
+{
+    UpdateNode::RequestScheduler* scheduler = UpdateNode::RequestScheduler::Instance();
+    scheduler->setBudgets(200, 200, 1000);
+    scheduler->setRetries(2, 10);
+
+    QEventLoop loop;
+
+    // nothing listens on the port, each attempt fails right away and is retried
+    QTcpServer closed;
+    QVERIFY(closed.listen(QHostAddress::LocalHost));
+    QUrl refused(QString("http://127.0.0.1:%1/api").arg(closed.serverPort()));
+    closed.close();
+
+    UpdateNode::ScheduledReply* reply = qobject_cast<UpdateNode::ScheduledReply*>(scheduler->get(QNetworkRequest(refused)));
+    QVERIFY(reply);
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(reply->error() != QNetworkReply::NoError);
+    QVERIFY(reply->attempts() == 3);
+    delete reply;
+
+    // the server accepts the connection but never answers, the hedged request to the alternate host does
+    QTcpServer silent;
+    QVERIFY(silent.listen(QHostAddress::LocalHost));
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setPayload("hedged", "/api");
+
+    scheduler->setAlternateHost(stub.url("/api"));
+    scheduler->setHedgeDelay(100);
+
+    reply = qobject_cast<UpdateNode::ScheduledReply*>(scheduler->get(QNetworkRequest(QUrl(QString("http://127.0.0.1:%1/api").arg(silent.serverPort())))));
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(reply->error() == QNetworkReply::NoError);
+    QVERIFY(reply->isHedged());
+    QVERIFY(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200);
+    QVERIFY(reply->readAll() == "hedged");
+    delete reply;
+
+    // a server error is retried, the last attempt is passed on as it is
+    scheduler->setAlternateHost(QUrl());
+    stub.setUnavailable(1);
+
+    reply = qobject_cast<UpdateNode::ScheduledReply*>(scheduler->get(QNetworkRequest(stub.url("/api"))));
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(reply->error() == QNetworkReply::NoError);
+    QVERIFY(reply->attempts() == 2);
+    QVERIFY(reply->readAll() == "hedged");
+    delete reply;
+
+    stub.setUnavailable(3);
+
+    reply = qobject_cast<UpdateNode::ScheduledReply*>(scheduler->get(QNetworkRequest(stub.url("/api"))));
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(reply->error() != QNetworkReply::NoError);
+    QVERIFY(reply->attempts() == 3);
+    QVERIFY(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 503);
+    delete reply;
+
+    scheduler->setBudgets(UPDATENODE_CONNECT_BUDGET, UPDATENODE_TTFB_BUDGET, UPDATENODE_BODY_BUDGET);
+    scheduler->setRetries(UPDATENODE_RETRIES, UPDATENODE_BACKOFF);
+    scheduler->setAlternateHost(QUrl());
+    scheduler->setHedgeDelay(UPDATENODE_HEDGE_DELAY);
+}
+
+void ClientTest::test_networksession_warmup()
+{
+#ifdef UPDATENODE_CONNECT_TO_HOST_SUPPORTED
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setKeepAlive(true);
+    stub.setPayload("warm", "/warm.txt");
+
+    QEventLoop loop;
+
+    // the connection is opened without a request, only once per host
+    UpdateNode::NetworkSession::Instance()->warmUp(stub.url("/warm.txt"));
+    UpdateNode::NetworkSession::Instance()->warmUp(stub.url("/other.txt"));
+    for(int i = 0; i < 100 && stub.connections() == 0; i++)
+    {
+        QTimer::singleShot(10, &loop, SLOT(quit()));
+        loop.exec();
+    }
+    QVERIFY(stub.connections() == 1);
+    QVERIFY(stub.requests() == 0);
+
+    // the request is sent over the warmed up connection
+    QNetworkReply* reply = UpdateNode::NetworkSession::Instance()->get(QNetworkRequest(stub.url("/warm.txt")));
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(reply->readAll() == "warm");
+    reply->deleteLater();
+
+    QVERIFY(stub.requests() == 1);
+    QVERIFY(stub.connections() == 1);
+#endif
+}
+
+void ClientTest::test_download_queue()
+{
+    // only failures which may pass on their own are retried
+    QVERIFY(UpdateNode::DownloadJob::isTransient(QNetworkReply::RemoteHostClosedError));
+    QVERIFY(UpdateNode::DownloadJob::isTransient(QNetworkReply::TimeoutError));
+    QVERIFY(!UpdateNode::DownloadJob::isTransient(QNetworkReply::NoError));
+    QVERIFY(!UpdateNode::DownloadJob::isTransient(QNetworkReply::OperationCanceledError));
+    QVERIFY(!UpdateNode::DownloadJob::isTransient(QNetworkReply::HostNotFoundError));
+    QVERIFY(!UpdateNode::DownloadJob::isTransient(QNetworkReply::SslHandshakeFailedError));
+    QVERIFY(!UpdateNode::DownloadJob::isTransient(QNetworkReply::ContentNotFoundError));
+
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+
+    UpdateNode::DownloadQueue queue;
+    queue.setConcurrency(1);
+
+    QList<UpdateNode::Update> updates;
+    QList<UpdateNode::DownloadJob*> jobs;
+
+    for(int i = 0; i < 4; i++)
+    {
+        QString path = QString("/queue_%1.bin").arg(i);
+        stub.setPayload(QByteArray(16 * 1024, 'a' + i), path);
+
+        UpdateNode::Update update;
+        update.setCode(QString("download_queue_%1").arg(i));
+        update.setDownloadLink(stub.url(path).toString());
+        updates.append(update);
+
+        // the last job is queued with a higher priority and starts first
+        jobs.append(queue.enqueue(update, i == 3 ? 1 : 0));
+    }
+
+    // a queued job ends as canceled without being started
+    queue.cancel(jobs.at(2));
+    QVERIFY(jobs.at(2)->state() == UpdateNode::DownloadJob::CANCELED);
+    QVERIFY(jobs.at(2)->error() == QNetworkReply::OperationCanceledError);
+    QVERIFY(queue.jobs().size() == 3);
+
+    QEventLoop loop;
+    QList<UpdateNode::DownloadJob*> started;
+    foreach(UpdateNode::DownloadJob* job, queue.jobs())
+        QObject::connect(job, SIGNAL(stateChanged(UpdateNode::DownloadJob*)), &loop, SLOT(quit()));
+    QObject::connect(&queue, SIGNAL(allDone()), &loop, SLOT(quit()));
+    QTimer::singleShot(20000, &loop, SLOT(quit()));
+
+    while(queue.isBusy())
+    {
+        loop.exec();
+
+        QVERIFY(queue.running() <= 1);
+        foreach(UpdateNode::DownloadJob* job, queue.jobs())
+            if(job->state() == UpdateNode::DownloadJob::RUNNING && !started.contains(job))
+                started.append(job);
+    }
+
+    QVERIFY(started.size() == 3);
+    QVERIFY(started.at(0) == jobs.at(3));
+    QVERIFY(started.at(1) == jobs.at(0));
+    QVERIFY(started.at(2) == jobs.at(1));
+    QVERIFY(queue.jobs().isEmpty());
+
+    QVERIFY(!QFile::exists(UpdateNode::LocalFile::getUpdateLocation(updates.at(2))));
+    updates.removeAt(2);
+
+    foreach(UpdateNode::Update update, updates)
+        QVERIFY(QFile::remove(UpdateNode::LocalFile::getUpdateLocation(update)));
+}
+
+void ClientTest::test_transfer_stats()
+{
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setRateLimit(256 * 1024);
+
+    // one download after the other, the waiting one is counted with the size of the running one
+    UpdateNode::DownloadQueue queue;
+    queue.setConcurrency(1);
+    UpdateNode::TransferStats stats(&queue);
+
+    QList<UpdateNode::Update> updates;
+    for(int i = 0; i < 2; i++)
+    {
+        QString path = QString("/stats_%1.bin").arg(i);
+        stub.setPayload(QByteArray(256 * 1024, 'a' + i), path);
+
+        UpdateNode::Update update;
+        update.setCode(QString("transfer_stats_%1").arg(i));
+        update.setDownloadLink(stub.url(path).toString());
+        updates.append(update);
+
+        queue.enqueue(update);
+    }
+
+    QSignalSpy progress(&stats, SIGNAL(downloadProgress(qint64,qint64)));
+    double maxRate = 0;
+    bool etaKnown = false;
+
+    QEventLoop loop;
+    QObject::connect(&stats, SIGNAL(statsChanged()), &loop, SLOT(quit()));
+    QTimer::singleShot(20000, &loop, SLOT(quit()));
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    while(queue.isBusy())
+    {
+        loop.exec();
+        maxRate = qMax(maxRate, stats.smoothedRate());
+        etaKnown = etaKnown || stats.eta() >= 0;
+    }
+
+    // the progress is published at the capped rate, not on every chunk received
+    QVERIFY(progress.count() > 0);
+    QVERIFY2(progress.count() <= elapsed.elapsed() / UPDATENODE_STATS_INTERVAL + 2, qPrintable(QString::number(progress.count())));
+
+    // the overall progress completes, and includes both downloads
+    QList<QVariant> last = progress.last();
+    QVERIFY(last.at(0).toLongLong() == 2 * 256 * 1024);
+    QVERIFY(last.at(1).toLongLong() == 2 * 256 * 1024);
+    QVERIFY(stats.bytesReceived() == 2 * 256 * 1024);
+
+    // the overall progress never moves back when the next download starts
+    double fraction = 0;
+    for(int i = 0; i < progress.count(); i++)
+    {
+        if(progress.at(i).at(1).toLongLong() <= 0)
+            continue;
+
+        double current = (double)progress.at(i).at(0).toLongLong() / progress.at(i).at(1).toLongLong();
+        QVERIFY2(current >= fraction, qPrintable(QString("%1 < %2").arg(current).arg(fraction)));
+        fraction = current;
+    }
+
+    QVERIFY(maxRate > 0);
+    QVERIFY(etaKnown);
+    QVERIFY(stats.toString().isEmpty());
+
+    foreach(UpdateNode::Update update, updates)
+        QVERIFY(QFile::remove(UpdateNode::LocalFile::getUpdateLocation(update)));
+}
+
+void ClientTest::test_throttle()
+{
+    UpdateNode::Throttle* throttle = UpdateNode::Throttle::Instance();
+
+    // without a limit, everything is granted
+    throttle->setRate(0);
+    QVERIFY(throttle->acquire(1024 * 1024) == 1024 * 1024);
+
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+    stub.setPayload(QByteArray(1024 * 1024, 'x'));
+
+    UpdateNode::Update update;
+    update.setCode(QString("throttle_%1").arg(QDateTime::currentDateTime().toTime_t()));
+
+    // 1 MB at 512 KB/s, minus what is left in the read buffer of the reply when it finishes
+    throttle->setRate(512 * 1024);
+
+    UpdateNode::Downloader downloader;
+    QEventLoop loop;
+    QObject::connect(&downloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), &loop, SLOT(quit()));
+    QTimer::singleShot(20000, &loop, SLOT(quit()));
+
+    QElapsedTimer timer;
+    timer.start();
+    QNetworkReply* reply = downloader.doDownload(stub.url(), update);
+    QVERIFY(reply != NULL);
+    loop.exec();
+
+    QVERIFY2(timer.elapsed() >= 1000, qPrintable(QString::number(timer.elapsed())));
+    QString location = UpdateNode::LocalFile::getUpdateLocation(update);
+    QVERIFY(QFileInfo(location).size() == 1024 * 1024);
+    QVERIFY(QFile::remove(location));
+
+    // background downloads yield to running requests of the service
+    throttle->setRate(0);
+    throttle->setBackground(true);
+
+    QNetworkRequest request(stub.url());
+    QNetworkReply* foreground = UpdateNode::RequestScheduler::Instance()->get(request);
+    QVERIFY(throttle->isYielding());
+    QVERIFY(throttle->acquire(1024 * 1024) < 1024 * 1024);
+
+    QObject::connect(foreground, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    QVERIFY(!throttle->isYielding());
+    QVERIFY(throttle->acquire(1024 * 1024) == 1024 * 1024);
+
+    throttle->setBackground(false);
+    foreground->deleteLater();
+}
+
+void ClientTest::test_mirror_selection()
+{
+    UpdateNode::MirrorSelector* selector = UpdateNode::MirrorSelector::Instance();
+
+    // rewritten links come first
+    UpdateNode::Config::Instance()->setMirrorRewrites(QStringList() << "http://example.invalid/=http://cache.invalid/updates/");
+    QList<QUrl> candidates = selector->candidates(QUrl("http://example.invalid/files/setup.exe"),
+                                                  QStringList() << "http://mirror.invalid/setup.exe");
+    QVERIFY(candidates.size() == 3);
+    QVERIFY(candidates.at(0) == QUrl("http://cache.invalid/updates/files/setup.exe"));
+    QVERIFY(candidates.at(1) == QUrl("http://example.invalid/files/setup.exe"));
+    QVERIFY(candidates.at(2) == QUrl("http://mirror.invalid/setup.exe"));
+    UpdateNode::Config::Instance()->setMirrorRewrites(QStringList());
+
+    HttpStub slow;
+    HttpStub fast;
+    QVERIFY(slow.listen(QHostAddress::LocalHost));
+    QVERIFY(fast.listen(QHostAddress::LocalHost));
+    slow.setRateLimit(16 * 1024);
+    slow.setPayload(QByteArray(256 * 1024, 'm'), "/mirror.bin");
+    fast.setPayload(QByteArray(256 * 1024, 'm'), "/mirror.bin");
+
+    UpdateNode::Update update;
+    update.setCode(QString("mirror_%1").arg(QDateTime::currentDateTime().toTime_t()));
+    update.setDownloadLink(slow.url("/mirror.bin").toString());
+    update.addMirror(fast.url("/mirror.bin").toString());
+
+    QVERIFY(!selector->isKnown(slow.url()));
+    QVERIFY(!selector->isKnown(fast.url()));
+
+    UpdateNode::Downloader downloader;
+    QEventLoop loop;
+    QObject::connect(&downloader, SIGNAL(done(const UpdateNode::Update&, QNetworkReply::NetworkError, const QString&)), &loop, SLOT(quit()));
+    QTimer::singleShot(20000, &loop, SLOT(quit()));
+
+    // both mirrors are probed first, the file is downloaded from the faster one
+    QVERIFY(downloader.doDownload(QUrl(update.getDownloadLink()), update) == NULL);
+    loop.exec();
+
+    QVERIFY(selector->isKnown(slow.url()));
+    QVERIFY(selector->isKnown(fast.url()));
+    QVERIFY(selector->throughput(fast.url()) > selector->throughput(slow.url()));
+    QVERIFY(fast.requests() == 2);
+
+    QString location = UpdateNode::LocalFile::getUpdateLocation(update);
+    QVERIFY(QFileInfo(location).size() == 256 * 1024);
+    QVERIFY(QFile::remove(location));
+
+    // with both mirrors known, the faster one is chosen right away
+    int requests = slow.requests();
+    QVERIFY(downloader.doDownload(QUrl(update.getDownloadLink()), update) != NULL);
+    loop.exec();
+
+    QVERIFY(slow.requests() == requests);
+    QVERIFY(fast.requests() == 3);
+    QVERIFY(QFile::remove(UpdateNode::LocalFile::getUpdateLocation(update)));
+}
+
+void ClientTest::test_prefetcher()
+{
+    HttpStub stub;
+    QVERIFY(stub.listen(QHostAddress::LocalHost));
+
+    QList<UpdateNode::Update> updates;
+    for(int i = 0; i < 2; i++)
+    {
+        QString path = QString("/prefetch_%1.bin").arg(i);
+        stub.setPayload(QByteArray(32 * 1024, 'p' + i), path);
+
+        UpdateNode::Update update;
+        update.setCode(QString("prefetch_%1_%2").arg(i).arg(QDateTime::currentDateTime().toTime_t()));
+        update.setDownloadLink(stub.url(path).toString());
+        updates.append(update);
+    }
+
+    UpdateNode::Settings settings;
+    QVERIFY(!settings.isUpdateReady(updates.at(0)));
+
+    QEventLoop loop;
+    QTimer::singleShot(20000, &loop, SLOT(quit()));
+
+    // the updates are downloaded in background and marked as ready
+    UpdateNode::Prefetcher prefetcher;
+    QObject::connect(&prefetcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    prefetcher.start(updates);
+    loop.exec();
+
+    QVERIFY(UpdateNode::Throttle::Instance()->isBackground());
+    QVERIFY(prefetcher.ready() == 2);
+    QVERIFY(prefetcher.failed() == 0);
+    QVERIFY(settings.isUpdateReady(updates.at(0)));
+    QVERIFY(settings.isUpdateReady(updates.at(1)));
+
+    // ready updates are not transferred again
+    int requests = stub.requests();
+    UpdateNode::Prefetcher again;
+    QObject::connect(&again, SIGNAL(finished()), &loop, SLOT(quit()));
+    again.start(updates);
+    loop.exec();
+
+    QVERIFY(again.ready() == 2);
+    QVERIFY(stub.requests() == requests);
+
+    // a modified file is not ready anymore
+    QString location = UpdateNode::LocalFile::getUpdateLocation(updates.at(1));
+    QFile file(location);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("x");
+    file.close();
+    QVERIFY(!settings.isUpdateReady(updates.at(1)));
+
+    UpdateNode::Throttle::Instance()->setBackground(false);
+    foreach(UpdateNode::Update update, updates)
+    {
+        settings.setUpdateReady(update.getCode(), false);
+        QVERIFY(QFile::remove(UpdateNode::LocalFile::getUpdateLocation(update)));
+    }
+}
+
+void ClientTest::test_install_scheduler()
+{
+#ifndef Q_OS_WIN
+    qRegisterMetaType<QProcess::ExitStatus>("QProcess::ExitStatus");
+
+    UpdateNode::Update update;
+    update.setRequiresAdmin(false);
+    update.setCommand("/bin/sh");
+    update.setCommandLine("-c \"sleep 1\"");
+    update.setIndependent(true);
+
+    UpdateNode::InstallScheduler scheduler;
+    scheduler.setConcurrency(2);
+
+    QSignalSpy started(&scheduler, SIGNAL(started(int)));
+    QSignalSpy finished(&scheduler, SIGNAL(finished(int, int, QProcess::ExitStatus)));
+
+    int first = scheduler.add(update, "product_a");
+    int second = scheduler.add(update, "product_a");
+    int third = scheduler.add(update, "product_b");
+
+    // the second update of a product waits for the first one, even if it is ready before
+    scheduler.setReady(second);
+    scheduler.setReady(third);
+    QTest::qWait(200);
+    QVERIFY2(started.count() == 1, qPrintable(QString::number(started.count())));
+    QVERIFY(started.at(0).at(0).toInt() == third);
+
+    // independent updates of different products run at the same time
+    scheduler.setReady(first);
+    QTest::qWait(200);
+    QVERIFY(started.count() == 2);
+    QVERIFY(scheduler.running() == 2);
+
+    QElapsedTimer timer;
+    timer.start();
+    while(scheduler.isBusy() && timer.elapsed() < 10000)
+        QTest::qWait(50);
+
+    QVERIFY(finished.count() == 3);
+    QVERIFY(started.at(2).at(0).toInt() == second);
+    foreach(QList<QVariant> arguments, finished)
+        QVERIFY(arguments.at(1).toInt() == 0);
+
+    // an update, which is not independent, waits for all updates before it
+    UpdateNode::Update serial = update;
+    serial.setIndependent(false);
+
+    started.clear();
+    scheduler.setReady(scheduler.add(update, "product_a"));
+    scheduler.setReady(scheduler.add(serial, "product_b"));
+    QTest::qWait(200);
+    QVERIFY(started.count() == 1);
+    QVERIFY(scheduler.running() == 1);
+
+    // waiting updates are dropped on stop, the running one finishes
+    scheduler.stop();
+    timer.restart();
+    while(scheduler.isBusy() && timer.elapsed() < 10000)
+        QTest::qWait(50);
+
+    QVERIFY(started.count() == 1);
+    QVERIFY(finished.count() == 4);
+#endif
+}
+
+void ClientTest::test_helper_session()
+{
+    // the client side of UpdateNode::ElevatedHelper, the session runs unelevated here
+    QLocalServer server;
+    QVERIFY(server.listen(QString("unclient-test-%1").arg(QDateTime::currentDateTime().toTime_t())));
+
+    UpdateNode::HelperSession session;
+    QSignalSpy finished(&session, SIGNAL(finished()));
+    QVERIFY(session.connectToClient(server.fullServerName(), "token"));
+    QVERIFY(server.waitForNewConnection(5000));
+
+    QLocalSocket* socket = server.nextPendingConnection();
+    QByteArray message;
+    QElapsedTimer timer;
+    timer.start();
+    while(!UpdateNode::ElevatedHelper::receive(socket, message) && timer.elapsed() < 5000)
+        QTest::qWait(20);
+
+    qint32 type;
+    qint32 request;
+    QString token;
+    QDataStream hello(message);
+    hello >> type >> token;
+    QVERIFY(type == UpdateNode::ElevatedHelper::MSG_HELLO);
+    QVERIFY(token == "token");
+
+    QFile source("helper_source.txt");
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    source.write("copied by the helper");
+    source.close();
+
+    // copy and chmod are answered by the session itself
+    QByteArray copy;
+    QDataStream copyStream(&copy, QIODevice::WriteOnly);
+    copyStream << (qint32)UpdateNode::ElevatedHelper::MSG_COPY << (qint32)1 << QString("helper_source.txt") << QString("helper_target.txt");
+    UpdateNode::ElevatedHelper::send(socket, copy);
+
+    QByteArray chmod;
+    QDataStream chmodStream(&chmod, QIODevice::WriteOnly);
+    chmodStream << (qint32)UpdateNode::ElevatedHelper::MSG_CHMOD << (qint32)2 << QString("helper_target.txt")
+                << (qint32)(QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner | QFile::ReadUser | QFile::WriteUser | QFile::ExeUser);
+    UpdateNode::ElevatedHelper::send(socket, chmod);
+
+    for(int i = 1; i <= 2; i++)
+    {
+        timer.restart();
+        while(!UpdateNode::ElevatedHelper::receive(socket, message) && timer.elapsed() < 5000)
+            QTest::qWait(20);
+
+        qint32 exitCode;
+        QDataStream result(message);
+        result >> type >> request >> exitCode;
+        QVERIFY(type == UpdateNode::ElevatedHelper::MSG_FINISHED);
+        QVERIFY(request == i);
+        QVERIFY2(exitCode == 0, qPrintable(QString::number(exitCode)));
+    }
+
+    QFile target("helper_target.txt");
+    QVERIFY(target.open(QIODevice::ReadOnly));
+    QVERIFY(target.readAll() == "copied by the helper");
+    target.close();
+    QVERIFY(target.permissions() & QFile::ExeOwner);
+
+    QVERIFY(QFile::remove("helper_source.txt"));
+    QVERIFY(QFile::remove("helper_target.txt"));
+
+    // the session ends once the client has disconnected
+    socket->disconnectFromServer();
+    timer.restart();
+    while(finished.count() == 0 && timer.elapsed() < 5000)
+        QTest::qWait(20);
+    QVERIFY(finished.count() == 1);
+}
+
+void ClientTest::test_helper_idle()
+{
+#ifdef UPDATENODE_HELPER_SUPPORTED
+    qRegisterMetaType<QProcess::ExitStatus>("QProcess::ExitStatus");
+
+    // stands in for pkexec: records the helper arguments, the session is run by the test itself
+    QFile elevator("helper-pkexec.sh");
+    QVERIFY(elevator.open(QIODevice::WriteOnly));
+    elevator.write("#!/bin/sh\necho \"$3 $4\" > helper_elevator.txt\n"
+                   "while [ ! -f helper_elevator.stop ]; do sleep 0.1; done\n");
+    elevator.close();
+    QVERIFY(elevator.setPermissions(elevator.permissions() | QFile::ExeOwner | QFile::ExeUser));
+    QFile::remove("helper_elevator.stop");
+
+    QFile file("helper_idle.txt");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    UpdateNode::ElevatedHelper helper;
+    QSignalSpy finished(&helper, SIGNAL(finished(int, int, QProcess::ExitStatus)));
+    QElapsedTimer timer;
+
+    // the second request comes after the first helper has gone idle, and starts a new one
+    for(int i = 0; i < 2; i++)
+    {
+        QFile::remove("helper_elevator.txt");
+        QVERIFY(helper.start(QFileInfo(elevator).absoluteFilePath()));
+        QVERIFY(helper.isRunning());
+        int request = helper.chmod("helper_idle.txt", QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser | QFile::WriteUser);
+
+        QFile arguments("helper_elevator.txt");
+        timer.start();
+        while(arguments.size() == 0 && timer.elapsed() < 5000)
+            QTest::qWait(20);
+        QVERIFY(arguments.open(QIODevice::ReadOnly));
+        QStringList helperArguments = QString::fromLocal8Bit(arguments.readAll()).trimmed().split(" ");
+        arguments.close();
+        QVERIFY(helperArguments.size() == 2);
+
+        // the token is passed in a file only the user can read
+        QFile tokenFile(helperArguments.at(1));
+        QVERIFY(tokenFile.permissions() & QFile::ReadOwner);
+        QVERIFY(!(tokenFile.permissions() & (QFile::ReadGroup | QFile::ReadOther)));
+        QVERIFY(tokenFile.open(QIODevice::ReadOnly));
+        QString token = QString::fromLatin1(tokenFile.readAll());
+        tokenFile.close();
+
+        UpdateNode::HelperSession session;
+        session.setIdleTimeout(200);
+        QSignalSpy sessionFinished(&session, SIGNAL(finished()));
+        QVERIFY(session.connectToClient(helperArguments.at(0), token));
+        QVERIFY(!token.isEmpty() && !helperArguments.contains(token));
+
+        timer.restart();
+        while(finished.count() < i + 1 && timer.elapsed() < 5000)
+            QTest::qWait(20);
+        QVERIFY(finished.count() == i + 1);
+        QVERIFY(finished.last().at(0).toInt() == request);
+        QVERIFY(finished.last().at(1).toInt() == 0);
+
+        timer.restart();
+        while((sessionFinished.count() == 0 || helper.isRunning()) && timer.elapsed() < 5000)
+            QTest::qWait(20);
+        QVERIFY(sessionFinished.count() == 1);
+        QVERIFY(!helper.isRunning());
+    }
+
+    QFile stop("helper_elevator.stop");
+    QVERIFY(stop.open(QIODevice::WriteOnly));
+    stop.close();
+
+    QTest::qWait(300);
+    QVERIFY(QFile::remove("helper_elevator.stop"));
+    QVERIFY(QFile::remove("helper_elevator.txt"));
+    QVERIFY(QFile::remove("helper_idle.txt"));
+    QVERIFY(elevator.remove());
+#endif
+}
+
+void ClientTest::test_file_copier()
+{
+    QFile source("copier_source.bin");
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    source.write(QByteArray(3 * UPDATENODE_COPY_BUFFER + 17, 'c'));
+    source.close();
+    QVERIFY(source.setPermissions(source.permissions() | QFile::ExeOwner));
+
+    QFile target("copier_target.bin");
+    QVERIFY(target.open(QIODevice::WriteOnly));
+    target.write("old version");
+    target.close();
+
+    QList<UpdateNode::FileCopier::Strategy> strategies;
+    strategies << UpdateNode::FileCopier::STRATEGY_AUTO << UpdateNode::FileCopier::STRATEGY_CLONE << UpdateNode::FileCopier::STRATEGY_COPY_RANGE
+               << UpdateNode::FileCopier::STRATEGY_SENDFILE << UpdateNode::FileCopier::STRATEGY_BUFFERED;
+
+    foreach(UpdateNode::FileCopier::Strategy strategy, strategies)
+    {
+        QFile::remove("copier_target.bin");
+        QVERIFY(target.open(QIODevice::WriteOnly));
+        target.write("old version");
+        target.close();
+
+        UpdateNode::FileCopier copier("copier_source.bin", "copier_target.bin");
+        if(!copier.copy(strategy))
+        {
+            // not every file system supports every strategy, a failed copy leaves the old file
+            QVERIFY2(strategy == UpdateNode::FileCopier::STRATEGY_CLONE || strategy == UpdateNode::FileCopier::STRATEGY_COPY_RANGE
+                     || strategy == UpdateNode::FileCopier::STRATEGY_SENDFILE, qPrintable(copier.errorString()));
+            QVERIFY(QFileInfo("copier_target.bin").size() == 11);
+            continue;
+        }
+
+        QVERIFY(strategy == UpdateNode::FileCopier::STRATEGY_AUTO || copier.strategy() == strategy);
+        QVERIFY2(QFileInfo("copier_target.bin").size() == QFileInfo("copier_source.bin").size(), qPrintable(UpdateNode::FileCopier::strategyName(copier.strategy())));
+        QVERIFY(QFile::permissions("copier_target.bin") == QFile::permissions("copier_source.bin"));
+    }
+
+    // no temporary files are left behind
+    QVERIFY(QDir().entryList(QStringList() << ".copier_target.bin.*", QDir::Files | QDir::Hidden).isEmpty());
+
+    // a missing source does not touch the destination
+    UpdateNode::FileCopier missing("copier_missing.bin", "copier_target.bin");
+    QVERIFY(!missing.copy());
+    QVERIFY(QFile::exists("copier_target.bin"));
+
+    QVERIFY(QFile::remove("copier_source.bin"));
+    QVERIFY(QFile::remove("copier_target.bin"));
+}
+
+void ClientTest::test_file_copier_benchmark()
+{
+    // writes 128 MB per strategy, so it is opt-in: set UPDATENODE_BENCHMARK to compare the strategies
+    if(qgetenv("UPDATENODE_BENCHMARK").isEmpty())
+        UPDATENODE_SKIP("set UPDATENODE_BENCHMARK to run");
+
+    QByteArray chunk(UPDATENODE_COPY_BUFFER, 'b');
+    QFile source("copier_benchmark.bin");
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    for(int i = 0; i < 128; i++)
+        source.write(chunk);
+    source.close();
+
+    QList<UpdateNode::FileCopier::Strategy> strategies;
+    strategies << UpdateNode::FileCopier::STRATEGY_CLONE << UpdateNode::FileCopier::STRATEGY_COPY_RANGE
+               << UpdateNode::FileCopier::STRATEGY_SENDFILE << UpdateNode::FileCopier::STRATEGY_BUFFERED;
+
+    foreach(UpdateNode::FileCopier::Strategy strategy, strategies)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        UpdateNode::FileCopier copier("copier_benchmark.bin", "copier_benchmark.copy");
+        if(!copier.copy(strategy))
+        {
+            qDebug() << UpdateNode::FileCopier::strategyName(strategy) << "not supported:" << copier.errorString();
+            continue;
+        }
+
+        qDebug() << UpdateNode::FileCopier::strategyName(strategy) << ":" << 128.0 * 1000 / qMax((qint64)1, timer.elapsed()) << "MB/s";
+        QVERIFY(QFileInfo("copier_benchmark.copy").size() == 128 * UPDATENODE_COPY_BUFFER);
+        QVERIFY(QFile::remove("copier_benchmark.copy"));
+    }
+
+    QVERIFY(QFile::remove("copier_benchmark.bin"));
+}
+
+void ClientTest::test_archive_extractor()
+{
+    QByteArray tar = tarEntry("bundle/", QByteArray(), '5') + tarEntry("bundle/readme.txt", "hello archive")
+            + tarEntry("bundle/bin/tool", QByteArray(1500, 't'), '0', 0755) + QByteArray(1024, '\0');
+
+    UpdateNode::ArchiveExtractor::removeTree("extract_target");
+
+    // small chunks split headers and data, as a download does
+    UpdateNode::ArchiveExtractor extractor("extract_target");
+    for(int i = 0; i < tar.size(); i += 7)
+        QVERIFY(extractor.write(tar.mid(i, 7)));
+    QVERIFY2(extractor.finish(), qPrintable(extractor.errorString()));
+    QVERIFY(extractor.format() == UpdateNode::ArchiveExtractor::FORMAT_TAR);
+    QCOMPARE(extractor.entries(), 3);
+
+    QFile readme("extract_target/bundle/readme.txt");
+    QVERIFY(readme.open(QIODevice::ReadOnly));
+    QCOMPARE(readme.readAll(), QByteArray("hello archive"));
+    readme.close();
+    QCOMPARE(QFileInfo("extract_target/bundle/bin/tool").size(), Q_INT64_C(1500));
+#ifdef Q_OS_UNIX
+    QVERIFY(QFile::permissions("extract_target/bundle/bin/tool") & QFile::ExeOwner);
+#endif
+    // no temporary files are left behind
+    QVERIFY(QDir("extract_target/bundle").entryList(QStringList() << ".readme.txt.*", QDir::Files | QDir::Hidden).isEmpty());
+
+#ifdef UPDATENODE_ZLIB
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    QVERIFY(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    QByteArray gzip(deflateBound(&stream, tar.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(tar.data());
+    stream.avail_in = tar.size();
+    stream.next_out = reinterpret_cast<Bytef*>(gzip.data());
+    stream.avail_out = gzip.size();
+    QVERIFY(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    gzip.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    UpdateNode::ArchiveExtractor gzipExtractor("extract_gzip");
+    for(int i = 0; i < gzip.size(); i += 3)
+        QVERIFY(gzipExtractor.write(gzip.mid(i, 3)));
+    QVERIFY2(gzipExtractor.finish(), qPrintable(gzipExtractor.errorString()));
+    QVERIFY(gzipExtractor.format() == UpdateNode::ArchiveExtractor::FORMAT_TAR_GZ);
+    QCOMPARE(QFileInfo("extract_gzip/bundle/bin/tool").size(), Q_INT64_C(1500));
+    QVERIFY(UpdateNode::ArchiveExtractor::removeTree("extract_gzip"));
+#endif
+
+    // entries outside of the target directory are rejected
+    QVERIFY(!UpdateNode::ArchiveExtractor::isSafePath("../escape.txt"));
+    QVERIFY(!UpdateNode::ArchiveExtractor::isSafePath("bundle/../../escape.txt"));
+    QVERIFY(!UpdateNode::ArchiveExtractor::isSafePath("/etc/passwd"));
+    QVERIFY(!UpdateNode::ArchiveExtractor::isSafePath("C:\\Windows\\escape.txt"));
+    QVERIFY(!UpdateNode::ArchiveExtractor::isSafePath("bundle\\..\\..\\escape.txt"));
+    QVERIFY(UpdateNode::ArchiveExtractor::isSafePath("bundle/file..txt"));
+
+    UpdateNode::ArchiveExtractor unsafe("extract_target");
+    QVERIFY(!unsafe.write(tarEntry("../escape.txt", "escaped")));
+    QVERIFY(!unsafe.finish());
+    QVERIFY(!QFile::exists("escape.txt"));
+
+    // a zip archive, extracted by the built-in extract command
+    QByteArray zip = zipEntry("docs/", QByteArray()) + zipEntry("docs/note.txt", "zipped content")
+            + QByteArray("PK\x05\x06") + QByteArray(18, '\0');
+    QFile archive("extract_archive.zip");
+    QVERIFY(archive.open(QIODevice::WriteOnly));
+    archive.write(zip);
+    archive.close();
+
+    // files extracted while downloading are only moved in place
+    QVERIFY(QDir().mkpath("extract_archive.zip" UPDATENODE_EXTRACT_SUFFIX "/staged"));
+    QFile staged("extract_archive.zip" UPDATENODE_EXTRACT_SUFFIX "/staged/file.txt");
+    QVERIFY(staged.open(QIODevice::WriteOnly));
+    staged.write("staged");
+    staged.close();
+
+    QVERIFY(UpdateNode::Commander::extract("extract_archive.zip", "extract_target"));
+    QVERIFY(QFile::exists("extract_target/staged/file.txt"));
+    QVERIFY(!QFile::exists("extract_target/docs/note.txt"));
+    QVERIFY(!QFileInfo("extract_archive.zip" UPDATENODE_EXTRACT_SUFFIX).exists());
+
+#ifdef Q_OS_UNIX
+    mode_t mask = ::umask(022);
+#endif
+    QVERIFY(UpdateNode::Commander::extract("extract_archive.zip", "extract_target"));
+    QFile note("extract_target/docs/note.txt");
+    QVERIFY(note.open(QIODevice::ReadOnly));
+    QCOMPARE(note.readAll(), QByteArray("zipped content"));
+    note.close();
+
+    // the zip entry carries no permissions, it gets the usual ones instead of those of its temporary file
+#ifdef Q_OS_UNIX
+    ::umask(mask);
+    QVERIFY(note.permissions() & QFile::ReadOther);
+    QVERIFY(note.permissions() & QFile::WriteOwner);
+    QVERIFY(!(note.permissions() & QFile::WriteOther));
+#endif
+
+    // a truncated archive fails
+    QVERIFY(archive.open(QIODevice::WriteOnly));
+    archive.write(zip.left(40));
+    archive.close();
+    QVERIFY(!UpdateNode::Commander::extract("extract_archive.zip", "extract_target"));
+
+    QVERIFY(QFile::remove("extract_archive.zip"));
+    QVERIFY(UpdateNode::ArchiveExtractor::removeTree("extract_target"));
+}
+
+/*!
+Returns a POSIX tar entry \a aName of type \a aType with content \a aData, padded to the block size
+*/
+QByteArray ClientTest::tarEntry(const QString& aName, const QByteArray& aData, char aType, int aMode)
+{
+    QByteArray header(512, '\0');
+    QByteArray name = aName.toUtf8();
+
+    header.replace(0, name.size(), name);
+    header.replace(100, 8, QByteArray::number(aMode, 8).rightJustified(7, '0') + '\0');
+    header.replace(108, 8, QByteArray("0000000") + '\0');
+    header.replace(116, 8, QByteArray("0000000") + '\0');
+    header.replace(124, 12, QByteArray::number(aData.size(), 8).rightJustified(11, '0') + '\0');
+    header.replace(136, 12, QByteArray("00000000000") + '\0');
+    header[156] = aType;
+    header.replace(257, 8, QByteArray("ustar\0" "00", 8));
+
+    int sum = 8 * ' ';
+    for(int i = 0; i < header.size(); i++)
+        if(i < 148 || i >= 156)
+            sum += (uchar)header.at(i);
+    header.replace(148, 8, QByteArray::number(sum, 8).rightJustified(6, '0') + '\0' + ' ');
+
+    return header + aData + QByteArray((512 - aData.size() % 512) % 512, '\0');
+}
+
+/*!
+Returns a stored zip entry \a aName with content \a aData
+*/
+QByteArray ClientTest::zipEntry(const QString& aName, const QByteArray& aData)
+{
+    QByteArray name = aName.toUtf8();
+    quint32 crc = 0xffffffff;
+
+    for(int i = 0; i < aData.size(); i++)
+    {
+        crc ^= (uchar)aData.at(i);
+        for(int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+    }
+
+    QByteArray entry;
+    QDataStream stream(&entry, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << (quint32)0x04034b50 << (quint16)20 << (quint16)0x0800 << (quint16)0 << (quint16)0 << (quint16)0
+           << (quint32)~crc << (quint32)aData.size() << (quint32)aData.size() << (quint16)name.size() << (quint16)0;
+    stream.writeRawData(name.constData(), name.size());
+    stream.writeRawData(aData.constData(), aData.size());
+
+    return entry;
+}
+
 void ClientTest::test_localfile_location()
 {
     QString tempPath = QDir::tempPath() + QDir::separator() + "UpdateNode" + QDir::separator() + UpdateNode::Config::Instance()->getKeyHashed();
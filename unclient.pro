@@ -21,7 +21,6 @@
 ##############################################################################
 
 QT = network \
-    xml \
     gui \
     core 
 
@@ -106,7 +105,27 @@ SOURCES += src/main.cpp \
     src/textbrowser.cpp \
     src/wincommander.cpp \
     src/limittimer.cpp \
-    src/binarysettings.cpp
+    src/binarysettings.cpp \
+    src/partfile.cpp \
+    src/segmenteddownload.cpp \
+    src/cachemanager.cpp \
+    src/patcher.cpp \
+    src/networksession.cpp \
+    src/responsecache.cpp \
+    src/requestscheduler.cpp \
+    src/scheduledreply.cpp \
+    src/downloadjob.cpp \
+    src/downloadqueue.cpp \
+    src/transferstats.cpp \
+    src/throttle.cpp \
+    src/mirrorselector.cpp \
+    src/mirrorprobe.cpp \
+    src/prefetcher.cpp \
+    src/elevatedhelper.cpp \
+    src/helpersession.cpp \
+    src/installscheduler.cpp \
+    src/filecopier.cpp \
+    src/archiveextractor.cpp
 
 macx:SOURCES += src/maccommander.cpp
 macx:HEADERS += inc/maccommander.h
@@ -137,7 +156,27 @@ HEADERS += \
     inc/textbrowser.h \
     inc/wincommander.h \
     inc/limittimer.h \
-    inc/binarysettings.h
+    inc/binarysettings.h \
+    inc/partfile.h \
+    inc/segmenteddownload.h \
+    inc/cachemanager.h \
+    inc/patcher.h \
+    inc/networksession.h \
+    inc/responsecache.h \
+    inc/requestscheduler.h \
+    inc/scheduledreply.h \
+    inc/downloadjob.h \
+    inc/downloadqueue.h \
+    inc/transferstats.h \
+    inc/throttle.h \
+    inc/mirrorselector.h \
+    inc/mirrorprobe.h \
+    inc/prefetcher.h \
+    inc/elevatedhelper.h \
+    inc/helpersession.h \
+    inc/installscheduler.h \
+    inc/filecopier.h \
+    inc/archiveextractor.h
 
 FORMS += \
     forms/singleappdialog.ui \
@@ -161,6 +200,17 @@ QMAKE_LFLAGS_WINDOWS += /MANIFESTUAC:level=\'asInvoker\'
 CONFIG += embed_manifest_exe
 }
 
+### zlib is needed for tar.gz archives and deflated zip entries of UpdateNode::ArchiveExtractor
+### on Windows, build with CONFIG+=zlib and zlib in the include and library path to enable them
+unix{
+DEFINES += UPDATENODE_ZLIB
+LIBS += -lz
+}
+win32:zlib{
+DEFINES += UPDATENODE_ZLIB
+LIBS += zlib.lib
+}
+
 ### when deploying, always generate new qm files
 updateqm.commands = lrelease unclient.pro
 updateqm.target = updateqm
@@ -206,7 +256,7 @@ create_package_deploy.commands = $(MKDIR) package
 create_package_deploy.target = create_package_deploy
 
 greaterThan(QT_MAJOR_VERSION, 4){
-qt_deploy.commands = windeployqt -xml -core -network -widgets -webkitwidgets --no-quick-import --no-translations --no-system-d3d-compiler --no-webkit2 --dir package release\\unclient.exe
+qt_deploy.commands = windeployqt -core -network -widgets -webkitwidgets --no-quick-import --no-translations --no-system-d3d-compiler --no-webkit2 --dir package release\\unclient.exe
 qt_deploy.target = qt_deploy
 }
 
@@ -217,15 +267,13 @@ qtgui_deploy.commands = $(COPY) "%QTDIR%\\bin\\qtgui4.dll" package
 qtgui_deploy.target = qtgui_deploy
 qtnetwork_deploy.commands = $(COPY) "%QTDIR%\\bin\\qtnetwork4.dll" package
 qtnetwork_deploy.target = qtnetwork_deploy
-qtxml_deploy.commands = $(COPY) "%QTDIR%\\bin\\qtxml4.dll" package
-qtxml_deploy.target = qtxml_deploy
 }
 
 ssl_package_deploy.commands = $(COPY) c:\\OpenSSL-Win32\\libeay32.dll package && $(COPY) c:\\OpenSSL-Win32\\ssleay32.dll package
 ssl_package_deploy.target = ssl_package_deploy
 
 lessThan(QT_MAJOR_VERSION, 5){
-package_deploy.depends = clean_package_deploy create_package_deploy qtcore_deploy qtgui_deploy qtnetwork_deploy qtxml_deploy qtwebkit_deploy ssl_package_deploy copy_binary vc_deploy
+package_deploy.depends = clean_package_deploy create_package_deploy qtcore_deploy qtgui_deploy qtnetwork_deploy qtwebkit_deploy ssl_package_deploy copy_binary vc_deploy
 }
 greaterThan(QT_MAJOR_VERSION, 4){
 package_deploy.depends = clean_package_deploy create_package_deploy qt_deploy ssl_package_deploy copy_binary vc_deploy
@@ -243,7 +291,7 @@ build_installer.target = build_installer
 copy_binary.commands = $(COPY) release\\unclient.exe package
 copy_binary.target = copy_binary
 
-QMAKE_EXTRA_TARGETS += copy_binary build_installer package_deploy clean_package_deploy create_package_deploy qt_deploy qtcore_deploy qtgui_deploy qtnetwork_deploy qtxml_deploy qtwebkit_deploy ssl_package_deploy vc_deploy
+QMAKE_EXTRA_TARGETS += copy_binary build_installer package_deploy clean_package_deploy create_package_deploy qt_deploy qtcore_deploy qtgui_deploy qtnetwork_deploy qtwebkit_deploy ssl_package_deploy vc_deploy
 }
 }
 